@@ -0,0 +1,97 @@
+/**
+ * @file ex_animated_culling.cpp
+ * @brief A node moved by an Animator into and out of the view, drawn with drawSceneGraphNodeCulled.
+ *        It renders without a window and checks that culling follows the animated transforms.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <ciso646>
+#include <glad/glad.h>
+#include <grafica/basic_shapes.h>
+#include <grafica/easy_shaders.h>
+#include <grafica/gpu_shape.h>
+#include <grafica/scene_graph.h>
+#include <grafica/transformations.h>
+#include <grafica/offscreen_context.h>
+#include <grafica/animation.h>
+#include <grafica/culling.h>
+
+namespace gr = Grafica;
+namespace tr = Grafica::Transformations;
+
+// Usage: ex_animated_culling
+// Returns 1 if a frame culls the cube while it is in view, or draws it while it is out of view.
+
+constexpr unsigned int WIDTH = 320;
+constexpr unsigned int HEIGHT = 240;
+
+int main()
+{
+    gr::OffscreenContext context(WIDTH, HEIGHT);
+    std::cout << context.description() << std::endl;
+
+    gr::ModelViewProjectionShaderProgram pipeline;
+    auto cubeShapePtr = std::make_shared<gr::GPUShape>(gr::toGPUShape(pipeline, gr::createColorCube(1, 0.5f, 0)));
+
+    // The animated node starts far to the right, out of the view
+    auto rootPtr = std::make_shared<gr::SceneGraphNode>("root");
+    auto moverPtr = std::make_shared<gr::SceneGraphNode>("mover", tr::translate(100, 0, 0));
+    moverPtr->addChild(std::make_shared<gr::SceneGraphNode>("cube", tr::identity(), cubeShapePtr));
+    rootPtr->addChild(moverPtr);
+
+    // In view at t = 1, out of view again at t = 2
+    gr::AnimationClip clip("enterAndLeave");
+    gr::ChannelIndex const channel = clip.addChannel("mover");
+    clip.setTranslationKeys(channel, {0, 1, 2}, {gr::Vector3f(100, 0, 0), gr::Vector3f(0, 0, 0), gr::Vector3f(-100, 0, 0)});
+
+    gr::Animator animator({"mover"});
+    gr::LayerIndex const layer = animator.addClip(clip, 1.0f, false);
+    std::vector<gr::SceneGraphNodePtr> const animatedNodes = {moverPtr};
+
+    gr::Matrix4f const projection = tr::perspective(45, float(WIDTH) / float(HEIGHT), 0.1f, 100);
+    gr::Matrix4f const view = tr::lookAt(gr::Vector3f(0, -10, 0), gr::Vector3f(0, 0, 0), gr::Vector3f(0, 0, 1));
+
+    glUseProgram(pipeline.shaderProgram);
+    glUniformMatrix4fv(glGetUniformLocation(pipeline.shaderProgram, "projection"), 1, GL_FALSE, projection.data());
+    glUniformMatrix4fv(glGetUniformLocation(pipeline.shaderProgram, "view"), 1, GL_FALSE, view.data());
+    glEnable(GL_DEPTH_TEST);
+
+    gr::CullingContext cullingContext;
+    bool passed = true;
+
+    // The bounds are first computed with the cube out of view, then every frame must see the animated position
+    for (float const time : {0.0f, 1.0f, 2.0f})
+    {
+        animator.setTime(layer, time);
+        animator.evaluate();
+        animator.apply(animatedNodes);
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        cullingContext.reset(projection, view);
+        gr::drawSceneGraphNodeCulled(rootPtr, pipeline, "model", cullingContext);
+
+        bool const expectedVisible = time == 1.0f;
+        bool const visible = cullingContext.stats.visibleTriangles > 0;
+        std::cout << "t = " << time << ": " << cullingContext.stats
+            << (visible == expectedVisible ? "" : " WRONG") << std::endl;
+        passed = passed and visible == expectedVisible;
+    }
+
+    // freeing GPU memory
+    cubeShapePtr->clear();
+
+    if (not passed)
+    {
+        std::cout << "ERROR::EX_ANIMATED_CULLING::STALE_BOUNDS" << std::endl;
+        return 1;
+    }
+    std::cout << "Culling followed the animation" << std::endl;
+
+    return 0;
+}
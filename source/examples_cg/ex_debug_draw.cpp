@@ -0,0 +1,213 @@
+/**
+ * @file ex_debug_draw.cpp
+ * @brief Bounds of every node of a cube city, a second camera frustum, axes and rays drawn with DebugDraw.
+ *        It renders without a window and compares against creating a GPUShape for each debug item.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <numbers>
+#include <ciso646>
+#include <glad/glad.h>
+#include <grafica/shape.h>
+#include <grafica/basic_shapes.h>
+#include <grafica/easy_shaders.h>
+#include <grafica/gpu_shape.h>
+#include <grafica/bounds.h>
+#include <grafica/transformations.h>
+#include <grafica/offscreen_context.h>
+#include <grafica/debug_draw.h>
+
+namespace gr = Grafica;
+namespace tr = Grafica::Transformations;
+
+// Usage: ex_debug_draw [output.png]
+
+constexpr unsigned int WIDTH = 1280;
+constexpr unsigned int HEIGHT = 720;
+constexpr unsigned int GRID_SIZE = 40;
+constexpr unsigned int FRAMES = 30;
+
+// Uploading a GPUShape for each item is slow, so the comparison uses fewer of them
+constexpr std::size_t SINGLE_SHAPE_BOXES = 1000;
+
+// The edges of a box as a shape for GL_LINES, the way debug geometry was drawn before DebugDraw
+gr::Shape createWireBox(const gr::AABB& aabb, gr::Coord r, gr::Coord g, gr::Coord b)
+{
+    gr::Shape shape(6);
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        shape.vertices.insert(shape.vertices.end(), {
+            i & 1 ? aabb.max[0] : aabb.min[0],
+            i & 2 ? aabb.max[1] : aabb.min[1],
+            i & 4 ? aabb.max[2] : aabb.min[2],
+            r, g, b});
+    }
+
+    for (unsigned int i = 0; i < 8; ++i)
+        for (unsigned int bit : {1u, 2u, 4u})
+            if (not (i & bit))
+                shape.indices.insert(shape.indices.end(), {i, i | bit});
+
+    return shape;
+}
+
+int main(int argc, char** argv)
+{
+    std::string const outputPath = argc > 1 ? argv[1] : "debug_draw.png";
+
+    gr::OffscreenContext context(WIDTH, HEIGHT);
+    std::cout << context.description() << std::endl;
+
+    gr::ModelViewProjectionShaderProgram scenePipeline;
+    gr::GPUShape gpuCube = gr::toGPUShape(scenePipeline, gr::createColorCube(0.45f, 0.45f, 0.5f));
+    gr::AABB const unitCube{gr::Vector3f(-0.5f, -0.5f, -0.5f), gr::Vector3f(0.5f, 0.5f, 0.5f)};
+
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<float> distribution(0, 1);
+
+    std::vector<gr::Matrix4f> models;
+    for (unsigned int x = 0; x < GRID_SIZE; ++x)
+    {
+        for (unsigned int y = 0; y < GRID_SIZE; ++y)
+        {
+            float const height = 0.2f + 1.5f * distribution(generator);
+            models.push_back(tr::translate(x - GRID_SIZE / 2.0f + 0.5f, y - GRID_SIZE / 2.0f + 0.5f, height / 2)
+                * tr::rotationZ(distribution(generator))
+                * tr::scale(0.6f, 0.6f, height));
+        }
+    }
+
+    gr::Matrix4f const projection = tr::perspective(45, float(WIDTH) / float(HEIGHT), 0.1f, 100);
+    gr::Matrix4f const view = tr::lookAt(gr::Vector3f(24, 18, 16), gr::Vector3f(0, 0, 0), gr::Vector3f(0, 0, 1));
+
+    // A second camera, whose frustum is drawn
+    gr::Matrix4f const otherProjection = tr::perspective(30, 1.5f, 1, 12);
+    gr::Matrix4f const otherView = tr::lookAt(gr::Vector3f(-14, -14, 6), gr::Vector3f(0, 0, 0), gr::Vector3f(0, 0, 1));
+
+    gr::DebugDrawShaderProgram debugPipeline;
+    gr::DebugDrawBuffer debugDrawBuffer = gr::toDebugDrawBuffer(debugPipeline);
+    gr::DebugDraw debugDraw;
+
+    for (GLuint shaderProgram : {scenePipeline.shaderProgram, debugPipeline.shaderProgram})
+    {
+        glUseProgram(shaderProgram);
+        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, projection.data());
+        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, view.data());
+    }
+
+    glClearColor(0.1f, 0.1f, 0.12f, 1.0f);
+    glEnable(GL_DEPTH_TEST);
+
+    auto const drawScene = [&]()
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glUseProgram(scenePipeline.shaderProgram);
+        GLint const modelLocation = glGetUniformLocation(scenePipeline.shaderProgram, "model");
+        for (auto const& model : models)
+        {
+            glUniformMatrix4fv(modelLocation, 1, GL_FALSE, model.data());
+            scenePipeline.drawCall(gpuCube);
+        }
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    // A GPUShape for each box, as before DebugDraw
+    {
+        drawScene();
+        context.finish();
+
+        auto const start = Clock::now();
+        GLint const modelLocation = glGetUniformLocation(scenePipeline.shaderProgram, "model");
+        gr::Matrix4f const identity = tr::identity();
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, identity.data());
+        for (std::size_t i = 0; i < SINGLE_SHAPE_BOXES; ++i)
+        {
+            gr::GPUShape gpuBox = gr::toGPUShape(scenePipeline, createWireBox(gr::transformAABB(unitCube, models[i]), 1, 1, 0), GL_STREAM_DRAW);
+            scenePipeline.drawCall(gpuBox, GL_LINES);
+            gpuBox.clear();
+        }
+        context.finish();
+        std::chrono::duration<double> const time = Clock::now() - start;
+
+        std::cout << SINGLE_SHAPE_BOXES << " boxes with a GPUShape each: " << std::fixed << std::setprecision(2)
+            << 1000 * time.count() << " ms" << std::endl;
+    }
+
+    std::chrono::duration<double> sceneTime(0), appendTime(0), flushTime(0);
+    std::size_t lines = 0;
+
+    for (unsigned int frame = 0; frame < FRAMES; ++frame)
+    {
+        auto const t0 = Clock::now();
+        drawScene();
+        context.finish();
+
+        auto const t1 = Clock::now();
+        for (auto const& model : models)
+        {
+            gr::AABB const aabb = gr::transformAABB(unitCube, model);
+            debugDraw.box(unitCube, model, gr::Vector3f(0.2f, 0.9f, 0.3f));
+            debugDraw.box(aabb, gr::Vector3f(1, 1, 0));
+            debugDraw.sphere({aabb.center(), aabb.extents().norm()}, gr::Vector3f(0.3f, 0.5f, 1));
+        }
+
+        // A path around the city, and rays from the other camera that can be seen through the buildings
+        std::vector<gr::Vector3f> path;
+        for (unsigned int i = 0; i <= 128; ++i)
+        {
+            float const angle = 2 * std::numbers::pi_v<float> * i / 128;
+            path.emplace_back(22 * std::cos(angle), 22 * std::sin(angle), 3 + 2 * std::sin(5 * angle + 0.1f * frame));
+        }
+        debugDraw.path(path, gr::Vector3f(1, 0.4f, 0.8f));
+
+        gr::Vector3f const otherPosition(-14, -14, 6);
+        for (unsigned int i = 0; i < 8; ++i)
+        {
+            gr::Vector3f const target(-6 + 2.0f * i, 6 - 2.0f * i, 0);
+            debugDraw.ray({otherPosition, (target - otherPosition).normalized()}, 24, gr::Vector3f(1, 0.2f, 0.2f), false);
+        }
+
+        debugDraw.frustum(otherProjection * otherView, gr::Vector3f(1, 1, 1), false);
+        debugDraw.axis(tr::identity(), 4, false);
+        debugDraw.axis(otherView.inverse(), 2, false);
+        lines = debugDraw.size();
+
+        auto const t2 = Clock::now();
+        glUseProgram(debugPipeline.shaderProgram);
+        debugDraw.flush(debugPipeline, debugDrawBuffer);
+        context.finish();
+
+        auto const t3 = Clock::now();
+        sceneTime += t1 - t0;
+        appendTime += t2 - t1;
+        flushTime += t3 - t2;
+    }
+
+    std::cout << lines << " lines in 2 draw calls, per frame: " << std::fixed << std::setprecision(2)
+        << "scene " << 1000 * sceneTime.count() / FRAMES << " ms, "
+        << "append " << 1000 * appendTime.count() / FRAMES << " ms, "
+        << "flush and draw " << 1000 * flushTime.count() / FRAMES << " ms" << std::endl;
+
+    if (not gr::savePNG(context.readPixels(), outputPath))
+    {
+        std::cout << "ERROR::EX_DEBUG_DRAW::COULD_NOT_WRITE " << outputPath << std::endl;
+        return 1;
+    }
+    std::cout << "Saved " << outputPath << std::endl;
+
+    // freeing GPU memory
+    gpuCube.clear();
+    debugDrawBuffer.clear();
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file ex_offscreen_benchmark.cpp
+ * @brief Drawing a scene graph with PhongColorShaderProgram without any window, timing it and saving the last frame.
+ *        It runs on servers without a display, with a GPU or with Mesa llvmpipe.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <ciso646>
+#include <glad/glad.h>
+#include <grafica/shape.h>
+#include <grafica/basic_shapes.h>
+#include <grafica/easy_shaders.h>
+#include <grafica/gpu_shape.h>
+#include <grafica/scene_graph.h>
+#include <grafica/transformations.h>
+#include <grafica/offscreen_context.h>
+#include <grafica/frame_capture.h>
+
+namespace gr = Grafica;
+namespace tr = Grafica::Transformations;
+
+// Usage: ex_offscreen_benchmark [output.png] [capture.y4m]
+// With a capture path every frame is also recorded, as a QA session would be. Each frame is then finished
+// before capturing, so the capture time does not include rendering and can be checked against the 1 ms goal.
+// Software GL copies the pixels inside glReadPixels, so llvmpipe takes about 3 ms at 1280x720; on a GPU the read
+// only queues a copy, but the goal has not been measured on one.
+
+constexpr unsigned int WIDTH = 1280;
+constexpr unsigned int HEIGHT = 720;
+constexpr unsigned int GRID_SIZE = 20;
+constexpr unsigned int FRAMES = 60;
+
+int main(int argc, char** argv)
+{
+    std::string const outputPath = argc > 1 ? argv[1] : "offscreen_benchmark.png";
+    std::string const capturePath = argc > 2 ? argv[2] : "";
+
+    // Instead of a GLFW window, GL is loaded and drawing goes to a framebuffer
+    gr::OffscreenContext context(WIDTH, HEIGHT);
+    std::cout << context.description() << std::endl;
+
+    gr::PhongColorShaderProgram phongPipeline;
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+    auto rootPtr = std::make_shared<gr::SceneGraphNode>("root");
+
+    auto floorShapePtr = std::make_shared<gr::GPUShape>(gr::toGPUShape(phongPipeline, gr::createColorNormalsCube(0.8f, 0.8f, 0.8f)));
+    rootPtr->childs.push_back(std::make_shared<gr::SceneGraphNode>(
+        "floor", tr::translate(0, 0, -0.05f) * tr::scale(GRID_SIZE, GRID_SIZE, 0.1f), floorShapePtr));
+
+    std::vector<gr::GPUShapePtr> cubeShapes;
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        cubeShapes.push_back(std::make_shared<gr::GPUShape>(gr::toGPUShape(phongPipeline,
+            gr::createColorNormalsCube(distribution(generator), distribution(generator), distribution(generator)))));
+    }
+
+    for (unsigned int x = 0; x < GRID_SIZE; ++x)
+    {
+        for (unsigned int y = 0; y < GRID_SIZE; ++y)
+        {
+            float const height = 0.2f + 1.5f * distribution(generator);
+            rootPtr->childs.push_back(std::make_shared<gr::SceneGraphNode>(
+                "cube_" + std::to_string(x) + "_" + std::to_string(y),
+                tr::translate(x - GRID_SIZE / 2.0f + 0.5f, y - GRID_SIZE / 2.0f + 0.5f, height / 2)
+                    * tr::rotationZ(distribution(generator))
+                    * tr::scale(0.6f, 0.6f, height),
+                cubeShapes[(x + 3 * y) % cubeShapes.size()]));
+        }
+    }
+
+    glClearColor(0.15f, 0.15f, 0.15f, 1.0f);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    glUseProgram(phongPipeline.shaderProgram);
+    gr::Matrix4f const projection = tr::perspective(45, float(WIDTH) / float(HEIGHT), 0.1f, 100);
+    glUniformMatrix4fv(glGetUniformLocation(phongPipeline.shaderProgram, "projection"), 1, GL_FALSE, projection.data());
+    glUniform3f(glGetUniformLocation(phongPipeline.shaderProgram, "La"), 1.0, 1.0, 1.0);
+    glUniform3f(glGetUniformLocation(phongPipeline.shaderProgram, "Ld"), 1.0, 1.0, 1.0);
+    glUniform3f(glGetUniformLocation(phongPipeline.shaderProgram, "Ls"), 1.0, 1.0, 1.0);
+    glUniform3f(glGetUniformLocation(phongPipeline.shaderProgram, "Ka"), 0.2, 0.2, 0.2);
+    glUniform3f(glGetUniformLocation(phongPipeline.shaderProgram, "Kd"), 0.9, 0.9, 0.9);
+    glUniform3f(glGetUniformLocation(phongPipeline.shaderProgram, "Ks"), 0.3, 0.3, 0.3);
+    glUniform3f(glGetUniformLocation(phongPipeline.shaderProgram, "lightPosition"), -6, -4, 10);
+    glUniform1ui(glGetUniformLocation(phongPipeline.shaderProgram, "shininess"), 100);
+    glUniform1f(glGetUniformLocation(phongPipeline.shaderProgram, "constantAttenuation"), 0.5);
+    glUniform1f(glGetUniformLocation(phongPipeline.shaderProgram, "linearAttenuation"), 0.01);
+    glUniform1f(glGetUniformLocation(phongPipeline.shaderProgram, "quadraticAttenuation"), 0.002);
+
+    gr::FrameCapture frameCapture(WIDTH, HEIGHT);
+    if (not capturePath.empty() and not frameCapture.start(gr::CaptureFormat::Y4M, capturePath, 30))
+        return 1;
+
+    std::chrono::duration<double> captureTime(0), maxCaptureTime(0);
+
+    auto const start = std::chrono::steady_clock::now();
+    for (unsigned int frame = 0; frame < FRAMES; ++frame)
+    {
+        // The camera orbits around the city
+        float const angle = 0.02f * frame;
+        gr::Vector3f const viewPosition(16 * std::cos(angle), 16 * std::sin(angle), 9);
+        gr::Matrix4f const view = tr::lookAt(viewPosition, gr::Vector3f(0, 0, 0), gr::Vector3f(0, 0, 1));
+        glUniformMatrix4fv(glGetUniformLocation(phongPipeline.shaderProgram, "view"), 1, GL_FALSE, view.data());
+        glUniform3f(glGetUniformLocation(phongPipeline.shaderProgram, "viewPosition"), viewPosition[0], viewPosition[1], viewPosition[2]);
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        gr::drawSceneGraphNode(rootPtr, phongPipeline, "model");
+
+        if (frameCapture.capturing())
+        {
+            // Software GL, as llvmpipe, would otherwise finish the frame inside glReadPixels
+            context.finish();
+
+            auto const captureStart = std::chrono::steady_clock::now();
+            frameCapture.capture(context.framebuffer());
+            std::chrono::duration<double> const time = std::chrono::steady_clock::now() - captureStart;
+            captureTime += time;
+            maxCaptureTime = std::max(maxCaptureTime, time);
+        }
+    }
+    // Without it, only the time to queue the commands would be measured
+    context.finish();
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << FRAMES << " frames of " << rootPtr->childs.size() << " nodes at "
+        << WIDTH << "x" << HEIGHT << " in " << std::fixed << std::setprecision(1) << elapsed.count() * 1000 << " ms: "
+        << FRAMES / elapsed.count() << " fps" << std::endl;
+
+    if (frameCapture.capturing())
+    {
+        frameCapture.stop();
+        auto const stats = frameCapture.stats();
+        std::cout << stats.writtenFrames << " frames captured to " << capturePath << ", capture overhead per frame: "
+            << std::setprecision(3) << 1000 * captureTime.count() / FRAMES << " ms average, "
+            << 1000 * maxCaptureTime.count() << " ms worst, "
+            << stats.stalledFrames << " frames waited for the GPU" << std::endl;
+    }
+
+    if (not gr::savePNG(context.readPixels(), outputPath))
+    {
+        std::cout << "ERROR::EX_OFFSCREEN_BENCHMARK::COULD_NOT_WRITE " << outputPath << std::endl;
+        return 1;
+    }
+    std::cout << "Saved " << outputPath << std::endl;
+
+    // freeing GPU memory
+    frameCapture.clear();
+    floorShapePtr->clear();
+    for (auto& cubeShapePtr : cubeShapes)
+        cubeShapePtr->clear();
+
+    return 0;
+}
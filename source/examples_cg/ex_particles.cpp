@@ -0,0 +1,115 @@
+/**
+ * @file ex_particles.cpp
+ * @brief A million particles from a few fountains, simulated on the CPU and drawn with one instanced draw call.
+ *        It renders without a window and reports the time of each stage.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <numbers>
+#include <ciso646>
+#include <glad/glad.h>
+#include <grafica/transformations.h>
+#include <grafica/offscreen_context.h>
+#include <grafica/particle_system.h>
+
+namespace gr = Grafica;
+namespace tr = Grafica::Transformations;
+
+// Usage: ex_particles [output.png]
+
+constexpr unsigned int WIDTH = 1280;
+constexpr unsigned int HEIGHT = 720;
+constexpr std::size_t PARTICLES = 1000000;
+constexpr unsigned int FOUNTAINS = 4;
+constexpr float TIME_STEP = 1.0f / 60.0f;
+constexpr unsigned int WARM_UP_FRAMES = 180;
+constexpr unsigned int FRAMES = 60;
+
+int main(int argc, char** argv)
+{
+    std::string const outputPath = argc > 1 ? argv[1] : "particles.png";
+
+    gr::OffscreenContext context(WIDTH, HEIGHT);
+    std::cout << context.description() << std::endl;
+
+    // Emitting as many particles per second as die, the system stays full
+    gr::ParticleSystem particleSystem(PARTICLES);
+    for (unsigned int i = 0; i < FOUNTAINS; ++i)
+    {
+        float const angle = 2 * std::numbers::pi_v<float> * i / FOUNTAINS;
+
+        gr::ParticleEmitter fountain;
+        fountain.position = gr::Vector3f(3 * std::cos(angle), 3 * std::sin(angle), 0);
+        fountain.positionSpread = gr::Vector3f(0.1f, 0.1f, 0);
+        fountain.velocity = gr::Vector3f(-std::cos(angle), -std::sin(angle), 7);
+        fountain.velocitySpread = gr::Vector3f(0.6f, 0.6f, 0.8f);
+        fountain.color = gr::Vector3f(0.5f + 0.5f * std::cos(angle), 0.5f, 0.5f + 0.5f * std::sin(angle));
+        fountain.colorSpread = gr::Vector3f(0.1f, 0.2f, 0.1f);
+        fountain.rate = PARTICLES / (FOUNTAINS * fountain.lifetime);
+        particleSystem.addEmitter(fountain);
+    }
+
+    gr::ParticleShaderProgram particlePipeline;
+    gr::ParticleBuffer particleBuffer = gr::toParticleBuffer(particlePipeline, PARTICLES);
+
+    glUseProgram(particlePipeline.shaderProgram);
+    gr::Matrix4f const projection = tr::perspective(45, float(WIDTH) / float(HEIGHT), 0.1f, 100);
+    gr::Matrix4f const view = tr::lookAt(gr::Vector3f(12, 0, 5), gr::Vector3f(0, 0, 3), gr::Vector3f(0, 0, 1));
+    glUniformMatrix4fv(glGetUniformLocation(particlePipeline.shaderProgram, "projection"), 1, GL_FALSE, projection.data());
+    glUniformMatrix4fv(glGetUniformLocation(particlePipeline.shaderProgram, "view"), 1, GL_FALSE, view.data());
+    glUniform1f(glGetUniformLocation(particlePipeline.shaderProgram, "particleSize"), 0.03f);
+
+    // Additive blending, the order of the particles does not matter
+    glClearColor(0.02f, 0.02f, 0.05f, 1.0f);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+
+    for (unsigned int frame = 0; frame < WARM_UP_FRAMES; ++frame)
+        particleSystem.update(TIME_STEP);
+
+    using Clock = std::chrono::steady_clock;
+    std::chrono::duration<double> updateTime(0), uploadTime(0), drawTime(0);
+
+    for (unsigned int frame = 0; frame < FRAMES; ++frame)
+    {
+        auto const t0 = Clock::now();
+        particleSystem.update(TIME_STEP);
+
+        auto const t1 = Clock::now();
+        particleBuffer.fillBuffers(particleSystem);
+
+        auto const t2 = Clock::now();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        particlePipeline.drawCall(particleBuffer);
+        context.finish();
+
+        auto const t3 = Clock::now();
+        updateTime += t1 - t0;
+        uploadTime += t2 - t1;
+        drawTime += t3 - t2;
+    }
+
+    std::cout << particleSystem.size() << " particles, per frame: " << std::fixed << std::setprecision(2)
+        << "update " << 1000 * updateTime.count() / FRAMES << " ms, "
+        << "upload " << 1000 * uploadTime.count() / FRAMES << " ms, "
+        << "draw " << 1000 * drawTime.count() / FRAMES << " ms" << std::endl;
+
+    if (not gr::savePNG(context.readPixels(), outputPath))
+    {
+        std::cout << "ERROR::EX_PARTICLES::COULD_NOT_WRITE " << outputPath << std::endl;
+        return 1;
+    }
+    std::cout << "Saved " << outputPath << std::endl;
+
+    // freeing GPU memory
+    particleBuffer.clear();
+
+    return 0;
+}
@@ -22,6 +22,8 @@
 #include <grafica/gpu_shape.h>
 #include <grafica/transformations.h>
 #include <grafica/scene_graph.h>
+#include <grafica/scene_graph_index.h>
+#include <grafica/animation.h>
 
 namespace gr = Grafica;
 namespace tr = Grafica::Transformations;
@@ -85,6 +87,39 @@ gr::SceneGraphNodePtr createCar(const PipelineT& pipeline, gr::Coord r, gr::Coor
     return carPtr;
 }
 
+// The red car goes back and forth along x while its wheels spin, sampled from the previous hand written motion
+gr::AnimationClip createRedCarClip()
+{
+    constexpr float duration = 2 * std::numbers::pi;
+
+    gr::AnimationClip clip("redCar");
+
+    constexpr unsigned int carKeys = 33;
+    std::vector<float> carTimes;
+    std::vector<gr::Vector3f> carPositions;
+    for (unsigned int key = 0; key < carKeys; ++key)
+    {
+        float const time = duration * key / (carKeys - 1);
+        carTimes.push_back(time);
+        carPositions.push_back(gr::Vector3f(3 * std::sin(time), 0, 0.5));
+    }
+    clip.setTranslationKeys(clip.addChannel("car"), carTimes, carPositions);
+
+    // Consecutive keys must be less than half a turn apart, so the rotation does not go backwards
+    constexpr unsigned int wheelKeys = 65;
+    std::vector<float> wheelTimes;
+    std::vector<gr::Quaternion> wheelRotations;
+    for (unsigned int key = 0; key < wheelKeys; ++key)
+    {
+        float const time = duration * key / (wheelKeys - 1);
+        wheelTimes.push_back(time);
+        wheelRotations.push_back(gr::Quaternion::fromAxisAngle(-10 * time, gr::Vector3f(0, 1, 0)));
+    }
+    clip.setRotationKeys(clip.addChannel("wheelRotation"), wheelTimes, wheelRotations);
+
+    return clip;
+}
+
 int main()
 {
     // Initialize glfw
@@ -132,7 +167,21 @@ int main()
     gr::SceneGraphNodePtr sgBlueCarPtr = createCar(pipeline, 0, 0, 1);
 
     // Asigning a transformation in the scene graph
-    sgBlueCarPtr->transform = tr::rotationZ(-std::numbers::pi/4) * tr::translate(3.0,0,0.5);
+    sgBlueCarPtr->setTransform(tr::rotationZ(-std::numbers::pi/4) * tr::translate(3.0,0,0.5));
+
+    // Indexing the red car, so its nodes are found without searching the whole tree
+    gr::SceneGraphIndex redCarIndex(sgRedCarPtr);
+
+    auto redWheelRotationNodeMaybe = redCarIndex.findNode("car/frontWheel/wheelRotation");
+
+    // If the node is not found, everything is lost :(
+    assert(redWheelRotationNodeMaybe.has_value());
+
+    // The animator writes the transforms of its targets, given in the same order as their names
+    gr::AnimationClip redCarClip = createRedCarClip();
+    gr::Animator animator({"car", "wheelRotation"});
+    animator.addClip(redCarClip);
+    std::vector<gr::SceneGraphNodePtr> const animatedNodes = {sgRedCarPtr, redWheelRotationNodeMaybe.value()};
 
     // Setting up the clear screen color
     glClearColor(0.85f, 0.85f, 0.85f, 1.0f);
@@ -176,18 +225,12 @@ int main()
 
         gr::Matrix4f view = tr::lookAt(viewPos, eye, at);
 
-        sgRedCarPtr->transform = tr::translate(3 * std::sin( t1 ),0,0.5);
-        auto redWheelRotationNodeMaybe = gr::findNode(sgRedCarPtr, "wheelRotation");
-        
-        // If the node is not found, everything is lost :(
-        assert(redWheelRotationNodeMaybe.has_value());
-        
-        gr::SceneGraphNode& redWheelRotationNode = *(redWheelRotationNodeMaybe.value());
-
-        redWheelRotationNode.transform = tr::rotationY(-10 * t1);
+        animator.advance(dt);
+        animator.evaluate();
+        animator.apply(animatedNodes);
 
         // Uncomment to print the red car position on every iteration
-        /*auto positionMaybe = tr::findPosition(sgRedCarPtr, "car");
+        /*auto positionMaybe = redCarIndex.findPosition("car");
         assert(positionMaybe.has_value());
         auto& position = positionMaybe.value();
         std::cout << position << std::endl;*/
@@ -0,0 +1,208 @@
+/**
+ * @file ex_sprite_benchmark.cpp
+ * @brief A hundred thousand moving sprites from a few textures and layers, drawn with a SpriteBatch.
+ *        It renders without a window and compares against one drawCall per sprite with TextureTransformShaderProgram.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <numbers>
+#include <ciso646>
+#include <glad/glad.h>
+#include <grafica/root_directory.h>
+#include <grafica/basic_shapes.h>
+#include <grafica/easy_shaders.h>
+#include <grafica/gpu_shape.h>
+#include <grafica/transformations.h>
+#include <grafica/offscreen_context.h>
+#include <grafica/sprite_batch.h>
+
+namespace gr = Grafica;
+namespace tr = Grafica::Transformations;
+
+// Usage: ex_sprite_benchmark [output.png]
+
+constexpr unsigned int WIDTH = 1280;
+constexpr unsigned int HEIGHT = 720;
+constexpr std::size_t SPRITES = 100000;
+constexpr std::size_t BUFFER_CAPACITY = 65536;
+constexpr int LAYERS = 4;
+constexpr float TIME_STEP = 1.0f / 60.0f;
+constexpr unsigned int FRAMES = 60;
+
+// Drawing every sprite as its own GPUShape is slow, so the comparison uses fewer of them
+constexpr std::size_t SINGLE_DRAW_SPRITES = 10000;
+
+struct MovingSprite
+{
+    gr::Sprite sprite;
+    gr::Vector2f velocity;
+    float angularVelocity;
+};
+
+int main(int argc, char** argv)
+{
+    std::string const outputPath = argc > 1 ? argv[1] : "sprites.png";
+
+    gr::OffscreenContext context(WIDTH, HEIGHT);
+    std::cout << context.description() << std::endl;
+
+    std::vector<GLuint> textures = {
+        gr::textureSimpleSetup(gr::getPath("assets/imgs/boo.png"), GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST),
+        gr::textureSimpleSetup(gr::getPath("assets/imgs/cg_box.png"), GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST),
+        gr::textureSimpleSetup(gr::getPath("assets/imgs/dice.jpg"), GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_LINEAR, GL_LINEAR)};
+
+    // Sprites live in pixel coordinates, with the origin at the bottom left corner
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> unit(0, 1);
+    std::vector<MovingSprite> movingSprites(SPRITES);
+    for (auto& moving : movingSprites)
+    {
+        float const size = 8 + 24 * unit(generator);
+        float const speed = 20 + 80 * unit(generator);
+        float const direction = 2 * std::numbers::pi_v<float> * unit(generator);
+
+        moving.sprite.texture = textures[generator() % textures.size()];
+        moving.sprite.layer = static_cast<int>(generator() % LAYERS);
+        moving.sprite.position = gr::Vector2f(WIDTH * unit(generator), HEIGHT * unit(generator));
+        moving.sprite.rotation = 2 * std::numbers::pi_v<float> * unit(generator);
+        moving.sprite.scale = gr::Vector2f(size, size);
+
+        // The dice image has its six faces in two columns and three rows
+        if (moving.sprite.texture == textures[2])
+        {
+            float const column = static_cast<float>(generator() % 2);
+            float const row = static_cast<float>(generator() % 3);
+            moving.sprite.uvRect = gr::Vector4f(column / 2, row / 3, (column + 1) / 2, (row + 1) / 3);
+        }
+
+        // Higher layers are brighter
+        float const brightness = 0.4f + 0.6f * moving.sprite.layer / (LAYERS - 1);
+        moving.sprite.tint = gr::Vector4f(brightness, brightness, brightness, 0.9f);
+
+        moving.velocity = gr::Vector2f(speed * std::cos(direction), speed * std::sin(direction));
+        moving.angularVelocity = 2 * unit(generator) - 1;
+    }
+
+    auto const update = [&]()
+    {
+        for (auto& moving : movingSprites)
+        {
+            gr::Sprite& sprite = moving.sprite;
+            sprite.position += TIME_STEP * moving.velocity;
+            sprite.rotation += TIME_STEP * moving.angularVelocity;
+
+            // Bouncing on the borders
+            for (unsigned int axis = 0; axis < 2; ++axis)
+            {
+                float const limit = axis == 0 ? WIDTH : HEIGHT;
+                if (sprite.position[axis] < 0 or sprite.position[axis] > limit)
+                    moving.velocity[axis] = -moving.velocity[axis];
+            }
+        }
+    };
+
+    gr::Matrix4f const projection = tr::ortho(0, WIDTH, 0, HEIGHT, -1, 1);
+
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
+
+    using Clock = std::chrono::steady_clock;
+
+    // One drawCall per sprite, as before SpriteBatch
+    {
+        gr::TextureTransformShaderProgram pipeline;
+        glUseProgram(pipeline.shaderProgram);
+        GLint const transformLocation = glGetUniformLocation(pipeline.shaderProgram, "transform");
+
+        gr::GPUShape gpuQuad = gr::toGPUShape(pipeline, gr::createTextureQuad(1, 1));
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        context.finish();
+
+        auto const start = Clock::now();
+        for (std::size_t i = 0; i < SINGLE_DRAW_SPRITES; ++i)
+        {
+            gr::Sprite const& sprite = movingSprites[i].sprite;
+            gr::Matrix4f const transform = projection
+                * tr::translate(sprite.position[0], sprite.position[1], 0)
+                * tr::rotationZ(sprite.rotation)
+                * tr::scale(sprite.scale[0], sprite.scale[1], 1);
+
+            gpuQuad.texture = sprite.texture;
+            glUniformMatrix4fv(transformLocation, 1, GL_FALSE, transform.data());
+            pipeline.drawCall(gpuQuad);
+        }
+        context.finish();
+        std::chrono::duration<double> const time = Clock::now() - start;
+
+        std::cout << SINGLE_DRAW_SPRITES << " sprites with a drawCall each: " << std::fixed << std::setprecision(2)
+            << 1000 * time.count() << " ms" << std::endl;
+
+        gpuQuad.clear();
+    }
+
+    gr::SpriteShaderProgram spritePipeline;
+    gr::SpriteBuffer spriteBuffer = gr::toSpriteBuffer(spritePipeline, BUFFER_CAPACITY);
+    gr::SpriteBatch spriteBatch;
+
+    glUseProgram(spritePipeline.shaderProgram);
+    glUniformMatrix4fv(glGetUniformLocation(spritePipeline.shaderProgram, "transform"), 1, GL_FALSE, projection.data());
+
+    std::chrono::duration<double> updateTime(0), batchTime(0), flushTime(0), drawTime(0);
+
+    for (unsigned int frame = 0; frame < FRAMES; ++frame)
+    {
+        auto const t0 = Clock::now();
+        update();
+
+        auto const t1 = Clock::now();
+        spriteBatch.begin();
+        for (auto const& moving : movingSprites)
+            spriteBatch.draw(moving.sprite);
+
+        // Software GL, as llvmpipe, shades the vertices inside each draw call, so that time is part of flush
+        auto const t2 = Clock::now();
+        glClear(GL_COLOR_BUFFER_BIT);
+        spriteBatch.flush(spritePipeline, spriteBuffer);
+
+        auto const t3 = Clock::now();
+        context.finish();
+
+        auto const t4 = Clock::now();
+        updateTime += t1 - t0;
+        batchTime += t2 - t1;
+        flushTime += t3 - t2;
+        drawTime += t4 - t3;
+    }
+
+    std::cout << spriteBatch.stats() << std::endl;
+    std::cout << SPRITES << " sprites, per frame: " << std::fixed << std::setprecision(2)
+        << "update " << 1000 * updateTime.count() / FRAMES << " ms, "
+        << "batch " << 1000 * batchTime.count() / FRAMES << " ms, "
+        << "flush " << 1000 * flushTime.count() / FRAMES << " ms, "
+        << "draw " << 1000 * drawTime.count() / FRAMES << " ms" << std::endl;
+
+    if (not gr::savePNG(context.readPixels(), outputPath))
+    {
+        std::cout << "ERROR::EX_SPRITE_BENCHMARK::COULD_NOT_WRITE " << outputPath << std::endl;
+        return 1;
+    }
+    std::cout << "Saved " << outputPath << std::endl;
+
+    // freeing GPU memory
+    spriteBuffer.clear();
+    glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <Eigen/Core>
+#include <Eigen/Dense>
+#include <grafica/simple_eigen.h>
+#include <grafica/matrix_batch.h>
+#include <grafica/transformations.h>
+
+namespace gr = Grafica;
+namespace tr = Grafica::Transformations;
+
+/* Microbenchmark of parent * local products and affine inverses over many matrices:
+ * Matrix4f (Eigen with DontAlign), Eigen::Matrix4f (aligned, vectorized by Eigen)
+ * and AlignedMatrix4f with the matrix_batch kernels.
+ */
+
+constexpr std::size_t MATRICES_COUNT = 100000;
+constexpr unsigned int REPETITIONS = 50;
+
+template <typename Function>
+float measure(Function&& function)
+{
+    auto const start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < REPETITIONS; ++i)
+        function();
+    std::chrono::duration<float, std::milli> const duration = std::chrono::steady_clock::now() - start;
+    return duration.count() / REPETITIONS;
+}
+
+void report(const std::string& name, float milliseconds, float baseline)
+{
+    std::cout << std::setw(36) << std::left << name
+        << std::fixed << std::setprecision(3) << std::setw(10) << std::right << milliseconds << " ms"
+        << std::setprecision(2) << std::setw(8) << baseline / milliseconds << "x" << std::endl;
+}
+
+float maxDifference(const std::vector<gr::Matrix4f>& expected, const gr::AlignedMatrix4fArray& obtained)
+{
+    float difference = 0;
+    for (std::size_t i = 0; i < expected.size(); ++i)
+        for (unsigned int element = 0; element < 16; ++element)
+            difference = std::max(difference, std::abs(expected[i].data()[element] - obtained[i].data[element]));
+    return difference;
+}
+
+int main()
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    auto randomTransform = [&]()
+    {
+        return gr::Matrix4f(
+            tr::translate(distribution(generator), distribution(generator), distribution(generator))
+            * tr::rotationA(distribution(generator) * 3.1416f, gr::Vector3f(distribution(generator), 1.0f, distribution(generator)))
+            * tr::uniformScale(1.0f + 0.5f * distribution(generator)));
+    };
+
+    std::vector<gr::Matrix4f> parents(MATRICES_COUNT), locals(MATRICES_COUNT), results(MATRICES_COUNT);
+    std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f>> eigenParents(MATRICES_COUNT), eigenLocals(MATRICES_COUNT), eigenResults(MATRICES_COUNT);
+    gr::AlignedMatrix4fArray alignedParents(MATRICES_COUNT), alignedLocals(MATRICES_COUNT), alignedResults(MATRICES_COUNT);
+
+    for (std::size_t i = 0; i < MATRICES_COUNT; ++i)
+    {
+        parents[i] = randomTransform();
+        locals[i] = randomTransform();
+        eigenParents[i] = parents[i];
+        eigenLocals[i] = locals[i];
+        alignedParents[i] = gr::AlignedMatrix4f::fromMatrix4f(parents[i]);
+        alignedLocals[i] = gr::AlignedMatrix4f::fromMatrix4f(locals[i]);
+    }
+
+    std::cout << MATRICES_COUNT << " matrices, average of " << REPETITIONS << " runs" << std::endl;
+
+    std::cout << std::endl << "parent * local" << std::endl;
+
+    float const dontAlignMultiply = measure([&]()
+    {
+        for (std::size_t i = 0; i < MATRICES_COUNT; ++i)
+            results[i] = parents[i] * locals[i];
+    });
+    report("Matrix4f (DontAlign)", dontAlignMultiply, dontAlignMultiply);
+
+    float const eigenMultiply = measure([&]()
+    {
+        for (std::size_t i = 0; i < MATRICES_COUNT; ++i)
+            eigenResults[i].noalias() = eigenParents[i] * eigenLocals[i];
+    });
+    report("Eigen::Matrix4f (aligned)", eigenMultiply, dontAlignMultiply);
+
+    float const batchMultiply = measure([&]()
+    {
+        gr::multiplyBatch(alignedParents.data(), alignedLocals.data(), alignedResults.data(), MATRICES_COUNT);
+    });
+    report("AlignedMatrix4f multiplyBatch", batchMultiply, dontAlignMultiply);
+    std::cout << "max difference: " << std::scientific << maxDifference(results, alignedResults) << std::endl;
+
+    std::cout << std::endl << "affine inverse" << std::endl;
+
+    float const dontAlignInverse = measure([&]()
+    {
+        for (std::size_t i = 0; i < MATRICES_COUNT; ++i)
+            results[i] = parents[i].inverse();
+    });
+    report("Matrix4f::inverse (DontAlign)", dontAlignInverse, dontAlignInverse);
+
+    float const eigenInverse = measure([&]()
+    {
+        for (std::size_t i = 0; i < MATRICES_COUNT; ++i)
+            eigenResults[i] = eigenParents[i].inverse();
+    });
+    report("Eigen::Matrix4f::inverse (aligned)", eigenInverse, dontAlignInverse);
+
+    float const batchInverse = measure([&]()
+    {
+        gr::affineInverseBatch(alignedParents.data(), alignedResults.data(), MATRICES_COUNT);
+    });
+    report("AlignedMatrix4f affineInverseBatch", batchInverse, dontAlignInverse);
+    std::cout << "max difference: " << std::scientific << maxDifference(results, alignedResults) << std::endl;
+
+    std::cout << std::endl << "transforming points" << std::endl;
+
+    std::vector<float> x(MATRICES_COUNT), y(MATRICES_COUNT), z(MATRICES_COUNT);
+    std::vector<gr::Vector4f> points(MATRICES_COUNT), transformedPoints(MATRICES_COUNT);
+    for (std::size_t i = 0; i < MATRICES_COUNT; ++i)
+    {
+        x[i] = distribution(generator);
+        y[i] = distribution(generator);
+        z[i] = distribution(generator);
+        points[i] = gr::Vector4f(x[i], y[i], z[i], 1.0f);
+    }
+    std::vector<float> resultX(MATRICES_COUNT), resultY(MATRICES_COUNT), resultZ(MATRICES_COUNT);
+
+    float const dontAlignTransform = measure([&]()
+    {
+        for (std::size_t i = 0; i < MATRICES_COUNT; ++i)
+            transformedPoints[i] = parents[0] * points[i];
+    });
+    report("Matrix4f * Vector4f (DontAlign)", dontAlignTransform, dontAlignTransform);
+
+    float const batchTransform = measure([&]()
+    {
+        gr::transformPoints(alignedParents[0], x.data(), y.data(), z.data(), resultX.data(), resultY.data(), resultZ.data(), MATRICES_COUNT);
+    });
+    report("AlignedMatrix4f transformPoints", batchTransform, dontAlignTransform);
+
+    float difference = 0;
+    for (std::size_t i = 0; i < MATRICES_COUNT; ++i)
+    {
+        difference = std::max(difference, std::abs(transformedPoints[i][0] - resultX[i]));
+        difference = std::max(difference, std::abs(transformedPoints[i][1] - resultY[i]));
+        difference = std::max(difference, std::abs(transformedPoints[i][2] - resultZ[i]));
+    }
+    std::cout << "max difference: " << std::scientific << difference << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <Eigen/Geometry>
+#include <grafica/simple_eigen.h>
+#include <grafica/quaternion.h>
+#include <grafica/transformations.h>
+
+namespace gr = Grafica;
+namespace tr = Grafica::Transformations;
+
+/* Accuracy and throughput of Grafica::Quaternion against Eigen::Quaternionf:
+ * conversions, single slerp, and the batched nlerp and slerp kernels.
+ */
+
+constexpr std::size_t ROTATIONS_COUNT = 100000;
+constexpr unsigned int REPETITIONS = 20;
+
+template <typename Function>
+float measure(Function&& function)
+{
+    auto const start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < REPETITIONS; ++i)
+        function();
+    std::chrono::duration<float, std::milli> const duration = std::chrono::steady_clock::now() - start;
+    return duration.count() / REPETITIONS;
+}
+
+void report(const std::string& name, float milliseconds, float baseline)
+{
+    std::cout << std::setw(36) << std::left << name
+        << std::fixed << std::setprecision(3) << std::setw(10) << std::right << milliseconds << " ms"
+        << std::setprecision(2) << std::setw(8) << baseline / milliseconds << "x" << std::endl;
+}
+
+/* Distance between rotations, q and -q being the same */
+float difference(const gr::Quaternion& a, const Eigen::Quaternionf& b)
+{
+    float const same = std::max({std::abs(a.w - b.w()), std::abs(a.x - b.x()), std::abs(a.y - b.y()), std::abs(a.z - b.z())});
+    float const opposite = std::max({std::abs(a.w + b.w()), std::abs(a.x + b.x()), std::abs(a.y + b.y()), std::abs(a.z + b.z())});
+    return std::min(same, opposite);
+}
+
+int main()
+{
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    auto randomRotation = [&]()
+    {
+        gr::Vector3f const axis(distribution(generator), distribution(generator), distribution(generator));
+        return gr::Quaternion::fromAxisAngle(3.1416f * distribution(generator), axis);
+    };
+
+    std::vector<gr::Quaternion> from(ROTATIONS_COUNT), to(ROTATIONS_COUNT), result(ROTATIONS_COUNT);
+    std::vector<Eigen::Quaternionf> eigenFrom(ROTATIONS_COUNT), eigenTo(ROTATIONS_COUNT), eigenResult(ROTATIONS_COUNT);
+    gr::QuaternionArray fromArray(ROTATIONS_COUNT), toArray(ROTATIONS_COUNT), resultArray(ROTATIONS_COUNT);
+    std::vector<float> t(ROTATIONS_COUNT);
+
+    for (std::size_t i = 0; i < ROTATIONS_COUNT; ++i)
+    {
+        from[i] = randomRotation();
+        to[i] = randomRotation();
+        t[i] = 0.5f + 0.5f * distribution(generator);
+
+        eigenFrom[i] = Eigen::Quaternionf(from[i].w, from[i].x, from[i].y, from[i].z);
+        eigenTo[i] = Eigen::Quaternionf(to[i].w, to[i].x, to[i].y, to[i].z);
+        fromArray.set(i, from[i]);
+        toArray.set(i, to[i]);
+    }
+
+    std::cout << "accuracy over " << ROTATIONS_COUNT << " random rotations" << std::endl;
+
+    float matrixError = 0, roundTripError = 0, rotateError = 0;
+    for (std::size_t i = 0; i < ROTATIONS_COUNT; ++i)
+    {
+        gr::Matrix4f const matrix = tr::rotationQ(from[i]);
+        Eigen::Matrix3f const eigenMatrix = eigenFrom[i].toRotationMatrix();
+        matrixError = std::max(matrixError, (matrix.topLeftCorner<3, 3>() - eigenMatrix).cwiseAbs().maxCoeff());
+        roundTripError = std::max(roundTripError, difference(gr::Quaternion::fromMatrix4f(matrix), eigenFrom[i]));
+
+        gr::Vector3f const vector(distribution(generator), distribution(generator), distribution(generator));
+        rotateError = std::max(rotateError, (from[i].rotate(vector) - eigenFrom[i] * Eigen::Vector3f(vector)).cwiseAbs().maxCoeff());
+    }
+    std::cout << std::scientific << std::setprecision(2)
+        << "toMatrix4f:    " << matrixError << std::endl
+        << "fromMatrix4f:  " << roundTripError << std::endl
+        << "rotate:        " << rotateError << std::endl;
+
+    float slerpError = 0;
+    for (std::size_t i = 0; i < ROTATIONS_COUNT; ++i)
+        slerpError = std::max(slerpError, difference(gr::slerp(from[i], to[i], t[i]), eigenFrom[i].slerp(t[i], eigenTo[i])));
+    std::cout << "slerp:         " << slerpError << std::endl;
+
+    gr::slerpBatch(fromArray, toArray, t.data(), resultArray);
+    float slerpBatchError = 0;
+    for (std::size_t i = 0; i < ROTATIONS_COUNT; ++i)
+        slerpBatchError = std::max(slerpBatchError, difference(resultArray.get(i), eigenFrom[i].slerp(t[i], eigenTo[i])));
+    std::cout << "slerpBatch:    " << slerpBatchError << std::endl;
+
+    // nlerp follows the same arc at a different speed, so only its endpoints and unit length are checked
+    gr::nlerpBatch(fromArray, toArray, t.data(), resultArray);
+    float nlerpNormError = 0;
+    for (std::size_t i = 0; i < ROTATIONS_COUNT; ++i)
+        nlerpNormError = std::max(nlerpNormError, std::abs(resultArray.get(i).norm() - 1.0f));
+    std::cout << "nlerpBatch |q|-1: " << nlerpNormError << std::endl;
+
+    // t = 0 must give from and t = 1 must give to, for both batched interpolations
+    for (float const endpoint : {0.0f, 1.0f})
+    {
+        std::vector<float> const endpointT(ROTATIONS_COUNT, endpoint);
+        std::vector<Eigen::Quaternionf> const& expected = endpoint == 0.0f ? eigenFrom : eigenTo;
+
+        float nlerpEndpointError = 0, slerpEndpointError = 0;
+        gr::nlerpBatch(fromArray, toArray, endpointT.data(), resultArray);
+        for (std::size_t i = 0; i < ROTATIONS_COUNT; ++i)
+            nlerpEndpointError = std::max(nlerpEndpointError, difference(resultArray.get(i), expected[i]));
+
+        gr::slerpBatch(fromArray, toArray, endpointT.data(), resultArray);
+        for (std::size_t i = 0; i < ROTATIONS_COUNT; ++i)
+            slerpEndpointError = std::max(slerpEndpointError, difference(resultArray.get(i), expected[i]));
+
+        std::cout << "t = " << std::defaultfloat << endpoint << std::scientific
+            << ", nlerpBatch: " << nlerpEndpointError << ", slerpBatch: " << slerpEndpointError << std::endl;
+    }
+
+    std::cout << std::endl << "throughput, average of " << REPETITIONS << " runs" << std::endl;
+
+    float const eigenSlerp = measure([&]()
+    {
+        for (std::size_t i = 0; i < ROTATIONS_COUNT; ++i)
+            eigenResult[i] = eigenFrom[i].slerp(t[i], eigenTo[i]);
+    });
+    report("Eigen::Quaternionf::slerp", eigenSlerp, eigenSlerp);
+
+    float const singleSlerp = measure([&]()
+    {
+        for (std::size_t i = 0; i < ROTATIONS_COUNT; ++i)
+            result[i] = gr::slerp(from[i], to[i], t[i]);
+    });
+    report("slerp", singleSlerp, eigenSlerp);
+
+    float const batchSlerp = measure([&]()
+    {
+        gr::slerpBatch(fromArray, toArray, t.data(), resultArray);
+    });
+    report("slerpBatch", batchSlerp, eigenSlerp);
+
+    float const batchNlerp = measure([&]()
+    {
+        gr::nlerpBatch(fromArray, toArray, t.data(), resultArray);
+    });
+    report("nlerpBatch", batchNlerp, eigenSlerp);
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <memory>
+#include <random>
+#include <grafica/simple_eigen.h>
+#include <grafica/basic_shapes.h>
+#include <grafica/gpu_shape.h>
+#include <grafica/scene_graph.h>
+#include <grafica/transformations.h>
+#include <grafica/ray_tracer.h>
+
+namespace gr = Grafica;
+namespace tr = Grafica::Transformations;
+
+/* Renders a scene graph on the CPU, without any window or OpenGL context, and saves the image.
+ * The GPUShapes are never filled: they only identify which Shape each node draws.
+ * Usage: ex_ray_tracer [output.png]
+ */
+
+constexpr unsigned int WIDTH = 1280;
+constexpr unsigned int HEIGHT = 720;
+constexpr unsigned int GRID_SIZE = 20;
+
+int main(int argc, char** argv)
+{
+    std::string const outputPath = argc > 1 ? argv[1] : "ray_tracer.png";
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+    gr::RayTracer rayTracer;
+    auto rootPtr = std::make_shared<gr::SceneGraphNode>("root");
+
+    auto floorShapePtr = std::make_shared<gr::GPUShape>();
+    rayTracer.setShape(*floorShapePtr, gr::createColorNormalsCube(0.8f, 0.8f, 0.8f));
+    rootPtr->childs.push_back(std::make_shared<gr::SceneGraphNode>(
+        "floor", tr::translate(0, 0, -0.05f) * tr::scale(GRID_SIZE, GRID_SIZE, 0.1f), floorShapePtr));
+
+    // A few shapes shared by many nodes, as the GL examples do
+    std::vector<gr::GPUShapePtr> cubeShapes;
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        cubeShapes.push_back(std::make_shared<gr::GPUShape>());
+        rayTracer.setShape(*cubeShapes.back(), gr::createColorNormalsCube(distribution(generator), distribution(generator), distribution(generator)));
+    }
+
+    for (unsigned int x = 0; x < GRID_SIZE; ++x)
+    {
+        for (unsigned int y = 0; y < GRID_SIZE; ++y)
+        {
+            float const height = 0.2f + 1.5f * distribution(generator);
+            auto nodePtr = std::make_shared<gr::SceneGraphNode>(
+                "cube_" + std::to_string(x) + "_" + std::to_string(y),
+                tr::translate(x - GRID_SIZE / 2.0f + 0.5f, y - GRID_SIZE / 2.0f + 0.5f, height / 2)
+                    * tr::rotationZ(distribution(generator))
+                    * tr::scale(0.6f, 0.6f, height),
+                cubeShapes[(x + 3 * y) % cubeShapes.size()]);
+            rootPtr->childs.push_back(nodePtr);
+        }
+    }
+
+    rayTracer.setScene(rootPtr);
+
+    gr::Matrix4f const projection = tr::perspective(45, float(WIDTH) / float(HEIGHT), 0.1f, 100);
+    gr::Matrix4f const view = tr::lookAt(gr::Vector3f(12, 10, 9), gr::Vector3f(0, 0, 0), gr::Vector3f(0, 0, 1));
+
+    gr::PhongLighting lighting;
+    lighting.lightPosition = gr::Vector3f(-6, -4, 10);
+    lighting.Kd = gr::Vector3f(0.9f, 0.9f, 0.9f);
+    lighting.Ks = gr::Vector3f(0.3f, 0.3f, 0.3f);
+    lighting.constantAttenuation = 0.5f;
+    lighting.linearAttenuation = 0.01f;
+    lighting.quadraticAttenuation = 0.002f;
+
+    gr::Image image;
+    for (bool shadows : {false, true})
+    {
+        gr::RayTracingSettings settings;
+        settings.shadows = shadows;
+
+        auto const stats = rayTracer.render(image, WIDTH, HEIGHT, projection, view, lighting, settings);
+        std::cout << (shadows ? "with shadows    " : "without shadows ")
+            << rayTracer.instancesCount() << " nodes, "
+            << stats.primaryRays << " primary rays, " << stats.shadowRays << " shadow rays in "
+            << std::fixed << std::setprecision(1) << stats.seconds * 1000 << " ms: "
+            << std::setprecision(2) << stats.raysPerSecond() / 1e6 << " Mrays/s" << std::endl;
+    }
+
+    if (not gr::savePNG(image, outputPath))
+    {
+        std::cout << "ERROR::EX_RAY_TRACER::COULD_NOT_WRITE " << outputPath << std::endl;
+        return 1;
+    }
+
+    std::cout << "Saved " << outputPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,108 @@
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <grafica/simple_eigen.h>
+#include <grafica/basic_shapes.h>
+#include <grafica/gpu_shape.h>
+#include <grafica/scene_graph.h>
+#include <grafica/transformations.h>
+#include <grafica/software_rasterizer.h>
+
+namespace gr = Grafica;
+namespace tr = Grafica::Transformations;
+
+/* Draws a scene graph with the Phong color pipeline on the CPU, without any window or OpenGL context,
+ * measures the frame rate and saves the last frame.
+ * The GPUShapes are never filled: they only identify which Shape each node draws.
+ * Usage: ex_software_rasterizer [output.png]
+ */
+
+constexpr unsigned int WIDTH = 1280;
+constexpr unsigned int HEIGHT = 720;
+constexpr unsigned int GRID_SIZE = 20;
+constexpr unsigned int FRAMES = 60;
+
+int main(int argc, char** argv)
+{
+    std::string const outputPath = argc > 1 ? argv[1] : "software_rasterizer.png";
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+    // Shapes stay alive here, the rasterizer only keeps pointers to them
+    std::vector<gr::Shape> shapes;
+    shapes.reserve(9);
+    gr::SoftwareShapes softwareShapes;
+    auto rootPtr = std::make_shared<gr::SceneGraphNode>("root");
+
+    auto floorShapePtr = std::make_shared<gr::GPUShape>();
+    shapes.push_back(gr::createColorNormalsCube(0.8f, 0.8f, 0.8f));
+    softwareShapes[floorShapePtr.get()] = &shapes.back();
+    rootPtr->childs.push_back(std::make_shared<gr::SceneGraphNode>(
+        "floor", tr::translate(0, 0, -0.05f) * tr::scale(GRID_SIZE, GRID_SIZE, 0.1f), floorShapePtr));
+
+    std::vector<gr::GPUShapePtr> cubeShapes;
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        cubeShapes.push_back(std::make_shared<gr::GPUShape>());
+        shapes.push_back(gr::createColorNormalsCube(distribution(generator), distribution(generator), distribution(generator)));
+        softwareShapes[cubeShapes.back().get()] = &shapes.back();
+    }
+
+    for (unsigned int x = 0; x < GRID_SIZE; ++x)
+    {
+        for (unsigned int y = 0; y < GRID_SIZE; ++y)
+        {
+            float const height = 0.2f + 1.5f * distribution(generator);
+            rootPtr->childs.push_back(std::make_shared<gr::SceneGraphNode>(
+                "cube_" + std::to_string(x) + "_" + std::to_string(y),
+                tr::translate(x - GRID_SIZE / 2.0f + 0.5f, y - GRID_SIZE / 2.0f + 0.5f, height / 2)
+                    * tr::rotationZ(distribution(generator))
+                    * tr::scale(0.6f, 0.6f, height),
+                cubeShapes[(x + 3 * y) % cubeShapes.size()]));
+        }
+    }
+
+    gr::SoftwarePhongColorPipeline pipeline;
+    pipeline.projection = tr::perspective(45, float(WIDTH) / float(HEIGHT), 0.1f, 100);
+    pipeline.lighting.lightPosition = gr::Vector3f(-6, -4, 10);
+    pipeline.lighting.Kd = gr::Vector3f(0.9f, 0.9f, 0.9f);
+    pipeline.lighting.Ks = gr::Vector3f(0.3f, 0.3f, 0.3f);
+    pipeline.lighting.constantAttenuation = 0.5f;
+    pipeline.lighting.linearAttenuation = 0.01f;
+    pipeline.lighting.quadraticAttenuation = 0.002f;
+
+    gr::SoftwareRasterizer rasterizer(WIDTH, HEIGHT);
+    rasterizer.setCullFace(true);
+
+    auto const start = std::chrono::steady_clock::now();
+    for (unsigned int frame = 0; frame < FRAMES; ++frame)
+    {
+        // The camera orbits around the city
+        float const angle = 0.02f * frame;
+        pipeline.viewPosition = gr::Vector3f(16 * std::cos(angle), 16 * std::sin(angle), 9);
+        pipeline.view = tr::lookAt(pipeline.viewPosition, gr::Vector3f(0, 0, 0), gr::Vector3f(0, 0, 1));
+
+        rasterizer.clear(gr::Vector3f(0.15f, 0.15f, 0.15f));
+        gr::rasterizeSceneGraphNode(rootPtr, rasterizer, pipeline, softwareShapes);
+    }
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << FRAMES << " frames of " << rootPtr->childs.size() << " nodes at "
+        << WIDTH << "x" << HEIGHT << " in " << std::fixed << std::setprecision(1) << elapsed.count() * 1000 << " ms: "
+        << FRAMES / elapsed.count() << " fps" << std::endl;
+
+    if (not gr::savePNG(rasterizer.image(), outputPath))
+    {
+        std::cout << "ERROR::EX_SOFTWARE_RASTERIZER::COULD_NOT_WRITE " << outputPath << std::endl;
+        return 1;
+    }
+
+    std::cout << "Saved " << outputPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file affine_transform.cpp
+ * @brief AffineTransform stores only the first 3 rows of an affine 4x4 matrix, as the last one is always (0, 0, 0, 1).
+ *        It takes 3/4 of the storage, and composing two of them costs 36 multiplications instead of 64.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "affine_transform.h"
+
+#include <Eigen/Dense>
+
+namespace Grafica
+{
+
+AffineTransform::AffineTransform():
+    matrix(Matrix34f::Identity())
+{
+}
+
+AffineTransform::AffineTransform(const Matrix34f& matrix_):
+    matrix(matrix_)
+{
+}
+
+AffineTransform AffineTransform::fromMatrix4f(const Matrix4f& matrix4)
+{
+    return AffineTransform(matrix4.topRows<3>());
+}
+
+Matrix4f AffineTransform::toMatrix4f() const
+{
+    Matrix4f matrix4;
+    matrix4.topRows<3>() = matrix;
+    matrix4.row(3) << 0, 0, 0, 1;
+    return matrix4;
+}
+
+void compose(const AffineTransform& lhs, const AffineTransform& rhs, AffineTransform& result)
+{
+    // [A a] [B b]   [AB  Ab + a]
+    // [0 1] [0 1] = [0      1  ]
+    Eigen::Matrix3f const linear = lhs.matrix.leftCols<3>() * rhs.matrix.leftCols<3>();
+    Eigen::Vector3f const translation = lhs.matrix.leftCols<3>() * rhs.matrix.col(3) + lhs.matrix.col(3);
+
+    result.matrix.leftCols<3>() = linear;
+    result.matrix.col(3) = translation;
+}
+
+AffineTransform AffineTransform::operator*(const AffineTransform& rhs) const
+{
+    AffineTransform result;
+    compose(*this, rhs, result);
+    return result;
+}
+
+AffineTransform& AffineTransform::operator*=(const AffineTransform& rhs)
+{
+    compose(*this, rhs, *this);
+    return *this;
+}
+
+Vector3f AffineTransform::transformPoint(const Vector3f& point) const
+{
+    return matrix.leftCols<3>() * point + matrix.col(3);
+}
+
+Vector3f AffineTransform::transformVector(const Vector3f& vector) const
+{
+    return matrix.leftCols<3>() * vector;
+}
+
+AffineTransform AffineTransform::inverse() const
+{
+    // [A a]^-1   [A^-1  -A^-1 a]
+    // [0 1]    = [0        1   ]
+    Eigen::Matrix3f const inverseLinear = matrix.leftCols<3>().inverse();
+
+    AffineTransform result;
+    result.matrix.leftCols<3>() = inverseLinear;
+    result.matrix.col(3) = -(inverseLinear * matrix.col(3));
+    return result;
+}
+
+AffineTransform AffineTransform::rigidInverse() const
+{
+    // The inverse of a rotation is its transpose
+    Eigen::Matrix3f const inverseLinear = matrix.leftCols<3>().transpose();
+
+    AffineTransform result;
+    result.matrix.leftCols<3>() = inverseLinear;
+    result.matrix.col(3) = -(inverseLinear * matrix.col(3));
+    return result;
+}
+
+Matrix4f operator*(const Matrix4f& lhs, const AffineTransform& rhs)
+{
+    // The missing last row of rhs only contributes with the last column of lhs
+    Matrix4f result;
+    result.leftCols<3>() = lhs.leftCols<3>() * rhs.matrix.leftCols<3>();
+    result.col(3) = lhs.leftCols<3>() * rhs.matrix.col(3) + lhs.col(3);
+    return result;
+}
+
+std::ostream& operator<<(std::ostream& os, const AffineTransform& transform)
+{
+    os << transform.matrix;
+    return os;
+}
+
+} // Grafica
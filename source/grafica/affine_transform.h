@@ -0,0 +1,63 @@
+/**
+ * @file affine_transform.h
+ * @brief AffineTransform stores only the first 3 rows of an affine 4x4 matrix, as the last one is always (0, 0, 0, 1).
+ *        It takes 3/4 of the storage, and composing two of them costs 36 multiplications instead of 64.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <iostream>
+#include "simple_eigen.h"
+
+namespace Grafica
+{
+
+class AffineTransform
+{
+public:
+    /** Rotation, scale and shearing in the first 3 columns, translation in the last one */
+    Matrix34f matrix;
+
+    /** The identity */
+    AffineTransform();
+
+    explicit AffineTransform(const Matrix34f& matrix_);
+
+    /** Drops the last row, which must be (0, 0, 0, 1) */
+    static AffineTransform fromMatrix4f(const Matrix4f& matrix4);
+
+    /** To be used at upload time, or when mixing with projections */
+    Matrix4f toMatrix4f() const;
+
+    /** this * rhs */
+    AffineTransform operator*(const AffineTransform& rhs) const;
+
+    AffineTransform& operator*=(const AffineTransform& rhs);
+
+    /** Applies translation, w = 1 */
+    Vector3f transformPoint(const Vector3f& point) const;
+
+    /** Ignores translation, w = 0 */
+    Vector3f transformVector(const Vector3f& vector) const;
+
+    inline Vector3f translation() const { return matrix.col(3); }
+
+    /** General inverse, the linear part must be invertible */
+    AffineTransform inverse() const;
+
+    /** Faster inverse, only valid for rotations and translations */
+    AffineTransform rigidInverse() const;
+};
+
+/** result = lhs * rhs, writing in place. result may be one of the operands. */
+void compose(const AffineTransform& lhs, const AffineTransform& rhs, AffineTransform& result);
+
+/** Convenient when mixing with view and projection matrices */
+Matrix4f operator*(const Matrix4f& lhs, const AffineTransform& rhs);
+
+std::ostream& operator<<(std::ostream& os, const AffineTransform& transform);
+
+} // Grafica
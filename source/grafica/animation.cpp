@@ -0,0 +1,345 @@
+/**
+ * @file animation.cpp
+ * @brief Keyframe animation: clips with translation, rotation and scale tracks, blended by an Animator
+ *        into the local transforms of many scene graph nodes at once.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "animation.h"
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <unordered_map>
+#include <ciso646>
+#include "transformations.h"
+
+namespace Grafica
+{
+
+AffineTransform TransformTRS::toAffineTransform() const
+{
+    return Transformations::translateRotateScale(translation, rotation, scale);
+}
+
+Matrix4f TransformTRS::toMatrix4f() const
+{
+    return toAffineTransform().toMatrix4f();
+}
+
+AnimationClip::AnimationClip(const std::string& name):
+    _name(name),
+    _duration(0)
+{
+}
+
+ChannelIndex AnimationClip::addChannel(const std::string& targetName)
+{
+    _channels.push_back({targetName, {}, {}, {}});
+    return static_cast<ChannelIndex>(_channels.size() - 1);
+}
+
+KeyRange AnimationClip::appendVectorKeys(const std::vector<float>& times, const std::vector<Vector3f>& values)
+{
+    assert(times.size() == values.size());
+    assert(std::is_sorted(times.begin(), times.end()));
+
+    KeyRange const range{static_cast<std::uint32_t>(_vectorTimes.size()), static_cast<std::uint32_t>(times.size())};
+    _vectorTimes.insert(_vectorTimes.end(), times.begin(), times.end());
+    _vectorValues.insert(_vectorValues.end(), values.begin(), values.end());
+
+    if (not times.empty())
+        _duration = std::max(_duration, times.back());
+
+    return range;
+}
+
+void AnimationClip::setTranslationKeys(ChannelIndex channel, const std::vector<float>& times, const std::vector<Vector3f>& values)
+{
+    _channels[channel].translation = appendVectorKeys(times, values);
+}
+
+void AnimationClip::setScaleKeys(ChannelIndex channel, const std::vector<float>& times, const std::vector<Vector3f>& values)
+{
+    _channels[channel].scale = appendVectorKeys(times, values);
+}
+
+void AnimationClip::setRotationKeys(ChannelIndex channel, const std::vector<float>& times, const std::vector<Quaternion>& values)
+{
+    assert(times.size() == values.size());
+    assert(std::is_sorted(times.begin(), times.end()));
+
+    _channels[channel].rotation = {static_cast<std::uint32_t>(_rotationTimes.size()), static_cast<std::uint32_t>(times.size())};
+    _rotationTimes.insert(_rotationTimes.end(), times.begin(), times.end());
+    _rotationValues.insert(_rotationValues.end(), values.begin(), values.end());
+
+    if (not times.empty())
+        _duration = std::max(_duration, times.back());
+}
+
+std::uint32_t findKey(const float* times, std::uint32_t count, float time, std::uint32_t& cursor)
+{
+    if (cursor >= count or times[cursor] > time)
+    {
+        // Time went backwards, e.g. a loop started again
+        auto const it = std::upper_bound(times, times + count, time);
+        cursor = it == times ? 0 : static_cast<std::uint32_t>(it - times - 1);
+        return cursor;
+    }
+
+    // Usually zero or one step
+    while (cursor + 1 < count and times[cursor + 1] <= time)
+        ++cursor;
+
+    return cursor;
+}
+
+namespace
+{
+    /* Position of time between the key and the next one, in [0, 1] */
+    float keyFraction(const float* times, std::uint32_t key, std::uint32_t count, float time)
+    {
+        if (key + 1 >= count or time <= times[key])
+            return 0;
+
+        float const interval = times[key + 1] - times[key];
+        return interval > 0 ? std::min((time - times[key]) / interval, 1.0f) : 0;
+    }
+
+    Vector3f sampleVector(const AnimationClip& clip, const KeyRange& range, float time, std::uint32_t& cursor, const Vector3f& fallback)
+    {
+        if (range.count == 0)
+            return fallback;
+
+        const float* times = clip.vectorTimes().data() + range.first;
+        const Vector3f* values = clip.vectorValues().data() + range.first;
+
+        std::uint32_t const key = findKey(times, range.count, time, cursor);
+        float const alpha = keyFraction(times, key, range.count, time);
+
+        if (alpha == 0)
+            return values[key];
+
+        return (1 - alpha) * values[key] + alpha * values[key + 1];
+    }
+
+    Quaternion sampleRotation(const AnimationClip& clip, const KeyRange& range, float time, std::uint32_t& cursor, const Quaternion& fallback)
+    {
+        if (range.count == 0)
+            return fallback;
+
+        const float* times = clip.rotationTimes().data() + range.first;
+        const Quaternion* values = clip.rotationValues().data() + range.first;
+
+        std::uint32_t const key = findKey(times, range.count, time, cursor);
+        float const alpha = keyFraction(times, key, range.count, time);
+
+        if (alpha == 0)
+            return values[key];
+
+        return slerp(values[key], values[key + 1], alpha);
+    }
+}
+
+Animator::Animator(const std::vector<std::string>& targetNames):
+    _targetNames(targetNames),
+    _restPoses(targetNames.size()),
+    _pose(targetNames.size())
+{
+    rebuildContributions();
+}
+
+LayerIndex Animator::addClip(const AnimationClip& clip, float weight, bool loop)
+{
+    std::unordered_map<std::string, std::uint32_t> targetsByName;
+    for (std::uint32_t target = 0; target < _targetNames.size(); ++target)
+        targetsByName.try_emplace(_targetNames[target], target);
+
+    Layer layer{&clip, weight, 0.0f, loop, {}, {}, {}};
+    for (auto const& channel : clip.channels())
+    {
+        auto it = targetsByName.find(channel.targetName);
+        layer.targets.push_back(it == targetsByName.end() ? NO_TARGET : it->second);
+    }
+    layer.cursors.assign(3 * clip.channels().size(), 0);
+    layer.samples.resize(clip.channels().size());
+
+    _layers.push_back(std::move(layer));
+    rebuildContributions();
+
+    return static_cast<LayerIndex>(_layers.size() - 1);
+}
+
+void Animator::rebuildContributions()
+{
+    std::size_t const targetsCount = _targetNames.size();
+
+    // Counting sort of the (layer, channel) pairs by target
+    _contributionOffsets.assign(targetsCount + 1, 0);
+    for (auto const& layer : _layers)
+        for (auto target : layer.targets)
+            if (target != NO_TARGET)
+                ++_contributionOffsets[target + 1];
+
+    for (std::size_t target = 0; target < targetsCount; ++target)
+        _contributionOffsets[target + 1] += _contributionOffsets[target];
+
+    _contributions.resize(_contributionOffsets.back());
+    std::vector<std::uint32_t> next(_contributionOffsets.begin(), _contributionOffsets.end() - 1);
+
+    for (LayerIndex layerIndex = 0; layerIndex < _layers.size(); ++layerIndex)
+    {
+        auto const& targets = _layers[layerIndex].targets;
+        for (ChannelIndex channel = 0; channel < targets.size(); ++channel)
+            if (targets[channel] != NO_TARGET)
+                _contributions[next[targets[channel]]++] = {layerIndex, channel};
+    }
+}
+
+void Animator::setRestPose(std::uint32_t target, const TransformTRS& restPose)
+{
+    _restPoses[target] = restPose;
+}
+
+void Animator::setWeight(LayerIndex layer, float weight)
+{
+    _layers[layer].weight = weight;
+}
+
+void Animator::setTime(LayerIndex layer, float time)
+{
+    _layers[layer].time = time;
+}
+
+void Animator::advance(float deltaTime)
+{
+    for (auto& layer : _layers)
+        layer.time += deltaTime;
+}
+
+void Animator::sampleLayer(Layer& layer)
+{
+    const AnimationClip& clip = *layer.clipPtr;
+    float const duration = clip.duration();
+
+    // The time stored keeps growing, only the sampled time wraps or clamps
+    float time = layer.time;
+    if (duration > 0)
+        time = layer.loop ? time - duration * std::floor(time / duration) : std::clamp(time, 0.0f, duration);
+
+    auto const& channels = clip.channels();
+    for (ChannelIndex channel = 0; channel < channels.size(); ++channel)
+    {
+        std::uint32_t const target = layer.targets[channel];
+        if (target == NO_TARGET)
+            continue;
+
+        auto const& tracks = channels[channel];
+        TransformTRS const& rest = _restPoses[target];
+        TransformTRS& sample = layer.samples[channel];
+        std::uint32_t* cursors = layer.cursors.data() + 3 * channel;
+
+        sample.translation = sampleVector(clip, tracks.translation, time, cursors[0], rest.translation);
+        sample.rotation = sampleRotation(clip, tracks.rotation, time, cursors[1], rest.rotation);
+        sample.scale = sampleVector(clip, tracks.scale, time, cursors[2], rest.scale);
+    }
+}
+
+void Animator::blendTarget(std::uint32_t target)
+{
+    Vector3f translation(0, 0, 0);
+    Vector3f scale(0, 0, 0);
+    Quaternion rotation{0, 0, 0, 0};
+    float totalWeight = 0;
+
+    for (std::uint32_t i = _contributionOffsets[target]; i < _contributionOffsets[target + 1]; ++i)
+    {
+        Layer const& layer = _layers[_contributions[i].layer];
+        if (layer.weight <= 0)
+            continue;
+
+        TransformTRS const& sample = layer.samples[_contributions[i].channel];
+        float const weight = layer.weight;
+
+        translation += weight * sample.translation;
+        scale += weight * sample.scale;
+
+        // q and -q are the same rotation, every sample is taken to the side of the first one
+        float const rotationWeight = (totalWeight > 0 and rotation.dot(sample.rotation) < 0) ? -weight : weight;
+        rotation.w += rotationWeight * sample.rotation.w;
+        rotation.x += rotationWeight * sample.rotation.x;
+        rotation.y += rotationWeight * sample.rotation.y;
+        rotation.z += rotationWeight * sample.rotation.z;
+
+        totalWeight += weight;
+    }
+
+    if (totalWeight <= 0)
+    {
+        _pose[target] = _restPoses[target];
+        return;
+    }
+
+    // Weights are normalized, so they do not need to add up to one
+    _pose[target].translation = translation / totalWeight;
+    _pose[target].scale = scale / totalWeight;
+    _pose[target].rotation = rotation.normalized();
+}
+
+void Animator::evaluate(ThreadPool& threadPool)
+{
+    threadPool.parallelFor(0, _layers.size(), 1, [this](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t layer = begin; layer < end; ++layer)
+            sampleLayer(_layers[layer]);
+    });
+
+    // Targets are independent once every layer is sampled
+    constexpr std::size_t TARGETS_PER_TASK = 256;
+    threadPool.parallelFor(0, _targetNames.size(), TARGETS_PER_TASK, [this](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t target = begin; target < end; ++target)
+            blendTarget(static_cast<std::uint32_t>(target));
+    });
+}
+
+void Animator::apply(FlatSceneGraph& flatSceneGraph, const std::vector<NodeIndex>& nodes) const
+{
+    for (std::size_t target = 0; target < nodes.size() and target < _pose.size(); ++target)
+    {
+        if (nodes[target] != NO_PARENT)
+            flatSceneGraph.setLocalTransform(nodes[target], _pose[target].toMatrix4f());
+    }
+}
+
+void Animator::apply(const std::vector<SceneGraphNodePtr>& nodes) const
+{
+    for (std::size_t target = 0; target < nodes.size() and target < _pose.size(); ++target)
+    {
+        if (nodes[target])
+            nodes[target]->setTransform(_pose[target].toMatrix4f());
+    }
+}
+
+std::vector<NodeIndex> Animator::findTargets(const FlatSceneGraph& flatSceneGraph) const
+{
+    // One pass over the graph instead of a search per target, the first node with each name wins
+    std::unordered_map<std::string, NodeIndex> nodesByName;
+    for (NodeIndex node = 0; node < flatSceneGraph.size(); ++node)
+        nodesByName.try_emplace(flatSceneGraph.name(node), node);
+
+    std::vector<NodeIndex> nodes;
+    nodes.reserve(_targetNames.size());
+
+    for (auto const& name : _targetNames)
+    {
+        auto it = nodesByName.find(name);
+        nodes.push_back(it == nodesByName.end() ? NO_PARENT : it->second);
+    }
+
+    return nodes;
+}
+
+} // Grafica
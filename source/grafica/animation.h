@@ -0,0 +1,186 @@
+/**
+ * @file animation.h
+ * @brief Keyframe animation: clips with translation, rotation and scale tracks, blended by an Animator
+ *        into the local transforms of many scene graph nodes at once.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <limits>
+#include "affine_transform.h"
+#include "flat_scene_graph.h"
+#include "quaternion.h"
+#include "scene_graph.h"
+#include "simple_eigen.h"
+#include "thread_pool.h"
+
+namespace Grafica
+{
+
+/** Translation, rotation and scale, the local transform of an animated node */
+struct TransformTRS
+{
+    Vector3f translation = Vector3f(0, 0, 0);
+    Quaternion rotation;
+    Vector3f scale = Vector3f(1, 1, 1);
+
+    AffineTransform toAffineTransform() const;
+
+    Matrix4f toMatrix4f() const;
+};
+
+/** Keys of a track, as a range in the key arrays of its clip */
+struct KeyRange
+{
+    std::uint32_t first = 0;
+    std::uint32_t count = 0;
+};
+
+/** The tracks animating one node, found by name when the clip is added to an Animator */
+struct AnimationChannel
+{
+    std::string targetName;
+    KeyRange translation;
+    KeyRange rotation;
+    KeyRange scale;
+};
+
+using ChannelIndex = std::uint32_t;
+
+/** Keys of every track are stored contiguously in a few arrays shared by the whole clip,
+ * so sampling a clip walks memory forward instead of chasing pointers per track.
+ */
+class AnimationClip
+{
+public:
+    explicit AnimationClip(const std::string& name);
+
+    ChannelIndex addChannel(const std::string& targetName);
+
+    /** times must be sorted and have the same size as values. Each track is set once. */
+    void setTranslationKeys(ChannelIndex channel, const std::vector<float>& times, const std::vector<Vector3f>& values);
+
+    void setRotationKeys(ChannelIndex channel, const std::vector<float>& times, const std::vector<Quaternion>& values);
+
+    void setScaleKeys(ChannelIndex channel, const std::vector<float>& times, const std::vector<Vector3f>& values);
+
+    inline const std::string& name() const { return _name; }
+
+    /** Time of the last key of any track */
+    inline float duration() const { return _duration; }
+
+    inline const std::vector<AnimationChannel>& channels() const { return _channels; }
+
+    inline const std::vector<float>& vectorTimes() const { return _vectorTimes; }
+    inline const std::vector<Vector3f>& vectorValues() const { return _vectorValues; }
+    inline const std::vector<float>& rotationTimes() const { return _rotationTimes; }
+    inline const std::vector<Quaternion>& rotationValues() const { return _rotationValues; }
+
+private:
+    KeyRange appendVectorKeys(const std::vector<float>& times, const std::vector<Vector3f>& values);
+
+    std::string _name;
+    float _duration;
+    std::vector<AnimationChannel> _channels;
+
+    /* Translation and scale keys */
+    std::vector<float> _vectorTimes;
+    std::vector<Vector3f> _vectorValues;
+
+    std::vector<float> _rotationTimes;
+    std::vector<Quaternion> _rotationValues;
+};
+
+/** Index of the key at or before time, within a track of count keys.
+ * cursor is the result of the previous call: when time moves forward, as in regular playback,
+ * the search continues from there in constant time; otherwise it falls back to a binary search.
+ */
+std::uint32_t findKey(const float* times, std::uint32_t count, float time, std::uint32_t& cursor);
+
+using LayerIndex = std::uint32_t;
+
+constexpr std::uint32_t NO_TARGET = std::numeric_limits<std::uint32_t>::max();
+
+/** Plays several clips at the same time over a fixed set of targets and blends them by weight.
+ * Targets are identified by name, and by their position in the list given to the constructor.
+ */
+class Animator
+{
+public:
+    explicit Animator(const std::vector<std::string>& targetNames);
+
+    /** Channels whose target name is not a target of this animator are ignored.
+     * The clip must outlive the animator. */
+    LayerIndex addClip(const AnimationClip& clip, float weight = 1.0f, bool loop = true);
+
+    /** Transform of a target when no clip animates it, or for the tracks a channel does not have */
+    void setRestPose(std::uint32_t target, const TransformTRS& restPose);
+
+    void setWeight(LayerIndex layer, float weight);
+
+    void setTime(LayerIndex layer, float time);
+
+    inline float time(LayerIndex layer) const { return _layers[layer].time; }
+
+    /** Moves the time of every layer */
+    void advance(float deltaTime);
+
+    /** Samples every layer, in parallel across clips, then blends them in parallel across targets */
+    void evaluate(ThreadPool& threadPool = defaultThreadPool());
+
+    /** The blended transforms, one per target. Only valid after evaluate. */
+    inline const std::vector<TransformTRS>& pose() const { return _pose; }
+
+    inline std::size_t targetsCount() const { return _targetNames.size(); }
+
+    /** Writes the pose as local transforms, nodes[i] being the node of target i */
+    void apply(FlatSceneGraph& flatSceneGraph, const std::vector<NodeIndex>& nodes) const;
+
+    /** Same as above for SceneGraphNodes, invalidating their bounds so culling sees the new transforms */
+    void apply(const std::vector<SceneGraphNodePtr>& nodes) const;
+
+    /** Nodes of the targets in a FlatSceneGraph, by name. Missing ones are NO_PARENT and skipped by apply. */
+    std::vector<NodeIndex> findTargets(const FlatSceneGraph& flatSceneGraph) const;
+
+private:
+    struct Layer
+    {
+        const AnimationClip* clipPtr;
+        float weight;
+        float time;
+        bool loop;
+
+        /* Per channel: its target, 3 cursors (translation, rotation, scale) and the last sample */
+        std::vector<std::uint32_t> targets;
+        std::vector<std::uint32_t> cursors;
+        std::vector<TransformTRS> samples;
+    };
+
+    /* A channel of a layer animating a target */
+    struct Contribution
+    {
+        LayerIndex layer;
+        ChannelIndex channel;
+    };
+
+    void sampleLayer(Layer& layer);
+    void blendTarget(std::uint32_t target);
+    void rebuildContributions();
+
+    std::vector<std::string> _targetNames;
+    std::vector<TransformTRS> _restPoses;
+    std::vector<Layer> _layers;
+    std::vector<TransformTRS> _pose;
+
+    /* Contributions grouped by target: those of target i are in [_contributionOffsets[i], _contributionOffsets[i + 1]) */
+    std::vector<Contribution> _contributions;
+    std::vector<std::uint32_t> _contributionOffsets;
+};
+
+} // Grafica
@@ -0,0 +1,290 @@
+/**
+ * @file bounds.cpp
+ * @brief Bounding volumes (axis aligned boxes and spheres), view frustums and rays, to discard geometry early.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "bounds.h"
+
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <ciso646>
+#include "simd.h"
+
+namespace Grafica
+{
+
+AABB AABB::empty()
+{
+    constexpr Coord infinity = std::numeric_limits<Coord>::infinity();
+    return {Vector3f(infinity, infinity, infinity), Vector3f(-infinity, -infinity, -infinity)};
+}
+
+bool AABB::isEmpty() const
+{
+    return min[0] > max[0] or min[1] > max[1] or min[2] > max[2];
+}
+
+void AABB::extend(const Vector3f& point)
+{
+    min = min.cwiseMin(point);
+    max = max.cwiseMax(point);
+}
+
+void AABB::extend(const AABB& other)
+{
+    min = min.cwiseMin(other.min);
+    max = max.cwiseMax(other.max);
+}
+
+AABB computeAABB(const Shape& shape)
+{
+    AABB aabb = AABB::empty();
+
+    for (std::size_t i = 0; i + 2 < shape.vertices.size(); i += shape.stride)
+        aabb.extend(Vector3f(shape.vertices[i], shape.vertices[i + 1], shape.vertices[i + 2]));
+
+    return aabb;
+}
+
+BoundingSphere computeBoundingSphere(const Shape& shape)
+{
+    AABB const aabb = computeAABB(shape);
+    if (aabb.isEmpty())
+        return {Vector3f(0, 0, 0), 0};
+
+    Vector3f const center = aabb.center();
+    Coord squaredRadius = 0;
+
+    for (std::size_t i = 0; i + 2 < shape.vertices.size(); i += shape.stride)
+    {
+        Vector3f const position(shape.vertices[i], shape.vertices[i + 1], shape.vertices[i + 2]);
+        squaredRadius = std::max(squaredRadius, (position - center).squaredNorm());
+    }
+
+    return {center, std::sqrt(squaredRadius)};
+}
+
+AABB transformAABB(const AABB& aabb, const Matrix4f& transform)
+{
+    if (aabb.isEmpty())
+        return aabb;
+
+    // Arvo's method: the new extents are the old ones through the absolute value of the linear part
+    Vector3f const center = aabb.center();
+    Vector3f const extents = aabb.extents();
+
+    Vector3f const newCenter = transform.block<3, 3>(0, 0) * center + transform.block<3, 1>(0, 3);
+    Vector3f const newExtents = transform.block<3, 3>(0, 0).cwiseAbs() * extents;
+
+    return {newCenter - newExtents, newCenter + newExtents};
+}
+
+Frustum extractFrustum(const Matrix4f& viewProjection)
+{
+    // Gribb & Hartmann: each plane is the last row plus or minus one of the others
+    Vector4f const rows[4] = {
+        viewProjection.row(0).transpose(),
+        viewProjection.row(1).transpose(),
+        viewProjection.row(2).transpose(),
+        viewProjection.row(3).transpose()};
+
+    Vector4f const planes[Frustum::PLANES_COUNT] = {
+        rows[3] + rows[0], // left
+        rows[3] - rows[0], // right
+        rows[3] + rows[1], // bottom
+        rows[3] - rows[1], // top
+        rows[3] + rows[2], // near
+        rows[3] - rows[2]  // far
+    };
+
+    Frustum frustum;
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        if (i < Frustum::PLANES_COUNT)
+        {
+            Vector4f const& plane = planes[i];
+            Coord const length = plane.head<3>().norm();
+            frustum.a[i] = plane[0] / length;
+            frustum.b[i] = plane[1] / length;
+            frustum.c[i] = plane[2] / length;
+            frustum.d[i] = plane[3] / length;
+        }
+        else
+        {
+            // Padding planes accept everything
+            frustum.a[i] = frustum.b[i] = frustum.c[i] = 0;
+            frustum.d[i] = 1;
+        }
+    }
+
+    return frustum;
+}
+
+bool intersects(const Frustum& frustum, const AABB& aabb)
+{
+    Vector3f const center = aabb.center();
+    Vector3f const extents = aabb.extents();
+
+#if defined(GRAFICA_USE_SSE2)
+    __m128 const centerX = _mm_set1_ps(center[0]), centerY = _mm_set1_ps(center[1]), centerZ = _mm_set1_ps(center[2]);
+    __m128 const extentX = _mm_set1_ps(extents[0]), extentY = _mm_set1_ps(extents[1]), extentZ = _mm_set1_ps(extents[2]);
+    __m128 const signMask = _mm_set1_ps(-0.0f);
+
+    for (unsigned int i = 0; i < 8; i += 4)
+    {
+        __m128 const a = _mm_load_ps(frustum.a + i);
+        __m128 const b = _mm_load_ps(frustum.b + i);
+        __m128 const c = _mm_load_ps(frustum.c + i);
+
+        // signed distance from the center, and the projected radius of the box over the normal
+        __m128 const distance = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(a, centerX), _mm_mul_ps(b, centerY)),
+            _mm_add_ps(_mm_mul_ps(c, centerZ), _mm_load_ps(frustum.d + i)));
+        __m128 const radius = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, a), extentX), _mm_mul_ps(_mm_andnot_ps(signMask, b), extentY)),
+            _mm_mul_ps(_mm_andnot_ps(signMask, c), extentZ));
+
+        if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps())) != 0)
+            return false;
+    }
+#else
+    for (unsigned int i = 0; i < Frustum::PLANES_COUNT; ++i)
+    {
+        Coord const distance = frustum.a[i] * center[0] + frustum.b[i] * center[1] + frustum.c[i] * center[2] + frustum.d[i];
+        Coord const radius = std::abs(frustum.a[i]) * extents[0] + std::abs(frustum.b[i]) * extents[1] + std::abs(frustum.c[i]) * extents[2];
+
+        if (distance + radius < 0)
+            return false;
+    }
+#endif
+
+    return true;
+}
+
+FrustumIntersection classify(const Frustum& frustum, const AABB& aabb)
+{
+    Vector3f const center = aabb.center();
+    Vector3f const extents = aabb.extents();
+    bool inside = true;
+
+#if defined(GRAFICA_USE_SSE2)
+    __m128 const centerX = _mm_set1_ps(center[0]), centerY = _mm_set1_ps(center[1]), centerZ = _mm_set1_ps(center[2]);
+    __m128 const extentX = _mm_set1_ps(extents[0]), extentY = _mm_set1_ps(extents[1]), extentZ = _mm_set1_ps(extents[2]);
+    __m128 const signMask = _mm_set1_ps(-0.0f);
+
+    for (unsigned int i = 0; i < 8; i += 4)
+    {
+        __m128 const a = _mm_load_ps(frustum.a + i);
+        __m128 const b = _mm_load_ps(frustum.b + i);
+        __m128 const c = _mm_load_ps(frustum.c + i);
+
+        __m128 const distance = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(a, centerX), _mm_mul_ps(b, centerY)),
+            _mm_add_ps(_mm_mul_ps(c, centerZ), _mm_load_ps(frustum.d + i)));
+        __m128 const radius = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, a), extentX), _mm_mul_ps(_mm_andnot_ps(signMask, b), extentY)),
+            _mm_mul_ps(_mm_andnot_ps(signMask, c), extentZ));
+
+        if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps())) != 0)
+            return FrustumIntersection::Outside;
+
+        if (_mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(distance, radius), _mm_setzero_ps())) != 0)
+            inside = false;
+    }
+#else
+    for (unsigned int i = 0; i < Frustum::PLANES_COUNT; ++i)
+    {
+        Coord const distance = frustum.a[i] * center[0] + frustum.b[i] * center[1] + frustum.c[i] * center[2] + frustum.d[i];
+        Coord const radius = std::abs(frustum.a[i]) * extents[0] + std::abs(frustum.b[i]) * extents[1] + std::abs(frustum.c[i]) * extents[2];
+
+        if (distance + radius < 0)
+            return FrustumIntersection::Outside;
+
+        if (distance - radius < 0)
+            inside = false;
+    }
+#endif
+
+    return inside ? FrustumIntersection::Inside : FrustumIntersection::Intersecting;
+}
+
+bool intersects(const Frustum& frustum, const BoundingSphere& sphere)
+{
+    for (unsigned int i = 0; i < Frustum::PLANES_COUNT; ++i)
+    {
+        Coord const distance = frustum.a[i] * sphere.center[0] + frustum.b[i] * sphere.center[1] + frustum.c[i] * sphere.center[2] + frustum.d[i];
+        if (distance < -sphere.radius)
+            return false;
+    }
+
+    return true;
+}
+
+Ray rayFromScreen(Coord x, Coord y, Coord width, Coord height, const Matrix4f& projection, const Matrix4f& view)
+{
+    Coord const ndcX = 2 * x / width - 1;
+    Coord const ndcY = 1 - 2 * y / height;
+
+    // The pixel on the near and far planes, back in world coordinates
+    Matrix4f const inverse = (projection * view).inverse();
+    Vector4f const nearPoint = inverse * Vector4f(ndcX, ndcY, -1, 1);
+    Vector4f const farPoint = inverse * Vector4f(ndcX, ndcY, 1, 1);
+
+    Vector3f const origin = nearPoint.head<3>() / nearPoint[3];
+    Vector3f const end = farPoint.head<3>() / farPoint[3];
+
+    return {origin, (end - origin).normalized()};
+}
+
+std::optional<Coord> intersect(const Ray& ray, const AABB& aabb, Coord maxDistance)
+{
+    Coord entry = 0;
+    Coord exit = maxDistance;
+
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+        Coord const origin = ray.origin[axis];
+        Coord const direction = ray.direction[axis];
+
+        // Parallel to the slab, it is either always or never between its planes
+        if (direction == 0)
+        {
+            if (origin < aabb.min[axis] or origin > aabb.max[axis])
+                return std::nullopt;
+            continue;
+        }
+
+        Coord const inverse = 1 / direction;
+        Coord near = (aabb.min[axis] - origin) * inverse;
+        Coord far = (aabb.max[axis] - origin) * inverse;
+        if (near > far)
+            std::swap(near, far);
+
+        entry = std::max(entry, near);
+        exit = std::min(exit, far);
+        if (entry > exit)
+            return std::nullopt;
+    }
+
+    return entry;
+}
+
+Coord squaredDistance(const Vector3f& point, const AABB& aabb)
+{
+    Vector3f const closest = point.cwiseMax(aabb.min).cwiseMin(aabb.max);
+    return (point - closest).squaredNorm();
+}
+
+std::ostream& operator<<(std::ostream& os, const AABB& aabb)
+{
+    os << "{ min: [" << aabb.min[0] << ", " << aabb.min[1] << ", " << aabb.min[2] << "]"
+        << ", max: [" << aabb.max[0] << ", " << aabb.max[1] << ", " << aabb.max[2] << "]}";
+    return os;
+}
+
+} // Grafica
@@ -0,0 +1,101 @@
+/**
+ * @file bounds.h
+ * @brief Bounding volumes (axis aligned boxes and spheres), view frustums and rays, to discard geometry early.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <iostream>
+#include <limits>
+#include <optional>
+#include "shape.h"
+#include "simple_eigen.h"
+
+namespace Grafica
+{
+
+/** Axis aligned bounding box. An empty box has min > max, so extending it with any point gives that point. */
+struct AABB
+{
+    Vector3f min;
+    Vector3f max;
+
+    static AABB empty();
+
+    bool isEmpty() const;
+
+    void extend(const Vector3f& point);
+
+    void extend(const AABB& other);
+
+    inline Vector3f center() const { return (min + max) / 2; }
+
+    /** Half size along each axis */
+    inline Vector3f extents() const { return (max - min) / 2; }
+};
+
+struct BoundingSphere
+{
+    Vector3f center;
+    Coord radius;
+};
+
+/** Bounds of the positions of a shape, the first 3 coordinates of every vertex */
+AABB computeAABB(const Shape& shape);
+
+/** Sphere centered in the AABB center, enclosing every vertex */
+BoundingSphere computeBoundingSphere(const Shape& shape);
+
+/** Box enclosing the given one after an affine transformation (it is not a tight fit under rotations) */
+AABB transformAABB(const AABB& aabb, const Matrix4f& transform);
+
+/** The 6 planes of a view frustum, with normals pointing inside.
+ * Planes are stored as structure of arrays padded to 8, so they can be tested 4 at a time.
+ */
+struct Frustum
+{
+    static constexpr unsigned int PLANES_COUNT = 6;
+
+    alignas(16) Coord a[8];
+    alignas(16) Coord b[8];
+    alignas(16) Coord c[8];
+    alignas(16) Coord d[8];
+};
+
+/** Planes of projection * view, so they are in world coordinates. With projection * view * model, in model coordinates. */
+Frustum extractFrustum(const Matrix4f& viewProjection);
+
+/** Conservative test: false only if the box is completely outside one of the planes */
+bool intersects(const Frustum& frustum, const AABB& aabb);
+
+enum class FrustumIntersection { Outside, Intersecting, Inside };
+
+/** As intersects, but also tells when the box is completely inside, so the planes need no further tests below it */
+FrustumIntersection classify(const Frustum& frustum, const AABB& aabb);
+
+bool intersects(const Frustum& frustum, const BoundingSphere& sphere);
+
+/** Half line origin + t * direction, t >= 0. The direction does not need to be normalized, distances are measured in its units. */
+struct Ray
+{
+    Vector3f origin;
+    Vector3f direction;
+};
+
+/** The ray through a pixel, from the camera into the scene. x and y are window coordinates, with y growing downwards
+ * as reported by GLFW. The direction is normalized.
+ */
+Ray rayFromScreen(Coord x, Coord y, Coord width, Coord height, const Matrix4f& projection, const Matrix4f& view);
+
+/** Slab test: the distance at which the ray enters the box, 0 if it starts inside, nullopt if it misses it before maxDistance */
+std::optional<Coord> intersect(const Ray& ray, const AABB& aabb, Coord maxDistance = std::numeric_limits<Coord>::infinity());
+
+/** Squared distance from a point to the closest point of the box, 0 inside */
+Coord squaredDistance(const Vector3f& point, const AABB& aabb);
+
+std::ostream& operator<<(std::ostream& os, const AABB& aabb);
+
+} // Grafica
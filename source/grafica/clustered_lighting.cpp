@@ -0,0 +1,360 @@
+/**
+ * @file clustered_lighting.cpp
+ * @brief Clustered forward lighting: the view frustum is split in screen tiles times depth slices,
+ *        and each cluster gets the list of point lights reaching it, so fragments only shade those lights.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "clustered_lighting.h"
+
+#include <bit>
+#include <cmath>
+#include <algorithm>
+#include <ciso646>
+#include "simd.h"
+
+namespace Grafica
+{
+
+namespace
+{
+    // Lights in view space, structure of arrays, padded to a multiple of 4 so SIMD loads never go out of bounds
+    struct LightSpheres
+    {
+        std::vector<Coord> x, y, z, squaredRadius;
+        std::vector<std::uint32_t> index;
+
+        void clear()
+        {
+            x.clear(); y.clear(); z.clear(); squaredRadius.clear(); index.clear();
+        }
+
+        void push(Coord x_, Coord y_, Coord z_, Coord radius, std::uint32_t index_)
+        {
+            x.push_back(x_); y.push_back(y_); z.push_back(z_);
+            squaredRadius.push_back(radius * radius);
+            index.push_back(index_);
+        }
+
+        void pad()
+        {
+            // A negative squared radius never intersects anything
+            while (x.size() % 4 != 0)
+            {
+                push(0, 0, 0, 0, 0);
+                squaredRadius.back() = -1;
+            }
+        }
+    };
+
+    struct AABB
+    {
+        Coord min[3], max[3];
+    };
+
+    // Appends to output the lights intersecting the box
+    void intersectSpheresAABB(const LightSpheres& spheres, const AABB& box, std::vector<std::uint32_t>& output)
+    {
+        std::size_t const count = spheres.x.size();
+
+#if defined(GRAFICA_USE_SSE2)
+        __m128 const zero = _mm_setzero_ps();
+        __m128 const minX = _mm_set1_ps(box.min[0]), maxX = _mm_set1_ps(box.max[0]);
+        __m128 const minY = _mm_set1_ps(box.min[1]), maxY = _mm_set1_ps(box.max[1]);
+        __m128 const minZ = _mm_set1_ps(box.min[2]), maxZ = _mm_set1_ps(box.max[2]);
+
+        for (std::size_t i = 0; i < count; i += 4)
+        {
+            __m128 const x = _mm_loadu_ps(&spheres.x[i]);
+            __m128 const y = _mm_loadu_ps(&spheres.y[i]);
+            __m128 const z = _mm_loadu_ps(&spheres.z[i]);
+
+            // distance from the center to the box along each axis, 0 when inside
+            __m128 const dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, x), _mm_sub_ps(x, maxX)), zero);
+            __m128 const dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, y), _mm_sub_ps(y, maxY)), zero);
+            __m128 const dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, z), _mm_sub_ps(z, maxZ)), zero);
+
+            __m128 const squaredDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            unsigned int mask = _mm_movemask_ps(_mm_cmple_ps(squaredDistance, _mm_loadu_ps(&spheres.squaredRadius[i])));
+
+            while (mask != 0)
+            {
+                output.push_back(spheres.index[i + std::countr_zero(mask)]);
+                mask &= mask - 1;
+            }
+        }
+#else
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Coord const dx = std::max({box.min[0] - spheres.x[i], spheres.x[i] - box.max[0], Coord(0)});
+            Coord const dy = std::max({box.min[1] - spheres.y[i], spheres.y[i] - box.max[1], Coord(0)});
+            Coord const dz = std::max({box.min[2] - spheres.z[i], spheres.z[i] - box.max[2], Coord(0)});
+
+            if (dx * dx + dy * dy + dz * dz <= spheres.squaredRadius[i])
+                output.push_back(spheres.index[i]);
+        }
+#endif
+    }
+}
+
+void assignLightsToClusters(
+    LightClusters& clusters,
+    const std::vector<PointLight>& lights,
+    const Matrix4f& view,
+    const Matrix4f& projection,
+    Coord near,
+    Coord far,
+    ClusterGridSize gridSize,
+    ThreadPool& threadPool)
+{
+    std::size_t const clustersPerSlice = gridSize.tilesX * gridSize.tilesY;
+    std::size_t const clustersCount = clustersPerSlice * gridSize.slices;
+
+    clusters.gridSize = gridSize;
+    clusters.near = near;
+    clusters.far = far;
+    clusters.offsets.assign(clustersCount, 0);
+    clusters.counts.assign(clustersCount, 0);
+    clusters.lightIndices.clear();
+
+    // Light positions in view space, where the clusters are defined
+    std::vector<Vector3f> viewPositions;
+    viewPositions.reserve(lights.size());
+    for (auto const& light : lights)
+    {
+        Vector4f const position = view * Vector4f(light.position[0], light.position[1], light.position[2], 1);
+        viewPositions.emplace_back(position[0], position[1], position[2]);
+    }
+
+    Coord const logFarNear = std::log(far / near);
+    auto sliceDepth = [&](unsigned int slice)
+    {
+        return near * std::exp(logFarNear * slice / gridSize.slices);
+    };
+
+    /* For a perspective projection, a point with view depth d projected at ndc (x, y)
+     * has view coordinates d * (x + P02) / P00 and d * (y + P12) / P11 */
+    Coord const p00 = projection(0, 0), p02 = projection(0, 2);
+    Coord const p11 = projection(1, 1), p12 = projection(1, 2);
+
+    std::vector<std::vector<std::uint32_t>> sliceIndices(gridSize.slices);
+
+    threadPool.parallelFor(0, gridSize.slices, 1, [&](std::size_t sliceBegin, std::size_t sliceEnd)
+    {
+        LightSpheres candidates;
+
+        for (std::size_t slice = sliceBegin; slice < sliceEnd; ++slice)
+        {
+            Coord const depthNear = sliceDepth(slice);
+            Coord const depthFar = sliceDepth(slice + 1);
+
+            // Only lights overlapping the slice depth range are tested against its clusters
+            candidates.clear();
+            for (std::uint32_t i = 0; i < lights.size(); ++i)
+            {
+                Coord const depth = -viewPositions[i][2];
+                if (depth + lights[i].radius >= depthNear and depth - lights[i].radius <= depthFar)
+                    candidates.push(viewPositions[i][0], viewPositions[i][1], viewPositions[i][2], lights[i].radius, i);
+            }
+            candidates.pad();
+
+            std::vector<std::uint32_t>& indices = sliceIndices[slice];
+
+            for (unsigned int tileY = 0; tileY < gridSize.tilesY; ++tileY)
+            {
+                Coord const y0 = -1 + Coord(2 * tileY) / gridSize.tilesY;
+                Coord const y1 = -1 + Coord(2 * (tileY + 1)) / gridSize.tilesY;
+                Coord const ys[] = {
+                    depthNear * (y0 + p12) / p11, depthNear * (y1 + p12) / p11,
+                    depthFar * (y0 + p12) / p11, depthFar * (y1 + p12) / p11};
+
+                for (unsigned int tileX = 0; tileX < gridSize.tilesX; ++tileX)
+                {
+                    Coord const x0 = -1 + Coord(2 * tileX) / gridSize.tilesX;
+                    Coord const x1 = -1 + Coord(2 * (tileX + 1)) / gridSize.tilesX;
+                    Coord const xs[] = {
+                        depthNear * (x0 + p02) / p00, depthNear * (x1 + p02) / p00,
+                        depthFar * (x0 + p02) / p00, depthFar * (x1 + p02) / p00};
+
+                    AABB const box{
+                        {*std::min_element(xs, xs + 4), *std::min_element(ys, ys + 4), -depthFar},
+                        {*std::max_element(xs, xs + 4), *std::max_element(ys, ys + 4), -depthNear}};
+
+                    std::size_t const cluster = tileX + gridSize.tilesX * (tileY + gridSize.tilesY * slice);
+                    std::size_t const offset = indices.size();
+
+                    intersectSpheresAABB(candidates, box, indices);
+
+                    // offsets are local to the slice for now
+                    clusters.offsets[cluster] = static_cast<std::uint32_t>(offset);
+                    clusters.counts[cluster] = static_cast<std::uint32_t>(indices.size() - offset);
+                }
+            }
+        }
+    });
+
+    // Joining the slices in a single list
+    for (unsigned int slice = 0; slice < gridSize.slices; ++slice)
+    {
+        std::uint32_t const sliceOffset = static_cast<std::uint32_t>(clusters.lightIndices.size());
+        for (std::size_t cluster = slice * clustersPerSlice; cluster < (slice + 1) * clustersPerSlice; ++cluster)
+            clusters.offsets[cluster] += sliceOffset;
+
+        clusters.lightIndices.insert(clusters.lightIndices.end(), sliceIndices[slice].begin(), sliceIndices[slice].end());
+    }
+}
+
+const std::string& clusteredLightingShaderCode()
+{
+    static const std::string shaderCode = R"(
+        // 4 texels per light: position and radius, Ld and constant attenuation,
+        // Ls and linear attenuation, quadratic attenuation.
+        uniform samplerBuffer lights;
+        uniform usamplerBuffer lightClusters;
+        uniform usamplerBuffer lightIndices;
+        uniform vec2 clusterTileSize;
+        uniform ivec3 clusterCount;
+        uniform float clusterNear;
+        uniform float clusterLogFarNear;
+        uniform vec3 viewPosition;
+
+        vec3 clusteredPhong(vec3 position, vec3 normal, float viewDepth, vec3 Kd, vec3 Ks, uint shininess)
+        {
+            // Finding the cluster of this fragment
+            ivec2 tile = clamp(ivec2(gl_FragCoord.xy / clusterTileSize), ivec2(0), clusterCount.xy - 1);
+            int slice = int(log(viewDepth / clusterNear) / clusterLogFarNear * float(clusterCount.z));
+            slice = clamp(slice, 0, clusterCount.z - 1);
+            int cluster = tile.x + clusterCount.x * (tile.y + clusterCount.y * slice);
+            uvec2 range = texelFetch(lightClusters, cluster).xy;
+
+            // fragment normal has been interpolated, so it does not necessarily have norm equal to 1
+            vec3 normalizedNormal = normalize(normal);
+            vec3 viewDir = normalize(viewPosition - position);
+
+            vec3 result = vec3(0.0);
+            for (uint i = 0u; i < range.y; i++)
+            {
+                int light = 4 * int(texelFetch(lightIndices, int(range.x + i)).r);
+                vec4 positionRadius = texelFetch(lights, light);
+                vec4 diffuseConstant = texelFetch(lights, light + 1);
+                vec4 specularLinear = texelFetch(lights, light + 2);
+                float quadraticAttenuation = texelFetch(lights, light + 3).r;
+
+                vec3 toLight = positionRadius.xyz - position;
+                float distToLight = length(toLight);
+                if (distToLight > positionRadius.w)
+                    continue;
+
+                // diffuse
+                vec3 lightDir = toLight / distToLight;
+                float diff = max(dot(normalizedNormal, lightDir), 0.0);
+                vec3 diffuse = Kd * diffuseConstant.rgb * diff;
+
+                // specular
+                vec3 reflectDir = reflect(-lightDir, normalizedNormal);
+                float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+                vec3 specular = Ks * specularLinear.rgb * spec;
+
+                // attenuation
+                float attenuation = diffuseConstant.a
+                    + specularLinear.a * distToLight
+                    + quadraticAttenuation * distToLight * distToLight;
+
+                result += (diffuse + specular) / attenuation;
+            }
+            return result;
+        }
+    )";
+    return shaderCode;
+}
+
+ClusteredLighting::ClusteredLighting(ClusterGridSize gridSize):
+    _gridSize(gridSize)
+{
+    glGenBuffers(3, _buffers);
+    glGenTextures(3, _textures);
+}
+
+void ClusteredLighting::update(
+    const std::vector<PointLight>& lights,
+    const Matrix4f& view,
+    const Matrix4f& projection,
+    Coord near,
+    Coord far,
+    unsigned int viewportWidth,
+    unsigned int viewportHeight,
+    ThreadPool& threadPool)
+{
+    _viewportWidth = viewportWidth;
+    _viewportHeight = viewportHeight;
+
+    // The camera sits at the origin of view space
+    Vector4f const viewPosition = view.inverse() * Vector4f(0, 0, 0, 1);
+    _viewPosition = Vector3f(viewPosition[0], viewPosition[1], viewPosition[2]);
+
+    assignLightsToClusters(_clusters, lights, view, projection, near, far, _gridSize, threadPool);
+
+    _lightsData.clear();
+    for (auto const& light : lights)
+    {
+        _lightsData.insert(_lightsData.end(), {
+            light.position[0], light.position[1], light.position[2], light.radius,
+            light.Ld[0], light.Ld[1], light.Ld[2], light.constantAttenuation,
+            light.Ls[0], light.Ls[1], light.Ls[2], light.linearAttenuation,
+            light.quadraticAttenuation, 0, 0, 0});
+    }
+
+    _clustersData.resize(2 * _clusters.offsets.size());
+    for (std::size_t cluster = 0; cluster < _clusters.offsets.size(); ++cluster)
+    {
+        _clustersData[2 * cluster] = _clusters.offsets[cluster];
+        _clustersData[2 * cluster + 1] = _clusters.counts[cluster];
+    }
+
+    // Empty buffers are not valid texture buffers, so at least one element is always sent
+    auto upload = [](GLuint buffer, GLuint texture, GLenum format, std::size_t bytes, const void* data)
+    {
+        static const GLuint empty[4] = {0, 0, 0, 0};
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, bytes != 0 ? bytes : sizeof(empty), bytes != 0 ? data : empty, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    };
+
+    upload(_buffers[0], _textures[0], GL_RGBA32F, _lightsData.size() * sizeof(GLfloat), _lightsData.data());
+    upload(_buffers[1], _textures[1], GL_RG32UI, _clustersData.size() * sizeof(GLuint), _clustersData.data());
+    upload(_buffers[2], _textures[2], GL_R32UI, _clusters.lightIndices.size() * sizeof(GLuint), _clusters.lightIndices.data());
+
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLighting::bind(GLuint shaderProgram, GLuint firstTextureUnit) const
+{
+    const char* const samplerNames[] = {"lights", "lightClusters", "lightIndices"};
+    for (GLuint i = 0; i < 3; ++i)
+    {
+        glActiveTexture(GL_TEXTURE0 + firstTextureUnit + i);
+        glBindTexture(GL_TEXTURE_BUFFER, _textures[i]);
+        glUniform1i(glGetUniformLocation(shaderProgram, samplerNames[i]), firstTextureUnit + i);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    glUniform2f(glGetUniformLocation(shaderProgram, "clusterTileSize"),
+        float(_viewportWidth) / _gridSize.tilesX,
+        float(_viewportHeight) / _gridSize.tilesY);
+    glUniform3i(glGetUniformLocation(shaderProgram, "clusterCount"), _gridSize.tilesX, _gridSize.tilesY, _gridSize.slices);
+    glUniform1f(glGetUniformLocation(shaderProgram, "clusterNear"), _clusters.near);
+    glUniform1f(glGetUniformLocation(shaderProgram, "clusterLogFarNear"), std::log(_clusters.far / _clusters.near));
+    glUniform3f(glGetUniformLocation(shaderProgram, "viewPosition"), _viewPosition[0], _viewPosition[1], _viewPosition[2]);
+}
+
+void ClusteredLighting::clear()
+{
+    glDeleteTextures(3, _textures);
+    glDeleteBuffers(3, _buffers);
+}
+
+} // Grafica
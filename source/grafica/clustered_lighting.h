@@ -0,0 +1,122 @@
+/**
+ * @file clustered_lighting.h
+ * @brief Clustered forward lighting: the view frustum is split in screen tiles times depth slices,
+ *        and each cluster gets the list of point lights reaching it, so fragments only shade those lights.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "simple_eigen.h"
+#include "thread_pool.h"
+
+namespace Grafica
+{
+
+/** A point light following the Phong model of PhongColorShaderProgram.
+ * Beyond radius the light is ignored, so it should be where the attenuation makes it negligible.
+ */
+struct PointLight
+{
+    Vector3f position;
+    Coord radius;
+    Vector3f Ld;
+    Vector3f Ls;
+    Coord constantAttenuation = 1;
+    Coord linearAttenuation = 0;
+    Coord quadraticAttenuation = 0;
+};
+
+struct ClusterGridSize
+{
+    unsigned int tilesX = 16;
+    unsigned int tilesY = 9;
+    unsigned int slices = 24;
+};
+
+/** Result of the light assignment.
+ * Cluster (x, y, z) has index x + tilesX * (y + tilesY * z). Its lights are
+ * lightIndices[offsets[cluster]] ... lightIndices[offsets[cluster] + counts[cluster] - 1]
+ */
+struct LightClusters
+{
+    ClusterGridSize gridSize;
+    Coord near = 0;
+    Coord far = 0;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> counts;
+    std::vector<std::uint32_t> lightIndices;
+};
+
+/** Assigns lights to the clusters of the frustum given by a perspective projection.
+ * Depth slices are exponentially distributed between near and far, so clusters keep similar proportions.
+ * Slices are processed in parallel, and each cluster tests its candidate lights 4 at a time with SIMD.
+ */
+void assignLightsToClusters(
+    LightClusters& clusters,
+    const std::vector<PointLight>& lights,
+    const Matrix4f& view,
+    const Matrix4f& projection,
+    Coord near,
+    Coord far,
+    ClusterGridSize gridSize = {},
+    ThreadPool& threadPool = defaultThreadPool());
+
+/** GLSL declarations and the function
+ *     vec3 clusteredPhong(vec3 position, vec3 normal, float viewDepth, vec3 Kd, vec3 Ks, uint shininess)
+ * computing the diffuse and specular contribution of the lights in the fragment's cluster.
+ * It is meant to be pasted in fragment shaders after the #version line.
+ */
+const std::string& clusteredLightingShaderCode();
+
+/** Owns the texture buffers with lights and clusters consumed by the clustered pipelines.
+ * As GPUShape, it must be created with a current OpenGL context and freed with clear().
+ */
+class ClusteredLighting
+{
+public:
+    explicit ClusteredLighting(ClusterGridSize gridSize = {});
+
+    /** Assigns the lights to clusters and uploads the results. The camera position is taken from view */
+    void update(
+        const std::vector<PointLight>& lights,
+        const Matrix4f& view,
+        const Matrix4f& projection,
+        Coord near,
+        Coord far,
+        unsigned int viewportWidth,
+        unsigned int viewportHeight,
+        ThreadPool& threadPool = defaultThreadPool());
+
+    /** Binds the buffers starting at firstTextureUnit and sets the uniforms of the clustered pipeline,
+     * viewPosition included. The program must be in use.
+     */
+    void bind(GLuint shaderProgram, GLuint firstTextureUnit = 1) const;
+
+    inline const LightClusters& clusters() const { return _clusters; }
+
+    /** Freeing GPU memory */
+    void clear();
+
+private:
+    LightClusters _clusters;
+    ClusterGridSize _gridSize;
+    unsigned int _viewportWidth = 1;
+    unsigned int _viewportHeight = 1;
+    Vector3f _viewPosition = Vector3f(0, 0, 0);
+
+    // buffer and texture for lights, clusters and light indices
+    GLuint _buffers[3];
+    GLuint _textures[3];
+
+    std::vector<GLfloat> _lightsData;
+    std::vector<GLuint> _clustersData;
+};
+
+} // Grafica
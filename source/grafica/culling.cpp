@@ -0,0 +1,41 @@
+/**
+ * @file culling.cpp
+ * @brief Drawing scene graphs skipping the subtrees outside of the view frustum or hidden behind occluders,
+ *        tested on the CPU or with GPU occlusion queries.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "culling.h"
+
+namespace Grafica
+{
+
+std::ostream& operator<<(std::ostream& os, const CullingStats& stats)
+{
+    os << "visible nodes=" << stats.visibleNodes
+        << " culled nodes=" << stats.culledNodes
+        << " visible triangles=" << stats.visibleTriangles
+        << " culled triangles=" << stats.culledTriangles
+        << " occluded nodes=" << stats.occludedNodes
+        << " occluded triangles=" << stats.occludedTriangles
+        << " issued queries=" << stats.issuedQueries
+        << " conditional nodes=" << stats.conditionalNodes;
+
+    return os;
+}
+
+CullingContext::CullingContext(const Matrix4f& projection, const Matrix4f& view, const OcclusionBuffer* occlusionBufferPtr_)
+{
+    reset(projection, view, occlusionBufferPtr_);
+}
+
+void CullingContext::reset(const Matrix4f& projection, const Matrix4f& view, const OcclusionBuffer* occlusionBufferPtr_)
+{
+    frustum = extractFrustum(projection * view);
+    stats = CullingStats();
+    occlusionBufferPtr = occlusionBufferPtr_;
+}
+
+} // Grafica
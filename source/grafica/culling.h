@@ -0,0 +1,164 @@
+/**
+ * @file culling.h
+ * @brief Drawing scene graphs skipping the subtrees outside of the view frustum or hidden behind occluders,
+ *        tested on the CPU or with GPU occlusion queries.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <glad/glad.h>
+#include "bounds.h"
+#include "occlusion_culling.h"
+#include "occlusion_queries.h"
+#include "scene_graph.h"
+#include "simple_eigen.h"
+#include "transformations.h"
+
+namespace Grafica
+{
+
+struct CullingStats
+{
+    std::size_t visibleNodes = 0;
+    std::size_t culledNodes = 0;
+    std::size_t visibleTriangles = 0;
+    std::size_t culledTriangles = 0;
+    std::size_t occludedNodes = 0;
+    std::size_t occludedTriangles = 0;
+    std::size_t issuedQueries = 0;
+    std::size_t conditionalNodes = 0;
+};
+
+std::ostream& operator<<(std::ostream& os, const CullingStats& stats);
+
+/* Everything needed to cull a frame. Stats accumulate until reset is called.
+ * With an occlusion buffer, already updated for this frame, subtrees hidden behind its occluders are skipped too.
+ * With occlusion queries, after their beginFrame, subtrees are drawn under conditional rendering when last seen hidden.
+ */
+struct CullingContext
+{
+    Frustum frustum;
+    CullingStats stats;
+    const OcclusionBuffer* occlusionBufferPtr = nullptr;
+    OcclusionQueries* occlusionQueriesPtr = nullptr;
+
+    CullingContext() = default;
+
+    CullingContext(const Matrix4f& projection, const Matrix4f& view, const OcclusionBuffer* occlusionBufferPtr_ = nullptr);
+
+    /* To be called once per frame, with the current camera */
+    void reset(const Matrix4f& projection, const Matrix4f& view, const OcclusionBuffer* occlusionBufferPtr_ = nullptr);
+};
+
+template <typename PipelineType>
+void drawSceneGraphNodeCulledCore(
+    SceneGraphNodePtr nodePtr,
+    const PipelineType& pipeline,
+    GLint transformLocation,
+    CullingContext& context,
+    const Matrix4f& parentTransform,
+    bool insideFrustum,
+    bool insideConditionalRender = false,
+    std::size_t parentPathKey = 0)
+{
+    // Subtrees without geometry have nothing to draw
+    if (nodePtr->bounds.isEmpty())
+        return;
+
+    bool const testOcclusion = context.occlusionBufferPtr != nullptr;
+
+    // Conditional rendering can not be nested, nodes inside one are drawn as they come
+    bool const queryOcclusion = context.occlusionQueriesPtr != nullptr and not insideConditionalRender;
+    std::size_t const pathKey = queryOcclusion ? OcclusionQueries::pathKey(parentPathKey, nodePtr.get()) : 0;
+    GLuint conditionalQuery = 0;
+
+    if (not insideFrustum or testOcclusion or queryOcclusion)
+    {
+        AABB const worldBounds = transformAABB(nodePtr->bounds, parentTransform);
+
+        // Once a subtree is completely inside, its descendants are too
+        if (not insideFrustum)
+        {
+            auto const intersection = classify(context.frustum, worldBounds);
+            if (intersection == FrustumIntersection::Outside)
+            {
+                context.stats.culledNodes += nodePtr->subtreeNodes;
+                context.stats.culledTriangles += nodePtr->subtreeTriangles;
+                return;
+            }
+
+            insideFrustum = intersection == FrustumIntersection::Inside;
+        }
+
+        // A hidden subtree hides all of its descendants
+        if (testOcclusion and not context.occlusionBufferPtr->isVisible(worldBounds))
+        {
+            context.stats.occludedNodes += nodePtr->subtreeNodes;
+            context.stats.occludedTriangles += nodePtr->subtreeTriangles;
+            return;
+        }
+
+        if (queryOcclusion)
+        {
+            auto const decision = context.occlusionQueriesPtr->visit(*nodePtr, worldBounds, pathKey);
+            if (decision.queryIssued)
+            {
+                context.stats.issuedQueries += 1;
+                glUseProgram(pipeline.shaderProgram);
+            }
+
+            conditionalQuery = decision.conditionalQuery;
+        }
+    }
+
+    if (conditionalQuery != 0)
+    {
+        context.stats.conditionalNodes += 1;
+        glBeginConditionalRender(conditionalQuery, context.occlusionQueriesPtr->conditionalRenderMode());
+    }
+
+    Matrix4f newTransform = parentTransform * nodePtr->transform;
+
+    context.stats.visibleNodes += 1;
+    if (nodePtr->gpuShapeMaybe.has_value())
+    {
+        auto const& shape = *nodePtr->gpuShapeMaybe.value();
+        glUniformMatrix4fv(transformLocation, 1, GL_FALSE, newTransform.data());
+        pipeline.drawCall(shape);
+        context.stats.visibleTriangles += shape.size / 3;
+    }
+
+    for (auto childPtr : nodePtr->childs)
+    {
+        drawSceneGraphNodeCulledCore(
+            childPtr, pipeline, transformLocation, context, newTransform, insideFrustum,
+            insideConditionalRender or conditionalQuery != 0, pathKey);
+    }
+
+    if (conditionalQuery != 0)
+        glEndConditionalRender();
+}
+
+/* As drawSceneGraphNode, skipping the subtrees whose bounds are outside of the frustum or occluded.
+ * The bounds are brought up to date first, visiting only the nodes passed to invalidateBounds and their ancestors.
+ */
+template <typename PipelineType>
+void drawSceneGraphNodeCulled(
+    SceneGraphNodePtr nodePtr,
+    const PipelineType& pipeline,
+    const std::string& transformName,
+    CullingContext& context,
+    const Matrix4f& parentTransform = Transformations::identity())
+{
+    updateSceneGraphBounds(nodePtr);
+
+    GLint const transformLocation = glGetUniformLocation(pipeline.shaderProgram, transformName.c_str());
+    drawSceneGraphNodeCulledCore(nodePtr, pipeline, transformLocation, context, parentTransform, false);
+}
+
+} // Grafica
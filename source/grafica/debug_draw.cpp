@@ -0,0 +1,324 @@
+/**
+ * @file debug_draw.cpp
+ * @brief Immediate mode debug lines: bounds, rays, paths, frustums and axes are appended to per frame buffers
+ *        and drawn with a single streamed upload and at most two draw calls.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "debug_draw.h"
+
+#include <bit>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <numbers>
+#include <ciso646>
+#include "gpu_shape.h"
+#include "load_shaders.h"
+#include "stream_buffer.h"
+
+namespace Grafica
+{
+
+namespace
+{
+    constexpr unsigned int SPHERE_SEGMENTS = 32;
+
+    static_assert(sizeof(DebugVertex) == 4 * SIZE_IN_BYTES);
+
+    enum DebugAttribute : GLuint
+    {
+        DEBUG_POSITION = 0,
+        DEBUG_COLOR
+    };
+
+    DebugVertex makeVertex(const Vector3f& position, std::uint32_t color)
+    {
+        return {position[0], position[1], position[2], color};
+    }
+
+    /* Cosine and sine of the angles splitting the circle, computed once */
+    const std::array<std::array<Coord, 2>, SPHERE_SEGMENTS>& unitCircle()
+    {
+        static const auto circle = []()
+        {
+            std::array<std::array<Coord, 2>, SPHERE_SEGMENTS> points;
+            for (unsigned int i = 0; i < SPHERE_SEGMENTS; ++i)
+            {
+                Coord const angle = 2 * std::numbers::pi_v<Coord> * i / SPHERE_SEGMENTS;
+                points[i] = {std::cos(angle), std::sin(angle)};
+            }
+            return points;
+        }();
+        return circle;
+    }
+}
+
+void DebugDrawBuffer::initBuffers(std::size_t capacity)
+{
+    this->capacity = capacity;
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(DebugVertex), nullptr, GL_STREAM_DRAW);
+}
+
+void DebugDrawBuffer::clear()
+{
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    vao = vbo = 0;
+    capacity = 0;
+}
+
+DebugDrawShaderProgram::DebugDrawShaderProgram()
+{
+    const std::string vertexShaderCode = R"(
+        #version 330 core
+
+        layout (location = 0) in vec3 position;
+        layout (location = 1) in vec4 color;
+        out vec4 newColor;
+        uniform mat4 view;
+        uniform mat4 projection;
+
+        void main()
+        {
+            gl_Position = projection * view * vec4(position, 1.0);
+            newColor = color;
+        }
+    )";
+
+    const std::string fragmentShaderCode = R"(
+        #version 330 core
+
+        in vec4 newColor;
+        out vec4 outColor;
+
+        void main()
+        {
+            outColor = newColor;
+        }
+    )";
+
+    shaderProgram = createShaderProgramFromCode({
+        {GL_VERTEX_SHADER, vertexShaderCode.c_str()},
+        {GL_FRAGMENT_SHADER, fragmentShaderCode.c_str()}
+    });
+}
+
+void DebugDrawShaderProgram::setupVAO(DebugDrawBuffer& debugDrawBuffer) const
+{
+    glBindVertexArray(debugDrawBuffer.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, debugDrawBuffer.vbo);
+
+    glVertexAttribPointer(DEBUG_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void*)offsetof(DebugVertex, x));
+    glEnableVertexAttribArray(DEBUG_POSITION);
+
+    glVertexAttribPointer(DEBUG_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DebugVertex), (void*)offsetof(DebugVertex, color));
+    glEnableVertexAttribArray(DEBUG_COLOR);
+
+    glBindVertexArray(0);
+}
+
+void DebugDrawShaderProgram::drawCall(const DebugDrawBuffer& debugDrawBuffer, std::size_t first, std::size_t count) const
+{
+    if (count == 0)
+        return;
+
+    glBindVertexArray(debugDrawBuffer.vao);
+    glDrawArrays(GL_LINES, static_cast<GLint>(first), static_cast<GLsizei>(count));
+    glBindVertexArray(0);
+}
+
+DebugDrawBuffer toDebugDrawBuffer(const DebugDrawShaderProgram& pipeline, std::size_t capacity)
+{
+    DebugDrawBuffer debugDrawBuffer;
+    debugDrawBuffer.initBuffers(capacity);
+    pipeline.setupVAO(debugDrawBuffer);
+    return debugDrawBuffer;
+}
+
+void DebugDraw::line(const Vector3f& from, const Vector3f& to, const Vector3f& color, bool depthTest)
+{
+    std::uint32_t const packedColor = packColor(color);
+    auto& lines = vertices(depthTest);
+    lines.push_back(makeVertex(from, packedColor));
+    lines.push_back(makeVertex(to, packedColor));
+}
+
+void DebugDraw::ray(const Ray& ray, Coord length, const Vector3f& color, bool depthTest)
+{
+    line(ray.origin, ray.origin + length * ray.direction, color, depthTest);
+}
+
+void DebugDraw::path(const std::vector<Vector3f>& points, const Vector3f& color, bool depthTest)
+{
+    if (points.size() < 2)
+        return;
+
+    std::uint32_t const packedColor = packColor(color);
+    auto& lines = vertices(depthTest);
+    for (std::size_t i = 1; i < points.size(); ++i)
+    {
+        lines.push_back(makeVertex(points[i - 1], packedColor));
+        lines.push_back(makeVertex(points[i], packedColor));
+    }
+}
+
+void DebugDraw::box(const AABB& aabb, const Vector3f& color, bool depthTest)
+{
+    Vector3f corners[8];
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        corners[i] = Vector3f(
+            i & 1 ? aabb.max[0] : aabb.min[0],
+            i & 2 ? aabb.max[1] : aabb.min[1],
+            i & 4 ? aabb.max[2] : aabb.min[2]);
+    }
+    edges(corners, color, depthTest);
+}
+
+void DebugDraw::box(const AABB& aabb, const Matrix4f& model, const Vector3f& color, bool depthTest)
+{
+    Vector3f corners[8];
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        Vector4f const corner(
+            i & 1 ? aabb.max[0] : aabb.min[0],
+            i & 2 ? aabb.max[1] : aabb.min[1],
+            i & 4 ? aabb.max[2] : aabb.min[2],
+            1);
+        corners[i] = (model * corner).head<3>();
+    }
+    edges(corners, color, depthTest);
+}
+
+void DebugDraw::sphere(const BoundingSphere& sphere, const Vector3f& color, bool depthTest)
+{
+    std::uint32_t const packedColor = packColor(color);
+    auto& lines = vertices(depthTest);
+
+    auto const& circle = unitCircle();
+    Vector3f const& center = sphere.center;
+    Coord const radius = sphere.radius;
+
+    // Each circle spans two axes, the first and the second of a rotation of (x, y, z)
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+        unsigned int const first = axis, second = (axis + 1) % 3;
+        auto const point = [&](unsigned int i)
+        {
+            Vector3f position = center;
+            position[first] += radius * circle[i % SPHERE_SEGMENTS][0];
+            position[second] += radius * circle[i % SPHERE_SEGMENTS][1];
+            return makeVertex(position, packedColor);
+        };
+
+        for (unsigned int i = 0; i < SPHERE_SEGMENTS; ++i)
+        {
+            lines.push_back(point(i));
+            lines.push_back(point(i + 1));
+        }
+    }
+}
+
+void DebugDraw::frustum(const Matrix4f& viewProjection, const Vector3f& color, bool depthTest)
+{
+    Matrix4f const inverse = viewProjection.inverse();
+
+    // Corners of the normalized device coordinates cube, back to world coordinates
+    Vector3f corners[8];
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        Vector4f const corner = inverse * Vector4f(i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1, 1);
+        corners[i] = corner.head<3>() / corner[3];
+    }
+    edges(corners, color, depthTest);
+}
+
+void DebugDraw::axis(const Matrix4f& model, Coord length, bool depthTest)
+{
+    Vector3f const origin = model.col(3).head<3>();
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+        Vector3f color(0, 0, 0);
+        color[axis] = 1;
+        line(origin, origin + length * model.col(axis).head<3>(), color, depthTest);
+    }
+}
+
+void DebugDraw::edges(const Vector3f (&corners)[8], const Vector3f& color, bool depthTest)
+{
+    std::uint32_t const packedColor = packColor(color);
+    auto& lines = vertices(depthTest);
+
+    // Corners differing in a single bit share an edge
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        for (unsigned int bit : {1u, 2u, 4u})
+        {
+            if (i & bit)
+                continue;
+
+            lines.push_back(makeVertex(corners[i], packedColor));
+            lines.push_back(makeVertex(corners[i | bit], packedColor));
+        }
+    }
+}
+
+void DebugDraw::flush(const DebugDrawShaderProgram& pipeline, DebugDrawBuffer& debugDrawBuffer)
+{
+    std::size_t const depthTestedCount = _depthTested.size();
+    std::size_t const onTopCount = _onTop.size();
+    std::size_t const count = depthTestedCount + onTopCount;
+    if (count == 0)
+        return;
+
+    // Growing to the next power of two, so a few frames are enough to settle on a size
+    if (count > debugDrawBuffer.capacity)
+        debugDrawBuffer.capacity = std::bit_ceil(count);
+
+    glBindBuffer(GL_ARRAY_BUFFER, debugDrawBuffer.vbo);
+    streamBufferData(GL_ARRAY_BUFFER, debugDrawBuffer.capacity * sizeof(DebugVertex), count * sizeof(DebugVertex), [&](void* data)
+    {
+        auto* vertices = static_cast<DebugVertex*>(data);
+        std::memcpy(vertices, _depthTested.data(), depthTestedCount * sizeof(DebugVertex));
+        std::memcpy(vertices + depthTestedCount, _onTop.data(), onTopCount * sizeof(DebugVertex));
+    });
+
+    GLboolean const depthTestEnabled = glIsEnabled(GL_DEPTH_TEST);
+
+    if (depthTestedCount > 0)
+    {
+        glEnable(GL_DEPTH_TEST);
+        pipeline.drawCall(debugDrawBuffer, 0, depthTestedCount);
+    }
+
+    if (onTopCount > 0)
+    {
+        glDisable(GL_DEPTH_TEST);
+        pipeline.drawCall(debugDrawBuffer, depthTestedCount, onTopCount);
+    }
+
+    if (depthTestEnabled)
+        glEnable(GL_DEPTH_TEST);
+    else
+        glDisable(GL_DEPTH_TEST);
+
+    _depthTested.clear();
+    _onTop.clear();
+}
+
+std::size_t DebugDraw::size() const
+{
+    return (_depthTested.size() + _onTop.size()) / 2;
+}
+
+} // Grafica
@@ -0,0 +1,106 @@
+/**
+ * @file debug_draw.h
+ * @brief Immediate mode debug lines: bounds, rays, paths, frustums and axes are appended to per frame buffers
+ *        and drawn with a single streamed upload and at most two draw calls.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include "simple_eigen.h"
+#include "transformations.h"
+#include "bounds.h"
+
+namespace Grafica
+{
+
+struct DebugVertex
+{
+    float x, y, z;
+
+    /** RGBA8, red in the lowest byte */
+    std::uint32_t color;
+};
+
+/** Lines streamed every frame. The buffer grows when a frame has more vertices than it can hold. */
+struct DebugDrawBuffer
+{
+    GLuint vao = 0, vbo = 0;
+
+    /* In vertices */
+    std::size_t capacity = 0;
+
+    void initBuffers(std::size_t capacity);
+
+    /* Freeing GPU memory */
+    void clear();
+};
+
+/** Colored lines in world coordinates. Uniforms: view and projection. */
+struct DebugDrawShaderProgram
+{
+    GLuint shaderProgram;
+
+    DebugDrawShaderProgram();
+
+    void setupVAO(DebugDrawBuffer& debugDrawBuffer) const;
+
+    /** Draws count vertices, count / 2 lines, starting at the vertex first of the buffer */
+    void drawCall(const DebugDrawBuffer& debugDrawBuffer, std::size_t first, std::size_t count) const;
+};
+
+/* Convenience function to ease initialization */
+DebugDrawBuffer toDebugDrawBuffer(const DebugDrawShaderProgram& pipeline, std::size_t capacity = 65536);
+
+/** Every call appends the lines of a shape to the buffer of depth tested lines, or to the buffer of lines drawn on top
+ * of everything when depthTest is false. Nothing reaches OpenGL until flush, which uploads both buffers at once,
+ * draws them with one draw call each and empties them for the next frame.
+ */
+class DebugDraw
+{
+public:
+    void line(const Vector3f& from, const Vector3f& to, const Vector3f& color, bool depthTest = true);
+
+    void ray(const Ray& ray, Coord length, const Vector3f& color, bool depthTest = true);
+
+    /** Consecutive points joined by lines */
+    void path(const std::vector<Vector3f>& points, const Vector3f& color, bool depthTest = true);
+
+    void box(const AABB& aabb, const Vector3f& color, bool depthTest = true);
+
+    /** The box moved by model, as an oriented box */
+    void box(const AABB& aabb, const Matrix4f& model, const Vector3f& color, bool depthTest = true);
+
+    /** Three great circles, on the XY, YZ and ZX planes */
+    void sphere(const BoundingSphere& sphere, const Vector3f& color, bool depthTest = true);
+
+    /** The edges of the volume seen through projection * view, as extractFrustum takes it */
+    void frustum(const Matrix4f& viewProjection, const Vector3f& color, bool depthTest = true);
+
+    /** X, Y and Z axes of model in red, green and blue, as createAxis */
+    void axis(const Matrix4f& model = Transformations::identity(), Coord length = 1, bool depthTest = true);
+
+    /** Draws every line appended since the last flush with pipeline, which must be in use with view and projection
+     * already set. The depth test is left as it was found.
+     */
+    void flush(const DebugDrawShaderProgram& pipeline, DebugDrawBuffer& debugDrawBuffer);
+
+    /** Lines waiting for the next flush */
+    std::size_t size() const;
+
+private:
+    inline std::vector<DebugVertex>& vertices(bool depthTest) { return depthTest ? _depthTested : _onTop; }
+
+    /* The 12 edges of a box given by its corners, with corner i at the maximum of axis k when bit k of i is set */
+    void edges(const Vector3f (&corners)[8], const Vector3f& color, bool depthTest);
+
+    std::vector<DebugVertex> _depthTested;
+    std::vector<DebugVertex> _onTop;
+};
+
+} // Grafica
@@ -0,0 +1,322 @@
+/**
+ * @file deferred_shading.cpp
+ * @brief Deferred rendering path: a geometry pass stores the Phong inputs of each pixel in a G-buffer,
+ *        and a full-screen lighting pass shades every pixel once, with the lights of ClusteredLighting.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "deferred_shading.h"
+
+#include <string>
+#include <iostream>
+#include "load_shaders.h"
+#include "clustered_lighting.h"
+
+namespace Grafica
+{
+
+namespace
+{
+    struct AttachmentFormat
+    {
+        GLint internalFormat;
+        GLenum format;
+        GLenum type;
+    };
+
+    // position needs full precision, normals and shininess fit in half floats, colors in bytes.
+    constexpr AttachmentFormat ATTACHMENT_FORMATS[GBuffer::ATTACHMENTS_COUNT] = {
+        {GL_RGBA32F, GL_RGBA, GL_FLOAT},
+        {GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT},
+        {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE},
+        {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE},
+        {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE}
+    };
+
+    const char* const ATTACHMENT_NAMES[GBuffer::ATTACHMENTS_COUNT] = {
+        "gPosition", "gNormal", "gAmbient", "gDiffuse", "gSpecular"
+    };
+
+    // Every geometry pass writes the same outputs
+    const std::string GEOMETRY_OUTPUTS_CODE = R"(
+        layout (location = 0) out vec4 gPosition;
+        layout (location = 1) out vec4 gNormal;
+        layout (location = 2) out vec4 gAmbient;
+        layout (location = 3) out vec4 gDiffuse;
+        layout (location = 4) out vec4 gSpecular;
+
+        uniform vec3 Ka;
+        uniform vec3 Kd;
+        uniform vec3 Ks;
+        uniform uint shininess;
+
+        void writeGBuffer(vec3 position, vec3 normal, vec3 color)
+        {
+            gPosition = vec4(position, 1.0);
+            gNormal = vec4(normalize(normal), float(shininess));
+            gAmbient = vec4(Ka * color, 1.0);
+            gDiffuse = vec4(Kd * color, 1.0);
+            gSpecular = vec4(Ks * color, 1.0);
+        }
+    )";
+}
+
+void GBuffer::initBuffers(unsigned int width_, unsigned int height_)
+{
+    if (fbo != 0)
+        clear();
+
+    width = width_;
+    height = height_;
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    glGenTextures(ATTACHMENTS_COUNT, textures);
+    GLenum drawBuffers[ATTACHMENTS_COUNT];
+    for (unsigned int i = 0; i < ATTACHMENTS_COUNT; ++i)
+    {
+        auto const& attachmentFormat = ATTACHMENT_FORMATS[i];
+
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, attachmentFormat.internalFormat, width, height, 0, attachmentFormat.format, attachmentFormat.type, nullptr);
+
+        // Texels are read one to one, no filtering is needed
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, textures[i], 0);
+        drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+    }
+    glDrawBuffers(ATTACHMENTS_COUNT, drawBuffers);
+
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::GBUFFER::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        throw;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GBuffer::beginGeometryPass() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+
+    // Zero coverage marks the pixels without geometry. The user clear color is left untouched.
+    GLfloat const zero[4] = {0, 0, 0, 0};
+    for (unsigned int i = 0; i < ATTACHMENTS_COUNT; ++i)
+        glClearBufferfv(GL_COLOR, i, zero);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void GBuffer::endGeometryPass(GLuint targetFramebuffer) const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+}
+
+void GBuffer::bindTextures(GLuint shaderProgram, GLuint firstTextureUnit) const
+{
+    for (unsigned int i = 0; i < ATTACHMENTS_COUNT; ++i)
+    {
+        glActiveTexture(GL_TEXTURE0 + firstTextureUnit + i);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glUniform1i(glGetUniformLocation(shaderProgram, ATTACHMENT_NAMES[i]), firstTextureUnit + i);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void GBuffer::blitDepth(GLuint targetFramebuffer) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFramebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+}
+
+void GBuffer::clear()
+{
+    glDeleteTextures(ATTACHMENTS_COUNT, textures);
+    glDeleteRenderbuffers(1, &depth);
+    glDeleteFramebuffers(1, &fbo);
+    fbo = 0;
+}
+
+DeferredColorGeometryShaderProgram::DeferredColorGeometryShaderProgram()
+{
+    const std::string vertexShaderCode = R"(
+        #version 330 core
+
+        layout (location = 0) in vec3 position;
+        layout (location = 1) in vec3 color;
+        layout (location = 2) in vec3 normal;
+        out vec3 fragPosition;
+        out vec3 fragOriginalColor;
+        out vec3 fragNormal;
+        uniform mat4 model;
+        uniform mat4 view;
+        uniform mat4 projection;
+
+        void main()
+        {
+            fragPosition = vec3(model * vec4(position, 1.0));
+            fragOriginalColor = color;
+            fragNormal = mat3(transpose(inverse(model))) * normal;
+            gl_Position = projection * view * vec4(fragPosition, 1.0);
+        }
+    )";
+
+    const std::string fragmentShaderCode = R"(
+        #version 330 core
+    )" + GEOMETRY_OUTPUTS_CODE + R"(
+        in vec3 fragNormal;
+        in vec3 fragPosition;
+        in vec3 fragOriginalColor;
+
+        void main()
+        {
+            writeGBuffer(fragPosition, fragNormal, fragOriginalColor);
+        }
+    )";
+
+    shaderProgram = createShaderProgramFromCode({
+        {GL_VERTEX_SHADER, vertexShaderCode.c_str()},
+        {GL_FRAGMENT_SHADER, fragmentShaderCode.c_str()}
+    });
+}
+
+DeferredTextureGeometryShaderProgram::DeferredTextureGeometryShaderProgram()
+{
+    const std::string vertexShaderCode = R"(
+        #version 330 core
+
+        layout (location = 0) in vec3 position;
+        layout (location = 1) in vec2 texCoords;
+        layout (location = 2) in vec3 normal;
+        out vec3 fragPosition;
+        out vec2 fragTexCoords;
+        out vec3 fragNormal;
+        uniform mat4 model;
+        uniform mat4 view;
+        uniform mat4 projection;
+
+        void main()
+        {
+            fragPosition = vec3(model * vec4(position, 1.0));
+            fragTexCoords = texCoords;
+            fragNormal = mat3(transpose(inverse(model))) * normal;
+            gl_Position = projection * view * vec4(fragPosition, 1.0);
+        }
+    )";
+
+    const std::string fragmentShaderCode = R"(
+        #version 330 core
+    )" + GEOMETRY_OUTPUTS_CODE + R"(
+        in vec3 fragNormal;
+        in vec2 fragTexCoords;
+        in vec3 fragPosition;
+
+        uniform sampler2D samplerTex;
+
+        void main()
+        {
+            vec4 fragOriginalColor = texture(samplerTex, fragTexCoords);
+            writeGBuffer(fragPosition, fragNormal, fragOriginalColor.rgb);
+        }
+    )";
+
+    shaderProgram = createShaderProgramFromCode({
+        {GL_VERTEX_SHADER, vertexShaderCode.c_str()},
+        {GL_FRAGMENT_SHADER, fragmentShaderCode.c_str()}
+    });
+}
+
+DeferredPhongLightingShaderProgram::DeferredPhongLightingShaderProgram()
+{
+    // A single triangle covering the viewport, vertices are generated from gl_VertexID
+    const std::string vertexShaderCode = R"(
+        #version 330 core
+
+        void main()
+        {
+            vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+            gl_Position = vec4(2.0 * position - 1.0, 0.0, 1.0);
+        }
+    )";
+
+    const std::string fragmentShaderCode = R"(
+        #version 330 core
+    )" + clusteredLightingShaderCode() + R"(
+        out vec4 fragColor;
+
+        uniform sampler2D gPosition;
+        uniform sampler2D gNormal;
+        uniform sampler2D gAmbient;
+        uniform sampler2D gDiffuse;
+        uniform sampler2D gSpecular;
+
+        uniform mat4 view;
+        uniform vec3 La;
+
+        void main()
+        {
+            ivec2 pixel = ivec2(gl_FragCoord.xy);
+            vec4 ambient = texelFetch(gAmbient, pixel, 0);
+
+            // Nothing was drawn here
+            if (ambient.a == 0.0)
+                discard;
+
+            vec3 position = texelFetch(gPosition, pixel, 0).xyz;
+            vec4 normalShininess = texelFetch(gNormal, pixel, 0);
+            vec3 diffuse = texelFetch(gDiffuse, pixel, 0).rgb;
+            vec3 specular = texelFetch(gSpecular, pixel, 0).rgb;
+
+            float viewDepth = -(view * vec4(position, 1.0)).z;
+            uint shininess = uint(normalShininess.a);
+
+            // Material colors are already multiplied by the shape color, as in PhongColorShaderProgram
+            vec3 lighting = clusteredPhong(position, normalShininess.xyz, viewDepth, diffuse, specular, shininess);
+            fragColor = vec4(ambient.rgb * La + lighting, 1.0);
+        }
+    )";
+
+    shaderProgram = createShaderProgramFromCode({
+        {GL_VERTEX_SHADER, vertexShaderCode.c_str()},
+        {GL_FRAGMENT_SHADER, fragmentShaderCode.c_str()}
+    });
+
+    // Core profile requires a VAO bound to draw, even without attributes
+    glGenVertexArrays(1, &vao);
+}
+
+void DeferredPhongLightingShaderProgram::drawCall() const
+{
+    // The full-screen triangle must not be depth tested against the scene
+    GLboolean const depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+}
+
+void DeferredPhongLightingShaderProgram::clear()
+{
+    glDeleteVertexArrays(1, &vao);
+}
+
+} // Grafica
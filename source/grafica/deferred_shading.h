@@ -0,0 +1,89 @@
+/**
+ * @file deferred_shading.h
+ * @brief Deferred rendering path: a geometry pass stores the Phong inputs of each pixel in a G-buffer,
+ *        and a full-screen lighting pass shades every pixel once, with the lights of ClusteredLighting.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <glad/glad.h>
+#include "easy_shaders.h"
+#include "gpu_shape.h"
+
+namespace Grafica
+{
+
+/** Framebuffer with one texture per attribute needed by the lighting pass:
+ * position, normal (shininess in alpha), ambient (Ka * color, coverage in alpha),
+ * diffuse (Kd * color) and specular (Ks * color). Depth is kept in a renderbuffer.
+ */
+struct GBuffer
+{
+    static constexpr unsigned int ATTACHMENTS_COUNT = 5;
+
+    GLuint fbo = 0;
+    GLuint textures[ATTACHMENTS_COUNT] = {0, 0, 0, 0, 0};
+    GLuint depth = 0;
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+    /** Creates the framebuffer and its attachments. It must be called again if the window is resized. */
+    void initBuffers(unsigned int width, unsigned int height);
+
+    /** Binds and clears the G-buffer, so the geometry pass can be drawn */
+    void beginGeometryPass() const;
+
+    /** Binds back targetFramebuffer, usually the default one */
+    void endGeometryPass(GLuint targetFramebuffer = 0) const;
+
+    /** Binds the attribute textures to the units firstTextureUnit ... firstTextureUnit + 4
+     * and sets the samplers of the lighting program, which must be in use.
+     */
+    void bindTextures(GLuint shaderProgram, GLuint firstTextureUnit = 0) const;
+
+    /** Copies the depth of the geometry pass to targetFramebuffer,
+     * so forward passes (transparencies, debug lines) can be drawn on top of the lit scene.
+     */
+    void blitDepth(GLuint targetFramebuffer = 0) const;
+
+    /* Freeing GPU memory */
+    void clear();
+};
+
+/** Geometry pass for shapes with position, color and normal.
+ * Uniforms: model, view, projection, Ka, Kd, Ks and shininess, as PhongColorShaderProgram.
+ */
+struct DeferredColorGeometryShaderProgram : public PositionColorNormalVAO
+{
+    DeferredColorGeometryShaderProgram();
+};
+
+/** Geometry pass for shapes with position, texture coordinates and normal, as PhongTextureShaderProgram */
+struct DeferredTextureGeometryShaderProgram : public PositionTextureNormalVAO
+{
+    DeferredTextureGeometryShaderProgram();
+};
+
+/** Full-screen pass computing the Phong model of PhongColorShaderProgram for every light in the pixel's cluster.
+ * Uniforms: view, La, plus the ones set by GBuffer::bindTextures and ClusteredLighting::bind,
+ * which include viewPosition taken from the view given to ClusteredLighting::update.
+ * Pixels not covered by the geometry pass are discarded, keeping the clear color.
+ */
+struct DeferredPhongLightingShaderProgram
+{
+    GLuint shaderProgram;
+    GLuint vao;
+
+    DeferredPhongLightingShaderProgram();
+
+    /** Draws a triangle covering the whole viewport */
+    void drawCall() const;
+
+    /* Freeing GPU memory */
+    void clear();
+};
+
+} // Grafica
@@ -7,6 +7,7 @@
 */
 
 #include "easy_shaders.h"
+#include "clustered_lighting.h"
 #include "root_directory.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -405,6 +406,65 @@ PhongColorShaderProgram::PhongColorShaderProgram()
     });
 }
 
+PhongColorClusteredShaderProgram::PhongColorClusteredShaderProgram()
+{
+    const std::string vertexShaderCode = R"(
+        #version 330 core
+
+        layout (location = 0) in vec3 position;
+        layout (location = 1) in vec3 color;
+        layout (location = 2) in vec3 normal;
+        out vec3 fragPosition;
+        out vec3 fragOriginalColor;
+        out vec3 fragNormal;
+        out float fragViewDepth;
+        uniform mat4 model;
+        uniform mat4 view;
+        uniform mat4 projection;
+
+        void main()
+        {
+            fragPosition = vec3(model * vec4(position, 1.0));
+            fragOriginalColor = color;
+            fragNormal = mat3(transpose(inverse(model))) * normal;
+            vec4 viewPosition = view * vec4(fragPosition, 1.0);
+            fragViewDepth = -viewPosition.z;
+            gl_Position = projection * viewPosition;
+        }
+    )";
+
+    const std::string fragmentShaderCode = R"(
+        #version 330 core
+    )" + clusteredLightingShaderCode() + R"(
+        out vec4 fragColor;
+
+        in vec3 fragNormal;
+        in vec3 fragPosition;
+        in vec3 fragOriginalColor;
+        in float fragViewDepth;
+
+        uniform vec3 La;
+        uniform vec3 Ka;
+        uniform vec3 Kd;
+        uniform vec3 Ks;
+        uniform uint shininess;
+
+        void main()
+        {
+            vec3 ambient = Ka * La;
+            vec3 lighting = clusteredPhong(fragPosition, fragNormal, fragViewDepth, Kd, Ks, shininess);
+
+            vec3 result = (ambient + lighting) * fragOriginalColor;
+            fragColor = vec4(result, 1.0);
+        }
+    )";
+
+    shaderProgram = createShaderProgramFromCode({
+        {GL_VERTEX_SHADER, vertexShaderCode.c_str()},
+        {GL_FRAGMENT_SHADER, fragmentShaderCode.c_str()}
+    });
+}
+
 
 void PositionTextureNormalVAO::setupVAO(GPUShape& gpuShape) const
 {
@@ -533,5 +593,68 @@ PhongTextureShaderProgram::PhongTextureShaderProgram()
     });
 }
 
+PhongTextureClusteredShaderProgram::PhongTextureClusteredShaderProgram()
+{
+    const std::string vertexShaderCode = R"(
+        #version 330 core
+
+        layout (location = 0) in vec3 position;
+        layout (location = 1) in vec2 texCoords;
+        layout (location = 2) in vec3 normal;
+        out vec3 fragPosition;
+        out vec2 fragTexCoords;
+        out vec3 fragNormal;
+        out float fragViewDepth;
+        uniform mat4 model;
+        uniform mat4 view;
+        uniform mat4 projection;
+
+        void main()
+        {
+            fragPosition = vec3(model * vec4(position, 1.0));
+            fragTexCoords = texCoords;
+            fragNormal = mat3(transpose(inverse(model))) * normal;
+            vec4 viewPosition = view * vec4(fragPosition, 1.0);
+            fragViewDepth = -viewPosition.z;
+            gl_Position = projection * viewPosition;
+        }
+    )";
+
+    const std::string fragmentShaderCode = R"(
+        #version 330 core
+    )" + clusteredLightingShaderCode() + R"(
+        out vec4 fragColor;
+
+        in vec3 fragNormal;
+        in vec2 fragTexCoords;
+        in vec3 fragPosition;
+        in float fragViewDepth;
+
+        uniform vec3 La;
+        uniform vec3 Ka;
+        uniform vec3 Kd;
+        uniform vec3 Ks;
+        uniform uint shininess;
+
+        uniform sampler2D samplerTex;
+
+        void main()
+        {
+            vec3 ambient = Ka * La;
+            vec3 lighting = clusteredPhong(fragPosition, fragNormal, fragViewDepth, Kd, Ks, shininess);
+
+            vec4 fragOriginalColor = texture(samplerTex, fragTexCoords);
+
+            vec3 result = (ambient + lighting) * fragOriginalColor.rgb;
+            fragColor = vec4(result, 1.0);
+        }
+    )";
+
+    shaderProgram = createShaderProgramFromCode({
+        {GL_VERTEX_SHADER, vertexShaderCode.c_str()},
+        {GL_FRAGMENT_SHADER, fragmentShaderCode.c_str()}
+    });
+}
+
     
 } //Grafica
\ No newline at end of file
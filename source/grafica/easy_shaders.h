@@ -78,6 +78,14 @@ struct PhongColorShaderProgram : public PositionColorNormalVAO
     PhongColorShaderProgram();
 };
 
+/** Phong with many point lights, only the lights of the fragment's cluster are shaded.
+ * Lights and viewPosition are provided by ClusteredLighting::bind, La, Ka, Kd, Ks and shininess are set as in PhongColorShaderProgram.
+ */
+struct PhongColorClusteredShaderProgram : public PositionColorNormalVAO
+{
+    PhongColorClusteredShaderProgram();
+};
+
 struct PositionTextureNormalVAO
 {
     GLuint shaderProgram;
@@ -91,5 +99,11 @@ struct PhongTextureShaderProgram : public PositionTextureNormalVAO
 {
     PhongTextureShaderProgram();
 };
+
+/** Textured version of PhongColorClusteredShaderProgram */
+struct PhongTextureClusteredShaderProgram : public PositionTextureNormalVAO
+{
+    PhongTextureClusteredShaderProgram();
+};
     
 } //Grafica
\ No newline at end of file
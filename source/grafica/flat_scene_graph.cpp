@@ -0,0 +1,212 @@
+/**
+ * @file flat_scene_graph.cpp
+ * @brief FlatSceneGraph stores a hierarchy of transformations in contiguous arrays ordered parents first,
+ *        so world transforms are updated with a single linear sweep, only where something changed.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "flat_scene_graph.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace Grafica
+{
+
+FlatSceneGraph::FlatSceneGraph(SceneGraphNodePtr rootPtr)
+{
+    // Depth first with an explicit stack, children are pushed in reverse to keep their order
+    std::vector<std::pair<SceneGraphNodePtr, NodeIndex>> pending;
+    pending.emplace_back(rootPtr, NO_PARENT);
+
+    while (not pending.empty())
+    {
+        auto [nodePtr, parent] = pending.back();
+        pending.pop_back();
+
+        NodeIndex const node = addNode(nodePtr->name, parent, nodePtr->transform, nodePtr->gpuShapeMaybe);
+
+        for (auto childIt = nodePtr->childs.rbegin(); childIt != nodePtr->childs.rend(); ++childIt)
+            pending.emplace_back(*childIt, node);
+    }
+}
+
+NodeIndex FlatSceneGraph::addNode(
+    const std::string& name,
+    NodeIndex parent,
+    const Matrix4f& localTransform,
+    std::optional<GPUShapePtr> gpuShapeMaybe)
+{
+    NodeIndex const node = static_cast<NodeIndex>(size());
+
+    _names.push_back(name);
+    _parents.push_back(parent);
+    _localTransforms.push_back(AlignedMatrix4f::fromMatrix4f(localTransform));
+    _worldTransforms.push_back(_localTransforms.back());
+    _dirty.push_back(1);
+    _worldChanged.push_back(0);
+
+    // Children are prepended, their order does not matter for the update
+    _firstChild.push_back(NO_PARENT);
+    _nextSibling.push_back(NO_PARENT);
+    if (parent != NO_PARENT)
+    {
+        _nextSibling[node] = _firstChild[parent];
+        _firstChild[parent] = node;
+    }
+    _subtreeSizesValid = false;
+
+    if (gpuShapeMaybe.has_value())
+        _drawableNodes.push_back(node);
+    _gpuShapes.push_back(std::move(gpuShapeMaybe));
+
+    return node;
+}
+
+void FlatSceneGraph::setLocalTransform(NodeIndex node, const Matrix4f& localTransform)
+{
+    _localTransforms[node] = AlignedMatrix4f::fromMatrix4f(localTransform);
+    _dirty[node] = 1;
+}
+
+std::optional<NodeIndex> FlatSceneGraph::findNode(const std::string& name) const
+{
+    auto it = std::find(_names.begin(), _names.end(), name);
+    if (it == _names.end())
+        return std::nullopt;
+
+    return static_cast<NodeIndex>(std::distance(_names.begin(), it));
+}
+
+void FlatSceneGraph::updateWorldTransforms()
+{
+    std::size_t const nodesCount = size();
+
+    // Parents come first, so when a node is reached its parent world transform is already final
+    for (std::size_t node = 0; node < nodesCount; ++node)
+    {
+        NodeIndex const parent = _parents[node];
+        bool const changed = _dirty[node] or (parent != NO_PARENT and _worldChanged[parent]);
+        _worldChanged[node] = changed;
+
+        if (not changed)
+            continue;
+
+        if (parent == NO_PARENT)
+            _worldTransforms[node] = _localTransforms[node];
+        else
+            multiply(_worldTransforms[parent], _localTransforms[node], _worldTransforms[node]);
+    }
+
+    std::fill(_dirty.begin(), _dirty.end(), 0);
+}
+
+void FlatSceneGraph::computeSubtreeSizes() const
+{
+    std::size_t const nodesCount = size();
+    _subtreeSizes.assign(nodesCount, 1);
+
+    // Children come after their parents, so a backwards sweep finishes each subtree before its parent
+    for (std::size_t node = nodesCount; node-- > 0;)
+    {
+        NodeIndex const parent = _parents[node];
+        if (parent != NO_PARENT)
+            _subtreeSizes[parent] += _subtreeSizes[node];
+    }
+
+    _subtreeSizesValid = true;
+}
+
+std::size_t FlatSceneGraph::subtreeSize(NodeIndex node) const
+{
+    if (not _subtreeSizesValid)
+        computeSubtreeSizes();
+
+    return _subtreeSizes[node];
+}
+
+void FlatSceneGraph::updateWorldTransforms(ThreadPool& threadPool, std::size_t grainSize)
+{
+    if (threadPool.size() == 0 or size() <= grainSize)
+    {
+        updateWorldTransforms();
+        return;
+    }
+
+    if (not _subtreeSizesValid)
+        computeSubtreeSizes();
+
+    // Every node is written by exactly one task, and only after its parent is final
+    TaskGroup taskGroup(threadPool);
+    for (std::size_t node = 0; node < size(); ++node)
+    {
+        if (_parents[node] == NO_PARENT)
+            updateSubtrees({{static_cast<NodeIndex>(node), false}}, grainSize, &taskGroup);
+    }
+    taskGroup.wait();
+}
+
+void FlatSceneGraph::updateSubtrees(PendingNodes pending, std::size_t grainSize, TaskGroup* taskGroupPtr)
+{
+    PendingNodes batch;
+    std::size_t batchSize = 0;
+
+    auto spawn = [this, grainSize, taskGroupPtr](PendingNodes roots)
+    {
+        taskGroupPtr->run([this, roots = std::move(roots), grainSize, taskGroupPtr]()
+        {
+            updateSubtrees(roots, grainSize, taskGroupPtr);
+        });
+    };
+
+    while (not pending.empty())
+    {
+        auto [node, changedAbove] = pending.back();
+        pending.pop_back();
+
+        NodeIndex const parent = _parents[node];
+        bool const changed = _dirty[node] or changedAbove;
+        _worldChanged[node] = changed;
+        _dirty[node] = 0;
+
+        if (changed)
+        {
+            if (parent == NO_PARENT)
+                _worldTransforms[node] = _localTransforms[node];
+            else
+                multiply(_worldTransforms[parent], _localTransforms[node], _worldTransforms[node]);
+        }
+
+        // Big subtrees become tasks, which may split again once stolen by another worker.
+        // Small sibling subtrees are batched until they are worth a task, so wide hierarchies split too.
+        for (NodeIndex child = _firstChild[node]; child != NO_PARENT; child = _nextSibling[child])
+        {
+            std::size_t const childSize = _subtreeSizes[child];
+            if (childSize >= grainSize)
+            {
+                spawn({{child, changed}});
+                continue;
+            }
+
+            batch.emplace_back(child, changed);
+            batchSize += childSize;
+            if (batchSize >= grainSize)
+            {
+                spawn(std::move(batch));
+                batch.clear();
+                batchSize = 0;
+            }
+        }
+
+        // What is left stays with this task
+        if (pending.empty() and not batch.empty())
+        {
+            std::swap(pending, batch);
+            batchSize = 0;
+        }
+    }
+}
+
+} // Grafica
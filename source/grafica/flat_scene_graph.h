@@ -0,0 +1,137 @@
+/**
+ * @file flat_scene_graph.h
+ * @brief FlatSceneGraph stores a hierarchy of transformations in contiguous arrays ordered parents first,
+ *        so world transforms are updated with a single linear sweep, only where something changed.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include <limits>
+#include <optional>
+#include <ciso646>
+#include <glad/glad.h>
+#include "gpu_shape.h"
+#include "matrix_batch.h"
+#include "scene_graph.h"
+#include "simple_eigen.h"
+#include "thread_pool.h"
+#include "transformations.h"
+
+namespace Grafica
+{
+
+using NodeIndex = std::uint32_t;
+
+constexpr NodeIndex NO_PARENT = std::numeric_limits<NodeIndex>::max();
+
+/** Data oriented alternative to SceneGraphNode.
+ * Each attribute lives in its own array and nodes are identified by their index.
+ * Every parent is stored before its children, which is the only order the update requires.
+ */
+class FlatSceneGraph
+{
+public:
+    FlatSceneGraph() = default;
+
+    /** Flattens a SceneGraphNode tree. A subtree shared by several parents is copied once per path,
+     * as each path has its own world transforms.
+     */
+    explicit FlatSceneGraph(SceneGraphNodePtr rootPtr);
+
+    /** Appends a node, the parent must already exist (or be NO_PARENT) */
+    NodeIndex addNode(
+        const std::string& name,
+        NodeIndex parent = NO_PARENT,
+        const Matrix4f& localTransform = Transformations::identity(),
+        std::optional<GPUShapePtr> gpuShapeMaybe = std::nullopt);
+
+    inline std::size_t size() const { return _parents.size(); }
+
+    inline NodeIndex parent(NodeIndex node) const { return _parents[node]; }
+
+    inline const std::string& name(NodeIndex node) const { return _names[node]; }
+
+    inline Matrix4f localTransform(NodeIndex node) const { return _localTransforms[node].toMatrix4f(); }
+
+    /** Only valid after updateWorldTransforms */
+    inline Matrix4f worldTransform(NodeIndex node) const { return _worldTransforms[node].toMatrix4f(); }
+
+    /** As worldTransform, without a conversion. Its data can be uploaded to OpenGL directly. */
+    inline const AlignedMatrix4f& alignedWorldTransform(NodeIndex node) const { return _worldTransforms[node]; }
+
+    inline const std::optional<GPUShapePtr>& gpuShapeMaybe(NodeIndex node) const { return _gpuShapes[node]; }
+
+    /** True when the world transform changed in the last updateWorldTransforms */
+    inline bool worldChanged(NodeIndex node) const { return _worldChanged[node] != 0; }
+
+    /** Nodes with a shape, in storage order */
+    inline const std::vector<NodeIndex>& drawableNodes() const { return _drawableNodes; }
+
+    /** Changes the local transform, marking the node and therefore its subtree for the next update */
+    void setLocalTransform(NodeIndex node, const Matrix4f& localTransform);
+
+    /** First node with the given name, linear search */
+    std::optional<NodeIndex> findNode(const std::string& name) const;
+
+    /** Recomputes world transforms of dirty nodes and their descendants, in one pass without recursion */
+    void updateWorldTransforms();
+
+    /** Same result as updateWorldTransforms, with independent subtrees updated as tasks on the pool.
+     * Subtrees with fewer than grainSize nodes are not split further, so small ones stay serial.
+     */
+    void updateWorldTransforms(ThreadPool& threadPool, std::size_t grainSize = DEFAULT_GRAIN_SIZE);
+
+    /** Number of nodes below and including the given one */
+    std::size_t subtreeSize(NodeIndex node) const;
+
+    static constexpr std::size_t DEFAULT_GRAIN_SIZE = 512;
+
+private:
+    /* Roots to update, and whether their parents world transforms changed */
+    using PendingNodes = std::vector<std::pair<NodeIndex, bool>>;
+
+    void updateSubtrees(PendingNodes pending, std::size_t grainSize, TaskGroup* taskGroupPtr);
+    void computeSubtreeSizes() const;
+
+    std::vector<std::string> _names;
+    std::vector<NodeIndex> _parents;
+    AlignedMatrix4fArray _localTransforms;
+    AlignedMatrix4fArray _worldTransforms;
+    std::vector<std::optional<GPUShapePtr>> _gpuShapes;
+    std::vector<std::uint8_t> _dirty;
+    std::vector<std::uint8_t> _worldChanged;
+    std::vector<NodeIndex> _drawableNodes;
+
+    /* Children as linked lists, so a subtree can be walked without scanning the whole graph */
+    std::vector<NodeIndex> _firstChild;
+    std::vector<NodeIndex> _nextSibling;
+
+    /* Computed on demand after the structure changes */
+    mutable std::vector<std::uint32_t> _subtreeSizes;
+    mutable bool _subtreeSizesValid = false;
+};
+
+/** Draws every node with a shape using its already updated world transform */
+template <typename PipelineType>
+void drawFlatSceneGraph(
+    const FlatSceneGraph& flatSceneGraph,
+    const PipelineType& pipeline,
+    const std::string& transformName)
+{
+    GLint const transformLocation = glGetUniformLocation(pipeline.shaderProgram, transformName.c_str());
+
+    for (auto node : flatSceneGraph.drawableNodes())
+    {
+        glUniformMatrix4fv(transformLocation, 1, GL_FALSE, flatSceneGraph.alignedWorldTransform(node).data);
+        pipeline.drawCall(*flatSceneGraph.gpuShapeMaybe(node).value());
+    }
+}
+
+} // Grafica
@@ -0,0 +1,350 @@
+/**
+ * @file frame_capture.cpp
+ * @brief Capturing rendered frames without stalling: pixels are read into a ring of pixel buffer objects,
+ *        mapped some frames later, and written to PNG files or a Y4M video by a background thread.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "frame_capture.h"
+
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <iomanip>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <ciso646>
+#include <stb_image_write.h>
+
+namespace Grafica
+{
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    /* Full range BT.601, as JPEG uses, in 8 bits fixed point */
+    std::uint8_t luma(int r, int g, int b)
+    {
+        return static_cast<std::uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+    }
+
+    std::uint8_t blueChroma(int r, int g, int b)
+    {
+        return static_cast<std::uint8_t>(std::clamp(((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128, 0, 255));
+    }
+
+    std::uint8_t redChroma(int r, int g, int b)
+    {
+        return static_cast<std::uint8_t>(std::clamp(((128 * r - 107 * g - 21 * b + 128) >> 8) + 128, 0, 255));
+    }
+}
+
+FrameCapture::FrameCapture(unsigned int width, unsigned int height, unsigned int ringSize, unsigned int maxQueuedFrames) :
+    _width(width),
+    _height(height),
+    _maxQueuedFrames(std::max(maxQueuedFrames, 1u)),
+    _frameBytes(std::size_t(width) * height * 4),
+    _slots(std::max(ringSize, 1u))
+{
+    for (auto& slot : _slots)
+    {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, _frameBytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    _writer = std::thread(&FrameCapture::writerLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    // Frames still in the ring are read back, so the context must be current here if capturing
+    if (_capturing)
+        stop();
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _frameQueued.notify_all();
+    _writer.join();
+}
+
+bool FrameCapture::start(CaptureFormat format, const std::string& path, unsigned int framesPerSecond)
+{
+    if (_capturing)
+        stop();
+
+    _format = format;
+    _path = path;
+    _nextFrame = 0;
+
+    if (format == CaptureFormat::Y4M)
+    {
+        _video = std::fopen(path.c_str(), "wb");
+        if (_video == nullptr)
+        {
+            std::cout << "ERROR::FRAME_CAPTURE::COULD_NOT_OPEN " << path << std::endl;
+            return false;
+        }
+
+        // Chroma planes have half the resolution, rounded up
+        std::fprintf(_video, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", _width, _height, framesPerSecond);
+    }
+
+    _capturing = true;
+    return true;
+}
+
+void FrameCapture::capture(GLuint framebuffer)
+{
+    if (not _capturing)
+        return;
+
+    auto const start = Clock::now();
+
+    // The oldest read of the ring, ringSize - 1 frames ago
+    Slot& slot = _slots[_nextSlot];
+    if (slot.fence != nullptr)
+        retrieve(slot);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = _nextFrame++;
+    _nextSlot = (_nextSlot + 1) % _slots.size();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.capturedFrames++;
+    _stats.captureSeconds += secondsSince(start);
+}
+
+void FrameCapture::flush()
+{
+    // From the oldest read to the latest one, so frames are queued in order
+    for (std::size_t i = 0; i < _slots.size(); ++i)
+    {
+        Slot& slot = _slots[(_nextSlot + i) % _slots.size()];
+        if (slot.fence != nullptr)
+            retrieve(slot);
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _frameWritten.wait(lock, [this]() { return _queue.empty() and _writing == 0; });
+
+    if (_video != nullptr)
+        std::fflush(_video);
+}
+
+void FrameCapture::stop()
+{
+    if (not _capturing)
+        return;
+
+    flush();
+
+    if (_video != nullptr)
+    {
+        std::fclose(_video);
+        _video = nullptr;
+    }
+
+    _capturing = false;
+}
+
+FrameCaptureStats FrameCapture::stats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+void FrameCapture::clear()
+{
+    for (auto& slot : _slots)
+    {
+        if (slot.fence != nullptr)
+            glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.buffer);
+        slot = Slot();
+    }
+}
+
+void FrameCapture::retrieve(Slot& slot)
+{
+    // Flushing makes sure the fence reaches the GPU. It has usually signaled already, so this does not wait.
+    GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        // The GPU is more than a ring behind: mapping an unfinished read would give a partial frame
+        auto const waitStart = Clock::now();
+        do
+        {
+            result = glClientWaitSync(slot.fence, 0, std::numeric_limits<GLuint64>::max());
+        }
+        while (result == GL_TIMEOUT_EXPIRED);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stats.stalledFrames++;
+        _stats.fenceWaitSeconds += secondsSince(waitStart);
+    }
+
+    if (result == GL_WAIT_FAILED)
+    {
+        // The fence is useless, waiting for every command is the only way to know the read is done
+        std::cout << "ERROR::FRAME_CAPTURE::FENCE_WAIT_FAILED 0x" << std::hex << glGetError() << std::dec << std::endl;
+        glFinish();
+    }
+
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    Frame frame;
+    frame.index = slot.frame;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_queue.size() >= _maxQueuedFrames)
+        {
+            auto const waitStart = Clock::now();
+            _frameWritten.wait(lock, [this]() { return _queue.size() < _maxQueuedFrames; });
+            _stats.waitSeconds += secondsSince(waitStart);
+        }
+
+        if (not _freeBuffers.empty())
+        {
+            frame.pixels = std::move(_freeBuffers.back());
+            _freeBuffers.pop_back();
+        }
+    }
+    frame.pixels.resize(_frameBytes);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    void const* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, _frameBytes, GL_MAP_READ_BIT);
+    if (data == nullptr)
+    {
+        std::cout << "ERROR::FRAME_CAPTURE::COULD_NOT_MAP_BUFFER" << std::endl;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return;
+    }
+    std::memcpy(frame.pixels.data(), data, _frameBytes);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(std::move(frame));
+    }
+    _frameQueued.notify_one();
+}
+
+void FrameCapture::writerLoop()
+{
+    while (true)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _frameQueued.wait(lock, [this]() { return _stopping or not _queue.empty(); });
+            if (_queue.empty())
+                return;
+
+            frame = std::move(_queue.front());
+            _queue.pop_front();
+            _writing = 1;
+        }
+
+        write(frame);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _writing = 0;
+            _stats.writtenFrames++;
+            _freeBuffers.push_back(std::move(frame.pixels));
+        }
+        _frameWritten.notify_all();
+    }
+}
+
+void FrameCapture::write(const Frame& frame)
+{
+    std::size_t const rowBytes = std::size_t(_width) * 4;
+
+    // Rows are flipped to go from top to bottom
+    auto const pixel = [&](unsigned int x, unsigned int y)
+    {
+        return frame.pixels.data() + (_height - 1 - y) * rowBytes + std::size_t(x) * 4;
+    };
+
+    if (_format == CaptureFormat::PNG)
+    {
+        // Alpha is dropped, it is whatever the clear color left there
+        _planes.resize(std::size_t(_width) * _height * 3);
+        for (unsigned int y = 0; y < _height; ++y)
+            for (unsigned int x = 0; x < _width; ++x)
+                std::memcpy(&_planes[(std::size_t(y) * _width + x) * 3], pixel(x, y), 3);
+
+        std::ostringstream fileName;
+        fileName << _path << "_" << std::setw(6) << std::setfill('0') << frame.index << ".png";
+        if (stbi_write_png(fileName.str().c_str(), _width, _height, 3, _planes.data(), _width * 3) == 0)
+            std::cout << "ERROR::FRAME_CAPTURE::COULD_NOT_WRITE " << fileName.str() << std::endl;
+
+        return;
+    }
+
+    unsigned int const chromaWidth = (_width + 1) / 2;
+    unsigned int const chromaHeight = (_height + 1) / 2;
+    std::size_t const lumaSize = std::size_t(_width) * _height;
+    std::size_t const chromaSize = std::size_t(chromaWidth) * chromaHeight;
+    _planes.resize(lumaSize + 2 * chromaSize);
+
+    std::uint8_t* lumaPlane = _planes.data();
+    std::uint8_t* blueChromaPlane = lumaPlane + lumaSize;
+    std::uint8_t* redChromaPlane = blueChromaPlane + chromaSize;
+
+    for (unsigned int y = 0; y < _height; ++y)
+    {
+        for (unsigned int x = 0; x < _width; ++x)
+        {
+            std::uint8_t const* rgba = pixel(x, y);
+            lumaPlane[std::size_t(y) * _width + x] = luma(rgba[0], rgba[1], rgba[2]);
+        }
+    }
+
+    // Chroma of the average color of each 2x2 block, repeating the last row and column for odd sizes
+    for (unsigned int y = 0; y < chromaHeight; ++y)
+    {
+        unsigned int const y0 = 2 * y, y1 = std::min(2 * y + 1, _height - 1);
+        for (unsigned int x = 0; x < chromaWidth; ++x)
+        {
+            unsigned int const x0 = 2 * x, x1 = std::min(2 * x + 1, _width - 1);
+            std::uint8_t const* block[4] = {pixel(x0, y0), pixel(x1, y0), pixel(x0, y1), pixel(x1, y1)};
+
+            int sum[3] = {0, 0, 0};
+            for (auto const* rgba : block)
+                for (unsigned int channel = 0; channel < 3; ++channel)
+                    sum[channel] += rgba[channel];
+
+            int const r = (sum[0] + 2) / 4, g = (sum[1] + 2) / 4, b = (sum[2] + 2) / 4;
+            blueChromaPlane[std::size_t(y) * chromaWidth + x] = blueChroma(r, g, b);
+            redChromaPlane[std::size_t(y) * chromaWidth + x] = redChroma(r, g, b);
+        }
+    }
+
+    if (std::fputs("FRAME\n", _video) < 0 or std::fwrite(_planes.data(), 1, _planes.size(), _video) != _planes.size())
+        std::cout << "ERROR::FRAME_CAPTURE::COULD_NOT_WRITE " << _path << std::endl;
+}
+
+} // Grafica
@@ -0,0 +1,146 @@
+/**
+ * @file frame_capture.h
+ * @brief Capturing rendered frames without stalling: pixels are read into a ring of pixel buffer objects,
+ *        mapped some frames later, and written to PNG files or a Y4M video by a background thread.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <glad/glad.h>
+
+namespace Grafica
+{
+
+enum class CaptureFormat
+{
+    /** One file per frame, path_000000.png, path_000001.png ... */
+    PNG,
+
+    /** A single uncompressed YUV 4:2:0 stream at path, playable and encodable by ffmpeg */
+    Y4M
+};
+
+struct FrameCaptureStats
+{
+    std::uint64_t capturedFrames = 0;
+    std::uint64_t writtenFrames = 0;
+
+    /** Time spent inside capture, by the rendering thread. With software GL, as llvmpipe,
+     * glReadPixels finishes rendering the frame first, so that time is counted here too.
+     */
+    double captureSeconds = 0;
+
+    /** Time capture waited for the writer to catch up */
+    double waitSeconds = 0;
+
+    /** Reads whose fence had not signaled when the ring came back to them, so capture waited for the GPU */
+    std::uint64_t stalledFrames = 0;
+    double fenceWaitSeconds = 0;
+
+    inline double averageCaptureMilliseconds() const
+    {
+        return capturedFrames > 0 ? 1000 * captureSeconds / capturedFrames : 0;
+    }
+};
+
+/** glReadPixels into a buffer bound to GL_PIXEL_PACK_BUFFER returns at once, the copy happens on the GPU
+ * when the frame is done. Each capture uses the next buffer of the ring, with a fence after the read;
+ * the buffer is mapped when the ring comes back to it, ringSize - 1 frames later, so the fence has
+ * almost always signaled by then. If it has not, capture blocks until it does, counted in stalledFrames;
+ * a larger ring avoids it. Mapped pixels are copied to memory owned by the writer thread,
+ * which converts and writes them in order.
+ * All methods but the stats must be called from the thread owning the GL context.
+ */
+class FrameCapture
+{
+public:
+    FrameCapture(unsigned int width, unsigned int height, unsigned int ringSize = 3, unsigned int maxQueuedFrames = 8);
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    /** Frames go to path, with the frame rate written in the Y4M header. Returns false if the file could not be created. */
+    bool start(CaptureFormat format, const std::string& path, unsigned int framesPerSecond = 60);
+
+    /** Reads the color of framebuffer, which must be width x height, bound as GL_READ_FRAMEBUFFER.
+     * If the writer is maxQueuedFrames behind, it waits for it instead of growing without bounds.
+     */
+    void capture(GLuint framebuffer = 0);
+
+    /** Waits until every captured frame is written */
+    void flush();
+
+    /** Flushes and closes the output. Capturing can start again with start. */
+    void stop();
+
+    inline bool capturing() const { return _capturing; }
+    inline unsigned int width() const { return _width; }
+    inline unsigned int height() const { return _height; }
+
+    FrameCaptureStats stats() const;
+
+    /** Freeing GPU memory */
+    void clear();
+
+private:
+    struct Slot
+    {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+        std::uint64_t frame = 0;
+    };
+
+    /* RGBA rows from bottom to top, as glReadPixels gives them */
+    struct Frame
+    {
+        std::uint64_t index;
+        std::vector<std::uint8_t> pixels;
+    };
+
+    void retrieve(Slot& slot);
+    void writerLoop();
+    void write(const Frame& frame);
+
+    unsigned int _width;
+    unsigned int _height;
+    unsigned int _maxQueuedFrames;
+    std::size_t _frameBytes;
+
+    std::vector<Slot> _slots;
+    std::size_t _nextSlot = 0;
+
+    CaptureFormat _format = CaptureFormat::PNG;
+    std::string _path;
+    std::FILE* _video = nullptr;
+    bool _capturing = false;
+    std::uint64_t _nextFrame = 0;
+
+    /* Shared with the writer thread */
+    mutable std::mutex _mutex;
+    std::condition_variable _frameQueued;
+    std::condition_variable _frameWritten;
+    std::deque<Frame> _queue;
+    std::vector<std::vector<std::uint8_t>> _freeBuffers;
+    std::size_t _writing = 0;
+    bool _stopping = false;
+    FrameCaptureStats _stats;
+
+    /* YUV planes of the frame being written, only touched by the writer thread */
+    std::vector<std::uint8_t> _planes;
+
+    std::thread _writer;
+};
+
+} // Grafica
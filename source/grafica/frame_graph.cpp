@@ -0,0 +1,497 @@
+/**
+ * @file frame_graph.cpp
+ * @brief FrameGraph describes a frame as passes reading and writing render targets.
+ *        Unused passes are culled and transient textures are shared between passes whose lifetimes do not overlap.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "frame_graph.h"
+
+#include <cassert>
+#include <limits>
+#include <algorithm>
+#include <ciso646>
+
+namespace Grafica
+{
+
+namespace
+{
+    // Pooled textures not used during this many frames are deleted
+    constexpr std::uint64_t MAX_UNUSED_FRAMES = 120;
+
+    constexpr std::size_t NO_POOL_INDEX = std::numeric_limits<std::size_t>::max();
+
+    constexpr ResourceHandle NO_VERSION = std::numeric_limits<ResourceHandle>::max();
+
+    bool isDepthFormat(GLint internalFormat)
+    {
+        return internalFormat == GL_DEPTH_COMPONENT16
+            or internalFormat == GL_DEPTH_COMPONENT24
+            or internalFormat == GL_DEPTH_COMPONENT32F;
+    }
+
+    bool isDepthStencilFormat(GLint internalFormat)
+    {
+        return internalFormat == GL_DEPTH24_STENCIL8
+            or internalFormat == GL_DEPTH32F_STENCIL8;
+    }
+
+    bool isIntegerFormat(GLint internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_R32UI: case GL_RG32UI: case GL_RGBA32UI:
+        case GL_R32I: case GL_RG32I: case GL_RGBA32I:
+        case GL_R16UI: case GL_RG16UI: case GL_RGBA16UI:
+        case GL_R8UI: case GL_RG8UI: case GL_RGBA8UI:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Approximated, just to report the memory used by the pool
+    std::size_t bytesPerTexel(GLint internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_RGBA32F: case GL_RGBA32UI: case GL_RGBA32I:
+            return 16;
+        case GL_RGB32F:
+            return 12;
+        case GL_RGBA16F: case GL_RG32F: case GL_RG32UI:
+            return 8;
+        case GL_RGB16F:
+            return 6;
+        default:
+            return 4;
+        }
+    }
+
+    GLuint createTexture(const TextureDescription& description)
+    {
+        GLenum format = GL_RGBA;
+        GLenum type = GL_FLOAT;
+        if (isDepthFormat(description.internalFormat))
+        {
+            format = GL_DEPTH_COMPONENT;
+        }
+        else if (isDepthStencilFormat(description.internalFormat))
+        {
+            format = GL_DEPTH_STENCIL;
+            type = GL_UNSIGNED_INT_24_8;
+        }
+        else if (isIntegerFormat(description.internalFormat))
+        {
+            format = GL_RGBA_INTEGER;
+            type = GL_UNSIGNED_INT;
+        }
+
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, description.internalFormat, description.width, description.height, 0, format, type, nullptr);
+
+        // Integer textures can not be filtered, with GL_LINEAR they would be incomplete
+        GLint const filter = isIntegerFormat(description.internalFormat) ? GL_NEAREST : GL_LINEAR;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        return texture;
+    }
+}
+
+ResourceHandle PassBuilder::create(const std::string& name, const TextureDescription& description)
+{
+    auto& resources = _frameGraph._resources;
+    ResourceHandle const handle = static_cast<ResourceHandle>(resources.size());
+    resources.push_back({name, description, false, 0, {_passIndex}, 0, false, NO_POOL_INDEX, handle, NO_VERSION});
+
+    _frameGraph._passes[_passIndex].writes.push_back(handle);
+    return handle;
+}
+
+ResourceHandle PassBuilder::read(ResourceHandle resource)
+{
+    assert(resource < _frameGraph._resources.size());
+    ResourceHandle const latest = _frameGraph.latestVersion(resource);
+    _frameGraph._passes[_passIndex].reads.push_back(latest);
+    return latest;
+}
+
+ResourceHandle PassBuilder::write(ResourceHandle resource)
+{
+    assert(resource < _frameGraph._resources.size());
+    auto& resources = _frameGraph._resources;
+    auto& pass = _frameGraph._passes[_passIndex];
+
+    // Drawing on top of what earlier passes left there depends on them, as a read would. Writing goes to
+    // a new version, so the pass is not kept alive by its own read and culling still works.
+    ResourceHandle const previous = _frameGraph.latestVersion(resource);
+    if (std::find(pass.reads.begin(), pass.reads.end(), previous) == pass.reads.end())
+        pass.reads.push_back(previous);
+
+    ResourceHandle const handle = static_cast<ResourceHandle>(resources.size());
+    auto version = resources[previous];
+    version.writers = {_passIndex};
+    version.output = false;
+    resources.push_back(std::move(version));
+    resources[previous].nextVersion = handle;
+
+    pass.writes.push_back(handle);
+    return handle;
+}
+
+void PassBuilder::sideEffect()
+{
+    _frameGraph._passes[_passIndex].sideEffect = true;
+}
+
+GLuint PassResources::texture(ResourceHandle resource) const
+{
+    return _frameGraph._resources.at(resource).texture;
+}
+
+const TextureDescription& PassResources::description(ResourceHandle resource) const
+{
+    return _frameGraph._resources.at(resource).description;
+}
+
+void FrameGraph::addPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute)
+{
+    _passes.push_back({name, std::move(execute), {}, {}, 0, false, false});
+
+    PassBuilder builder(*this, _passes.size() - 1);
+    setup(builder);
+}
+
+ResourceHandle FrameGraph::importTexture(const std::string& name, GLuint texture, const TextureDescription& description)
+{
+    ResourceHandle const handle = static_cast<ResourceHandle>(_resources.size());
+    _resources.push_back({name, description, true, texture, {}, 0, false, NO_POOL_INDEX, handle, NO_VERSION});
+    return handle;
+}
+
+void FrameGraph::markOutput(ResourceHandle resource)
+{
+    _resources.at(latestVersion(resource)).output = true;
+}
+
+ResourceHandle FrameGraph::latestVersion(ResourceHandle resource) const
+{
+    while (_resources[resource].nextVersion != NO_VERSION)
+        resource = _resources[resource].nextVersion;
+    return resource;
+}
+
+void FrameGraph::compile()
+{
+    _frame++;
+    _stats = FrameGraphStats();
+    _stats.passes = _passes.size();
+
+    // 1. Reference counts: passes are referenced by the resources they write, resources by their readers
+    for (auto& resource : _resources)
+        resource.references = resource.output ? 1 : 0;
+
+    for (auto& pass : _passes)
+    {
+        pass.references = pass.writes.size();
+        pass.culled = false;
+        for (auto resource : pass.reads)
+            _resources[resource].references++;
+    }
+
+    // A pass writing nothing, without side effects, is useless from the start
+    for (auto& pass : _passes)
+    {
+        if (pass.references != 0 or pass.sideEffect)
+            continue;
+
+        pass.culled = true;
+        _stats.culledPasses++;
+        for (auto resource : pass.reads)
+            _resources[resource].references--;
+    }
+
+    std::vector<ResourceHandle> unreferenced;
+    for (ResourceHandle handle = 0; handle < _resources.size(); ++handle)
+    {
+        if (_resources[handle].references == 0)
+            unreferenced.push_back(handle);
+    }
+
+    // 2. Culling: a pass whose outputs are all unused is dropped, which may leave its inputs unused too
+    while (not unreferenced.empty())
+    {
+        ResourceHandle const handle = unreferenced.back();
+        unreferenced.pop_back();
+
+        for (auto writer : _resources[handle].writers)
+        {
+            Pass& pass = _passes[writer];
+            if (pass.references == 0 or --pass.references > 0 or pass.sideEffect)
+                continue;
+
+            pass.culled = true;
+            _stats.culledPasses++;
+            for (auto read : pass.reads)
+            {
+                if (--_resources[read].references == 0)
+                    unreferenced.push_back(read);
+            }
+        }
+    }
+
+    // 3. Lifetimes, as the range of surviving passes using each transient resource, over all its versions
+    std::size_t const never = std::numeric_limits<std::size_t>::max();
+    std::vector<std::size_t> firstUse(_resources.size(), never), lastUse(_resources.size(), 0);
+    for (std::size_t passIndex = 0; passIndex < _passes.size(); ++passIndex)
+    {
+        Pass const& pass = _passes[passIndex];
+        if (pass.culled)
+            continue;
+
+        auto use = [&](ResourceHandle handle)
+        {
+            ResourceHandle const first = _resources[handle].firstVersion;
+            firstUse[first] = std::min(firstUse[first], passIndex);
+            lastUse[first] = std::max(lastUse[first], passIndex);
+        };
+        std::for_each(pass.reads.begin(), pass.reads.end(), use);
+        std::for_each(pass.writes.begin(), pass.writes.end(), use);
+    }
+    for (ResourceHandle handle = 0; handle < _resources.size(); ++handle)
+    {
+        if (_resources[handle].output)
+            lastUse[_resources[handle].firstVersion] = _passes.size();
+    }
+
+    // 4. Allocation: a pooled texture is reused as soon as the last pass of its previous resource is done
+    for (auto& pooledTexture : _pool)
+        pooledTexture.inUse = false;
+
+    for (std::size_t passIndex = 0; passIndex < _passes.size(); ++passIndex)
+    {
+        for (ResourceHandle handle = 0; handle < _resources.size(); ++handle)
+        {
+            Resource& resource = _resources[handle];
+            if (resource.imported or firstUse[handle] != passIndex)
+                continue;
+
+            resource.poolIndex = acquireTexture(resource.description);
+            resource.texture = _pool[resource.poolIndex].texture;
+            _stats.transientResources++;
+        }
+
+        for (ResourceHandle handle = 0; handle < _resources.size(); ++handle)
+        {
+            Resource const& resource = _resources[handle];
+            if (not resource.imported and firstUse[handle] != never and lastUse[handle] == passIndex)
+                _pool[resource.poolIndex].inUse = false;
+        }
+    }
+
+    // Later versions render to the texture of the first one
+    for (auto& resource : _resources)
+    {
+        Resource const& first = _resources[resource.firstVersion];
+        resource.texture = first.texture;
+        resource.poolIndex = first.poolIndex;
+    }
+
+    releaseUnusedTextures();
+
+    _stats.pooledTextures = _pool.size();
+    for (auto const& pooledTexture : _pool)
+    {
+        auto const& description = pooledTexture.description;
+        _stats.pooledBytes += description.width * description.height * bytesPerTexel(description.internalFormat);
+    }
+}
+
+std::size_t FrameGraph::acquireTexture(const TextureDescription& description)
+{
+    for (std::size_t poolIndex = 0; poolIndex < _pool.size(); ++poolIndex)
+    {
+        PooledTexture& pooledTexture = _pool[poolIndex];
+        if (not pooledTexture.inUse and pooledTexture.description == description)
+        {
+            pooledTexture.inUse = true;
+            pooledTexture.lastUsedFrame = _frame;
+            return poolIndex;
+        }
+    }
+
+    _pool.push_back({createTexture(description), description, _frame, true});
+    return _pool.size() - 1;
+}
+
+void FrameGraph::releaseUnusedTextures()
+{
+    std::vector<GLuint> released;
+    for (auto const& pooledTexture : _pool)
+    {
+        if (pooledTexture.lastUsedFrame + MAX_UNUSED_FRAMES < _frame)
+            released.push_back(pooledTexture.texture);
+    }
+
+    if (released.empty())
+        return;
+
+    // Framebuffers using a released texture are not valid anymore
+    for (auto it = _framebuffers.begin(); it != _framebuffers.end();)
+    {
+        bool const usesReleased = std::any_of(it->first.begin(), it->first.end(), [&](GLuint texture)
+        {
+            return std::find(released.begin(), released.end(), texture) != released.end();
+        });
+
+        if (usesReleased)
+        {
+            glDeleteFramebuffers(1, &it->second);
+            it = _framebuffers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    glDeleteTextures(static_cast<GLsizei>(released.size()), released.data());
+    std::erase_if(_pool, [&](const PooledTexture& pooledTexture)
+    {
+        return pooledTexture.lastUsedFrame + MAX_UNUSED_FRAMES < _frame;
+    });
+
+    // Pool indices changed, they are recomputed for the resources of this frame
+    for (auto& resource : _resources)
+    {
+        if (resource.imported or resource.poolIndex == NO_POOL_INDEX)
+            continue;
+
+        auto it = std::find_if(_pool.begin(), _pool.end(), [&](const PooledTexture& pooledTexture)
+        {
+            return pooledTexture.texture == resource.texture;
+        });
+        resource.poolIndex = std::distance(_pool.begin(), it);
+    }
+}
+
+GLuint FrameGraph::framebuffer(const Pass& pass)
+{
+    std::vector<GLuint> attachments;
+    for (auto handle : pass.writes)
+        attachments.push_back(_resources[handle].texture);
+
+    auto it = _framebuffers.find(attachments);
+    if (it != _framebuffers.end())
+        return it->second;
+
+    GLuint fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    std::vector<GLenum> drawBuffers;
+    for (auto handle : pass.writes)
+    {
+        Resource const& resource = _resources[handle];
+        GLint const internalFormat = resource.description.internalFormat;
+
+        GLenum attachment;
+        if (isDepthFormat(internalFormat))
+        {
+            attachment = GL_DEPTH_ATTACHMENT;
+        }
+        else if (isDepthStencilFormat(internalFormat))
+        {
+            attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+        }
+        else
+        {
+            attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(drawBuffers.size());
+            drawBuffers.push_back(attachment);
+        }
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, resource.texture, 0);
+    }
+
+    // Depth only passes, like shadow maps, do not write colors
+    if (drawBuffers.empty())
+        glDrawBuffer(GL_NONE);
+    else
+        glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::FRAME_GRAPH::FRAMEBUFFER_INCOMPLETE: " << pass.name << std::endl;
+        throw;
+    }
+
+    _framebuffers.emplace(attachments, fbo);
+    return fbo;
+}
+
+void FrameGraph::execute()
+{
+    PassResources passResources(*this);
+
+    for (auto& pass : _passes)
+    {
+        if (pass.culled)
+            continue;
+
+        if (not pass.writes.empty())
+        {
+            Resource const& firstOutput = _resources[pass.writes.front()];
+            bool const defaultFramebuffer = std::any_of(pass.writes.begin(), pass.writes.end(), [&](ResourceHandle handle)
+            {
+                return _resources[handle].imported and _resources[handle].texture == 0;
+            });
+
+            glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebuffer ? 0 : framebuffer(pass));
+            glViewport(0, 0, firstOutput.description.width, firstOutput.description.height);
+        }
+
+        pass.execute(passResources);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void FrameGraph::reset()
+{
+    _passes.clear();
+    _resources.clear();
+}
+
+void FrameGraph::clear()
+{
+    reset();
+
+    for (auto const& [attachments, fbo] : _framebuffers)
+        glDeleteFramebuffers(1, &fbo);
+    _framebuffers.clear();
+
+    for (auto const& pooledTexture : _pool)
+        glDeleteTextures(1, &pooledTexture.texture);
+    _pool.clear();
+}
+
+std::ostream& operator<<(std::ostream& os, const FrameGraphStats& stats)
+{
+    os << "[" << stats.passes << " passes - "
+        << stats.culledPasses << " culled - "
+        << stats.transientResources << " transient textures in "
+        << stats.pooledTextures << " pooled ("
+        << stats.pooledBytes / (1024 * 1024) << " MB)]";
+    return os;
+}
+
+} // Grafica
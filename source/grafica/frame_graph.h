@@ -0,0 +1,186 @@
+/**
+ * @file frame_graph.h
+ * @brief FrameGraph describes a frame as passes reading and writing render targets.
+ *        Unused passes are culled and transient textures are shared between passes whose lifetimes do not overlap.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <iostream>
+#include <glad/glad.h>
+
+namespace Grafica
+{
+
+class FrameGraph;
+
+/** Size and format of a render target texture */
+struct TextureDescription
+{
+    unsigned int width;
+    unsigned int height;
+    GLint internalFormat;
+
+    bool operator==(const TextureDescription& other) const = default;
+};
+
+/** Identifies a virtual resource of the graph. Handles are only valid for the frame they were created in. */
+using ResourceHandle = std::uint32_t;
+
+/** Used inside the setup function of a pass to declare the resources it uses */
+class PassBuilder
+{
+public:
+    /** Declares a new transient texture written by this pass */
+    ResourceHandle create(const std::string& name, const TextureDescription& description);
+
+    /** Declares that this pass samples the resource, as the last pass writing it so far left it */
+    ResourceHandle read(ResourceHandle resource);
+
+    /** Declares that this pass renders on top of an existing resource. Returns a new version of it, sharing
+     * its texture: this pass reads the previous version, so the passes that wrote it are kept as long as
+     * this one is, while the new version keeps this pass only if something uses it.
+     * Handles of earlier versions stay valid and refer to the latest one, as passes run in declaration order.
+     */
+    ResourceHandle write(ResourceHandle resource);
+
+    /** The pass is never culled, even if nothing reads its outputs (e.g. it updates external state) */
+    void sideEffect();
+
+private:
+    friend class FrameGraph;
+    PassBuilder(FrameGraph& frameGraph, std::size_t passIndex) : _frameGraph(frameGraph), _passIndex(passIndex) {}
+
+    FrameGraph& _frameGraph;
+    std::size_t _passIndex;
+};
+
+/** Given to the execute function of a pass to get the OpenGL textures behind its handles.
+ * When the function is called, the framebuffer with the pass outputs is already bound.
+ */
+class PassResources
+{
+public:
+    GLuint texture(ResourceHandle resource) const;
+
+    const TextureDescription& description(ResourceHandle resource) const;
+
+private:
+    friend class FrameGraph;
+    explicit PassResources(const FrameGraph& frameGraph) : _frameGraph(frameGraph) {}
+
+    const FrameGraph& _frameGraph;
+};
+
+struct FrameGraphStats
+{
+    std::size_t passes = 0;
+    std::size_t culledPasses = 0;
+    std::size_t transientResources = 0;
+    std::size_t pooledTextures = 0;
+    std::size_t pooledBytes = 0;
+};
+
+/** Typical usage per frame:
+ *     frameGraph.reset();
+ *     auto backbuffer = frameGraph.importTexture("backbuffer", 0, {width, height, GL_RGBA8});
+ *     frameGraph.addPass("shadows", setup, execute); ...
+ *     frameGraph.markOutput(backbuffer);
+ *     frameGraph.compile();
+ *     frameGraph.execute();
+ * Passes are executed in declaration order: a handle exists only after the pass creating it was added,
+ * so that order always respects the dependencies.
+ * Textures and framebuffers are kept in a pool between frames and must be freed with clear().
+ */
+class FrameGraph
+{
+public:
+    using SetupFunction = std::function<void(PassBuilder&)>;
+    using ExecuteFunction = std::function<void(const PassResources&)>;
+
+    /** Calls setup right away, so the handles it creates can be used by the next passes */
+    void addPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute);
+
+    /** Registers a texture owned outside the graph. Texture 0 stands for the default framebuffer. */
+    ResourceHandle importTexture(const std::string& name, GLuint texture, const TextureDescription& description);
+
+    /** The resource is needed after the frame graph, so the passes producing it are kept */
+    void markOutput(ResourceHandle resource);
+
+    /** Culls the passes not contributing to outputs and assigns pooled textures to the transient resources */
+    void compile();
+
+    /** Runs the surviving passes, binding a framebuffer with the outputs of each one */
+    void execute();
+
+    /** Forgets the passes and resources of the frame, keeping the pooled textures */
+    void reset();
+
+    /** Freeing GPU memory */
+    void clear();
+
+    inline const FrameGraphStats& stats() const { return _stats; }
+
+private:
+    friend class PassBuilder;
+    friend class PassResources;
+
+    struct Resource
+    {
+        std::string name;
+        TextureDescription description;
+        bool imported;
+        GLuint texture;
+        std::vector<std::size_t> writers;
+        std::size_t references;
+        bool output;
+        std::size_t poolIndex;
+
+        /* The first version, which owns the texture, and the one written after this, if any */
+        ResourceHandle firstVersion;
+        ResourceHandle nextVersion;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        ExecuteFunction execute;
+        std::vector<ResourceHandle> reads;
+        std::vector<ResourceHandle> writes;
+        std::size_t references;
+        bool sideEffect;
+        bool culled;
+    };
+
+    struct PooledTexture
+    {
+        GLuint texture;
+        TextureDescription description;
+        std::uint64_t lastUsedFrame;
+        bool inUse;
+    };
+
+    ResourceHandle latestVersion(ResourceHandle resource) const;
+    std::size_t acquireTexture(const TextureDescription& description);
+    void releaseUnusedTextures();
+    GLuint framebuffer(const Pass& pass);
+
+    std::vector<Resource> _resources;
+    std::vector<Pass> _passes;
+    std::vector<PooledTexture> _pool;
+    std::map<std::vector<GLuint>, GLuint> _framebuffers;
+    std::uint64_t _frame = 0;
+    FrameGraphStats _stats;
+};
+
+std::ostream& operator<<(std::ostream& os, const FrameGraphStats& stats);
+
+} // Grafica
@@ -22,6 +22,8 @@ void GPUShape::initBuffers()
 void GPUShape::fillBuffers(const Shape& shape, GLuint usage)
 {
     size = shape.indices.size();
+    bounds = computeAABB(shape);
+    boundingSphere = computeBoundingSphere(shape);
 
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, shape.vertices.size() * SIZE_IN_BYTES, shape.vertices.data(), usage);
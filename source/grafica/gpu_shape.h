@@ -15,6 +15,7 @@
 #include <glad/glad.h>
 
 #include "shape.h"
+#include "bounds.h"
 
 namespace Grafica
 {
@@ -26,8 +27,12 @@ constexpr unsigned int SIZE_IN_BYTES = 4;
 
 struct GPUShape
 {
-    GLuint vao, vbo, ebo, texture;
-    std::size_t size;
+    GLuint vao = 0, vbo = 0, ebo = 0, texture = 0;
+    std::size_t size = 0;
+
+    /* Bounds of the vertex positions in model coordinates, updated by fillBuffers */
+    AABB bounds = AABB::empty();
+    BoundingSphere boundingSphere = {Vector3f(0, 0, 0), 0};
 
     /*
     Convenience function for initialization of OpenGL buffers.
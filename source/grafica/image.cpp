@@ -0,0 +1,34 @@
+/**
+ * @file image.cpp
+ * @brief RGB images in memory, as produced by the CPU renderers, and saving them to files.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "image.h"
+
+#include <algorithm>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+namespace Grafica
+{
+
+bool savePNG(const Image& image, const std::string& path)
+{
+    std::vector<unsigned char> bytes(image.pixels.size() * 3);
+    for (std::size_t i = 0; i < image.pixels.size(); ++i)
+        for (unsigned int channel = 0; channel < 3; ++channel)
+            bytes[3 * i + channel] = static_cast<unsigned char>(std::clamp(image.pixels[i][channel], 0.0f, 1.0f) * 255 + 0.5f);
+
+    return stbi_write_png(path.c_str(), image.width, image.height, 3, bytes.data(), image.width * 3) != 0;
+}
+
+bool saveHDR(const Image& image, const std::string& path)
+{
+    static_assert(sizeof(Vector3f) == 3 * sizeof(float), "Vector3f is expected to be 3 packed floats");
+    return stbi_write_hdr(path.c_str(), image.width, image.height, 3, image.pixels.data()->data()) != 0;
+}
+
+} // Grafica
@@ -0,0 +1,35 @@
+/**
+ * @file image.h
+ * @brief RGB images in memory, as produced by the CPU renderers, and saving them to files.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "simple_eigen.h"
+
+namespace Grafica
+{
+
+/** RGB as the shaders write it to the framebuffer, rows from top to bottom */
+struct Image
+{
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<Vector3f> pixels;
+
+    inline Vector3f& at(unsigned int x, unsigned int y) { return pixels[std::size_t(y) * width + x]; }
+    inline const Vector3f& at(unsigned int x, unsigned int y) const { return pixels[std::size_t(y) * width + x]; }
+};
+
+/** 8 bits per channel, clamping to [0, 1]. Returns false if the file could not be written. */
+bool savePNG(const Image& image, const std::string& path);
+
+/** Radiance HDR, keeping values above 1 */
+bool saveHDR(const Image& image, const std::string& path);
+
+} // Grafica
@@ -0,0 +1,352 @@
+/**
+ * @file loose_octree.cpp
+ * @brief Loose octree over object bounds, for ray picking, overlap and nearest neighbour queries
+ *        without walking the whole scene. Moving objects are updated incrementally.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "loose_octree.h"
+
+#include <cmath>
+#include <cassert>
+#include <queue>
+#include <utility>
+#include <algorithm>
+#include <ciso646>
+
+namespace Grafica
+{
+
+namespace
+{
+    bool overlaps(const AABB& lhs, const AABB& rhs)
+    {
+        return (lhs.min.array() <= rhs.max.array()).all() and (rhs.min.array() <= lhs.max.array()).all();
+    }
+
+    bool containsBox(const AABB& outer, const AABB& inner)
+    {
+        return (outer.min.array() <= inner.min.array()).all() and (inner.max.array() <= outer.max.array()).all();
+    }
+
+    /* Cells or objects waiting in a priority queue, the closest one on top */
+    template <typename T>
+    using ClosestFirst = std::priority_queue<std::pair<Coord, T>, std::vector<std::pair<Coord, T>>, std::greater<std::pair<Coord, T>>>;
+}
+
+LooseOctree::LooseOctree(const AABB& worldBounds, unsigned int maxDepth, Coord looseness):
+    _looseness(std::max(looseness, Coord(1))),
+    _maxDepth(maxDepth)
+{
+    Vector3f const center = worldBounds.isEmpty() ? Vector3f(0, 0, 0) : worldBounds.center();
+    Coord const halfSize = worldBounds.isEmpty() ? 1 : std::max(worldBounds.extents().maxCoeff(), Coord(1e-3));
+
+    Cell root;
+    root.center = center;
+    root.halfSize = halfSize;
+    Vector3f const looseExtents = Vector3f::Constant(halfSize * _looseness);
+    root.looseBounds = {center - looseExtents, center + looseExtents};
+    root.parent = NO_CELL;
+    std::fill(std::begin(root.children), std::end(root.children), NO_CELL);
+    root.depth = 0;
+    root.subtreeObjects = 0;
+
+    _cells.push_back(std::move(root));
+}
+
+LooseOctree::CellIndex LooseOctree::createCell(CellIndex parent, unsigned int octant)
+{
+    Coord const halfSize = _cells[parent].halfSize / 2;
+    Vector3f const offset(
+        octant & 1 ? halfSize : -halfSize,
+        octant & 2 ? halfSize : -halfSize,
+        octant & 4 ? halfSize : -halfSize);
+
+    Cell cell;
+    cell.center = _cells[parent].center + offset;
+    cell.halfSize = halfSize;
+    Vector3f const looseExtents = Vector3f::Constant(halfSize * _looseness);
+    cell.looseBounds = {cell.center - looseExtents, cell.center + looseExtents};
+    cell.parent = parent;
+    std::fill(std::begin(cell.children), std::end(cell.children), NO_CELL);
+    cell.depth = _cells[parent].depth + 1;
+    cell.subtreeObjects = 0;
+
+    _cells.push_back(std::move(cell));
+
+    CellIndex const index = static_cast<CellIndex>(_cells.size() - 1);
+    _cells[parent].children[octant] = index;
+    return index;
+}
+
+LooseOctree::CellIndex LooseOctree::findCell(const AABB& bounds)
+{
+    Vector3f const center = bounds.center();
+    Coord const halfSize = bounds.extents().maxCoeff();
+
+    // Outside of the root cell everything stays at the root
+    Cell const& root = _cells[0];
+    if (((center - root.center).cwiseAbs().array() > root.halfSize).any())
+        return 0;
+
+    // Going down while the object fits in the loose bounds of the child containing its center
+    CellIndex cell = 0;
+    while (_cells[cell].depth < _maxDepth)
+    {
+        Coord const childHalfSize = _cells[cell].halfSize / 2;
+        if (halfSize > (_looseness - 1) * childHalfSize)
+            break;
+
+        Vector3f const& cellCenter = _cells[cell].center;
+        unsigned int const octant =
+            (center[0] >= cellCenter[0] ? 1 : 0) |
+            (center[1] >= cellCenter[1] ? 2 : 0) |
+            (center[2] >= cellCenter[2] ? 4 : 0);
+
+        CellIndex const child = _cells[cell].children[octant];
+        cell = child != NO_CELL ? child : createCell(cell, octant);
+    }
+
+    return cell;
+}
+
+void LooseOctree::addToCell(ObjectId id, CellIndex cell)
+{
+    Object& object = _objects[id];
+    object.cell = cell;
+    object.slot = static_cast<std::uint32_t>(_cells[cell].objects.size());
+    _cells[cell].objects.push_back(id);
+
+    // The root takes whatever does not fit anywhere, growing to keep it inside
+    if (cell == 0)
+        _cells[0].looseBounds.extend(object.bounds);
+
+    for (CellIndex ancestor = cell; ancestor != NO_CELL; ancestor = _cells[ancestor].parent)
+        _cells[ancestor].subtreeObjects += 1;
+}
+
+void LooseOctree::removeFromCell(ObjectId id)
+{
+    Object& object = _objects[id];
+    auto& objects = _cells[object.cell].objects;
+
+    // Swap and pop, fixing the slot of the object moved
+    ObjectId const last = objects.back();
+    objects[object.slot] = last;
+    _objects[last].slot = object.slot;
+    objects.pop_back();
+
+    for (CellIndex ancestor = object.cell; ancestor != NO_CELL; ancestor = _cells[ancestor].parent)
+        _cells[ancestor].subtreeObjects -= 1;
+
+    object.cell = NO_CELL;
+}
+
+void LooseOctree::update(ObjectId id, const AABB& bounds)
+{
+    assert(not bounds.isEmpty());
+
+    if (id >= _objects.size())
+        _objects.resize(id + 1);
+
+    Object& object = _objects[id];
+    object.bounds = bounds;
+
+    if (object.cell != NO_CELL)
+    {
+        // Small motions stay within the loose bounds, and then nothing moves
+        Cell const& cell = _cells[object.cell];
+        if (object.cell != 0 and containsBox(cell.looseBounds, bounds))
+            return;
+
+        removeFromCell(id);
+        _size -= 1;
+    }
+
+    addToCell(id, findCell(bounds));
+    _size += 1;
+}
+
+void LooseOctree::remove(ObjectId id)
+{
+    if (not contains(id))
+        return;
+
+    removeFromCell(id);
+    _size -= 1;
+}
+
+bool LooseOctree::contains(ObjectId id) const
+{
+    return id < _objects.size() and _objects[id].cell != NO_CELL;
+}
+
+void LooseOctree::queryAABB(const AABB& aabb, std::vector<ObjectId>& result) const
+{
+    std::vector<CellIndex> pending = {0};
+    while (not pending.empty())
+    {
+        Cell const& cell = _cells[pending.back()];
+        pending.pop_back();
+
+        if (cell.subtreeObjects == 0 or not overlaps(cell.looseBounds, aabb))
+            continue;
+
+        for (auto id : cell.objects)
+            if (overlaps(_objects[id].bounds, aabb))
+                result.push_back(id);
+
+        for (auto child : cell.children)
+            if (child != NO_CELL)
+                pending.push_back(child);
+    }
+}
+
+void LooseOctree::querySphere(const BoundingSphere& sphere, std::vector<ObjectId>& result) const
+{
+    Coord const squaredRadius = sphere.radius * sphere.radius;
+
+    std::vector<CellIndex> pending = {0};
+    while (not pending.empty())
+    {
+        Cell const& cell = _cells[pending.back()];
+        pending.pop_back();
+
+        if (cell.subtreeObjects == 0 or squaredDistance(sphere.center, cell.looseBounds) > squaredRadius)
+            continue;
+
+        for (auto id : cell.objects)
+            if (squaredDistance(sphere.center, _objects[id].bounds) <= squaredRadius)
+                result.push_back(id);
+
+        for (auto child : cell.children)
+            if (child != NO_CELL)
+                pending.push_back(child);
+    }
+}
+
+std::optional<ObjectHit> LooseOctree::raycast(
+    const Ray& ray,
+    Coord maxDistance,
+    const std::function<std::optional<Coord>(ObjectId, Coord)>& exactTest) const
+{
+    std::optional<ObjectHit> closest;
+    Coord closestDistance = maxDistance;
+
+    ClosestFirst<CellIndex> pending;
+    if (auto entry = intersect(ray, _cells[0].looseBounds, closestDistance))
+        pending.push({*entry, 0});
+
+    while (not pending.empty())
+    {
+        auto const [entry, cellIndex] = pending.top();
+        pending.pop();
+
+        // Everything left is farther than what was already hit
+        if (entry > closestDistance)
+            break;
+
+        Cell const& cell = _cells[cellIndex];
+        for (auto id : cell.objects)
+        {
+            auto distance = intersect(ray, _objects[id].bounds, closestDistance);
+            if (distance and exactTest)
+                distance = exactTest(id, *distance);
+
+            if (distance and *distance <= closestDistance)
+            {
+                closestDistance = *distance;
+                closest = ObjectHit{id, *distance};
+            }
+        }
+
+        for (auto child : cell.children)
+        {
+            if (child == NO_CELL or _cells[child].subtreeObjects == 0)
+                continue;
+
+            if (auto childEntry = intersect(ray, _cells[child].looseBounds, closestDistance))
+                pending.push({*childEntry, child});
+        }
+    }
+
+    return closest;
+}
+
+std::vector<ObjectHit> LooseOctree::nearest(const Vector3f& point, std::size_t k, Coord maxDistance) const
+{
+    std::vector<ObjectHit> result;
+    if (k == 0)
+        return result;
+
+    Coord const squaredMaxDistance = std::isinf(maxDistance) ? maxDistance : maxDistance * maxDistance;
+
+    // The k best so far, the worst of them on top
+    std::priority_queue<std::pair<Coord, ObjectId>> best;
+    auto worst = [&]()
+    {
+        return best.size() < k ? squaredMaxDistance : best.top().first;
+    };
+
+    ClosestFirst<CellIndex> pending;
+    pending.push({squaredDistance(point, _cells[0].looseBounds), 0});
+
+    while (not pending.empty())
+    {
+        auto const [cellDistance, cellIndex] = pending.top();
+        pending.pop();
+
+        if (cellDistance > worst())
+            break;
+
+        Cell const& cell = _cells[cellIndex];
+        for (auto id : cell.objects)
+        {
+            Coord const distance = squaredDistance(point, _objects[id].bounds);
+            if (distance > worst())
+                continue;
+
+            best.push({distance, id});
+            if (best.size() > k)
+                best.pop();
+        }
+
+        for (auto child : cell.children)
+        {
+            if (child == NO_CELL or _cells[child].subtreeObjects == 0)
+                continue;
+
+            Coord const childDistance = squaredDistance(point, _cells[child].looseBounds);
+            if (childDistance <= worst())
+                pending.push({childDistance, child});
+        }
+    }
+
+    result.resize(best.size());
+    for (std::size_t i = result.size(); i-- > 0;)
+    {
+        result[i] = {best.top().second, std::sqrt(best.top().first)};
+        best.pop();
+    }
+
+    return result;
+}
+
+void updateLooseOctree(LooseOctree& octree, const FlatSceneGraph& flatSceneGraph)
+{
+    for (auto node : flatSceneGraph.drawableNodes())
+    {
+        if (octree.contains(node) and not flatSceneGraph.worldChanged(node))
+            continue;
+
+        AABB const& modelBounds = flatSceneGraph.gpuShapeMaybe(node).value()->bounds;
+        if (modelBounds.isEmpty())
+            continue;
+
+        octree.update(node, transformAABB(modelBounds, flatSceneGraph.worldTransform(node)));
+    }
+}
+
+} // Grafica
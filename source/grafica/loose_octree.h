@@ -0,0 +1,118 @@
+/**
+ * @file loose_octree.h
+ * @brief Loose octree over object bounds, for ray picking, overlap and nearest neighbour queries
+ *        without walking the whole scene. Moving objects are updated incrementally.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <optional>
+#include <functional>
+#include "bounds.h"
+#include "flat_scene_graph.h"
+#include "simple_eigen.h"
+
+namespace Grafica
+{
+
+using ObjectId = std::uint32_t;
+
+struct ObjectHit
+{
+    ObjectId id;
+    Coord distance;
+};
+
+/** Each cell stores the objects whose center falls in it and whose size fits in the cell grown by the looseness
+ * factor, so an object lives in exactly one cell, picked from its size and center without any search.
+ * A moving object only changes cell when it crosses the loose bounds, which are larger than the cell itself.
+ * Objects outside of the initial bounds are kept at the root.
+ */
+class LooseOctree
+{
+public:
+    explicit LooseOctree(const AABB& worldBounds, unsigned int maxDepth = 8, Coord looseness = 2);
+
+    /** Adds or moves an object. Ids are small integers, e.g. node indices, as they index an array. */
+    void update(ObjectId id, const AABB& bounds);
+
+    void remove(ObjectId id);
+
+    bool contains(ObjectId id) const;
+
+    inline std::size_t size() const { return _size; }
+
+    /** Bounds as last given to update */
+    const AABB& bounds(ObjectId id) const { return _objects[id].bounds; }
+
+    /** Objects whose bounds overlap the box, appended to result */
+    void queryAABB(const AABB& aabb, std::vector<ObjectId>& result) const;
+
+    /** Objects whose bounds overlap the sphere, appended to result */
+    void querySphere(const BoundingSphere& sphere, std::vector<ObjectId>& result) const;
+
+    /** Closest object along the ray, visiting cells from front to back.
+     * The test of an object defaults to its bounds; exactTest can refine it, e.g. against triangles,
+     * given the distance where the ray enters the bounds. It returns the hit distance or nullopt on a miss.
+     */
+    std::optional<ObjectHit> raycast(
+        const Ray& ray,
+        Coord maxDistance = std::numeric_limits<Coord>::infinity(),
+        const std::function<std::optional<Coord>(ObjectId, Coord)>& exactTest = nullptr) const;
+
+    /** Up to k objects closest to point, measured to their bounds, from closest to farthest */
+    std::vector<ObjectHit> nearest(
+        const Vector3f& point,
+        std::size_t k,
+        Coord maxDistance = std::numeric_limits<Coord>::infinity()) const;
+
+private:
+    using CellIndex = std::uint32_t;
+    static constexpr CellIndex NO_CELL = std::numeric_limits<CellIndex>::max();
+
+    struct Cell
+    {
+        Vector3f center;
+        Coord halfSize;
+        AABB looseBounds;
+        CellIndex parent;
+        CellIndex children[8];
+        unsigned int depth;
+        std::vector<ObjectId> objects;
+
+        /* Objects in this cell and below, so empty branches are skipped */
+        std::uint32_t subtreeObjects;
+    };
+
+    struct Object
+    {
+        AABB bounds;
+        CellIndex cell = NO_CELL;
+        std::uint32_t slot = 0;
+    };
+
+    CellIndex findCell(const AABB& bounds);
+    CellIndex createCell(CellIndex parent, unsigned int octant);
+    void addToCell(ObjectId id, CellIndex cell);
+    void removeFromCell(ObjectId id);
+
+    Coord _looseness;
+    unsigned int _maxDepth;
+    std::size_t _size = 0;
+    std::vector<Cell> _cells;
+    std::vector<Object> _objects;
+};
+
+/** Keeps an octree in sync with the drawable nodes of a FlatSceneGraph, to be called after updateWorldTransforms.
+ * Object ids are node indices and bounds are those of the shapes in world coordinates.
+ * Only nodes whose world transform changed are moved, except the first time a node is seen.
+ */
+void updateLooseOctree(LooseOctree& octree, const FlatSceneGraph& flatSceneGraph);
+
+} // Grafica
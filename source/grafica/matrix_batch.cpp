@@ -0,0 +1,317 @@
+/**
+ * @file matrix_batch.cpp
+ * @brief Aligned 4x4 matrices and SIMD kernels to multiply, invert and apply many of them at once.
+ *        Matrix4f is kept unaligned for OpenGL interop, which makes Eigen skip its vectorized paths;
+ *        hot loops use these types instead, and convert back at the GL upload boundary.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "matrix_batch.h"
+
+#include <cstring>
+#include "simd.h"
+
+namespace Grafica
+{
+
+AlignedMatrix4f AlignedMatrix4f::identity()
+{
+    AlignedMatrix4f matrix;
+    for (unsigned int i = 0; i < 16; ++i)
+        matrix.data[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+    return matrix;
+}
+
+AlignedMatrix4f AlignedMatrix4f::fromMatrix4f(const Matrix4f& matrix)
+{
+    // Both are column major
+    AlignedMatrix4f aligned;
+    std::memcpy(aligned.data, matrix.data(), sizeof(aligned.data));
+    return aligned;
+}
+
+Matrix4f AlignedMatrix4f::toMatrix4f() const
+{
+    Matrix4f matrix;
+    std::memcpy(matrix.data(), data, sizeof(data));
+    return matrix;
+}
+
+void multiply(const AlignedMatrix4f& lhs, const AlignedMatrix4f& rhs, AlignedMatrix4f& result)
+{
+    // Each result column is a combination of the lhs columns, weighted by the rhs column.
+    // All lhs columns are loaded before any store, and each rhs column before its result column is written.
+#if defined(GRAFICA_USE_AVX)
+    __m256 const lhs0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(lhs.data + 0));
+    __m256 const lhs1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(lhs.data + 4));
+    __m256 const lhs2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(lhs.data + 8));
+    __m256 const lhs3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(lhs.data + 12));
+
+    // Two result columns per iteration, one in each 128 bits lane
+    for (unsigned int column = 0; column < 4; column += 2)
+    {
+        __m256 const rhsColumns = _mm256_load_ps(rhs.data + 4 * column);
+        __m256 const sum = _mm256_add_ps(
+            _mm256_add_ps(
+                _mm256_mul_ps(lhs0, _mm256_permute_ps(rhsColumns, 0x00)),
+                _mm256_mul_ps(lhs1, _mm256_permute_ps(rhsColumns, 0x55))),
+            _mm256_add_ps(
+                _mm256_mul_ps(lhs2, _mm256_permute_ps(rhsColumns, 0xAA)),
+                _mm256_mul_ps(lhs3, _mm256_permute_ps(rhsColumns, 0xFF))));
+        _mm256_store_ps(result.data + 4 * column, sum);
+    }
+#elif defined(GRAFICA_USE_SSE2)
+    __m128 const lhs0 = _mm_load_ps(lhs.data + 0);
+    __m128 const lhs1 = _mm_load_ps(lhs.data + 4);
+    __m128 const lhs2 = _mm_load_ps(lhs.data + 8);
+    __m128 const lhs3 = _mm_load_ps(lhs.data + 12);
+
+    for (unsigned int column = 0; column < 4; ++column)
+    {
+        __m128 const rhsColumn = _mm_load_ps(rhs.data + 4 * column);
+        __m128 const sum = _mm_add_ps(
+            _mm_add_ps(
+                _mm_mul_ps(lhs0, _mm_shuffle_ps(rhsColumn, rhsColumn, 0x00)),
+                _mm_mul_ps(lhs1, _mm_shuffle_ps(rhsColumn, rhsColumn, 0x55))),
+            _mm_add_ps(
+                _mm_mul_ps(lhs2, _mm_shuffle_ps(rhsColumn, rhsColumn, 0xAA)),
+                _mm_mul_ps(lhs3, _mm_shuffle_ps(rhsColumn, rhsColumn, 0xFF))));
+        _mm_store_ps(result.data + 4 * column, sum);
+    }
+#else
+    AlignedMatrix4f product;
+    for (unsigned int column = 0; column < 4; ++column)
+    {
+        for (unsigned int row = 0; row < 4; ++row)
+        {
+            product(row, column) =
+                lhs(row, 0) * rhs(0, column) +
+                lhs(row, 1) * rhs(1, column) +
+                lhs(row, 2) * rhs(2, column) +
+                lhs(row, 3) * rhs(3, column);
+        }
+    }
+    result = product;
+#endif
+}
+
+void multiplyBatch(
+    const AlignedMatrix4f* parents,
+    const AlignedMatrix4f* locals,
+    AlignedMatrix4f* results,
+    std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i)
+        multiply(parents[i], locals[i], results[i]);
+}
+
+void multiplyBatch(
+    const AlignedMatrix4f& parent,
+    const AlignedMatrix4f* locals,
+    AlignedMatrix4f* results,
+    std::size_t count)
+{
+    // A copy, as results may overlap the parent
+    AlignedMatrix4f const parentCopy = parent;
+    for (std::size_t i = 0; i < count; ++i)
+        multiply(parentCopy, locals[i], results[i]);
+}
+
+namespace
+{
+    using namespace Simd;
+
+    /* Written once for a float and for four floats in a SSE register.
+     * in and out are the 16 elements in column major order, out must not alias in */
+    template <typename Real>
+    inline void affineInverseCore(const Real* in, Real* out)
+    {
+        // Columns of the linear part
+        Real const a0 = in[0], a1 = in[1], a2 = in[2];
+        Real const b0 = in[4], b1 = in[5], b2 = in[6];
+        Real const c0 = in[8], c1 = in[9], c2 = in[10];
+
+        // Rows of the inverse are the cross products of pairs of columns, over the determinant
+        Real const bc0 = sub(mul(b1, c2), mul(b2, c1));
+        Real const bc1 = sub(mul(b2, c0), mul(b0, c2));
+        Real const bc2 = sub(mul(b0, c1), mul(b1, c0));
+
+        Real const ca0 = sub(mul(c1, a2), mul(c2, a1));
+        Real const ca1 = sub(mul(c2, a0), mul(c0, a2));
+        Real const ca2 = sub(mul(c0, a1), mul(c1, a0));
+
+        Real const ab0 = sub(mul(a1, b2), mul(a2, b1));
+        Real const ab1 = sub(mul(a2, b0), mul(a0, b2));
+        Real const ab2 = sub(mul(a0, b1), mul(a1, b0));
+
+        Real const determinant = add(add(mul(a0, bc0), mul(a1, bc1)), mul(a2, bc2));
+        Real const one = splat(determinant, 1.0f);
+        Real const inverseDeterminant = div(one, determinant);
+
+        Real const r00 = mul(bc0, inverseDeterminant), r01 = mul(bc1, inverseDeterminant), r02 = mul(bc2, inverseDeterminant);
+        Real const r10 = mul(ca0, inverseDeterminant), r11 = mul(ca1, inverseDeterminant), r12 = mul(ca2, inverseDeterminant);
+        Real const r20 = mul(ab0, inverseDeterminant), r21 = mul(ab1, inverseDeterminant), r22 = mul(ab2, inverseDeterminant);
+
+        Real const t0 = in[12], t1 = in[13], t2 = in[14];
+        Real const zero = splat(t0, 0.0f);
+
+        out[0] = r00; out[1] = r10; out[2] = r20; out[3] = zero;
+        out[4] = r01; out[5] = r11; out[6] = r21; out[7] = zero;
+        out[8] = r02; out[9] = r12; out[10] = r22; out[11] = zero;
+        out[12] = neg(add(add(mul(r00, t0), mul(r01, t1)), mul(r02, t2)));
+        out[13] = neg(add(add(mul(r10, t0), mul(r11, t1)), mul(r12, t2)));
+        out[14] = neg(add(add(mul(r20, t0), mul(r21, t1)), mul(r22, t2)));
+        out[15] = one;
+    }
+}
+
+void affineInverse(const AlignedMatrix4f& matrix, AlignedMatrix4f& result)
+{
+    AlignedMatrix4f inverse;
+    affineInverseCore(matrix.data, inverse.data);
+    result = inverse;
+}
+
+void toBlock(const AlignedMatrix4f* matrices, MatrixBlock4& block)
+{
+#if defined(GRAFICA_USE_SSE2)
+    // Transposing each column of the four matrices gives its four elements across matrices
+    for (unsigned int column = 0; column < 4; ++column)
+    {
+        __m128 row0 = _mm_load_ps(matrices[0].data + 4 * column);
+        __m128 row1 = _mm_load_ps(matrices[1].data + 4 * column);
+        __m128 row2 = _mm_load_ps(matrices[2].data + 4 * column);
+        __m128 row3 = _mm_load_ps(matrices[3].data + 4 * column);
+        _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+        _mm_store_ps(block.lanes[4 * column + 0], row0);
+        _mm_store_ps(block.lanes[4 * column + 1], row1);
+        _mm_store_ps(block.lanes[4 * column + 2], row2);
+        _mm_store_ps(block.lanes[4 * column + 3], row3);
+    }
+#else
+    for (unsigned int element = 0; element < 16; ++element)
+        for (unsigned int i = 0; i < 4; ++i)
+            block.lanes[element][i] = matrices[i].data[element];
+#endif
+}
+
+void fromBlock(const MatrixBlock4& block, AlignedMatrix4f* matrices)
+{
+#if defined(GRAFICA_USE_SSE2)
+    for (unsigned int column = 0; column < 4; ++column)
+    {
+        __m128 row0 = _mm_load_ps(block.lanes[4 * column + 0]);
+        __m128 row1 = _mm_load_ps(block.lanes[4 * column + 1]);
+        __m128 row2 = _mm_load_ps(block.lanes[4 * column + 2]);
+        __m128 row3 = _mm_load_ps(block.lanes[4 * column + 3]);
+        _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+        _mm_store_ps(matrices[0].data + 4 * column, row0);
+        _mm_store_ps(matrices[1].data + 4 * column, row1);
+        _mm_store_ps(matrices[2].data + 4 * column, row2);
+        _mm_store_ps(matrices[3].data + 4 * column, row3);
+    }
+#else
+    for (unsigned int element = 0; element < 16; ++element)
+        for (unsigned int i = 0; i < 4; ++i)
+            matrices[i].data[element] = block.lanes[element][i];
+#endif
+}
+
+void affineInverseBatch(const AlignedMatrix4f* matrices, AlignedMatrix4f* results, std::size_t count)
+{
+    std::size_t i = 0;
+
+#if defined(GRAFICA_USE_SSE2)
+    for (; i + 4 <= count; i += 4)
+    {
+        MatrixBlock4 block;
+        toBlock(matrices + i, block);
+
+        __m128 in[16], out[16];
+        for (unsigned int element = 0; element < 16; ++element)
+            in[element] = _mm_load_ps(block.lanes[element]);
+
+        affineInverseCore(in, out);
+
+        for (unsigned int element = 0; element < 16; ++element)
+            _mm_store_ps(block.lanes[element], out[element]);
+
+        fromBlock(block, results + i);
+    }
+#endif
+
+    for (; i < count; ++i)
+        affineInverse(matrices[i], results[i]);
+}
+
+void transformPoints(
+    const AlignedMatrix4f& matrix,
+    const float* x, const float* y, const float* z,
+    float* resultX, float* resultY, float* resultZ,
+    std::size_t count)
+{
+    const float* m = matrix.data;
+    std::size_t i = 0;
+
+#if defined(GRAFICA_USE_AVX)
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 const px = _mm256_loadu_ps(x + i);
+        __m256 const py = _mm256_loadu_ps(y + i);
+        __m256 const pz = _mm256_loadu_ps(z + i);
+
+        for (unsigned int row = 0; row < 3; ++row)
+        {
+            __m256 const value = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[row]), px), _mm256_mul_ps(_mm256_set1_ps(m[4 + row]), py)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[8 + row]), pz), _mm256_set1_ps(m[12 + row])));
+            float* output = row == 0 ? resultX : (row == 1 ? resultY : resultZ);
+            _mm256_storeu_ps(output + i, value);
+        }
+    }
+#endif
+
+#if defined(GRAFICA_USE_SSE2)
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 const px = _mm_loadu_ps(x + i);
+        __m128 const py = _mm_loadu_ps(y + i);
+        __m128 const pz = _mm_loadu_ps(z + i);
+
+        for (unsigned int row = 0; row < 3; ++row)
+        {
+            __m128 const value = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[row]), px), _mm_mul_ps(_mm_set1_ps(m[4 + row]), py)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[8 + row]), pz), _mm_set1_ps(m[12 + row])));
+            float* output = row == 0 ? resultX : (row == 1 ? resultY : resultZ);
+            _mm_storeu_ps(output + i, value);
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        float const px = x[i], py = y[i], pz = z[i];
+        resultX[i] = m[0] * px + m[4] * py + m[8] * pz + m[12];
+        resultY[i] = m[1] * px + m[5] * py + m[9] * pz + m[13];
+        resultZ[i] = m[2] * px + m[6] * py + m[10] * pz + m[14];
+    }
+}
+
+Vector4f transform(const AlignedMatrix4f& matrix, const Vector4f& vector)
+{
+    Vector4f result;
+    for (unsigned int row = 0; row < 4; ++row)
+    {
+        result[row] =
+            matrix(row, 0) * vector[0] +
+            matrix(row, 1) * vector[1] +
+            matrix(row, 2) * vector[2] +
+            matrix(row, 3) * vector[3];
+    }
+    return result;
+}
+
+} // Grafica
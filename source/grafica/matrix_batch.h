@@ -0,0 +1,85 @@
+/**
+ * @file matrix_batch.h
+ * @brief Aligned 4x4 matrices and SIMD kernels to multiply, invert and apply many of them at once.
+ *        Matrix4f is kept unaligned for OpenGL interop, which makes Eigen skip its vectorized paths;
+ *        hot loops use these types instead, and convert back at the GL upload boundary.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "simple_eigen.h"
+
+namespace Grafica
+{
+
+/** Column major 4x4 matrix, as Matrix4f and OpenGL, aligned to 32 bytes so columns are loaded with aligned SSE/AVX loads.
+ * Its data can be passed directly to glUniformMatrix4fv.
+ */
+struct alignas(32) AlignedMatrix4f
+{
+    float data[16];
+
+    static AlignedMatrix4f identity();
+
+    static AlignedMatrix4f fromMatrix4f(const Matrix4f& matrix);
+
+    Matrix4f toMatrix4f() const;
+
+    inline float& operator()(unsigned int row, unsigned int column) { return data[4 * column + row]; }
+    inline float operator()(unsigned int row, unsigned int column) const { return data[4 * column + row]; }
+};
+
+/** std::vector honors the alignment of its elements since C++17 */
+using AlignedMatrix4fArray = std::vector<AlignedMatrix4f>;
+
+/** Four matrices interleaved element by element (array of structures of arrays), lanes[e][i] is element e of matrix i.
+ * A kernel working on it computes four matrices with the instructions scalar code spends on one.
+ */
+struct alignas(16) MatrixBlock4
+{
+    float lanes[16][4];
+};
+
+/** result = lhs * rhs. result may be one of the operands. */
+void multiply(const AlignedMatrix4f& lhs, const AlignedMatrix4f& rhs, AlignedMatrix4f& result);
+
+/** results[i] = parents[i] * locals[i] */
+void multiplyBatch(
+    const AlignedMatrix4f* parents,
+    const AlignedMatrix4f* locals,
+    AlignedMatrix4f* results,
+    std::size_t count);
+
+/** results[i] = parent * locals[i] */
+void multiplyBatch(
+    const AlignedMatrix4f& parent,
+    const AlignedMatrix4f* locals,
+    AlignedMatrix4f* results,
+    std::size_t count);
+
+/** Inverse of a matrix whose last row is (0, 0, 0, 1), e.g. any composition of translations, rotations and scales */
+void affineInverse(const AlignedMatrix4f& matrix, AlignedMatrix4f& result);
+
+/** affineInverse for many matrices, four at a time through MatrixBlock4 */
+void affineInverseBatch(const AlignedMatrix4f* matrices, AlignedMatrix4f* results, std::size_t count);
+
+/** Transforms count points given as separate x, y and z arrays (w = 1). Outputs may alias the inputs. */
+void transformPoints(
+    const AlignedMatrix4f& matrix,
+    const float* x, const float* y, const float* z,
+    float* resultX, float* resultY, float* resultZ,
+    std::size_t count);
+
+/** Transforms a single point */
+Vector4f transform(const AlignedMatrix4f& matrix, const Vector4f& vector);
+
+void toBlock(const AlignedMatrix4f* matrices, MatrixBlock4& block);
+
+void fromBlock(const MatrixBlock4& block, AlignedMatrix4f* matrices);
+
+} // Grafica
@@ -0,0 +1,319 @@
+/**
+ * @file occlusion_culling.cpp
+ * @brief Software occlusion culling: occluder meshes are rasterized on the CPU into a small hierarchical depth buffer,
+ *        against which the bounds of the scene are tested before drawing. Nothing is read back from the GPU.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "occlusion_culling.h"
+
+#include <cmath>
+#include <cassert>
+#include <limits>
+#include <algorithm>
+#include <ciso646>
+#include "simd.h"
+
+namespace Grafica
+{
+
+OccluderMesh OccluderMesh::fromShape(const Shape& shape)
+{
+    assert(shape.stride >= 3);
+
+    OccluderMesh mesh;
+    for (std::size_t i = 0; i + 2 < shape.vertices.size(); i += shape.stride)
+        mesh.positions.push_back(Vector3f(shape.vertices[i], shape.vertices[i + 1], shape.vertices[i + 2]));
+
+    mesh.indices = shape.indices;
+    return mesh;
+}
+
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height):
+    _width((std::max(width, 1u) + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE),
+    _height(std::max(height, 1u)),
+    _tilesX(_width / TILE_SIZE),
+    _tilesY((_height + TILE_SIZE - 1) / TILE_SIZE),
+    _viewProjection(Matrix4f::Identity()),
+    _depth(_width * _height, 1.0f),
+    _tileMaxDepth(_tilesX * _tilesY, 1.0f)
+{
+}
+
+void OcclusionBuffer::setupTriangle(const Vector4f& a, const Vector4f& b, const Vector4f& c, std::vector<ScreenTriangle>& triangles) const
+{
+    // Clipping against the near plane, z + w >= 0. The other planes are handled by the pixel bounds.
+    const Vector4f* input[3] = {&a, &b, &c};
+    Vector4f polygon[4];
+    unsigned int count = 0;
+
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        Vector4f const& current = *input[i];
+        Vector4f const& next = *input[(i + 1) % 3];
+        float const currentDistance = current[2] + current[3];
+        float const nextDistance = next[2] + next[3];
+
+        if (currentDistance >= 0)
+            polygon[count++] = current;
+
+        if ((currentDistance >= 0) != (nextDistance >= 0))
+        {
+            float const t = currentDistance / (currentDistance - nextDistance);
+            polygon[count++] = current + t * (next - current);
+        }
+    }
+
+    if (count < 3)
+        return;
+
+    float x[4], y[4], z[4];
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        float const inverseW = 1.0f / polygon[i][3];
+        x[i] = (polygon[i][0] * inverseW * 0.5f + 0.5f) * _width;
+        y[i] = (polygon[i][1] * inverseW * 0.5f + 0.5f) * _height;
+        z[i] = polygon[i][2] * inverseW * 0.5f + 0.5f;
+    }
+
+    // A fan, as clipping a triangle by a plane leaves a convex polygon
+    for (unsigned int i = 1; i + 1 < count; ++i)
+    {
+        unsigned int first = 0, second = i, third = i + 1;
+
+        float const area = (x[second] - x[first]) * (y[third] - y[first]) - (x[third] - x[first]) * (y[second] - y[first]);
+        if (area == 0 or not std::isfinite(area))
+            continue;
+
+        // Both sides are drawn, so clockwise triangles are turned around
+        if (area < 0)
+            std::swap(second, third);
+
+        ScreenTriangle triangle{
+            {x[first], x[second], x[third]},
+            {y[first], y[second], y[third]},
+            {z[first], z[second], z[third]},
+            0, 0, 0, 0};
+
+        float const minX = std::min({x[first], x[second], x[third]});
+        float const maxX = std::max({x[first], x[second], x[third]});
+        float const minY = std::min({y[first], y[second], y[third]});
+        float const maxY = std::max({y[first], y[second], y[third]});
+
+        triangle.minX = static_cast<int>(std::max(std::floor(minX), 0.0f));
+        triangle.maxX = static_cast<int>(std::min(std::floor(maxX), _width - 1.0f));
+        triangle.minY = static_cast<int>(std::max(std::floor(minY), 0.0f));
+        triangle.maxY = static_cast<int>(std::min(std::floor(maxY), _height - 1.0f));
+
+        if (triangle.minX > triangle.maxX or triangle.minY > triangle.maxY)
+            continue;
+
+        triangles.push_back(triangle);
+    }
+}
+
+void OcclusionBuffer::update(
+    const std::vector<Occluder>& occluders,
+    const Matrix4f& viewProjection,
+    ThreadPool& threadPool)
+{
+    _viewProjection = viewProjection;
+    std::fill(_depth.begin(), _depth.end(), 1.0f);
+
+    // Setting up the triangles of each occluder in parallel, then gathering them in order
+    std::vector<std::vector<ScreenTriangle>> occluderTriangles(occluders.size());
+    threadPool.parallelFor(0, occluders.size(), 1, [&](std::size_t begin, std::size_t end)
+    {
+        std::vector<Vector4f> clipPositions;
+        for (std::size_t occluder = begin; occluder < end; ++occluder)
+        {
+            OccluderMesh const& mesh = *occluders[occluder].meshPtr;
+            Matrix4f const transform = viewProjection * occluders[occluder].transform;
+
+            clipPositions.clear();
+            for (auto const& position : mesh.positions)
+                clipPositions.push_back(transform * Vector4f(position[0], position[1], position[2], 1));
+
+            for (std::size_t index = 0; index + 2 < mesh.indices.size(); index += 3)
+            {
+                setupTriangle(
+                    clipPositions[mesh.indices[index]],
+                    clipPositions[mesh.indices[index + 1]],
+                    clipPositions[mesh.indices[index + 2]],
+                    occluderTriangles[occluder]);
+            }
+        }
+    });
+
+    _triangles.clear();
+    for (auto const& triangles : occluderTriangles)
+        _triangles.insert(_triangles.end(), triangles.begin(), triangles.end());
+
+    // Each task owns a band of one tile of height, so no pixel is written by two threads
+    threadPool.parallelFor(0, _tilesY, 1, [this](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t tileRow = begin; tileRow < end; ++tileRow)
+        {
+            unsigned int const firstRow = static_cast<unsigned int>(tileRow) * TILE_SIZE;
+            rasterizeBand(firstRow, std::min(firstRow + TILE_SIZE, _height));
+            updateTiles(static_cast<unsigned int>(tileRow), static_cast<unsigned int>(tileRow) + 1);
+        }
+    });
+}
+
+void OcclusionBuffer::rasterizeBand(unsigned int firstRow, unsigned int endRow)
+{
+    using namespace Simd;
+
+    for (auto const& triangle : _triangles)
+    {
+        if (triangle.maxY < int(firstRow) or triangle.minY >= int(endRow))
+            continue;
+
+        float const* x = triangle.x;
+        float const* y = triangle.y;
+        float const* z = triangle.z;
+
+        // Edge functions, positive inside: E(px, py) = A px + B py + C
+        float A[3], B[3], C[3];
+        for (unsigned int edge = 0; edge < 3; ++edge)
+        {
+            unsigned int const next = (edge + 1) % 3;
+            A[edge] = y[edge] - y[next];
+            B[edge] = x[next] - x[edge];
+            C[edge] = -A[edge] * x[edge] - B[edge] * y[edge];
+        }
+
+        // Depth is linear in screen space after the perspective division
+        float const area = B[0] * (y[2] - y[0]) + A[0] * (x[2] - x[0]);
+        float const dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+        float const dzdy = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) / area;
+        float const dzc = z[0] - dzdx * x[0] - dzdy * y[0];
+
+        Float8 const a0 = splat8(A[0]), a1 = splat8(A[1]), a2 = splat8(A[2]);
+        Float8 const dx = splat8(dzdx);
+        Float8 const zero = splat8(0);
+
+        unsigned int const rowBegin = std::max(unsigned(triangle.minY), firstRow);
+        unsigned int const rowEnd = std::min(unsigned(triangle.maxY) + 1, endRow);
+        unsigned int const columnBegin = unsigned(triangle.minX) / TILE_SIZE * TILE_SIZE;
+
+        for (unsigned int row = rowBegin; row < rowEnd; ++row)
+        {
+            // Sampling at pixel centers
+            float const py = row + 0.5f;
+            Float8 const rowE0 = splat8(B[0] * py + C[0]);
+            Float8 const rowE1 = splat8(B[1] * py + C[1]);
+            Float8 const rowE2 = splat8(B[2] * py + C[2]);
+            Float8 const rowZ = splat8(dzdy * py + dzc);
+            float* depthRow = _depth.data() + row * _width;
+
+            for (unsigned int column = columnBegin; column <= unsigned(triangle.maxX); column += 8)
+            {
+                Float8 const px = ramp8(column + 0.5f);
+
+                Mask8 const inside = logicalAnd(
+                    logicalAnd(
+                        greaterEqual(add(mul(a0, px), rowE0), zero),
+                        greaterEqual(add(mul(a1, px), rowE1), zero)),
+                    greaterEqual(add(mul(a2, px), rowE2), zero));
+
+                if (not any(inside))
+                    continue;
+
+                Float8 const depth = add(mul(dx, px), rowZ);
+                Float8 const previous = load8(depthRow + column);
+                store8(depthRow + column, select(inside, min(previous, depth), previous));
+            }
+        }
+    }
+}
+
+void OcclusionBuffer::updateTiles(unsigned int firstTileRow, unsigned int endTileRow)
+{
+    using namespace Simd;
+
+    for (unsigned int tileY = firstTileRow; tileY < endTileRow; ++tileY)
+    {
+        unsigned int const rowEnd = std::min((tileY + 1) * TILE_SIZE, _height);
+        for (unsigned int tileX = 0; tileX < _tilesX; ++tileX)
+        {
+            Float8 farthest = splat8(0);
+            for (unsigned int row = tileY * TILE_SIZE; row < rowEnd; ++row)
+                farthest = max(farthest, load8(_depth.data() + row * _width + tileX * TILE_SIZE));
+
+            float lanes[8];
+            store8(lanes, farthest);
+            _tileMaxDepth[tileY * _tilesX + tileX] = *std::max_element(lanes, lanes + 8);
+        }
+    }
+}
+
+bool OcclusionBuffer::isVisible(const AABB& aabb) const
+{
+    if (aabb.isEmpty())
+        return true;
+
+    float minX = std::numeric_limits<float>::max(), maxX = std::numeric_limits<float>::lowest();
+    float minY = minX, maxY = maxX;
+    float minDepth = minX;
+
+    for (unsigned int corner = 0; corner < 8; ++corner)
+    {
+        Vector4f const point(
+            corner & 1 ? aabb.max[0] : aabb.min[0],
+            corner & 2 ? aabb.max[1] : aabb.min[1],
+            corner & 4 ? aabb.max[2] : aabb.min[2],
+            1);
+        Vector4f const clip = _viewProjection * point;
+
+        // In front of the near plane there is nothing to hide it
+        if (clip[3] <= 0 or clip[2] + clip[3] < 0)
+            return true;
+
+        float const inverseW = 1.0f / clip[3];
+        float const x = (clip[0] * inverseW * 0.5f + 0.5f) * _width;
+        float const y = (clip[1] * inverseW * 0.5f + 0.5f) * _height;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minDepth = std::min(minDepth, clip[2] * inverseW * 0.5f + 0.5f);
+    }
+
+    // Every pixel touched by the projected box
+    int const x0 = static_cast<int>(std::max(std::floor(minX), 0.0f));
+    int const x1 = static_cast<int>(std::min(std::floor(maxX), _width - 1.0f));
+    int const y0 = static_cast<int>(std::max(std::floor(minY), 0.0f));
+    int const y1 = static_cast<int>(std::min(std::floor(maxY), _height - 1.0f));
+
+    // Off screen, the frustum decides
+    if (x0 > x1 or y0 > y1)
+        return true;
+
+    for (int tileY = y0 / int(TILE_SIZE); tileY <= y1 / int(TILE_SIZE); ++tileY)
+    {
+        for (int tileX = x0 / int(TILE_SIZE); tileX <= x1 / int(TILE_SIZE); ++tileX)
+        {
+            // The whole tile is in front of the box
+            if (_tileMaxDepth[tileY * _tilesX + tileX] < minDepth)
+                continue;
+
+            int const rowBegin = std::max(y0, tileY * int(TILE_SIZE));
+            int const rowEnd = std::min(y1, (tileY + 1) * int(TILE_SIZE) - 1);
+            int const columnBegin = std::max(x0, tileX * int(TILE_SIZE));
+            int const columnEnd = std::min(x1, (tileX + 1) * int(TILE_SIZE) - 1);
+
+            for (int row = rowBegin; row <= rowEnd; ++row)
+                for (int column = columnBegin; column <= columnEnd; ++column)
+                    if (_depth[row * _width + column] >= minDepth)
+                        return true;
+        }
+    }
+
+    return false;
+}
+
+} // Grafica
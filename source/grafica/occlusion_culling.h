@@ -0,0 +1,92 @@
+/**
+ * @file occlusion_culling.h
+ * @brief Software occlusion culling: occluder meshes are rasterized on the CPU into a small hierarchical depth buffer,
+ *        against which the bounds of the scene are tested before drawing. Nothing is read back from the GPU.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <vector>
+#include "bounds.h"
+#include "shape.h"
+#include "simple_eigen.h"
+#include "thread_pool.h"
+
+namespace Grafica
+{
+
+/** Geometry drawn into the occlusion buffer: only positions, usually a simplified version of a large object,
+ * e.g. the box inside a building. It must never stick out of what it stands for, or visible objects get culled.
+ */
+struct OccluderMesh
+{
+    std::vector<Vector3f> positions;
+    Indices indices;
+
+    /** Takes the first 3 coordinates of every vertex of a shape of triangles */
+    static OccluderMesh fromShape(const Shape& shape);
+};
+
+struct Occluder
+{
+    const OccluderMesh* meshPtr;
+    Matrix4f transform;
+};
+
+/** Depth buffer at low resolution, plus the farthest depth of each 8x8 tile so most tests are answered
+ * by a few tiles instead of every pixel.
+ */
+class OcclusionBuffer
+{
+public:
+    static constexpr unsigned int TILE_SIZE = 8;
+
+    /** The width is rounded up to a multiple of TILE_SIZE, as the rasterizer fills 8 pixels at a time */
+    OcclusionBuffer(unsigned int width = 256, unsigned int height = 128);
+
+    /** Clears the buffer and rasterizes the occluders seen from viewProjection, in parallel by bands of rows.
+     * Triangles are drawn from both sides.
+     */
+    void update(
+        const std::vector<Occluder>& occluders,
+        const Matrix4f& viewProjection,
+        ThreadPool& threadPool = defaultThreadPool());
+
+    /** Conservative test with the last update: false only if the box is behind the occluders at every pixel it covers.
+     * Boxes crossing the near plane are always visible.
+     */
+    bool isVisible(const AABB& aabb) const;
+
+    inline unsigned int width() const { return _width; }
+    inline unsigned int height() const { return _height; }
+
+    /** Depth in [0, 1] at a pixel, 1 being the far plane or no occluder. Row 0 is the bottom of the screen. */
+    inline float depth(unsigned int x, unsigned int y) const { return _depth[y * _width + x]; }
+
+    /** Triangles drawn by the last update, after clipping */
+    inline std::size_t trianglesCount() const { return _triangles.size(); }
+
+private:
+    struct ScreenTriangle
+    {
+        /* Vertices in pixels, with depth in [0, 1], counter clockwise */
+        float x[3], y[3], z[3];
+        int minX, maxX, minY, maxY;
+    };
+
+    void setupTriangle(const Vector4f& a, const Vector4f& b, const Vector4f& c, std::vector<ScreenTriangle>& triangles) const;
+    void rasterizeBand(unsigned int firstRow, unsigned int endRow);
+    void updateTiles(unsigned int firstTileRow, unsigned int endTileRow);
+
+    unsigned int _width, _height;
+    unsigned int _tilesX, _tilesY;
+    Matrix4f _viewProjection;
+    std::vector<float> _depth;
+    std::vector<float> _tileMaxDepth;
+    std::vector<ScreenTriangle> _triangles;
+};
+
+} // Grafica
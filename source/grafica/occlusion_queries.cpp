@@ -0,0 +1,246 @@
+/**
+ * @file occlusion_queries.cpp
+ * @brief GPU occlusion queries against the bounds of scene graph nodes, using the results of previous frames
+ *        and conditional rendering so the CPU never waits for the GPU.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "occlusion_queries.h"
+
+#include <bit>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <ciso646>
+#include "load_shaders.h"
+#include "scene_graph.h"
+
+namespace Grafica
+{
+
+namespace
+{
+    /* Instances not reached for this many frames are forgotten */
+    constexpr std::uint64_t FORGET_AFTER_FRAMES = 120;
+}
+
+OcclusionQueries::OcclusionQueries(std::size_t minTriangles, unsigned int maxQueryInterval):
+    _minTriangles(minTriangles),
+    _maxQueryInterval(std::max(maxQueryInterval, 1u)),
+    _target(GLAD_GL_VERSION_4_3 ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED),
+    _viewProjection(Matrix4f::Identity()),
+    _eye(0, 0, 0)
+{
+    const std::string vertexShaderCode = R"(
+        #version 330 core
+
+        layout (location = 0) in vec3 position;
+        uniform mat4 transform;
+
+        void main()
+        {
+            gl_Position = transform * vec4(position, 1.0);
+        }
+    )";
+
+    const std::string fragmentShaderCode = R"(
+        #version 330 core
+
+        out vec4 fragColor;
+
+        void main()
+        {
+            fragColor = vec4(1.0);
+        }
+    )";
+
+    _boxProgram = createShaderProgramFromCode({
+        {GL_VERTEX_SHADER, vertexShaderCode.c_str()},
+        {GL_FRAGMENT_SHADER, fragmentShaderCode.c_str()}
+    });
+    _boxTransformLocation = glGetUniformLocation(_boxProgram, "transform");
+
+    const GLfloat vertices[] = {
+        -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f,  0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,
+        -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f,  0.5f,  0.5f,  -0.5f,  0.5f,  0.5f};
+
+    const GLuint indices[] = {
+        0, 2, 1,  0, 3, 2,
+        4, 5, 6,  4, 6, 7,
+        0, 1, 5,  0, 5, 4,
+        1, 2, 6,  1, 6, 5,
+        2, 3, 7,  2, 7, 6,
+        3, 0, 4,  3, 4, 7};
+
+    glGenVertexArrays(1, &_boxVao);
+    glGenBuffers(1, &_boxVbo);
+    glGenBuffers(1, &_boxEbo);
+
+    glBindVertexArray(_boxVao);
+    glBindBuffer(GL_ARRAY_BUFFER, _boxVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _boxEbo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+    auto position = glGetAttribLocation(_boxProgram, "position");
+    glVertexAttribPointer(position, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+    glEnableVertexAttribArray(position);
+
+    glBindVertexArray(0);
+}
+
+void OcclusionQueries::beginFrame(const Matrix4f& projection, const Matrix4f& view)
+{
+    ++_frame;
+    _viewProjection = projection * view;
+    _eye = view.inverse().block<3, 1>(0, 3);
+
+    // Distance to the near plane of a perspective projection, boxes closer than it could be clipped
+    _near = projection(3, 3) == 0 ? projection(2, 3) / (projection(2, 2) - 1) : 0;
+
+    for (auto it = _nodes.begin(); it != _nodes.end();)
+    {
+        if (_frame - it->second.lastVisitedFrame > FORGET_AFTER_FRAMES)
+        {
+            glDeleteQueries(1, &it->second.query);
+            it = _nodes.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+std::size_t OcclusionQueries::pathKey(std::size_t parentPathKey, const SceneGraphNode* nodePtr)
+{
+    std::size_t const nodeHash = std::hash<const SceneGraphNode*>()(nodePtr);
+    return parentPathKey ^ (nodeHash + 0x9e3779b97f4a7c15ull + (parentPathKey << 6) + (parentPathKey >> 2));
+}
+
+const NodeVisibility* OcclusionQueries::visibility(std::size_t pathKey) const
+{
+    auto const it = _nodes.find(pathKey);
+    return it == _nodes.end() ? nullptr : &it->second;
+}
+
+void OcclusionQueries::harvest(NodeVisibility& visibility)
+{
+    if (not visibility.queryPending)
+        return;
+
+    // Never waiting: without a result the previous one is kept
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(visibility.query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == GL_FALSE)
+        return;
+
+    GLuint anySamplesPassed = GL_FALSE;
+    glGetQueryObjectuiv(visibility.query, GL_QUERY_RESULT, &anySamplesPassed);
+
+    visibility.queryPending = false;
+    visibility.visible = anySamplesPassed != GL_FALSE;
+    visibility.history = (visibility.history << 1) | (visibility.visible ? 1u : 0u);
+}
+
+void OcclusionQueries::issueQuery(NodeVisibility& visibility, const AABB& worldBounds)
+{
+    if (visibility.query == 0)
+        glGenQueries(1, &visibility.query);
+
+    // Flat boxes still need some volume to be rasterized
+    Vector3f const size = (worldBounds.max - worldBounds.min).cwiseMax(Vector3f(1e-4f, 1e-4f, 1e-4f));
+    Matrix4f box = Matrix4f::Identity();
+    box.block<3, 3>(0, 0) = size.asDiagonal();
+    box.block<3, 1>(0, 3) = worldBounds.center();
+    Matrix4f const transform = _viewProjection * box;
+
+    // The masks of the caller are restored afterwards, whatever they were
+    GLboolean colorMask[4];
+    GLboolean depthMask;
+    glGetBooleanv(GL_COLOR_WRITEMASK, colorMask);
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+
+    GLboolean const cullFace = glIsEnabled(GL_CULL_FACE);
+    glDisable(GL_CULL_FACE);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+
+    glUseProgram(_boxProgram);
+    glUniformMatrix4fv(_boxTransformLocation, 1, GL_FALSE, transform.data());
+
+    glBeginQuery(_target, visibility.query);
+    glBindVertexArray(_boxVao);
+    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr);
+    glBindVertexArray(0);
+    glEndQuery(_target);
+
+    glDepthMask(depthMask);
+    glColorMask(colorMask[0], colorMask[1], colorMask[2], colorMask[3]);
+    if (cullFace)
+        glEnable(GL_CULL_FACE);
+
+    visibility.queryPending = true;
+}
+
+OcclusionQueryDecision OcclusionQueries::visit(const SceneGraphNode& node, const AABB& worldBounds, std::size_t pathKey)
+{
+    OcclusionQueryDecision decision;
+    if (node.subtreeTriangles < _minTriangles)
+        return decision;
+
+    NodeVisibility& visibility = _nodes[pathKey];
+    visibility.lastVisitedFrame = _frame;
+    harvest(visibility);
+
+    // With the camera inside the box, its faces are behind the near plane and would hide a visible node
+    Vector3f const margin(_near, _near, _near);
+    if ((_eye.array() >= (worldBounds.min - margin).array()).all() and
+        (_eye.array() <= (worldBounds.max + margin).array()).all())
+    {
+        visibility.visible = true;
+        return decision;
+    }
+
+    if (not visibility.visible)
+    {
+        // Still hidden for all we know: asking again, and letting the GPU decide whether to draw.
+        // While the last query has no result it is kept, otherwise a GPU a few frames behind
+        // would never answer and the node would stay culled.
+        if (not visibility.queryPending)
+        {
+            issueQuery(visibility, worldBounds);
+            decision.queryIssued = true;
+        }
+        decision.conditionalQuery = visibility.query;
+        return decision;
+    }
+
+    if (not visibility.queryPending and _frame >= visibility.nextQueryFrame)
+    {
+        issueQuery(visibility, worldBounds);
+        decision.queryIssued = true;
+
+        // The longer a node stays visible, the less likely it is to be hidden next frame
+        unsigned int const visibleResults = std::countr_one(visibility.history);
+        visibility.nextQueryFrame = _frame + std::clamp(visibleResults, 1u, _maxQueryInterval);
+    }
+
+    return decision;
+}
+
+void OcclusionQueries::clear()
+{
+    for (auto& [key, visibility] : _nodes)
+        glDeleteQueries(1, &visibility.query);
+    _nodes.clear();
+
+    glDeleteVertexArrays(1, &_boxVao);
+    glDeleteBuffers(1, &_boxVbo);
+    glDeleteBuffers(1, &_boxEbo);
+    glDeleteProgram(_boxProgram);
+}
+
+} // Grafica
@@ -0,0 +1,108 @@
+/**
+ * @file occlusion_queries.h
+ * @brief GPU occlusion queries against the bounds of scene graph nodes, using the results of previous frames
+ *        and conditional rendering so the CPU never waits for the GPU.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <glad/glad.h>
+#include "bounds.h"
+#include "simple_eigen.h"
+
+namespace Grafica
+{
+
+class SceneGraphNode;
+
+/** What is known about an instance of a node, updated as query results arrive */
+struct NodeVisibility
+{
+    GLuint query = 0;
+    bool queryPending = false;
+
+    /** Latest result, nodes start visible */
+    bool visible = true;
+
+    /** One bit per result, the lowest one being the latest. 1 is visible. */
+    std::uint32_t history = 1;
+
+    std::uint64_t nextQueryFrame = 0;
+    std::uint64_t lastVisitedFrame = 0;
+};
+
+/** What to do with a node this frame. With a conditionalQuery, the subtree is drawn inside
+ * glBeginConditionalRender with that query, so the GPU skips it if the box turns out hidden.
+ */
+struct OcclusionQueryDecision
+{
+    GLuint conditionalQuery = 0;
+    bool queryIssued = false;
+};
+
+/** Node bounds are drawn as boxes, without writing color nor depth, inside GL_ANY_SAMPLES_PASSED_CONSERVATIVE queries
+ * (GL_ANY_SAMPLES_PASSED before OpenGL 4.3).
+ * Results are only read once available, so they are a frame or more late:
+ * - nodes last seen hidden are queried again as soon as their last query has a result, and drawn under
+ *   conditional rendering with the latest query, so they are never missing;
+ * - nodes last seen visible are drawn, and queried less often the longer they stay visible.
+ * Boxes are tested against the depth drawn so far, so drawing from front to back improves the results.
+ */
+class OcclusionQueries
+{
+public:
+    /** Nodes whose subtree has fewer triangles are not worth a query */
+    OcclusionQueries(std::size_t minTriangles = 256, unsigned int maxQueryInterval = 8);
+
+    /** To be called once per frame before drawing, with the current camera */
+    void beginFrame(const Matrix4f& projection, const Matrix4f& view);
+
+    /** Collects the available result of the instance of node at pathKey and decides how to draw it.
+     * When a query is issued the box program is left in use.
+     */
+    OcclusionQueryDecision visit(const SceneGraphNode& node, const AABB& worldBounds, std::size_t pathKey);
+
+    /** Identifies an instance of a node by the path to it, as shared subtrees are reached from many parents */
+    static std::size_t pathKey(std::size_t parentPathKey, const SceneGraphNode* nodePtr);
+
+    /** GL_QUERY_WAIT by default: the GPU, not the CPU, waits for the result of the box */
+    void setConditionalRenderMode(GLenum mode) { _conditionalRenderMode = mode; }
+    GLenum conditionalRenderMode() const { return _conditionalRenderMode; }
+
+    /** nullptr if the instance was never visited */
+    const NodeVisibility* visibility(std::size_t pathKey) const;
+
+    inline std::uint64_t frame() const { return _frame; }
+
+    /** Freeing GPU memory */
+    void clear();
+
+private:
+    void harvest(NodeVisibility& visibility);
+    void issueQuery(NodeVisibility& visibility, const AABB& worldBounds);
+
+    std::size_t _minTriangles;
+    unsigned int _maxQueryInterval;
+    GLenum _target;
+    GLenum _conditionalRenderMode = GL_QUERY_WAIT;
+
+    std::uint64_t _frame = 0;
+    Matrix4f _viewProjection;
+    Vector3f _eye;
+    Coord _near = 0;
+
+    std::unordered_map<std::size_t, NodeVisibility> _nodes;
+
+    /* A unit cube drawn with a position only program */
+    GLuint _boxProgram;
+    GLuint _boxVao, _boxVbo, _boxEbo;
+    GLint _boxTransformLocation;
+};
+
+} // Grafica
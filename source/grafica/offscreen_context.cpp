@@ -0,0 +1,281 @@
+/**
+ * @file offscreen_context.cpp
+ * @brief OpenGL context without any window or display, rendering to a framebuffer object,
+ *        so pipelines and scene graphs can be drawn from batch jobs, tests and benchmarks.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "offscreen_context.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <ciso646>
+
+#ifdef GRAFICA_ENABLE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace Grafica
+{
+
+#ifdef GRAFICA_ENABLE_EGL
+
+namespace
+{
+    /* Whether the space separated list of extensions of display has name.
+     * EGL_NO_DISPLAY gives the client extensions, available before any display exists.
+     */
+    bool hasExtension(EGLDisplay display, const std::string& name)
+    {
+        const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+        if (extensions == nullptr)
+            return false;
+
+        std::istringstream stream(extensions);
+        std::string extension;
+        while (stream >> extension)
+            if (extension == name)
+                return true;
+
+        return false;
+    }
+
+    /* The first device able to give a display: the GPU, or the software renderer if there is none */
+    EGLDisplay getDisplay()
+    {
+        auto const queryDevices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress("eglQueryDevicesEXT"));
+        auto const getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (queryDevices == nullptr or getPlatformDisplay == nullptr)
+            return EGL_NO_DISPLAY;
+
+        constexpr EGLint MAX_DEVICES = 16;
+        EGLDeviceEXT devices[MAX_DEVICES];
+        EGLint devicesCount = 0;
+        if (not queryDevices(MAX_DEVICES, devices, &devicesCount))
+            return EGL_NO_DISPLAY;
+
+        for (EGLint i = 0; i < devicesCount; ++i)
+        {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, devices[i], nullptr);
+            if (display != EGL_NO_DISPLAY and eglInitialize(display, nullptr, nullptr))
+                return display;
+        }
+
+        return EGL_NO_DISPLAY;
+    }
+}
+
+OffscreenContext::OffscreenContext(unsigned int width, unsigned int height)
+{
+    // Devices are listed and opened without a display server. EGL_EXT_device_base includes the enumeration.
+    if (not hasExtension(EGL_NO_DISPLAY, "EGL_EXT_device_enumeration") and not hasExtension(EGL_NO_DISPLAY, "EGL_EXT_device_base"))
+    {
+        std::cout << "ERROR::OFFSCREEN_CONTEXT::MISSING_EGL_EXTENSION EGL_EXT_device_enumeration" << std::endl;
+        throw;
+    }
+
+    if (not hasExtension(EGL_NO_DISPLAY, "EGL_EXT_platform_device"))
+    {
+        std::cout << "ERROR::OFFSCREEN_CONTEXT::MISSING_EGL_EXTENSION EGL_EXT_platform_device" << std::endl;
+        throw;
+    }
+
+    EGLDisplay display = getDisplay();
+    if (display == EGL_NO_DISPLAY)
+    {
+        std::cout << "ERROR::OFFSCREEN_CONTEXT::NO_EGL_DISPLAY" << std::endl;
+        throw;
+    }
+    _display = display;
+
+    // The context is made current without any surface
+    if (not hasExtension(display, "EGL_KHR_surfaceless_context"))
+    {
+        std::cout << "ERROR::OFFSCREEN_CONTEXT::MISSING_EGL_EXTENSION EGL_KHR_surfaceless_context" << std::endl;
+        throw;
+    }
+
+    // Drawing goes to our framebuffer, the config is only needed to create the context
+    EGLint const configAttributes[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_NONE};
+    EGLConfig config;
+    EGLint configsCount = 0;
+    if (not eglBindAPI(EGL_OPENGL_API) or not eglChooseConfig(display, configAttributes, &config, 1, &configsCount) or configsCount == 0)
+    {
+        std::cout << "ERROR::OFFSCREEN_CONTEXT::NO_OPENGL_CONFIG" << std::endl;
+        throw;
+    }
+
+    EGLint const contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE};
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT)
+    {
+        std::cout << "ERROR::OFFSCREEN_CONTEXT::COULD_NOT_CREATE_CONTEXT 0x" << std::hex << eglGetError() << std::dec << std::endl;
+        throw;
+    }
+    _context = context;
+
+    makeCurrent();
+
+    if (not gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+    {
+        std::cout << "ERROR::OFFSCREEN_CONTEXT::COULD_NOT_LOAD_GL" << std::endl;
+        throw;
+    }
+
+    _width = width;
+    _height = height;
+    createFramebuffer();
+}
+
+OffscreenContext::~OffscreenContext()
+{
+    // Not through makeCurrent, a destructor must not throw. Without the context, the framebuffer goes with it.
+    if (eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, _context))
+        deleteFramebuffer();
+    else
+        std::cout << "ERROR::OFFSCREEN_CONTEXT::COULD_NOT_MAKE_CURRENT 0x" << std::hex << eglGetError() << std::dec << std::endl;
+
+    // The display is not terminated, other contexts may still use it
+    eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(_display, _context);
+    eglReleaseThread();
+}
+
+void OffscreenContext::makeCurrent() const
+{
+    if (not eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, _context))
+    {
+        std::cout << "ERROR::OFFSCREEN_CONTEXT::COULD_NOT_MAKE_CURRENT 0x" << std::hex << eglGetError() << std::dec << std::endl;
+        throw;
+    }
+}
+
+void OffscreenContext::release() const
+{
+    eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+#else
+
+OffscreenContext::OffscreenContext([[maybe_unused]] unsigned int width, [[maybe_unused]] unsigned int height)
+{
+    std::cout << "ERROR::OFFSCREEN_CONTEXT::GRAFICA_BUILT_WITHOUT_EGL" << std::endl;
+    throw;
+}
+
+OffscreenContext::~OffscreenContext()
+{
+}
+
+void OffscreenContext::makeCurrent() const
+{
+}
+
+void OffscreenContext::release() const
+{
+}
+
+#endif // GRAFICA_ENABLE_EGL
+
+void OffscreenContext::resize(unsigned int width, unsigned int height)
+{
+    _width = width;
+    _height = height;
+    deleteFramebuffer();
+    createFramebuffer();
+}
+
+void OffscreenContext::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glViewport(0, 0, _width, _height);
+}
+
+void OffscreenContext::finish() const
+{
+    glFinish();
+}
+
+Image OffscreenContext::readPixels() const
+{
+    Image image;
+    readPixels(image);
+    return image;
+}
+
+void OffscreenContext::readPixels(Image& image) const
+{
+    image.width = _width;
+    image.height = _height;
+    image.pixels.resize(std::size_t(_width) * _height);
+
+    // Vector3f is three packed floats, so GL writes the pixels in place
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, _width, _height, GL_RGB, GL_FLOAT, image.pixels.data());
+
+    // GL rows go from bottom to top
+    for (unsigned int row = 0; row < _height / 2; ++row)
+    {
+        auto const top = image.pixels.begin() + std::size_t(row) * _width;
+        auto const bottom = image.pixels.begin() + std::size_t(_height - 1 - row) * _width;
+        std::swap_ranges(top, top + _width, bottom);
+    }
+}
+
+std::string OffscreenContext::description() const
+{
+    auto const glString = [](GLenum name)
+    {
+        auto const value = glGetString(name);
+        return value == nullptr ? std::string() : std::string(reinterpret_cast<const char*>(value));
+    };
+
+    return glString(GL_VENDOR) + ", " + glString(GL_RENDERER) + ", " + glString(GL_VERSION);
+}
+
+void OffscreenContext::createFramebuffer()
+{
+    glGenRenderbuffers(1, &_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, _width, _height);
+
+    glGenRenderbuffers(1, &_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, _width, _height);
+
+    glGenFramebuffers(1, &_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::OFFSCREEN_CONTEXT::FRAMEBUFFER_NOT_COMPLETE" << std::endl;
+        throw;
+    }
+
+    glViewport(0, 0, _width, _height);
+}
+
+void OffscreenContext::deleteFramebuffer()
+{
+    glDeleteFramebuffers(1, &_framebuffer);
+    glDeleteRenderbuffers(1, &_colorBuffer);
+    glDeleteRenderbuffers(1, &_depthBuffer);
+    _framebuffer = _colorBuffer = _depthBuffer = 0;
+}
+
+} // Grafica
@@ -0,0 +1,75 @@
+/**
+ * @file offscreen_context.h
+ * @brief OpenGL context without any window or display, rendering to a framebuffer object,
+ *        so pipelines and scene graphs can be drawn from batch jobs, tests and benchmarks.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <string>
+#include <glad/glad.h>
+#include "image.h"
+
+namespace Grafica
+{
+
+/** OpenGL 3.3 core context created with EGL, without a surface, as the examples get from GLFW.
+ * It works on GPUs without a display server and on software GL as Mesa llvmpipe
+ * (LIBGL_ALWAYS_SOFTWARE=1 forces it). EGL must advertise EGL_EXT_device_enumeration,
+ * EGL_EXT_platform_device and EGL_KHR_surfaceless_context.
+ * The context is made current on the creating thread and GL is loaded with glad.
+ * Drawing goes to a framebuffer with RGBA8 color and 24 bits depth, bound and with its viewport set.
+ * If grafica is built without EGL, or no context can be created, the constructor fails.
+ */
+class OffscreenContext
+{
+public:
+    OffscreenContext(unsigned int width, unsigned int height);
+    ~OffscreenContext();
+
+    OffscreenContext(const OffscreenContext&) = delete;
+    OffscreenContext& operator=(const OffscreenContext&) = delete;
+
+    /** To use the context from another thread, after releasing it in the current one */
+    void makeCurrent() const;
+    void release() const;
+
+    /** Recreates the framebuffer attachments, keeping every other GL object */
+    void resize(unsigned int width, unsigned int height);
+
+    /** Binds the framebuffer and sets its viewport, after drawing to other framebuffers */
+    void bind() const;
+
+    /** Waits until every command is done, so CPU timings include the GPU work */
+    void finish() const;
+
+    /** Color buffer read back, converted to rows from top to bottom */
+    Image readPixels() const;
+    void readPixels(Image& image) const;
+
+    inline GLuint framebuffer() const { return _framebuffer; }
+    inline unsigned int width() const { return _width; }
+    inline unsigned int height() const { return _height; }
+
+    /** GL_VENDOR, GL_RENDERER and GL_VERSION, to tell which driver produced a benchmark */
+    std::string description() const;
+
+private:
+    void createFramebuffer();
+    void deleteFramebuffer();
+
+    /* EGLDisplay and EGLContext, kept opaque so EGL headers stay out of user code */
+    void* _display = nullptr;
+    void* _context = nullptr;
+
+    GLuint _framebuffer = 0;
+    GLuint _colorBuffer = 0;
+    GLuint _depthBuffer = 0;
+    unsigned int _width = 0;
+    unsigned int _height = 0;
+};
+
+} // Grafica
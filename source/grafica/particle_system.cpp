@@ -0,0 +1,351 @@
+/**
+ * @file particle_system.cpp
+ * @brief Particles stored as arrays of each attribute, simulated with SIMD on the thread pool,
+ *        and drawn as camera facing billboards with a single instanced draw call.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "particle_system.h"
+
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <ciso646>
+#include "gpu_shape.h"
+#include "load_shaders.h"
+#include "simd.h"
+#include "stream_buffer.h"
+
+namespace Grafica
+{
+
+namespace
+{
+    /* Particles updated by each task, a multiple of 8 */
+    constexpr std::size_t CHUNK_PARTICLES = 16384;
+
+    /* Attribute arrays copied to the GPU, in this order */
+    enum ParticleAttribute : GLuint
+    {
+        PARTICLE_X = 0,
+        PARTICLE_Y,
+        PARTICLE_Z,
+        PARTICLE_AGE,
+        PARTICLE_COLOR,
+        PARTICLE_ATTRIBUTES_COUNT
+    };
+}
+
+ParticleSystem::ParticleSystem(std::size_t capacity, std::uint32_t seed) :
+    _capacity(capacity),
+    _generator(seed)
+{
+    // Room for the last group of 8, so the kernel never needs a scalar tail
+    std::size_t const paddedCapacity = (capacity + 7) & ~std::size_t(7);
+    for (auto* array : {&_particles.x, &_particles.y, &_particles.z, &_particles.vx, &_particles.vy, &_particles.vz, &_particles.age, &_particles.ageRate})
+        array->assign(paddedCapacity, 0);
+    _particles.color.assign(paddedCapacity, 0);
+
+    std::size_t const chunksCount = (capacity + CHUNK_PARTICLES - 1) / CHUNK_PARTICLES;
+    _deadIndices.resize(chunksCount);
+    for (auto& deadIndices : _deadIndices)
+        deadIndices.reserve(CHUNK_PARTICLES);
+}
+
+std::size_t ParticleSystem::addEmitter(const ParticleEmitter& emitter)
+{
+    _emitters.push_back(emitter);
+    _emitterCarry.push_back(0);
+    return _emitters.size() - 1;
+}
+
+std::size_t ParticleSystem::emit(const ParticleEmitter& emitter, std::size_t count)
+{
+    std::uniform_real_distribution<Coord> distribution(-1, 1);
+    auto const spread = [&](const Vector3f& value, const Vector3f& spread)
+    {
+        return Vector3f(
+            value[0] + spread[0] * distribution(_generator),
+            value[1] + spread[1] * distribution(_generator),
+            value[2] + spread[2] * distribution(_generator));
+    };
+
+    std::size_t const emitted = std::min(count, _capacity - _size);
+    for (std::size_t i = _size; i < _size + emitted; ++i)
+    {
+        Vector3f const position = spread(emitter.position, emitter.positionSpread);
+        Vector3f const velocity = spread(emitter.velocity, emitter.velocitySpread);
+        Coord const lifetime = std::max(emitter.lifetime + emitter.lifetimeSpread * distribution(_generator), Coord(1e-3));
+
+        _particles.x[i] = position[0];
+        _particles.y[i] = position[1];
+        _particles.z[i] = position[2];
+        _particles.vx[i] = velocity[0];
+        _particles.vy[i] = velocity[1];
+        _particles.vz[i] = velocity[2];
+        _particles.age[i] = 0;
+        _particles.ageRate[i] = 1 / lifetime;
+        _particles.color[i] = packColor(spread(emitter.color, emitter.colorSpread));
+    }
+
+    _size += emitted;
+    return emitted;
+}
+
+void ParticleSystem::update(Coord deltaTime, ThreadPool& threadPool)
+{
+    simulate(deltaTime, threadPool);
+    compact();
+
+    // After compacting, so new particles can take the places of the dead ones
+    for (std::size_t i = 0; i < _emitters.size(); ++i)
+    {
+        if (not _emitters[i].enabled)
+            continue;
+
+        _emitterCarry[i] += _emitters[i].rate * deltaTime;
+        Coord const count = std::floor(_emitterCarry[i]);
+        _emitterCarry[i] -= count;
+
+        // Births are spread along the step, otherwise each frame's particles move as a visible layer
+        std::size_t const first = _size;
+        emit(_emitters[i], static_cast<std::size_t>(count));
+
+        std::uniform_real_distribution<Coord> distribution(0, deltaTime);
+        for (std::size_t particle = first; particle < _size; ++particle)
+        {
+            Coord const elapsed = distribution(_generator);
+            _particles.x[particle] += _particles.vx[particle] * elapsed;
+            _particles.y[particle] += _particles.vy[particle] * elapsed;
+            _particles.z[particle] += _particles.vz[particle] * elapsed;
+            _particles.age[particle] = _particles.ageRate[particle] * elapsed;
+        }
+    }
+}
+
+void ParticleSystem::simulate(Coord deltaTime, ThreadPool& threadPool)
+{
+    using namespace Simd;
+
+    std::size_t const chunksCount = (_size + CHUNK_PARTICLES - 1) / CHUNK_PARTICLES;
+
+    // Exact for any time step: the velocity keeps 1 - drag of itself each second
+    Coord const damping = std::pow(std::clamp(1 - drag, Coord(0), Coord(1)), deltaTime);
+
+    threadPool.parallelFor(0, chunksCount, 1, [&](std::size_t beginChunk, std::size_t endChunk)
+    {
+        Float8 const step = splat8(deltaTime);
+        Float8 const damping8 = splat8(damping);
+        Float8 const impulseX = splat8(gravity[0] * deltaTime);
+        Float8 const impulseY = splat8(gravity[1] * deltaTime);
+        Float8 const impulseZ = splat8(gravity[2] * deltaTime);
+        Float8 const one = splat8(1);
+
+        for (std::size_t chunk = beginChunk; chunk < endChunk; ++chunk)
+        {
+            auto& deadIndices = _deadIndices[chunk];
+            deadIndices.clear();
+
+            std::size_t const begin = chunk * CHUNK_PARTICLES;
+            std::size_t const end = std::min(begin + CHUNK_PARTICLES, _size);
+
+            for (std::size_t i = begin; i < end; i += 8)
+            {
+                Float8 const vx = add(mul(load8(&_particles.vx[i]), damping8), impulseX);
+                Float8 const vy = add(mul(load8(&_particles.vy[i]), damping8), impulseY);
+                Float8 const vz = add(mul(load8(&_particles.vz[i]), damping8), impulseZ);
+                store8(&_particles.vx[i], vx);
+                store8(&_particles.vy[i], vy);
+                store8(&_particles.vz[i], vz);
+
+                store8(&_particles.x[i], add(load8(&_particles.x[i]), mul(vx, step)));
+                store8(&_particles.y[i], add(load8(&_particles.y[i]), mul(vy, step)));
+                store8(&_particles.z[i], add(load8(&_particles.z[i]), mul(vz, step)));
+
+                Float8 const age = add(load8(&_particles.age[i]), mul(load8(&_particles.ageRate[i]), step));
+                store8(&_particles.age[i], age);
+
+                for (unsigned int deadLanes = bits(greaterEqual(age, one)); deadLanes != 0; deadLanes &= deadLanes - 1)
+                {
+                    std::size_t const index = i + std::countr_zero(deadLanes);
+                    if (index < end)
+                        deadIndices.push_back(static_cast<std::uint32_t>(index));
+                }
+            }
+        }
+    });
+}
+
+void ParticleSystem::compact()
+{
+    std::size_t const chunksCount = (_size + CHUNK_PARTICLES - 1) / CHUNK_PARTICLES;
+
+    // Each hole, in increasing order, takes the last live particle. Dead particles at the end are just dropped.
+    for (std::size_t chunk = 0; chunk < chunksCount; ++chunk)
+    {
+        for (auto const hole : _deadIndices[chunk])
+        {
+            while (_size > hole and _particles.age[_size - 1] >= 1)
+                --_size;
+
+            if (hole >= _size)
+                return;
+
+            move(_size - 1, hole);
+            --_size;
+        }
+    }
+}
+
+void ParticleSystem::move(std::size_t from, std::size_t to)
+{
+    _particles.x[to] = _particles.x[from];
+    _particles.y[to] = _particles.y[from];
+    _particles.z[to] = _particles.z[from];
+    _particles.vx[to] = _particles.vx[from];
+    _particles.vy[to] = _particles.vy[from];
+    _particles.vz[to] = _particles.vz[from];
+    _particles.age[to] = _particles.age[from];
+    _particles.ageRate[to] = _particles.ageRate[from];
+    _particles.color[to] = _particles.color[from];
+}
+
+void ParticleBuffer::initBuffers(std::size_t capacity)
+{
+    this->capacity = capacity;
+    size = 0;
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, capacity * PARTICLE_ATTRIBUTES_COUNT * SIZE_IN_BYTES, nullptr, GL_STREAM_DRAW);
+}
+
+void ParticleBuffer::fillBuffers(const ParticleSystem& particleSystem)
+{
+    static_assert(sizeof(float) == SIZE_IN_BYTES and sizeof(std::uint32_t) == SIZE_IN_BYTES);
+
+    size = std::min(particleSystem.size(), capacity);
+    std::size_t const bytes = capacity * PARTICLE_ATTRIBUTES_COUNT * SIZE_IN_BYTES;
+    std::size_t const arrayBytes = capacity * SIZE_IN_BYTES;
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    streamBufferData(GL_ARRAY_BUFFER, bytes, size == 0 ? 0 : bytes, [&](void* data)
+    {
+        auto* mapped = static_cast<std::uint8_t*>(data);
+        auto const& particles = particleSystem.particles();
+        std::memcpy(mapped + PARTICLE_X * arrayBytes, particles.x.data(), size * SIZE_IN_BYTES);
+        std::memcpy(mapped + PARTICLE_Y * arrayBytes, particles.y.data(), size * SIZE_IN_BYTES);
+        std::memcpy(mapped + PARTICLE_Z * arrayBytes, particles.z.data(), size * SIZE_IN_BYTES);
+        std::memcpy(mapped + PARTICLE_AGE * arrayBytes, particles.age.data(), size * SIZE_IN_BYTES);
+        std::memcpy(mapped + PARTICLE_COLOR * arrayBytes, particles.color.data(), size * SIZE_IN_BYTES);
+    });
+}
+
+void ParticleBuffer::clear()
+{
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    vao = vbo = 0;
+    capacity = size = 0;
+}
+
+ParticleShaderProgram::ParticleShaderProgram()
+{
+    const std::string vertexShaderCode = R"(
+        #version 330 core
+
+        layout (location = 0) in float particleX;
+        layout (location = 1) in float particleY;
+        layout (location = 2) in float particleZ;
+        layout (location = 3) in float particleAge;
+        layout (location = 4) in vec4 particleColor;
+        out vec2 fragCorner;
+        out vec4 fragColor;
+        uniform mat4 view;
+        uniform mat4 projection;
+        uniform float particleSize;
+
+        void main()
+        {
+            // Triangle strip over the corners (-1, -1), (1, -1), (-1, 1), (1, 1)
+            vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+
+            // Offsetting in view coordinates keeps the quad facing the camera
+            vec4 viewPosition = view * vec4(particleX, particleY, particleZ, 1.0);
+            viewPosition.xy += corner * (0.5 * particleSize);
+            gl_Position = projection * viewPosition;
+
+            fragCorner = corner;
+            fragColor = vec4(particleColor.rgb, particleColor.a * (1.0 - particleAge));
+        }
+    )";
+
+    const std::string fragmentShaderCode = R"(
+        #version 330 core
+
+        in vec2 fragCorner;
+        in vec4 fragColor;
+        out vec4 outColor;
+
+        void main()
+        {
+            float distance2 = dot(fragCorner, fragCorner);
+            if (distance2 > 1.0)
+                discard;
+
+            outColor = vec4(fragColor.rgb, fragColor.a * (1.0 - distance2));
+        }
+    )";
+
+    shaderProgram = createShaderProgramFromCode({
+        {GL_VERTEX_SHADER, vertexShaderCode.c_str()},
+        {GL_FRAGMENT_SHADER, fragmentShaderCode.c_str()}
+    });
+}
+
+void ParticleShaderProgram::setupVAO(ParticleBuffer& particleBuffer) const
+{
+    std::size_t const arrayBytes = particleBuffer.capacity * SIZE_IN_BYTES;
+
+    glBindVertexArray(particleBuffer.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, particleBuffer.vbo);
+
+    // One value of each array per instance
+    for (GLuint attribute : {PARTICLE_X, PARTICLE_Y, PARTICLE_Z, PARTICLE_AGE})
+    {
+        glVertexAttribPointer(attribute, 1, GL_FLOAT, GL_FALSE, SIZE_IN_BYTES, (void*)(attribute * arrayBytes));
+        glVertexAttribDivisor(attribute, 1);
+        glEnableVertexAttribArray(attribute);
+    }
+
+    glVertexAttribPointer(PARTICLE_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, SIZE_IN_BYTES, (void*)(PARTICLE_COLOR * arrayBytes));
+    glVertexAttribDivisor(PARTICLE_COLOR, 1);
+    glEnableVertexAttribArray(PARTICLE_COLOR);
+
+    glBindVertexArray(0);
+}
+
+void ParticleShaderProgram::drawCall(const ParticleBuffer& particleBuffer) const
+{
+    if (particleBuffer.size == 0)
+        return;
+
+    glBindVertexArray(particleBuffer.vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(particleBuffer.size));
+    glBindVertexArray(0);
+}
+
+ParticleBuffer toParticleBuffer(const ParticleShaderProgram& pipeline, std::size_t capacity)
+{
+    ParticleBuffer particleBuffer;
+    particleBuffer.initBuffers(capacity);
+    pipeline.setupVAO(particleBuffer);
+    return particleBuffer;
+}
+
+} // Grafica
@@ -0,0 +1,149 @@
+/**
+ * @file particle_system.h
+ * @brief Particles stored as arrays of each attribute, simulated with SIMD on the thread pool,
+ *        and drawn as camera facing billboards with a single instanced draw call.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <glad/glad.h>
+#include "simple_eigen.h"
+#include "thread_pool.h"
+
+namespace Grafica
+{
+
+/** Particles are born at position plus a random offset in [-positionSpread, positionSpread],
+ * with the same kind of randomness on their velocity, lifetime and color.
+ */
+struct ParticleEmitter
+{
+    Vector3f position = Vector3f(0, 0, 0);
+    Vector3f positionSpread = Vector3f(0, 0, 0);
+    Vector3f velocity = Vector3f(0, 0, 1);
+    Vector3f velocitySpread = Vector3f(0.5f, 0.5f, 0.5f);
+    Coord lifetime = 2;
+    Coord lifetimeSpread = 0.5f;
+    Vector3f color = Vector3f(1, 0.6f, 0.2f);
+    Vector3f colorSpread = Vector3f(0, 0.2f, 0.1f);
+
+    /** Particles per second, spawned by ParticleSystem::update */
+    Coord rate = 1000;
+    bool enabled = true;
+};
+
+/** Attributes of particle i are at index i of each array. Arrays are allocated once, for the capacity. */
+struct ParticleArrays
+{
+    std::vector<float> x, y, z;
+    std::vector<float> vx, vy, vz;
+
+    /** From 0 at birth to 1 at death */
+    std::vector<float> age;
+
+    /** 1 / lifetime */
+    std::vector<float> ageRate;
+
+    /** RGBA8, red in the lowest byte */
+    std::vector<std::uint32_t> color;
+};
+
+/** Live particles are always the first size() of the arrays.
+ * update integrates them 8 at a time with Simd::Float8, in chunks run by the thread pool; each chunk
+ * lists the particles that died, and holes are filled with the last live particles, so the arrays
+ * never move nor grow. When full, new particles are dropped.
+ */
+class ParticleSystem
+{
+public:
+    explicit ParticleSystem(std::size_t capacity, std::uint32_t seed = 0);
+
+    std::size_t addEmitter(const ParticleEmitter& emitter);
+
+    inline ParticleEmitter& emitter(std::size_t index) { return _emitters[index]; }
+    inline const ParticleEmitter& emitter(std::size_t index) const { return _emitters[index]; }
+    inline std::size_t emittersCount() const { return _emitters.size(); }
+
+    /** Spawns count particles at once, for bursts. Returns how many fitted. */
+    std::size_t emit(const ParticleEmitter& emitter, std::size_t count);
+
+    /** Spawns the particles of each emitter for this time step, then moves and ages every particle */
+    void update(Coord deltaTime, ThreadPool& threadPool = defaultThreadPool());
+
+    /** Constant acceleration, in world units per second squared */
+    Vector3f gravity = Vector3f(0, 0, -9.8f);
+
+    /** Fraction of the velocity lost per second */
+    Coord drag = 0.1f;
+
+    inline std::size_t size() const { return _size; }
+    inline std::size_t capacity() const { return _capacity; }
+    inline const ParticleArrays& particles() const { return _particles; }
+
+    /** Removes every particle */
+    inline void reset() { _size = 0; }
+
+private:
+    void simulate(Coord deltaTime, ThreadPool& threadPool);
+    void compact();
+    void move(std::size_t from, std::size_t to);
+
+    std::size_t _capacity;
+    std::size_t _size = 0;
+    ParticleArrays _particles;
+
+    std::vector<ParticleEmitter> _emitters;
+
+    /* Fraction of a particle left to spawn by each emitter */
+    std::vector<Coord> _emitterCarry;
+
+    /* Indices of the particles that died, one list per chunk, in increasing order */
+    std::vector<std::vector<std::uint32_t>> _deadIndices;
+
+    std::mt19937 _generator;
+};
+
+/** GPU copy of the particles, refreshed every frame. Attribute arrays are copied as they are, one after the other,
+ * into a buffer orphaned by each update, so the driver never waits for the previous frame's draw.
+ */
+struct ParticleBuffer
+{
+    GLuint vao = 0, vbo = 0;
+    std::size_t capacity = 0;
+    std::size_t size = 0;
+
+    void initBuffers(std::size_t capacity);
+
+    void fillBuffers(const ParticleSystem& particleSystem);
+
+    /* Freeing GPU memory */
+    void clear();
+};
+
+/** Billboards facing the camera, as round spots fading with age.
+ * Uniforms: view, projection and particleSize, in world units.
+ * The quad corners come from gl_VertexID and the particle from the instance, so no vertex buffer is needed.
+ * It is meant to be drawn after opaque geometry with blending and without depth writes, as
+ *     glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA, GL_ONE); glDepthMask(GL_FALSE);
+ */
+struct ParticleShaderProgram
+{
+    GLuint shaderProgram;
+
+    ParticleShaderProgram();
+
+    void setupVAO(ParticleBuffer& particleBuffer) const;
+
+    void drawCall(const ParticleBuffer& particleBuffer) const;
+};
+
+/* Convenience function to ease initialization */
+ParticleBuffer toParticleBuffer(const ParticleShaderProgram& pipeline, std::size_t capacity);
+
+} // Grafica
@@ -0,0 +1,63 @@
+/**
+ * @file phong_lighting.cpp
+ * @brief The Phong model of PhongColorShaderProgram and PhongTextureShaderProgram, evaluated on the CPU.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "phong_lighting.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace Grafica
+{
+
+namespace
+{
+    /* The shininess is an integer, squaring is much cheaper than std::pow */
+    Coord power(Coord base, unsigned int exponent)
+    {
+        Coord result = 1;
+        while (exponent > 0)
+        {
+            if (exponent & 1)
+                result *= base;
+            base *= base;
+            exponent >>= 1;
+        }
+        return result;
+    }
+}
+
+Vector3f phongShading(
+    const PhongLighting& lighting,
+    const Vector3f& position,
+    const Vector3f& normal,
+    const Vector3f& viewPosition,
+    const Vector3f& color,
+    bool lightVisible)
+{
+    // ambient
+    Vector3f const ambient = lighting.Ka.cwiseProduct(lighting.La);
+    if (not lightVisible)
+        return ambient.cwiseProduct(color);
+
+    // diffuse
+    Vector3f const normalizedNormal = normal.normalized();
+    Vector3f const toLight = lighting.lightPosition - position;
+    Vector3f const lightDirection = toLight.normalized();
+    Coord const diffuseFactor = std::max(normalizedNormal.dot(lightDirection), 0.0f);
+    Vector3f const diffuse = lighting.Kd.cwiseProduct(lighting.Ld) * diffuseFactor;
+
+    // specular
+    Vector3f const viewDirection = (viewPosition - position).normalized();
+    Vector3f const reflectDirection = 2 * normalizedNormal.dot(lightDirection) * normalizedNormal - lightDirection;
+    Coord const specularFactor = power(std::max(viewDirection.dot(reflectDirection), 0.0f), lighting.shininess);
+    Vector3f const specular = lighting.Ks.cwiseProduct(lighting.Ls) * specularFactor;
+
+    return (ambient + (diffuse + specular) / attenuation(lighting, toLight.norm())).cwiseProduct(color);
+}
+
+} // Grafica
@@ -0,0 +1,52 @@
+/**
+ * @file phong_lighting.h
+ * @brief The Phong model of PhongColorShaderProgram and PhongTextureShaderProgram, evaluated on the CPU.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include "simple_eigen.h"
+
+namespace Grafica
+{
+
+/** The uniforms of PhongColorShaderProgram, with the same names and meaning.
+ * viewPosition is taken from the view matrix by the renderers.
+ */
+struct PhongLighting
+{
+    Vector3f lightPosition = Vector3f(-5, -5, 5);
+    Vector3f La = Vector3f(1, 1, 1);
+    Vector3f Ld = Vector3f(1, 1, 1);
+    Vector3f Ls = Vector3f(1, 1, 1);
+    Vector3f Ka = Vector3f(0.2f, 0.2f, 0.2f);
+    Vector3f Kd = Vector3f(0.9f, 0.5f, 0.5f);
+    Vector3f Ks = Vector3f(1, 1, 1);
+    unsigned int shininess = 100;
+    Coord constantAttenuation = 0.0001f;
+    Coord linearAttenuation = 0.03f;
+    Coord quadraticAttenuation = 0.01f;
+};
+
+inline Coord attenuation(const PhongLighting& lighting, Coord distance)
+{
+    return lighting.constantAttenuation
+        + lighting.linearAttenuation * distance
+        + lighting.quadraticAttenuation * distance * distance;
+}
+
+/** Same steps as the fragment shaders. The normal does not need to be normalized.
+ * Without lightVisible only the ambient term is left, for points in shadow.
+ */
+Vector3f phongShading(
+    const PhongLighting& lighting,
+    const Vector3f& position,
+    const Vector3f& normal,
+    const Vector3f& viewPosition,
+    const Vector3f& color,
+    bool lightVisible = true);
+
+} // Grafica
@@ -0,0 +1,324 @@
+/**
+ * @file quaternion.cpp
+ * @brief Unit quaternions to store and interpolate rotations, and batched SIMD interpolation over many of them.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "quaternion.h"
+
+#include <cmath>
+#include <algorithm>
+#include "simd.h"
+
+namespace Grafica
+{
+
+Quaternion Quaternion::identity()
+{
+    return Quaternion();
+}
+
+Quaternion Quaternion::fromAxisAngle(Coord theta_radians, Vector3f axis)
+{
+    axis.normalize();
+    Coord const s = std::sin(theta_radians / 2);
+    return {std::cos(theta_radians / 2), axis[0] * s, axis[1] * s, axis[2] * s};
+}
+
+Quaternion Quaternion::fromMatrix4f(const Matrix4f& m)
+{
+    // Shepperd's method: starting from the largest component avoids dividing by a small number
+    Coord const trace = m(0, 0) + m(1, 1) + m(2, 2);
+    Quaternion q;
+
+    if (trace > 0)
+    {
+        Coord const s = std::sqrt(trace + 1) * 2;
+        q.w = s / 4;
+        q.x = (m(2, 1) - m(1, 2)) / s;
+        q.y = (m(0, 2) - m(2, 0)) / s;
+        q.z = (m(1, 0) - m(0, 1)) / s;
+    }
+    else if (m(0, 0) > m(1, 1) and m(0, 0) > m(2, 2))
+    {
+        Coord const s = std::sqrt(1 + m(0, 0) - m(1, 1) - m(2, 2)) * 2;
+        q.w = (m(2, 1) - m(1, 2)) / s;
+        q.x = s / 4;
+        q.y = (m(0, 1) + m(1, 0)) / s;
+        q.z = (m(0, 2) + m(2, 0)) / s;
+    }
+    else if (m(1, 1) > m(2, 2))
+    {
+        Coord const s = std::sqrt(1 + m(1, 1) - m(0, 0) - m(2, 2)) * 2;
+        q.w = (m(0, 2) - m(2, 0)) / s;
+        q.x = (m(0, 1) + m(1, 0)) / s;
+        q.y = s / 4;
+        q.z = (m(1, 2) + m(2, 1)) / s;
+    }
+    else
+    {
+        Coord const s = std::sqrt(1 + m(2, 2) - m(0, 0) - m(1, 1)) * 2;
+        q.w = (m(1, 0) - m(0, 1)) / s;
+        q.x = (m(0, 2) + m(2, 0)) / s;
+        q.y = (m(1, 2) + m(2, 1)) / s;
+        q.z = s / 4;
+    }
+
+    return q.normalized();
+}
+
+Eigen::Matrix3f Quaternion::toMatrix3f() const
+{
+    Coord const xx = x * x, yy = y * y, zz = z * z;
+    Coord const xy = x * y, xz = x * z, yz = y * z;
+    Coord const wx = w * x, wy = w * y, wz = w * z;
+
+    return (Eigen::Matrix3f() <<
+        1 - 2 * (yy + zz), 2 * (xy - wz),     2 * (xz + wy),
+        2 * (xy + wz),     1 - 2 * (xx + zz), 2 * (yz - wx),
+        2 * (xz - wy),     2 * (yz + wx),     1 - 2 * (xx + yy)).finished();
+}
+
+Matrix4f Quaternion::toMatrix4f() const
+{
+    Matrix4f matrix = Matrix4f::Identity();
+    matrix.topLeftCorner<3, 3>() = toMatrix3f();
+    return matrix;
+}
+
+Quaternion Quaternion::operator*(const Quaternion& rhs) const
+{
+    return {
+        w * rhs.w - x * rhs.x - y * rhs.y - z * rhs.z,
+        w * rhs.x + x * rhs.w + y * rhs.z - z * rhs.y,
+        w * rhs.y - x * rhs.z + y * rhs.w + z * rhs.x,
+        w * rhs.z + x * rhs.y - y * rhs.x + z * rhs.w};
+}
+
+Quaternion Quaternion::conjugate() const
+{
+    return {w, -x, -y, -z};
+}
+
+Coord Quaternion::dot(const Quaternion& other) const
+{
+    return w * other.w + x * other.x + y * other.y + z * other.z;
+}
+
+Coord Quaternion::norm() const
+{
+    return std::sqrt(dot(*this));
+}
+
+Quaternion Quaternion::normalized() const
+{
+    Coord const inverseNorm = 1 / norm();
+    return {w * inverseNorm, x * inverseNorm, y * inverseNorm, z * inverseNorm};
+}
+
+Vector3f Quaternion::rotate(const Vector3f& vector) const
+{
+    // v' = v + 2 u x (u x v + w v), with u the vector part
+    Vector3f const u(x, y, z);
+    Vector3f const uv = u.cross(vector);
+    return vector + 2 * u.cross(uv + w * vector);
+}
+
+namespace
+{
+    using namespace Simd;
+
+    /* Shared by the single and batched versions, for a float or four floats in a SSE register.
+     * Both take the shortest path, flipping the destination when the dot product is negative. */
+
+    template <typename Real>
+    inline void nlerpCore(
+        Real fromW, Real fromX, Real fromY, Real fromZ,
+        Real toW, Real toX, Real toY, Real toZ,
+        Real t,
+        Real& resultW, Real& resultX, Real& resultY, Real& resultZ)
+    {
+        Real const cosine = add(add(mul(fromW, toW), mul(fromX, toX)), add(mul(fromY, toY), mul(fromZ, toZ)));
+        Real const s = flipSign(t, cosine);
+        Real const d = sub(splat(t, 1.0f), t);
+
+        Real const w = add(mul(d, fromW), mul(s, toW));
+        Real const x = add(mul(d, fromX), mul(s, toX));
+        Real const y = add(mul(d, fromY), mul(s, toY));
+        Real const z = add(mul(d, fromZ), mul(s, toZ));
+
+        Real const inverseNorm = div(splat(t, 1.0f), sqrt(add(add(mul(w, w), mul(x, x)), add(mul(y, y), mul(z, z)))));
+        resultW = mul(w, inverseNorm);
+        resultX = mul(x, inverseNorm);
+        resultY = mul(y, inverseNorm);
+        resultZ = mul(z, inverseNorm);
+    }
+
+    /* Eberly's coefficients: u[i] = 1 / (i (2i + 1)), v[i] = i / (2i + 1),
+     * with the last pair scaled by mu to compensate the truncation of the series.
+     * With 8 terms the coefficients are off by up to 2e-5; with 10, and mu fitted for them, by 4e-6. */
+    constexpr unsigned int SLERP_TERMS = 10;
+    constexpr float SLERP_MU = 1.8763f;
+    constexpr float SLERP_U[SLERP_TERMS] = {
+        1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9), 1.0f / (5 * 11),
+        1.0f / (6 * 13), 1.0f / (7 * 15), 1.0f / (8 * 17), 1.0f / (9 * 19), SLERP_MU / (10 * 21)};
+    constexpr float SLERP_V[SLERP_TERMS] = {
+        1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9, 5.0f / 11,
+        6.0f / 13, 7.0f / 15, 8.0f / 17, 9.0f / 19, SLERP_MU * 10 / 21};
+
+    template <typename Real>
+    inline void slerpCore(
+        Real fromW, Real fromX, Real fromY, Real fromZ,
+        Real toW, Real toX, Real toY, Real toZ,
+        Real t,
+        Real& resultW, Real& resultX, Real& resultY, Real& resultZ)
+    {
+        Real const signedCosine = add(add(mul(fromW, toW), mul(fromX, toX)), add(mul(fromY, toY), mul(fromZ, toZ)));
+        Real const cosine = abs(signedCosine);
+        Real const one = splat(t, 1.0f);
+
+        Real const d = sub(one, t);
+        Real const squaredT = mul(t, t);
+        Real const squaredD = mul(d, d);
+        Real const cosineMinusOne = sub(cosine, one);
+
+        // Horner evaluation of both coefficients, from the last term
+        Real coefficientT = one;
+        Real coefficientD = one;
+        for (unsigned int i = SLERP_TERMS; i-- > 0;)
+        {
+            Real const u = splat(t, SLERP_U[i]);
+            Real const v = splat(t, SLERP_V[i]);
+            Real const bT = mul(sub(mul(u, squaredT), v), cosineMinusOne);
+            Real const bD = mul(sub(mul(u, squaredD), v), cosineMinusOne);
+            coefficientT = add(one, mul(bT, coefficientT));
+            coefficientD = add(one, mul(bD, coefficientD));
+        }
+        coefficientT = flipSign(mul(t, coefficientT), signedCosine);
+        coefficientD = mul(d, coefficientD);
+
+        resultW = add(mul(coefficientD, fromW), mul(coefficientT, toW));
+        resultX = add(mul(coefficientD, fromX), mul(coefficientT, toX));
+        resultY = add(mul(coefficientD, fromY), mul(coefficientT, toY));
+        resultZ = add(mul(coefficientD, fromZ), mul(coefficientT, toZ));
+    }
+
+    template <typename Kernel>
+    void interpolateBatch(
+        const QuaternionArray& from,
+        const QuaternionArray& to,
+        const float* t,
+        QuaternionArray& result,
+        Kernel&& kernel)
+    {
+        std::size_t const count = std::min(from.size(), to.size());
+        result.resize(count);
+        std::size_t i = 0;
+
+#if defined(GRAFICA_USE_SSE2)
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 w, x, y, z;
+            kernel(
+                _mm_loadu_ps(from.w() + i), _mm_loadu_ps(from.x() + i), _mm_loadu_ps(from.y() + i), _mm_loadu_ps(from.z() + i),
+                _mm_loadu_ps(to.w() + i), _mm_loadu_ps(to.x() + i), _mm_loadu_ps(to.y() + i), _mm_loadu_ps(to.z() + i),
+                _mm_loadu_ps(t + i),
+                w, x, y, z);
+            _mm_storeu_ps(result.w() + i, w);
+            _mm_storeu_ps(result.x() + i, x);
+            _mm_storeu_ps(result.y() + i, y);
+            _mm_storeu_ps(result.z() + i, z);
+        }
+#endif
+
+        for (; i < count; ++i)
+        {
+            float w, x, y, z;
+            kernel(
+                from.w()[i], from.x()[i], from.y()[i], from.z()[i],
+                to.w()[i], to.x()[i], to.y()[i], to.z()[i],
+                t[i],
+                w, x, y, z);
+            result.w()[i] = w;
+            result.x()[i] = x;
+            result.y()[i] = y;
+            result.z()[i] = z;
+        }
+    }
+}
+
+Quaternion nlerp(const Quaternion& from, const Quaternion& to, Coord t)
+{
+    Quaternion result;
+    nlerpCore(from.w, from.x, from.y, from.z, to.w, to.x, to.y, to.z, t, result.w, result.x, result.y, result.z);
+    return result;
+}
+
+Quaternion slerp(const Quaternion& from, const Quaternion& to, Coord t)
+{
+    Coord cosine = from.dot(to);
+    Coord const sign = cosine < 0 ? -1.0f : 1.0f;
+    cosine *= sign;
+
+    // Almost the same rotation, sin(angle) is too small to divide by
+    if (cosine > 0.9995f)
+        return nlerp(from, to, t);
+
+    Coord const angle = std::acos(cosine);
+    Coord const inverseSine = 1 / std::sin(angle);
+    Coord const fromWeight = std::sin((1 - t) * angle) * inverseSine;
+    Coord const toWeight = sign * std::sin(t * angle) * inverseSine;
+
+    return {
+        fromWeight * from.w + toWeight * to.w,
+        fromWeight * from.x + toWeight * to.x,
+        fromWeight * from.y + toWeight * to.y,
+        fromWeight * from.z + toWeight * to.z};
+}
+
+std::ostream& operator<<(std::ostream& os, const Quaternion& quaternion)
+{
+    os << "(" << quaternion.w << ", " << quaternion.x << ", " << quaternion.y << ", " << quaternion.z << ")";
+    return os;
+}
+
+QuaternionArray::QuaternionArray(std::size_t size)
+{
+    resize(size);
+}
+
+void QuaternionArray::resize(std::size_t size)
+{
+    // New elements are the identity
+    _w.resize(size, 1.0f);
+    _x.resize(size, 0.0f);
+    _y.resize(size, 0.0f);
+    _z.resize(size, 0.0f);
+}
+
+void QuaternionArray::set(std::size_t index, const Quaternion& quaternion)
+{
+    _w[index] = quaternion.w;
+    _x[index] = quaternion.x;
+    _y[index] = quaternion.y;
+    _z[index] = quaternion.z;
+}
+
+Quaternion QuaternionArray::get(std::size_t index) const
+{
+    return {_w[index], _x[index], _y[index], _z[index]};
+}
+
+void nlerpBatch(const QuaternionArray& from, const QuaternionArray& to, const float* t, QuaternionArray& result)
+{
+    interpolateBatch(from, to, t, result, [](auto&&... arguments) { nlerpCore(arguments...); });
+}
+
+void slerpBatch(const QuaternionArray& from, const QuaternionArray& to, const float* t, QuaternionArray& result)
+{
+    interpolateBatch(from, to, t, result, [](auto&&... arguments) { slerpCore(arguments...); });
+}
+
+} // Grafica
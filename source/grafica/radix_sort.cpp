@@ -0,0 +1,111 @@
+/**
+ * @file radix_sort.cpp
+ * @brief Parallel LSD radix sort for 64 bits keys carrying the index of the element they sort.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "radix_sort.h"
+
+#include <array>
+#include <algorithm>
+
+namespace Grafica
+{
+
+namespace
+{
+    constexpr unsigned int RADIX_BITS = 8;
+    constexpr std::size_t RADIX_SIZE = 1 << RADIX_BITS;
+    constexpr std::uint64_t RADIX_MASK = RADIX_SIZE - 1;
+    constexpr unsigned int PASSES = 64 / RADIX_BITS;
+
+    // Below this size, a single thread is faster than synchronizing workers
+    constexpr std::size_t MIN_KEYS_PER_CHUNK = 4096;
+
+    using Histogram = std::array<std::size_t, RADIX_SIZE>;
+}
+
+void radixSort(std::vector<SortKey>& keys, std::vector<SortKey>& scratch, ThreadPool& threadPool)
+{
+    std::size_t const keysCount = keys.size();
+    if (keysCount < 2)
+        return;
+
+    scratch.resize(keysCount);
+
+    std::size_t const chunks = std::clamp<std::size_t>(keysCount / MIN_KEYS_PER_CHUNK, 1, threadPool.size() + 1);
+    std::size_t const chunkSize = (keysCount + chunks - 1) / chunks;
+
+    // Finding which bits change among keys, so passes over constant bytes are skipped
+    std::vector<std::uint64_t> orBits(chunks, 0), andBits(chunks, ~std::uint64_t(0));
+    threadPool.parallelFor(0, chunks, 1, [&](std::size_t chunkBegin, std::size_t chunkEnd)
+    {
+        for (std::size_t chunk = chunkBegin; chunk < chunkEnd; ++chunk)
+        {
+            std::size_t const end = std::min(keysCount, (chunk + 1) * chunkSize);
+            for (std::size_t i = chunk * chunkSize; i < end; ++i)
+            {
+                orBits[chunk] |= keys[i].key;
+                andBits[chunk] &= keys[i].key;
+            }
+        }
+    });
+
+    std::uint64_t changingBits = 0;
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+        changingBits |= orBits[chunk] ^ andBits[chunk];
+
+    std::vector<Histogram> histograms(chunks);
+
+    for (unsigned int pass = 0; pass < PASSES; ++pass)
+    {
+        unsigned int const shift = pass * RADIX_BITS;
+        if (((changingBits >> shift) & RADIX_MASK) == 0)
+            continue;
+
+        // 1. Every chunk counts its digits
+        threadPool.parallelFor(0, chunks, 1, [&](std::size_t chunkBegin, std::size_t chunkEnd)
+        {
+            for (std::size_t chunk = chunkBegin; chunk < chunkEnd; ++chunk)
+            {
+                Histogram& histogram = histograms[chunk];
+                histogram.fill(0);
+
+                std::size_t const end = std::min(keysCount, (chunk + 1) * chunkSize);
+                for (std::size_t i = chunk * chunkSize; i < end; ++i)
+                    histogram[(keys[i].key >> shift) & RADIX_MASK]++;
+            }
+        });
+
+        // 2. Exclusive prefix sum over (digit, chunk), so each chunk knows where to write each digit
+        std::size_t offset = 0;
+        for (std::size_t digit = 0; digit < RADIX_SIZE; ++digit)
+        {
+            for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+            {
+                std::size_t const count = histograms[chunk][digit];
+                histograms[chunk][digit] = offset;
+                offset += count;
+            }
+        }
+
+        // 3. Scattering, chunks are disjoint so the order among equal digits is preserved
+        threadPool.parallelFor(0, chunks, 1, [&](std::size_t chunkBegin, std::size_t chunkEnd)
+        {
+            for (std::size_t chunk = chunkBegin; chunk < chunkEnd; ++chunk)
+            {
+                Histogram& offsets = histograms[chunk];
+
+                std::size_t const end = std::min(keysCount, (chunk + 1) * chunkSize);
+                for (std::size_t i = chunk * chunkSize; i < end; ++i)
+                    scratch[offsets[(keys[i].key >> shift) & RADIX_MASK]++] = keys[i];
+            }
+        });
+
+        keys.swap(scratch);
+    }
+}
+
+} // Grafica
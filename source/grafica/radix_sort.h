@@ -0,0 +1,31 @@
+/**
+ * @file radix_sort.h
+ * @brief Parallel LSD radix sort for 64 bits keys carrying the index of the element they sort.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "thread_pool.h"
+
+namespace Grafica
+{
+
+/** A key to sort and the position of the element it belongs to */
+struct SortKey
+{
+    std::uint64_t key;
+    std::uint32_t index;
+};
+
+/** Sorts keys in ascending order. The sort is stable.
+ * scratch is used as the second buffer of the passes, keeping it between calls avoids reallocations.
+ * Bytes shared by all keys are skipped, so short keys cost fewer passes.
+ */
+void radixSort(std::vector<SortKey>& keys, std::vector<SortKey>& scratch, ThreadPool& threadPool = defaultThreadPool());
+
+} // Grafica
@@ -0,0 +1,391 @@
+/**
+ * @file ray_tracer.cpp
+ * @brief CPU ray tracer rendering SceneGraphNode trees with the Phong model of PhongColorShaderProgram,
+ *        for reference images and light baking without a GPU.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "ray_tracer.h"
+
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <cassert>
+#include <numeric>
+#include <algorithm>
+#include <ciso646>
+
+namespace Grafica
+{
+
+namespace
+{
+    /* Instance nodes are median splits, so the instance tree is at most 33 levels deep and each level leaves
+     * at most one node pending. Mesh traversal stays within TriangleBVH::MAX_DEPTH on its own. */
+    constexpr unsigned int STACK_SIZE = 64;
+
+    /* Bakes and shadows run over this many points or pixels per task */
+    constexpr std::size_t BAKE_GRAIN = 256;
+
+    /* Offset of shadow rays from the surface, relative to the magnitude of the coordinates */
+    constexpr Coord SHADOW_BIAS = 1e-4f;
+
+    /* Whether something lies between a surface point and the light.
+     * The ray starts slightly off the surface, on the side facing the light. */
+    bool inShadow(const RayTracer& rayTracer, const Vector3f& position, const Vector3f& normal, const Vector3f& lightPosition)
+    {
+        Vector3f const toLight = lightPosition - position;
+        Coord const scale = 1 + position.cwiseAbs().maxCoeff();
+        Coord const side = normal.dot(toLight) >= 0 ? 1 : -1;
+
+        Vector3f const origin = position + normal * (side * SHADOW_BIAS * scale);
+        return rayTracer.occluded({origin, lightPosition - origin}, 1 - SHADOW_BIAS);
+    }
+}
+
+void RayTracer::setShape(const GPUShape& gpuShape, const Shape& shape, ThreadPool& threadPool)
+{
+    assert(shape.stride >= 6);
+
+    auto meshPtr = std::make_shared<Mesh>();
+    std::size_t const verticesCount = shape.vertices.size() / shape.stride;
+    meshPtr->positions.reserve(verticesCount);
+    meshPtr->colors.reserve(verticesCount);
+
+    for (std::size_t vertex = 0; vertex < verticesCount; ++vertex)
+    {
+        Coord const* attributes = shape.vertices.data() + vertex * shape.stride;
+        meshPtr->positions.push_back(Vector3f(attributes[0], attributes[1], attributes[2]));
+        meshPtr->colors.push_back(Vector3f(attributes[3], attributes[4], attributes[5]));
+
+        if (shape.stride >= 9)
+            meshPtr->normals.push_back(Vector3f(attributes[6], attributes[7], attributes[8]));
+    }
+
+    meshPtr->indices = shape.indices;
+    meshPtr->bvh.build(meshPtr->positions, meshPtr->indices, threadPool);
+
+    _meshes[&gpuShape] = meshPtr;
+}
+
+void RayTracer::removeShape(const GPUShape& gpuShape)
+{
+    _meshes.erase(&gpuShape);
+}
+
+void RayTracer::setScene(SceneGraphNodePtr rootPtr)
+{
+    _instances.clear();
+    _instanceNodes.clear();
+
+    collectInstances(rootPtr, Transformations::identity());
+
+    _instanceIds.resize(_instances.size());
+    std::iota(_instanceIds.begin(), _instanceIds.end(), 0);
+
+    if (_instances.empty())
+        return;
+
+    // Children are allocated in pairs, at most 2n - 1 nodes
+    _instanceNodes.reserve(2 * _instances.size());
+    _instanceNodes.push_back({AABB::empty(), 0, 0});
+    buildInstanceNode(0, 0, static_cast<std::uint32_t>(_instances.size()));
+}
+
+void RayTracer::collectInstances(const SceneGraphNodePtr& nodePtr, const Matrix4f& parentTransform)
+{
+    Matrix4f const transform = parentTransform * nodePtr->transform;
+
+    if (nodePtr->gpuShapeMaybe.has_value())
+    {
+        auto const it = _meshes.find(nodePtr->gpuShapeMaybe.value().get());
+        if (it != _meshes.end() and it->second->bvh.trianglesCount() > 0)
+        {
+            Instance instance;
+            instance.meshPtr = it->second;
+            instance.nodePtr = nodePtr.get();
+            instance.modelToWorld = transform;
+            instance.worldToModel = transform.inverse();
+            instance.normalMatrix = transform.block<3, 3>(0, 0).inverse().transpose();
+            instance.worldBounds = transformAABB(it->second->bvh.bounds(), transform);
+            _instances.push_back(std::move(instance));
+        }
+    }
+
+    for (auto const& childPtr : nodePtr->childs)
+        collectInstances(childPtr, transform);
+}
+
+void RayTracer::buildInstanceNode(std::uint32_t nodeIndex, std::uint32_t first, std::uint32_t count)
+{
+    AABB bounds = AABB::empty();
+    AABB centroidBounds = AABB::empty();
+    for (std::uint32_t i = first; i < first + count; ++i)
+    {
+        bounds.extend(_instances[_instanceIds[i]].worldBounds);
+        centroidBounds.extend(_instances[_instanceIds[i]].worldBounds.center());
+    }
+
+    if (count <= 2)
+    {
+        _instanceNodes[nodeIndex] = {bounds, first, count};
+        return;
+    }
+
+    // Nodes are few compared to triangles, halves along the longest axis are good enough
+    unsigned int axis = 0;
+    (centroidBounds.max - centroidBounds.min).maxCoeff(&axis);
+
+    std::uint32_t const leftCount = count / 2;
+    auto const begin = _instanceIds.begin() + first;
+    std::nth_element(begin, begin + leftCount, begin + count, [&](std::uint32_t lhs, std::uint32_t rhs)
+    {
+        return _instances[lhs].worldBounds.center()[axis] < _instances[rhs].worldBounds.center()[axis];
+    });
+
+    std::uint32_t const left = static_cast<std::uint32_t>(_instanceNodes.size());
+    _instanceNodes.resize(left + 2);
+    _instanceNodes[nodeIndex] = {bounds, left, 0};
+
+    buildInstanceNode(left, first, leftCount);
+    buildInstanceNode(left + 1, first + leftCount, count - leftCount);
+}
+
+template <bool ANY_HIT>
+bool RayTracer::traverse(const Ray& ray, Coord maxDistance, std::uint32_t& instance, TriangleHit& hit) const
+{
+    if (_instanceNodes.empty())
+        return false;
+
+    struct Pending
+    {
+        std::uint32_t node;
+        Coord entry;
+    };
+
+    Pending stack[STACK_SIZE];
+    unsigned int stackSize = 0;
+
+    Coord closest = maxDistance;
+    bool found = false;
+
+    if (auto entry = Grafica::intersect(ray, _instanceNodes[0].bounds, closest))
+        stack[stackSize++] = {0, *entry};
+
+    while (stackSize > 0)
+    {
+        Pending const pending = stack[--stackSize];
+        if (pending.entry > closest)
+            continue;
+
+        InstanceNode const& node = _instanceNodes[pending.node];
+        if (node.count == 0)
+        {
+            auto leftEntry = Grafica::intersect(ray, _instanceNodes[node.leftOrFirst].bounds, closest);
+            auto rightEntry = Grafica::intersect(ray, _instanceNodes[node.leftOrFirst + 1].bounds, closest);
+
+            // The nearest child goes last, to be popped first
+            bool const leftFirst = leftEntry and (not rightEntry or *leftEntry <= *rightEntry);
+
+            assert(stackSize + 2 <= STACK_SIZE);
+            if (leftFirst and rightEntry)
+                stack[stackSize++] = {node.leftOrFirst + 1, *rightEntry};
+            if (leftEntry)
+                stack[stackSize++] = {node.leftOrFirst, *leftEntry};
+            if (not leftFirst and rightEntry)
+                stack[stackSize++] = {node.leftOrFirst + 1, *rightEntry};
+            continue;
+        }
+
+        for (std::uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+        {
+            Instance const& candidate = _instances[_instanceIds[i]];
+            if (not Grafica::intersect(ray, candidate.worldBounds, closest))
+                continue;
+
+            // The direction keeps the scale of the transform, so distances are the same in both spaces
+            Ray const modelRay = {
+                (candidate.worldToModel * Vector4f(ray.origin[0], ray.origin[1], ray.origin[2], 1)).head<3>(),
+                candidate.worldToModel.block<3, 3>(0, 0) * ray.direction};
+
+            if (ANY_HIT)
+            {
+                if (candidate.meshPtr->bvh.occluded(modelRay, closest))
+                    return true;
+            }
+            else if (auto triangleHit = candidate.meshPtr->bvh.intersect(modelRay, closest))
+            {
+                closest = triangleHit->distance;
+                hit = *triangleHit;
+                instance = _instanceIds[i];
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+std::optional<RayHit> RayTracer::intersect(const Ray& ray, Coord maxDistance) const
+{
+    std::uint32_t instanceIndex = 0;
+    TriangleHit triangleHit{};
+    if (not traverse<false>(ray, maxDistance, instanceIndex, triangleHit))
+        return std::nullopt;
+
+    Instance const& instance = _instances[instanceIndex];
+    Mesh const& mesh = *instance.meshPtr;
+
+    Index const i0 = mesh.indices[3 * triangleHit.triangle];
+    Index const i1 = mesh.indices[3 * triangleHit.triangle + 1];
+    Index const i2 = mesh.indices[3 * triangleHit.triangle + 2];
+    Coord const u = triangleHit.u;
+    Coord const v = triangleHit.v;
+    Coord const w = 1 - u - v;
+
+    RayHit hit;
+    hit.nodePtr = instance.nodePtr;
+    hit.triangle = triangleHit.triangle;
+    hit.distance = triangleHit.distance;
+    hit.u = u;
+    hit.v = v;
+    hit.position = ray.origin + ray.direction * triangleHit.distance;
+    hit.color = w * mesh.colors[i0] + u * mesh.colors[i1] + v * mesh.colors[i2];
+
+    Vector3f const normal = mesh.normals.empty()
+        ? Vector3f((mesh.positions[i1] - mesh.positions[i0]).cross(mesh.positions[i2] - mesh.positions[i0]))
+        : Vector3f(w * mesh.normals[i0] + u * mesh.normals[i1] + v * mesh.normals[i2]);
+    hit.normal = (instance.normalMatrix * normal).normalized();
+
+    return hit;
+}
+
+bool RayTracer::occluded(const Ray& ray, Coord maxDistance) const
+{
+    std::uint32_t instanceIndex = 0;
+    TriangleHit triangleHit{};
+    return traverse<true>(ray, maxDistance, instanceIndex, triangleHit);
+}
+
+AABB RayTracer::bounds() const
+{
+    return _instanceNodes.empty() ? AABB::empty() : _instanceNodes[0].bounds;
+}
+
+Vector3f RayTracer::shade(const RayHit& hit, const Vector3f& viewPosition, const PhongLighting& lighting,
+    const RayTracingSettings& settings, std::uint64_t& shadowRays) const
+{
+    bool lightVisible = true;
+    if (settings.shadows)
+    {
+        ++shadowRays;
+        lightVisible = not inShadow(*this, hit.position, hit.normal, lighting.lightPosition);
+    }
+
+    return phongShading(lighting, hit.position, hit.normal, viewPosition, hit.color, lightVisible);
+}
+
+RayTracingStats RayTracer::render(
+    Image& image,
+    unsigned int width,
+    unsigned int height,
+    const Matrix4f& projection,
+    const Matrix4f& view,
+    const PhongLighting& lighting,
+    const RayTracingSettings& settings,
+    ThreadPool& threadPool) const
+{
+    auto const start = std::chrono::steady_clock::now();
+
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(std::size_t(width) * height, settings.background);
+
+    Matrix4f const inverse = (projection * view).inverse();
+    Vector3f const viewPosition = view.inverse().block<3, 1>(0, 3);
+
+    unsigned int const tileSize = std::max(settings.tileSize, 1u);
+    unsigned int const tilesX = (width + tileSize - 1) / tileSize;
+    unsigned int const tilesY = (height + tileSize - 1) / tileSize;
+
+    std::atomic<std::uint64_t> primaryRays = 0;
+    std::atomic<std::uint64_t> shadowRays = 0;
+
+    // Tiles keep the rays of a task close together, sharing the nodes and triangles they visit
+    threadPool.parallelFor(0, std::size_t(tilesX) * tilesY, 1, [&](std::size_t begin, std::size_t end)
+    {
+        std::uint64_t taskPrimaryRays = 0;
+        std::uint64_t taskShadowRays = 0;
+
+        for (std::size_t tile = begin; tile < end; ++tile)
+        {
+            unsigned int const x0 = static_cast<unsigned int>(tile % tilesX) * tileSize;
+            unsigned int const y0 = static_cast<unsigned int>(tile / tilesX) * tileSize;
+
+            for (unsigned int y = y0; y < std::min(y0 + tileSize, height); ++y)
+            {
+                Coord const ndcY = 1 - 2 * (y + Coord(0.5)) / height;
+
+                for (unsigned int x = x0; x < std::min(x0 + tileSize, width); ++x)
+                {
+                    Coord const ndcX = 2 * (x + Coord(0.5)) / width - 1;
+
+                    // From the near plane to the far plane, as the rasterizer clips
+                    Vector4f const nearPoint = inverse * Vector4f(ndcX, ndcY, -1, 1);
+                    Vector4f const farPoint = inverse * Vector4f(ndcX, ndcY, 1, 1);
+                    Vector3f const origin = nearPoint.head<3>() / nearPoint[3];
+                    Vector3f const toFar = farPoint.head<3>() / farPoint[3] - origin;
+                    Coord const farDistance = toFar.norm();
+
+                    ++taskPrimaryRays;
+                    if (auto hit = intersect({origin, toFar / farDistance}, farDistance))
+                        image.at(x, y) = shade(*hit, viewPosition, lighting, settings, taskShadowRays);
+                }
+            }
+        }
+
+        primaryRays += taskPrimaryRays;
+        shadowRays += taskShadowRays;
+    });
+
+    RayTracingStats stats;
+    stats.primaryRays = primaryRays.load();
+    stats.shadowRays = shadowRays.load();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+std::vector<Vector3f> RayTracer::bakeLighting(
+    const std::vector<Vector3f>& positions,
+    const std::vector<Vector3f>& normals,
+    const PhongLighting& lighting,
+    const RayTracingSettings& settings,
+    ThreadPool& threadPool) const
+{
+    assert(positions.size() == normals.size());
+
+    std::vector<Vector3f> result(positions.size());
+    Vector3f const ambient = lighting.Ka.cwiseProduct(lighting.La);
+
+    threadPool.parallelFor(0, positions.size(), BAKE_GRAIN, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            Vector3f const normal = normals[i].normalized();
+            Vector3f const toLight = lighting.lightPosition - positions[i];
+            Coord const diffuseFactor = std::max(normal.dot(toLight.normalized()), 0.0f);
+
+            result[i] = ambient;
+            if (diffuseFactor == 0 or (settings.shadows and inShadow(*this, positions[i], normal, lighting.lightPosition)))
+                continue;
+
+            result[i] += lighting.Kd.cwiseProduct(lighting.Ld) * (diffuseFactor / attenuation(lighting, toLight.norm()));
+        }
+    });
+
+    return result;
+}
+
+} // Grafica
@@ -0,0 +1,163 @@
+/**
+ * @file ray_tracer.h
+ * @brief CPU ray tracer rendering SceneGraphNode trees with the Phong model of PhongColorShaderProgram,
+ *        for reference images and light baking without a GPU.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include "bounds.h"
+#include "gpu_shape.h"
+#include "image.h"
+#include "phong_lighting.h"
+#include "scene_graph.h"
+#include "shape.h"
+#include "simple_eigen.h"
+#include "thread_pool.h"
+#include "triangle_bvh.h"
+
+namespace Grafica
+{
+
+struct RayTracingSettings
+{
+    /** Without shadows the result matches PhongColorShaderProgram */
+    bool shadows = true;
+
+    /** Color of the pixels where nothing is hit */
+    Vector3f background = Vector3f(0.15f, 0.15f, 0.15f);
+
+    /** Square tiles of this many pixels are the unit of work of each thread */
+    unsigned int tileSize = 16;
+};
+
+struct RayTracingStats
+{
+    std::uint64_t primaryRays = 0;
+    std::uint64_t shadowRays = 0;
+    double seconds = 0;
+
+    inline double raysPerSecond() const { return seconds > 0 ? (primaryRays + shadowRays) / seconds : 0; }
+};
+
+struct RayHit
+{
+    const SceneGraphNode* nodePtr;
+
+    /** Triangle of the Shape given to setShape, as in TriangleHit */
+    std::uint32_t triangle;
+
+    /** Along the ray direction, in units of its length */
+    Coord distance;
+    Coord u, v;
+
+    /** Interpolated at the hit, in world coordinates */
+    Vector3f position;
+    Vector3f normal;
+    Vector3f color;
+};
+
+/** Two levels of BVHs: one over the triangles of each shape, in model coordinates and shared by all nodes drawing it,
+ * and one over the world bounds of the nodes, rebuilt by setScene. Rays are moved to model coordinates at each node.
+ * Queries are const and thread safe; setShape and setScene are not.
+ */
+class RayTracer
+{
+public:
+    /** The CPU copy of a GPUShape, as given to fillBuffers. Vertices are position, color and normal,
+     * as for PhongColorShaderProgram; with only position and color, triangles are flat shaded.
+     * Nodes drawing a GPUShape without its Shape are ignored.
+     */
+    void setShape(const GPUShape& gpuShape, const Shape& shape, ThreadPool& threadPool = defaultThreadPool());
+
+    void removeShape(const GPUShape& gpuShape);
+
+    /** Takes the nodes of the tree with their current world transforms. To be called again after they change. */
+    void setScene(SceneGraphNodePtr rootPtr);
+
+    std::optional<RayHit> intersect(const Ray& ray, Coord maxDistance = std::numeric_limits<Coord>::infinity()) const;
+
+    bool occluded(const Ray& ray, Coord maxDistance = std::numeric_limits<Coord>::infinity()) const;
+
+    /** Renders the scene with the same projection and view matrices used by the GL pipelines.
+     * The image is resized to width x height. Tiles are shaded in parallel, one ray per pixel center.
+     */
+    RayTracingStats render(
+        Image& image,
+        unsigned int width,
+        unsigned int height,
+        const Matrix4f& projection,
+        const Matrix4f& view,
+        const PhongLighting& lighting,
+        const RayTracingSettings& settings = RayTracingSettings(),
+        ThreadPool& threadPool = defaultThreadPool()) const;
+
+    /** View independent light at surface points: ambient plus diffuse, with shadows if enabled, per unit of color.
+     * Multiplied by the vertex colors it gives the baked result; stored in a lightmap it replaces the
+     * ambient and diffuse terms of the shader.
+     */
+    std::vector<Vector3f> bakeLighting(
+        const std::vector<Vector3f>& positions,
+        const std::vector<Vector3f>& normals,
+        const PhongLighting& lighting,
+        const RayTracingSettings& settings = RayTracingSettings(),
+        ThreadPool& threadPool = defaultThreadPool()) const;
+
+    inline std::size_t instancesCount() const { return _instances.size(); }
+
+    /** World bounds of the whole scene */
+    AABB bounds() const;
+
+private:
+    struct Mesh
+    {
+        TriangleBVH bvh;
+        std::vector<Vector3f> positions;
+        std::vector<Vector3f> colors;
+        std::vector<Vector3f> normals;
+        Indices indices;
+    };
+
+    struct Instance
+    {
+        std::shared_ptr<const Mesh> meshPtr;
+        const SceneGraphNode* nodePtr;
+        Matrix4f modelToWorld;
+        Matrix4f worldToModel;
+        Eigen::Matrix3f normalMatrix;
+        AABB worldBounds;
+    };
+
+    struct InstanceNode
+    {
+        AABB bounds = AABB::empty();
+        std::uint32_t leftOrFirst = 0;
+        std::uint32_t count = 0;
+    };
+
+    void collectInstances(const SceneGraphNodePtr& nodePtr, const Matrix4f& parentTransform);
+    void buildInstanceNode(std::uint32_t nodeIndex, std::uint32_t first, std::uint32_t count);
+
+    template <bool ANY_HIT>
+    bool traverse(const Ray& ray, Coord maxDistance, std::uint32_t& instance, TriangleHit& hit) const;
+
+    Vector3f shade(const RayHit& hit, const Vector3f& viewPosition, const PhongLighting& lighting,
+        const RayTracingSettings& settings, std::uint64_t& shadowRays) const;
+
+    std::unordered_map<const GPUShape*, std::shared_ptr<Mesh>> _meshes;
+    std::vector<Instance> _instances;
+    std::vector<std::uint32_t> _instanceIds;
+    std::vector<InstanceNode> _instanceNodes;
+};
+
+} // Grafica
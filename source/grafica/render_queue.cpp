@@ -0,0 +1,167 @@
+/**
+ * @file render_queue.cpp
+ * @brief RenderQueue collects draw items from many pipelines and submits them sorted,
+ *        so OpenGL state changes (programs, textures, VAOs) are minimized.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "render_queue.h"
+
+#include <bit>
+#include <algorithm>
+#include <ciso646>
+
+namespace Grafica
+{
+
+namespace
+{
+    constexpr std::uint32_t PROGRAM_BITS = 10;
+    constexpr std::uint32_t TEXTURE_BITS = 12;
+    constexpr std::uint32_t VAO_BITS = 12;
+    constexpr std::uint32_t DEPTH_BITS = 24;
+
+    constexpr std::uint64_t TRANSLUCENT_BIT = std::uint64_t(1) << 63;
+    constexpr std::uint64_t DEPTH_MASK = (std::uint64_t(1) << DEPTH_BITS) - 1;
+
+    /* The bit pattern of a non negative float grows with its value,
+     * so its highest bits are a good enough quantized depth. */
+    std::uint64_t quantizeDepth(Coord depth)
+    {
+        depth = std::max<Coord>(depth, 0);
+        return std::bit_cast<std::uint32_t>(depth) >> (32 - DEPTH_BITS);
+    }
+}
+
+void RenderQueue::clear()
+{
+    _items.clear();
+    _keys.clear();
+
+    // Ids only group the items of a frame, so deleted GL names do not keep theirs and the maps stay small
+    _programIds.clear();
+    _textureIds.clear();
+    _vaoIds.clear();
+}
+
+std::uint32_t RenderQueue::denseId(std::unordered_map<GLuint, std::uint32_t>& ids, GLuint name, std::uint32_t maxId)
+{
+    auto [it, inserted] = ids.try_emplace(name, static_cast<std::uint32_t>(ids.size()));
+
+    // Once the field is full, items share the last id: the order is still valid, only less grouped.
+    return std::min(it->second, maxId);
+}
+
+std::uint64_t RenderQueue::makeKey(const DrawItem& item, Coord depth, bool translucent)
+{
+    std::uint64_t const program = denseId(_programIds, item.shaderProgram, (1 << PROGRAM_BITS) - 1);
+    std::uint64_t const texture = denseId(_textureIds, item.texture, (1 << TEXTURE_BITS) - 1);
+    std::uint64_t const vao = denseId(_vaoIds, item.vao, (1 << VAO_BITS) - 1);
+    std::uint64_t const quantizedDepth = quantizeDepth(depth);
+
+    if (not translucent)
+    {
+        // State first, then front to back to take advantage of early depth testing
+        return (program << 53) | (texture << 41) | (vao << 29) | (quantizedDepth << 5);
+    }
+
+    // Depth first, back to front, so blending is correct
+    return TRANSLUCENT_BIT | ((DEPTH_MASK - quantizedDepth) << 39) | (program << 29) | (texture << 17) | (vao << 5);
+}
+
+void RenderQueue::push(
+    const GPUShape& gpuShape,
+    GLuint shaderProgram,
+    const Matrix4f& model,
+    bool translucent,
+    GLuint mode)
+{
+    DrawItem const& item = _items.emplace_back(DrawItem{
+        shaderProgram,
+        gpuShape.vao,
+        gpuShape.texture,
+        gpuShape.size,
+        mode,
+        model});
+
+    // Distance along the view direction to the origin of the model
+    Coord const depth = -(_view.row(2).dot(model.col(3)));
+
+    _keys.push_back({makeKey(item, depth, translucent), static_cast<std::uint32_t>(_items.size() - 1)});
+}
+
+void RenderQueue::sort(ThreadPool& threadPool)
+{
+    radixSort(_keys, _scratch, threadPool);
+}
+
+void RenderQueue::submit(const std::string& transformName)
+{
+    _stats = RenderQueueStats();
+
+    GLuint currentProgram = 0, currentVao = 0, currentTexture = 0;
+    GLint modelLocation = -1;
+    bool blending = false;
+
+    for (auto const& sortKey : _keys)
+    {
+        DrawItem const& item = _items[sortKey.index];
+
+        bool const translucent = (sortKey.key & TRANSLUCENT_BIT) != 0;
+        if (translucent and not blending)
+        {
+            // Translucent items come after every opaque one
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            blending = true;
+        }
+
+        if (item.shaderProgram != currentProgram)
+        {
+            glUseProgram(item.shaderProgram);
+            modelLocation = glGetUniformLocation(item.shaderProgram, transformName.c_str());
+            currentProgram = item.shaderProgram;
+            _stats.programChanges++;
+        }
+
+        if (item.texture != 0 and item.texture != currentTexture)
+        {
+            glBindTexture(GL_TEXTURE_2D, item.texture);
+            currentTexture = item.texture;
+            _stats.textureChanges++;
+        }
+
+        if (item.vao != currentVao)
+        {
+            glBindVertexArray(item.vao);
+            currentVao = item.vao;
+            _stats.vaoChanges++;
+        }
+
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, item.model.data());
+        glDrawElements(item.mode, item.size, GL_UNSIGNED_INT, nullptr);
+        _stats.drawCalls++;
+    }
+
+    if (blending)
+    {
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
+    }
+
+    glBindVertexArray(0);
+}
+
+std::ostream& operator<<(std::ostream& os, const RenderQueueStats& stats)
+{
+    os << "[" << stats.drawCalls << " draw calls - "
+        << stats.programChanges << " programs - "
+        << stats.textureChanges << " textures - "
+        << stats.vaoChanges << " vaos]";
+    return os;
+}
+
+} // Grafica
@@ -0,0 +1,119 @@
+/**
+ * @file render_queue.h
+ * @brief RenderQueue collects draw items from many pipelines and submits them sorted,
+ *        so OpenGL state changes (programs, textures, VAOs) are minimized.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include <glad/glad.h>
+#include "gpu_shape.h"
+#include "scene_graph.h"
+#include "simple_eigen.h"
+#include "transformations.h"
+#include "radix_sort.h"
+#include "thread_pool.h"
+
+namespace Grafica
+{
+
+/** Everything needed to issue one draw call */
+struct DrawItem
+{
+    GLuint shaderProgram;
+    GLuint vao;
+    GLuint texture;
+    std::size_t size;
+    GLuint mode;
+    Matrix4f model;
+};
+
+/** Counters of the last submission, useful to check how much state changes were saved */
+struct RenderQueueStats
+{
+    std::size_t drawCalls = 0;
+    std::size_t programChanges = 0;
+    std::size_t textureChanges = 0;
+    std::size_t vaoChanges = 0;
+};
+
+/** Draw keys are 64 bits:
+ * opaque:      [63] 0 | [62..53] program | [52..41] texture | [40..29] vao | [28..5] depth (front to back)
+ * translucent: [63] 1 | [62..39] depth (back to front) | [38..29] program | [28..17] texture | [16..5] vao
+ * Program, texture and VAO are dense ids assigned by the queue, not OpenGL names.
+ */
+class RenderQueue
+{
+public:
+    /** The view matrix is used to compute the depth of each item, it must be set before pushing items. */
+    void setView(const Matrix4f& view) { _view = view; }
+
+    /** Removes all items and the ids given to programs, textures and VAOs, keeping the allocated memory for the next frame */
+    void clear();
+
+    /** Adds a draw of gpuShape with the given program. Textures are bound only if gpuShape.texture is not 0. */
+    void push(
+        const GPUShape& gpuShape,
+        GLuint shaderProgram,
+        const Matrix4f& model,
+        bool translucent = false,
+        GLuint mode = GL_TRIANGLES);
+
+    /** Sorts the draw keys with a parallel radix sort */
+    void sort(ThreadPool& threadPool = defaultThreadPool());
+
+    /** Issues all draw calls in key order. The model matrix of each item is sent to the uniform transformName.
+     * Other uniforms (view, projection, lights) must already be set on each program.
+     * Translucent items are drawn with alpha blending and without writing depth.
+     */
+    void submit(const std::string& transformName = "model");
+
+    inline std::size_t size() const { return _items.size(); }
+
+    inline const RenderQueueStats& stats() const { return _stats; }
+
+private:
+    std::uint64_t makeKey(const DrawItem& item, Coord depth, bool translucent);
+    std::uint32_t denseId(std::unordered_map<GLuint, std::uint32_t>& ids, GLuint name, std::uint32_t maxId);
+
+    Matrix4f _view = Transformations::identity();
+    std::vector<DrawItem> _items;
+    std::vector<SortKey> _keys;
+    std::vector<SortKey> _scratch;
+    std::unordered_map<GLuint, std::uint32_t> _programIds;
+    std::unordered_map<GLuint, std::uint32_t> _textureIds;
+    std::unordered_map<GLuint, std::uint32_t> _vaoIds;
+    RenderQueueStats _stats;
+};
+
+std::ostream& operator<<(std::ostream& os, const RenderQueueStats& stats);
+
+/** Traverses the scene graph as drawSceneGraphNode does, but pushing the nodes into the queue
+ * instead of drawing them right away. Different subtrees can be pushed with different pipelines.
+ */
+template <typename PipelineType>
+void enqueueSceneGraphNode(
+    RenderQueue& renderQueue,
+    SceneGraphNodePtr nodePtr,
+    const PipelineType& pipeline,
+    const Matrix4f& parentTransform = Transformations::identity(),
+    bool translucent = false)
+{
+    Matrix4f newTransform = parentTransform * nodePtr->transform;
+
+    if (nodePtr->gpuShapeMaybe.has_value())
+        renderQueue.push(*nodePtr->gpuShapeMaybe.value(), pipeline.shaderProgram, newTransform, translucent);
+
+    for (auto childPtr : nodePtr->childs)
+        enqueueSceneGraphNode(renderQueue, childPtr, pipeline, newTransform, translucent);
+}
+
+} // Grafica
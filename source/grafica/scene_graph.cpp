@@ -8,6 +8,8 @@
 
 #include "scene_graph.h"
 
+#include <algorithm>
+
 namespace Grafica
 {
 
@@ -17,6 +19,103 @@ void SceneGraphNode::clear()
         childPtr->clear();
 }
 
+namespace
+{
+    /* So invalidateBounds can reach parentPtr from childPtr */
+    void linkBoundsParent(SceneGraphNode& child, const SceneGraphNodePtr& parentPtr)
+    {
+        auto& parents = child.boundsParents;
+        std::erase_if(parents, [](const std::weak_ptr<SceneGraphNode>& parent) { return parent.expired(); });
+
+        bool const linked = std::any_of(parents.begin(), parents.end(), [&](const std::weak_ptr<SceneGraphNode>& parent)
+        {
+            return parent.lock() == parentPtr;
+        });
+        if (not linked)
+            parents.push_back(parentPtr);
+    }
+}
+
+void updateSceneGraphBounds(SceneGraphNodePtr nodePtr)
+{
+    // A clean node has a clean subtree, as invalidating a node also marks its ancestors
+    if (not nodePtr->boundsDirty)
+        return;
+
+    AABB localBounds = AABB::empty();
+    std::size_t nodes = 1;
+    std::size_t triangles = 0;
+
+    if (nodePtr->gpuShapeMaybe.has_value())
+    {
+        auto const& gpuShape = *nodePtr->gpuShapeMaybe.value();
+        localBounds.extend(gpuShape.bounds);
+        triangles += gpuShape.size / 3;
+    }
+
+    for (auto& childPtr : nodePtr->childs)
+    {
+        linkBoundsParent(*childPtr, nodePtr);
+        updateSceneGraphBounds(childPtr);
+
+        localBounds.extend(childPtr->bounds);
+        nodes += childPtr->subtreeNodes;
+        triangles += childPtr->subtreeTriangles;
+    }
+
+    nodePtr->bounds = transformAABB(localBounds, nodePtr->transform);
+    nodePtr->subtreeNodes = nodes;
+    nodePtr->subtreeTriangles = triangles;
+    nodePtr->boundsDirty = false;
+}
+
+void invalidateBounds(SceneGraphNodePtr nodePtr)
+{
+    nodePtr->invalidateBounds();
+}
+
+void SceneGraphNode::setTransform(const Matrix4f& transform_)
+{
+    transform = transform_;
+    invalidateBounds();
+}
+
+void SceneGraphNode::setGPUShape(std::optional<GPUShapePtr> gpuShapeMaybe_)
+{
+    gpuShapeMaybe = std::move(gpuShapeMaybe_);
+    invalidateBounds();
+}
+
+void SceneGraphNode::addChild(SceneGraphNodePtr childPtr)
+{
+    childs.push_back(std::move(childPtr));
+    invalidateBounds();
+}
+
+void SceneGraphNode::invalidateBounds()
+{
+    boundsDirty = true;
+
+    // Shared subtrees have several parents, every path up to a root is marked.
+    // A parent already dirty has its ancestors dirty too, so the walk stops there.
+    std::vector<SceneGraphNode*> pending{this};
+    while (not pending.empty())
+    {
+        SceneGraphNode* node = pending.back();
+        pending.pop_back();
+
+        for (auto const& parent : node->boundsParents)
+        {
+            SceneGraphNodePtr parentPtr = parent.lock();
+            if (parentPtr == nullptr or parentPtr->boundsDirty)
+                continue;
+
+            parentPtr->boundsDirty = true;
+            pending.push_back(parentPtr.get());
+        }
+    }
+}
+
 std::optional<SceneGraphNodePtr> findNode(
     SceneGraphNodePtr nodePtr,
     const std::string& name)
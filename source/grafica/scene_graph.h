@@ -11,8 +11,11 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <memory>
+#include <cstdint>
 #include <optional>
 #include <ciso646>
+#include "bounds.h"
 #include "gpu_shape.h"
 #include "shape.h"
 #include "simple_eigen.h"
@@ -30,9 +33,25 @@ class SceneGraphNode
 {
 public:
     std::string name;
+
+    /* After assigning transform, gpuShapeMaybe or childs directly, invalidateBounds must be called on the node,
+     * otherwise the bounds used for culling stay as they were. setTransform, setGPUShape and addChild do it. */
     Matrix4f transform;
     std::optional<GPUShapePtr> gpuShapeMaybe;
     std::vector<SceneGraphNodePtr> childs;
+
+    /* Cached by updateSceneGraphBounds: a conservative box around the whole subtree,
+     * in the parent coordinates (the transform of this node is already applied),
+     * and how many nodes and triangles are in it. */
+    AABB bounds = AABB::empty();
+    std::size_t subtreeNodes = 0;
+    std::size_t subtreeTriangles = 0;
+
+    /* Set by invalidateBounds on the node and all its ancestors, so updateSceneGraphBounds only visits those.
+     * The parents are the ones updateSceneGraphBounds has seen; a parent the node was removed from
+     * only costs an unneeded recomputation. */
+    bool boundsDirty = true;
+    std::vector<std::weak_ptr<SceneGraphNode>> boundsParents;
     
     SceneGraphNode(
         const std::string& name_) : 
@@ -61,9 +80,28 @@ public:
         childs()
     {}
 
+    void setTransform(const Matrix4f& transform_);
+
+    void setGPUShape(std::optional<GPUShapePtr> gpuShapeMaybe_);
+
+    void addChild(SceneGraphNodePtr childPtr);
+
+    /* Marks the bounds of this node and all its ancestors to be recomputed */
+    void invalidateBounds();
+
     void clear();
 };
 
+/* Brings the cached bounds of every node up to date. Only the nodes invalidated since the last call,
+ * and their ancestors, are visited, so nothing is traversed when nothing moved.
+ */
+void updateSceneGraphBounds(SceneGraphNodePtr nodePtr);
+
+/* Must be called on a node after assigning its transform, its GPUShape or its childs.
+ * The node and every ancestor are marked, up to the root, in as many steps as the tree is deep.
+ */
+void invalidateBounds(SceneGraphNodePtr nodePtr);
+
 std::optional<SceneGraphNodePtr> findNode(
     SceneGraphNodePtr nodePtr,
     const std::string& name);
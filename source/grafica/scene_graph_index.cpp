@@ -0,0 +1,316 @@
+/**
+ * @file scene_graph_index.cpp
+ * @brief SceneGraphIndex finds SceneGraphNodes by name or path with hash lookups instead of depth first searches.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "scene_graph_index.h"
+
+#include <algorithm>
+#include <utility>
+#include <ciso646>
+
+namespace Grafica
+{
+
+NameId NameTable::intern(const std::string& name)
+{
+    auto [it, inserted] = _ids.try_emplace(name, static_cast<NameId>(_names.size()));
+    if (inserted)
+        _names.push_back(name);
+
+    return it->second;
+}
+
+std::optional<NameId> NameTable::find(std::string_view name) const
+{
+    auto it = _ids.find(std::string(name));
+    if (it == _ids.end())
+        return std::nullopt;
+
+    return it->second;
+}
+
+SceneGraphIndex::SceneGraphIndex(SceneGraphNodePtr rootPtr):
+    _rootPtr(rootPtr)
+{
+    rebuild();
+}
+
+std::uint64_t SceneGraphIndex::childKey(EntryIndex parent, NameId name)
+{
+    return (std::uint64_t(parent) << 32) | name;
+}
+
+void SceneGraphIndex::rebuild()
+{
+    _entries.clear();
+    _freeEntries.clear();
+    _children.clear();
+    _entriesByName.clear();
+    _entriesByNode.clear();
+
+    indexSubtree(_rootPtr, NO_ENTRY);
+}
+
+void SceneGraphIndex::indexSubtree(SceneGraphNodePtr nodePtr, EntryIndex parent)
+{
+    std::vector<std::pair<SceneGraphNodePtr, EntryIndex>> pending;
+    pending.emplace_back(nodePtr, parent);
+
+    while (not pending.empty())
+    {
+        auto [currentPtr, currentParent] = pending.back();
+        pending.pop_back();
+
+        NameId const name = _names.intern(currentPtr->name);
+        EntryIndex const entry = newEntry(currentPtr, currentParent, name);
+
+        if (currentParent != NO_ENTRY)
+            _entries[currentParent].children.push_back(entry);
+
+        // With repeated names among siblings, the path reaches the first one still present
+        _children[childKey(currentParent, name)].push_back(entry);
+        _entriesByName[name].push_back(entry);
+        _entriesByNode[currentPtr.get()].push_back(entry);
+
+        // Reversed, so children are indexed in order
+        for (auto childIt = currentPtr->childs.rbegin(); childIt != currentPtr->childs.rend(); ++childIt)
+            pending.emplace_back(*childIt, entry);
+    }
+}
+
+SceneGraphIndex::EntryIndex SceneGraphIndex::newEntry(SceneGraphNodePtr nodePtr, EntryIndex parent, NameId name)
+{
+    if (_freeEntries.empty())
+    {
+        _entries.push_back({nodePtr, parent, name, {}});
+        return static_cast<EntryIndex>(_entries.size() - 1);
+    }
+
+    EntryIndex const entry = _freeEntries.back();
+    _freeEntries.pop_back();
+
+    Entry& reused = _entries[entry];
+    reused.nodePtr = nodePtr;
+    reused.parent = parent;
+    reused.name = name;
+    return entry;
+}
+
+void SceneGraphIndex::removeEntry(EntryIndex entry)
+{
+    EntryIndex const parent = _entries[entry].parent;
+    if (parent != NO_ENTRY)
+        std::erase(_entries[parent].children, entry);
+
+    std::vector<EntryIndex> pending{entry};
+    while (not pending.empty())
+    {
+        EntryIndex const current = pending.back();
+        pending.pop_back();
+
+        Entry& currentEntry = _entries[current];
+
+        auto childIt = _children.find(childKey(currentEntry.parent, currentEntry.name));
+        if (childIt != _children.end())
+        {
+            std::erase(childIt->second, current);
+            if (childIt->second.empty())
+                _children.erase(childIt);
+        }
+
+        auto& nameEntries = _entriesByName[currentEntry.name];
+        std::erase(nameEntries, current);
+        if (nameEntries.empty())
+            _entriesByName.erase(currentEntry.name);
+
+        auto& nodeEntries = _entriesByNode[currentEntry.nodePtr.get()];
+        std::erase(nodeEntries, current);
+        if (nodeEntries.empty())
+            _entriesByNode.erase(currentEntry.nodePtr.get());
+
+        pending.insert(pending.end(), currentEntry.children.begin(), currentEntry.children.end());
+        currentEntry.children.clear();
+        currentEntry.nodePtr.reset();
+        _freeEntries.push_back(current);
+    }
+}
+
+std::optional<SceneGraphIndex::EntryIndex> SceneGraphIndex::findEntry(const std::string& nameOrPath) const
+{
+    // A plain name
+    if (nameOrPath.find('/') == std::string::npos)
+    {
+        auto nameMaybe = _names.find(nameOrPath);
+        if (not nameMaybe.has_value())
+            return std::nullopt;
+
+        auto it = _entriesByName.find(nameMaybe.value());
+        if (it == _entriesByName.end() or it->second.empty())
+            return std::nullopt;
+
+        return it->second.front();
+    }
+
+    // A path, resolved one name at a time from the root
+    std::string_view path(nameOrPath);
+    EntryIndex entry = NO_ENTRY;
+    while (true)
+    {
+        std::size_t const separator = path.find('/');
+        auto nameMaybe = _names.find(path.substr(0, separator));
+        if (not nameMaybe.has_value())
+            return std::nullopt;
+
+        auto it = _children.find(childKey(entry, nameMaybe.value()));
+        if (it == _children.end() or it->second.empty())
+            return std::nullopt;
+
+        entry = it->second.front();
+
+        if (separator == std::string_view::npos)
+            return entry;
+
+        path.remove_prefix(separator + 1);
+    }
+}
+
+std::optional<SceneGraphNodePtr> SceneGraphIndex::findNode(const std::string& nameOrPath) const
+{
+    auto entryMaybe = findEntry(nameOrPath);
+    if (not entryMaybe.has_value())
+        return std::nullopt;
+
+    return _entries[entryMaybe.value()].nodePtr;
+}
+
+std::optional<Matrix4f> SceneGraphIndex::findTransform(
+    const std::string& nameOrPath,
+    const Matrix4f& parentTransform) const
+{
+    auto entryMaybe = findEntry(nameOrPath);
+    if (not entryMaybe.has_value())
+        return std::nullopt;
+
+    // Composing the transformations along the path, from the node up to the root
+    EntryIndex entry = entryMaybe.value();
+    Matrix4f transform = _entries[entry].nodePtr->transform;
+    for (entry = _entries[entry].parent; entry != NO_ENTRY; entry = _entries[entry].parent)
+        transform = _entries[entry].nodePtr->transform * transform;
+
+    return parentTransform * transform;
+}
+
+std::optional<Vector4f> SceneGraphIndex::findPosition(
+    const std::string& nameOrPath,
+    const Matrix4f& parentTransform) const
+{
+    auto transformMaybe = findTransform(nameOrPath, parentTransform);
+
+    if (not transformMaybe.has_value())
+        return std::nullopt;
+
+    auto& transform = transformMaybe.value();
+    return transform * Vector4f(0,0,0,1);
+}
+
+bool SceneGraphIndex::addChild(const std::string& parentNameOrPath, SceneGraphNodePtr childPtr)
+{
+    auto parentEntryMaybe = findEntry(parentNameOrPath);
+    if (not parentEntryMaybe.has_value())
+        return false;
+
+    SceneGraphNodePtr parentPtr = _entries[parentEntryMaybe.value()].nodePtr;
+    parentPtr->addChild(childPtr);
+
+    // The parent node may be shared, so the child appears under every path reaching it
+    std::vector<EntryIndex> const parentEntries = _entriesByNode[parentPtr.get()];
+    for (auto parentEntry : parentEntries)
+        indexSubtree(childPtr, parentEntry);
+
+    return true;
+}
+
+bool SceneGraphIndex::removeChild(const std::string& nameOrPath)
+{
+    auto entryMaybe = findEntry(nameOrPath);
+    if (not entryMaybe.has_value() or _entries[entryMaybe.value()].parent == NO_ENTRY)
+        return false;
+
+    Entry const& entry = _entries[entryMaybe.value()];
+    SceneGraphNodePtr childPtr = entry.nodePtr;
+    SceneGraphNodePtr parentPtr = _entries[entry.parent].nodePtr;
+
+    auto& childs = parentPtr->childs;
+    childs.erase(std::find(childs.begin(), childs.end(), childPtr));
+    invalidateBounds(parentPtr);
+
+    // As in addChild, every path through the parent loses the child
+    std::vector<EntryIndex> const parentEntries = _entriesByNode[parentPtr.get()];
+    for (auto parentEntry : parentEntries)
+    {
+        auto const& children = _entries[parentEntry].children;
+        auto childIt = std::find_if(children.begin(), children.end(), [&](EntryIndex child)
+        {
+            return _entries[child].nodePtr == childPtr;
+        });
+
+        if (childIt != children.end())
+            removeEntry(*childIt);
+    }
+
+    return true;
+}
+
+namespace
+{
+    using PendingNames = std::unordered_map<std::string, std::vector<std::size_t>>;
+
+    void findTransformsCore(
+        SceneGraphNodePtr nodePtr,
+        const Matrix4f& parentTransform,
+        PendingNames& pendingNames,
+        std::vector<std::optional<Matrix4f>>& transforms)
+    {
+        Matrix4f newTransform = parentTransform * nodePtr->transform;
+
+        auto it = pendingNames.find(nodePtr->name);
+        if (it != pendingNames.end())
+        {
+            for (auto position : it->second)
+                transforms[position] = newTransform;
+
+            // The first node found in depth first order wins, as findTransform right after a rebuild
+            pendingNames.erase(it);
+        }
+
+        for (const auto& child : nodePtr->childs)
+        {
+            if (pendingNames.empty())
+                return;
+
+            findTransformsCore(child, newTransform, pendingNames, transforms);
+        }
+    }
+}
+
+std::vector<std::optional<Matrix4f>> findTransforms(
+    SceneGraphNodePtr nodePtr,
+    const std::vector<std::string>& names,
+    const Matrix4f& parentTransform)
+{
+    std::vector<std::optional<Matrix4f>> transforms(names.size(), std::nullopt);
+
+    PendingNames pendingNames;
+    for (std::size_t position = 0; position < names.size(); ++position)
+        pendingNames[names[position]].push_back(position);
+
+    findTransformsCore(nodePtr, parentTransform, pendingNames, transforms);
+
+    return transforms;
+}
+
+} // Grafica
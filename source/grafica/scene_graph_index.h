@@ -0,0 +1,120 @@
+/**
+ * @file scene_graph_index.h
+ * @brief SceneGraphIndex finds SceneGraphNodes by name or path with hash lookups instead of depth first searches.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include "scene_graph.h"
+#include "simple_eigen.h"
+#include "transformations.h"
+
+namespace Grafica
+{
+
+using NameId = std::uint32_t;
+
+/** Stores each different string once and identifies it with a small integer */
+class NameTable
+{
+public:
+    NameId intern(const std::string& name);
+
+    std::optional<NameId> find(std::string_view name) const;
+
+    inline const std::string& name(NameId nameId) const { return _names[nameId]; }
+
+private:
+    std::vector<std::string> _names;
+    std::unordered_map<std::string, NameId> _ids;
+};
+
+/** Index over every path of a scene graph.
+ * A path is the sequence of node names from the root, separated by '/', e.g. "car/frontWheel/wheelRotation".
+ * As subtrees can be shared among parents, a single node may be reached through several paths;
+ * paths tell them apart, while a plain name resolves to the path indexed first. Right after rebuild that is
+ * the first one in depth first order; paths added later by addChild come after every path already indexed.
+ * When siblings share a name, a path reaches the first of them, and the next one once it is removed.
+ * The index stays valid as long as the tree is modified through addChild and removeChild,
+ * otherwise rebuild must be called.
+ */
+class SceneGraphIndex
+{
+public:
+    explicit SceneGraphIndex(SceneGraphNodePtr rootPtr);
+
+    /** Indexes the whole tree again */
+    void rebuild();
+
+    std::optional<SceneGraphNodePtr> findNode(const std::string& nameOrPath) const;
+
+    /** World transform of the node, composing the transforms along its path */
+    std::optional<Matrix4f> findTransform(
+        const std::string& nameOrPath,
+        const Matrix4f& parentTransform = Transformations::identity()) const;
+
+    std::optional<Vector4f> findPosition(
+        const std::string& nameOrPath,
+        const Matrix4f& parentTransform = Transformations::identity()) const;
+
+    /** Appends childPtr to the node at parentPath, invalidating its bounds. Returns false if the parent does not exist. */
+    bool addChild(const std::string& parentNameOrPath, SceneGraphNodePtr childPtr);
+
+    /** Detaches the node at path from its parent, invalidating the bounds of the parent.
+     * Returns false if it does not exist or it is the root.
+     */
+    bool removeChild(const std::string& nameOrPath);
+
+    inline const NameTable& names() const { return _names; }
+
+private:
+    using EntryIndex = std::uint32_t;
+    static constexpr EntryIndex NO_ENTRY = ~EntryIndex(0);
+
+    /** A node reached through a specific path */
+    struct Entry
+    {
+        SceneGraphNodePtr nodePtr;
+        EntryIndex parent;
+        NameId name;
+        std::vector<EntryIndex> children;
+    };
+
+    static std::uint64_t childKey(EntryIndex parent, NameId name);
+
+    std::optional<EntryIndex> findEntry(const std::string& nameOrPath) const;
+    void indexSubtree(SceneGraphNodePtr nodePtr, EntryIndex parent);
+    void removeEntry(EntryIndex entry);
+    EntryIndex newEntry(SceneGraphNodePtr nodePtr, EntryIndex parent, NameId name);
+
+    SceneGraphNodePtr _rootPtr;
+    NameTable _names;
+    std::vector<Entry> _entries;
+
+    /* Entries left by removeChild, reused by the next indexed nodes so churn does not grow the index */
+    std::vector<EntryIndex> _freeEntries;
+
+    /* Children of an entry with a given name, in the order they were indexed */
+    std::unordered_map<std::uint64_t, std::vector<EntryIndex>> _children;
+    std::unordered_map<NameId, std::vector<EntryIndex>> _entriesByName;
+    std::unordered_map<const SceneGraphNode*, std::vector<EntryIndex>> _entriesByNode;
+};
+
+/** Resolves the world transforms of many names with a single traversal.
+ * The result has one element per name, std::nullopt for the ones not found.
+ */
+std::vector<std::optional<Matrix4f>> findTransforms(
+    SceneGraphNodePtr nodePtr,
+    const std::vector<std::string>& names,
+    const Matrix4f& parentTransform = Transformations::identity());
+
+} // Grafica
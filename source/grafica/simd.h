@@ -0,0 +1,175 @@
+/**
+ * @file simd.h
+ * @brief Detection of the SIMD instruction sets available at compile time, and common operations to write kernels once for scalars and SSE registers.
+ *        Kernels written with intrinsics must always keep a scalar fallback.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+// SSE2 is always available on x86-64, MSVC does not define __SSE2__ there.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define GRAFICA_USE_SSE2
+    #include <emmintrin.h>
+#endif
+
+// AVX has to be enabled explicitly with the compiler flags (-mavx, /arch:AVX)
+#if defined(__AVX__)
+    #define GRAFICA_USE_AVX
+    #include <immintrin.h>
+#endif
+
+#include <cmath>
+#include <ciso646>
+
+namespace Grafica
+{
+namespace Simd
+{
+
+/* The same kernel can be written once as a template over float and __m128,
+ * with these functions as the common operations. */
+
+inline float add(float a, float b) { return a + b; }
+inline float sub(float a, float b) { return a - b; }
+inline float mul(float a, float b) { return a * b; }
+inline float div(float a, float b) { return a / b; }
+inline float neg(float a) { return -a; }
+inline float abs(float a) { return std::abs(a); }
+inline float sqrt(float a) { return std::sqrt(a); }
+inline float splat(float, float value) { return value; }
+
+/** a with its sign flipped where sign is negative */
+inline float flipSign(float a, float sign) { return std::signbit(sign) ? -a : a; }
+
+#if defined(GRAFICA_USE_SSE2)
+inline __m128 add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+inline __m128 sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+inline __m128 mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+inline __m128 div(__m128 a, __m128 b) { return _mm_div_ps(a, b); }
+inline __m128 neg(__m128 a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+inline __m128 abs(__m128 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline __m128 sqrt(__m128 a) { return _mm_sqrt_ps(a); }
+inline __m128 splat(__m128, float value) { return _mm_set1_ps(value); }
+inline __m128 flipSign(__m128 a, __m128 sign) { return _mm_xor_ps(a, _mm_and_ps(sign, _mm_set1_ps(-0.0f))); }
+#endif
+
+/** Eight floats in one AVX register, two SSE registers or an array, whichever the build allows.
+ * Kernels working on rows of 8 pixels are written once with it.
+ */
+struct Float8
+{
+#if defined(GRAFICA_USE_AVX)
+    __m256 v;
+#elif defined(GRAFICA_USE_SSE2)
+    __m128 low, high;
+#else
+    float v[8];
+#endif
+};
+
+/** Result of comparing Float8, one boolean per lane. bits(mask) has lane i in bit i. */
+struct Mask8
+{
+#if defined(GRAFICA_USE_AVX)
+    __m256 v;
+#elif defined(GRAFICA_USE_SSE2)
+    __m128 low, high;
+#else
+    bool v[8];
+#endif
+};
+
+#if defined(GRAFICA_USE_AVX)
+inline Float8 splat8(float value) { return {_mm256_set1_ps(value)}; }
+inline Float8 ramp8(float first) { return {_mm256_add_ps(_mm256_set1_ps(first), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7))}; }
+inline Float8 load8(const float* data) { return {_mm256_loadu_ps(data)}; }
+inline void store8(float* data, Float8 a) { _mm256_storeu_ps(data, a.v); }
+inline Float8 add(Float8 a, Float8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline Float8 sub(Float8 a, Float8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline Float8 mul(Float8 a, Float8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline Float8 min(Float8 a, Float8 b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline Float8 max(Float8 a, Float8 b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline Mask8 greaterEqual(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)}; }
+inline Mask8 less(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+inline Mask8 logicalAnd(Mask8 a, Mask8 b) { return {_mm256_and_ps(a.v, b.v)}; }
+inline Float8 select(Mask8 mask, Float8 ifTrue, Float8 ifFalse) { return {_mm256_blendv_ps(ifFalse.v, ifTrue.v, mask.v)}; }
+inline bool any(Mask8 mask) { return _mm256_movemask_ps(mask.v) != 0; }
+inline unsigned int bits(Mask8 mask) { return static_cast<unsigned int>(_mm256_movemask_ps(mask.v)); }
+#elif defined(GRAFICA_USE_SSE2)
+inline Float8 splat8(float value) { return {_mm_set1_ps(value), _mm_set1_ps(value)}; }
+inline Float8 ramp8(float first)
+{
+    __m128 const start = _mm_set1_ps(first);
+    return {_mm_add_ps(start, _mm_setr_ps(0, 1, 2, 3)), _mm_add_ps(start, _mm_setr_ps(4, 5, 6, 7))};
+}
+inline Float8 load8(const float* data) { return {_mm_loadu_ps(data), _mm_loadu_ps(data + 4)}; }
+inline void store8(float* data, Float8 a) { _mm_storeu_ps(data, a.low); _mm_storeu_ps(data + 4, a.high); }
+inline Float8 add(Float8 a, Float8 b) { return {_mm_add_ps(a.low, b.low), _mm_add_ps(a.high, b.high)}; }
+inline Float8 sub(Float8 a, Float8 b) { return {_mm_sub_ps(a.low, b.low), _mm_sub_ps(a.high, b.high)}; }
+inline Float8 mul(Float8 a, Float8 b) { return {_mm_mul_ps(a.low, b.low), _mm_mul_ps(a.high, b.high)}; }
+inline Float8 min(Float8 a, Float8 b) { return {_mm_min_ps(a.low, b.low), _mm_min_ps(a.high, b.high)}; }
+inline Float8 max(Float8 a, Float8 b) { return {_mm_max_ps(a.low, b.low), _mm_max_ps(a.high, b.high)}; }
+inline Mask8 greaterEqual(Float8 a, Float8 b) { return {_mm_cmpge_ps(a.low, b.low), _mm_cmpge_ps(a.high, b.high)}; }
+inline Mask8 less(Float8 a, Float8 b) { return {_mm_cmplt_ps(a.low, b.low), _mm_cmplt_ps(a.high, b.high)}; }
+inline Mask8 logicalAnd(Mask8 a, Mask8 b) { return {_mm_and_ps(a.low, b.low), _mm_and_ps(a.high, b.high)}; }
+inline Float8 select(Mask8 mask, Float8 ifTrue, Float8 ifFalse)
+{
+    return {
+        _mm_or_ps(_mm_and_ps(mask.low, ifTrue.low), _mm_andnot_ps(mask.low, ifFalse.low)),
+        _mm_or_ps(_mm_and_ps(mask.high, ifTrue.high), _mm_andnot_ps(mask.high, ifFalse.high))};
+}
+inline bool any(Mask8 mask) { return _mm_movemask_ps(_mm_or_ps(mask.low, mask.high)) != 0; }
+inline unsigned int bits(Mask8 mask) { return static_cast<unsigned int>(_mm_movemask_ps(mask.low) | (_mm_movemask_ps(mask.high) << 4)); }
+#else
+template <typename Function>
+inline Float8 lanes8(Function function)
+{
+    Float8 result;
+    for (unsigned int lane = 0; lane < 8; ++lane)
+        result.v[lane] = function(lane);
+    return result;
+}
+
+template <typename Function>
+inline Mask8 maskLanes8(Function function)
+{
+    Mask8 result;
+    for (unsigned int lane = 0; lane < 8; ++lane)
+        result.v[lane] = function(lane);
+    return result;
+}
+
+inline Float8 splat8(float value) { return lanes8([&](unsigned int) { return value; }); }
+inline Float8 ramp8(float first) { return lanes8([&](unsigned int lane) { return first + lane; }); }
+inline Float8 load8(const float* data) { return lanes8([&](unsigned int lane) { return data[lane]; }); }
+inline void store8(float* data, Float8 a) { for (unsigned int lane = 0; lane < 8; ++lane) data[lane] = a.v[lane]; }
+inline Float8 add(Float8 a, Float8 b) { return lanes8([&](unsigned int lane) { return a.v[lane] + b.v[lane]; }); }
+inline Float8 sub(Float8 a, Float8 b) { return lanes8([&](unsigned int lane) { return a.v[lane] - b.v[lane]; }); }
+inline Float8 mul(Float8 a, Float8 b) { return lanes8([&](unsigned int lane) { return a.v[lane] * b.v[lane]; }); }
+inline Float8 min(Float8 a, Float8 b) { return lanes8([&](unsigned int lane) { return a.v[lane] < b.v[lane] ? a.v[lane] : b.v[lane]; }); }
+inline Float8 max(Float8 a, Float8 b) { return lanes8([&](unsigned int lane) { return a.v[lane] > b.v[lane] ? a.v[lane] : b.v[lane]; }); }
+inline Mask8 greaterEqual(Float8 a, Float8 b) { return maskLanes8([&](unsigned int lane) { return a.v[lane] >= b.v[lane]; }); }
+inline Mask8 less(Float8 a, Float8 b) { return maskLanes8([&](unsigned int lane) { return a.v[lane] < b.v[lane]; }); }
+inline Mask8 logicalAnd(Mask8 a, Mask8 b) { return maskLanes8([&](unsigned int lane) { return a.v[lane] and b.v[lane]; }); }
+inline Float8 select(Mask8 mask, Float8 ifTrue, Float8 ifFalse) { return lanes8([&](unsigned int lane) { return mask.v[lane] ? ifTrue.v[lane] : ifFalse.v[lane]; }); }
+inline bool any(Mask8 mask)
+{
+    for (unsigned int lane = 0; lane < 8; ++lane)
+        if (mask.v[lane])
+            return true;
+    return false;
+}
+inline unsigned int bits(Mask8 mask)
+{
+    unsigned int result = 0;
+    for (unsigned int lane = 0; lane < 8; ++lane)
+        result |= mask.v[lane] ? 1u << lane : 0u;
+    return result;
+}
+#endif
+
+} // Simd
+} // Grafica
@@ -0,0 +1,242 @@
+/**
+ * @file skinned_model.cpp
+ * @brief Loading skinned meshes, their skeleton and their animations from files, through assimp.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "skinned_model.h"
+
+#include <string>
+#include <utility>
+#include <iostream>
+#include <unordered_map>
+#include <ciso646>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+namespace Grafica
+{
+
+namespace
+{
+    Matrix4f toMatrix4f(const aiMatrix4x4& matrix)
+    {
+        Matrix4f result;
+        for (unsigned int row = 0; row < 4; ++row)
+            for (unsigned int column = 0; column < 4; ++column)
+                result(row, column) = matrix[row][column];
+
+        return result;
+    }
+
+    Vector3f toVector3f(const aiVector3D& vector)
+    {
+        return Vector3f(vector.x, vector.y, vector.z);
+    }
+
+    Quaternion toQuaternion(const aiQuaternion& quaternion)
+    {
+        return {quaternion.w, quaternion.x, quaternion.y, quaternion.z};
+    }
+
+    TransformTRS toTransformTRS(const aiMatrix4x4& matrix)
+    {
+        aiVector3D scaling, position;
+        aiQuaternion rotation;
+        matrix.Decompose(scaling, rotation, position);
+
+        return {toVector3f(position), toQuaternion(rotation), toVector3f(scaling)};
+    }
+
+    class SkinnedModelBuilder
+    {
+    public:
+        SkinnedModelBuilder(const aiScene& scene, SkinnedModel& model):
+            _scene(scene),
+            _model(model)
+        {
+            // Inverse bind matrices are known from the meshes, while the hierarchy comes from the nodes
+            for (unsigned int mesh = 0; mesh < scene.mNumMeshes; ++mesh)
+            {
+                const aiMesh& aiMesh = *scene.mMeshes[mesh];
+                for (unsigned int bone = 0; bone < aiMesh.mNumBones; ++bone)
+                {
+                    const aiBone& aiBone = *aiMesh.mBones[bone];
+                    _inverseBindMatrices.try_emplace(aiBone.mName.C_Str(), toMatrix4f(aiBone.mOffsetMatrix));
+                }
+            }
+        }
+
+        void addNode(const aiNode& node, BoneIndex parent)
+        {
+            std::string const name = node.mName.C_Str();
+            auto const inverseBind = _inverseBindMatrices.find(name);
+
+            BoneIndex const bone = _model.skeleton.addBone(
+                name,
+                parent,
+                inverseBind != _inverseBindMatrices.end() ? inverseBind->second : Matrix4f::Identity(),
+                toTransformTRS(node.mTransformation));
+            _bonesByName.try_emplace(name, bone);
+
+            for (unsigned int child = 0; child < node.mNumChildren; ++child)
+                addNode(*node.mChildren[child], bone);
+
+            for (unsigned int mesh = 0; mesh < node.mNumMeshes; ++mesh)
+                _meshNodes.push_back({node.mMeshes[mesh], bone});
+        }
+
+        /** Once every node is added, as the bones of a mesh can be anywhere in the hierarchy */
+        void addMeshes()
+        {
+            for (auto const& [mesh, node] : _meshNodes)
+                addMesh(*_scene.mMeshes[mesh], node);
+        }
+
+    private:
+        void addMesh(const aiMesh& mesh, BoneIndex node)
+        {
+            Shape& shape = _model.skinnedShape.shape;
+            auto& influences = _model.skinnedShape.influences;
+            Index const firstVertex = static_cast<Index>(influences.size());
+
+            aiColor4D diffuse(1, 1, 1, 1);
+            if (mesh.mMaterialIndex < _scene.mNumMaterials)
+                _scene.mMaterials[mesh.mMaterialIndex]->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse);
+
+            for (unsigned int vertex = 0; vertex < mesh.mNumVertices; ++vertex)
+            {
+                aiVector3D const& position = mesh.mVertices[vertex];
+                aiColor4D const color = mesh.HasVertexColors(0) ? mesh.mColors[0][vertex] : diffuse;
+                aiVector3D const normal = mesh.HasNormals() ? mesh.mNormals[vertex] : aiVector3D(0, 0, 1);
+
+                shape.vertices.insert(shape.vertices.end(), {
+                    position.x, position.y, position.z,
+                    color.r, color.g, color.b,
+                    normal.x, normal.y, normal.z});
+            }
+
+            // Gathering the weights per vertex, they are stored per bone
+            std::vector<std::vector<BoneWeight>> weights(mesh.mNumVertices);
+            for (unsigned int bone = 0; bone < mesh.mNumBones; ++bone)
+            {
+                const aiBone& aiBone = *mesh.mBones[bone];
+                BoneIndex const skeletonBone = _bonesByName.at(aiBone.mName.C_Str());
+
+                for (unsigned int weight = 0; weight < aiBone.mNumWeights; ++weight)
+                {
+                    aiVertexWeight const& vertexWeight = aiBone.mWeights[weight];
+                    weights[vertexWeight.mVertexId].push_back({skeletonBone, vertexWeight.mWeight});
+                }
+            }
+
+            for (auto& vertexWeights : weights)
+            {
+                // A rigid mesh moves with its node
+                if (mesh.mNumBones == 0)
+                    vertexWeights.push_back({node, 1.0f});
+
+                for (auto const& boneWeight : vertexWeights)
+                {
+                    if (boneWeight.bone >= MAX_SKIN_BONES)
+                    {
+                        std::cout << "ERROR::SKINNED_MODEL::TOO_MANY_BONES " << _model.skeleton.name(boneWeight.bone) << std::endl;
+                        throw;
+                    }
+                }
+
+                influences.push_back(packInfluences(std::move(vertexWeights)));
+            }
+
+            for (unsigned int face = 0; face < mesh.mNumFaces; ++face)
+            {
+                const aiFace& aiFace = mesh.mFaces[face];
+                for (unsigned int index = 0; index < aiFace.mNumIndices; ++index)
+                    shape.indices.push_back(firstVertex + aiFace.mIndices[index]);
+            }
+        }
+
+        const aiScene& _scene;
+        SkinnedModel& _model;
+        std::unordered_map<std::string, Matrix4f> _inverseBindMatrices;
+        std::unordered_map<std::string, BoneIndex> _bonesByName;
+        std::vector<std::pair<unsigned int, BoneIndex>> _meshNodes;
+    };
+
+    AnimationClip toAnimationClip(const aiAnimation& animation)
+    {
+        AnimationClip clip(animation.mName.C_Str());
+
+        // Files without the rate are usually at 25 ticks per second
+        double const ticksPerSecond = animation.mTicksPerSecond != 0 ? animation.mTicksPerSecond : 25.0;
+
+        for (unsigned int channel = 0; channel < animation.mNumChannels; ++channel)
+        {
+            const aiNodeAnim& nodeAnimation = *animation.mChannels[channel];
+            ChannelIndex const channelIndex = clip.addChannel(nodeAnimation.mNodeName.C_Str());
+
+            std::vector<float> times;
+            std::vector<Vector3f> vectors;
+            std::vector<Quaternion> rotations;
+
+            for (unsigned int key = 0; key < nodeAnimation.mNumPositionKeys; ++key)
+            {
+                times.push_back(static_cast<float>(nodeAnimation.mPositionKeys[key].mTime / ticksPerSecond));
+                vectors.push_back(toVector3f(nodeAnimation.mPositionKeys[key].mValue));
+            }
+            clip.setTranslationKeys(channelIndex, times, vectors);
+
+            times.clear();
+            for (unsigned int key = 0; key < nodeAnimation.mNumRotationKeys; ++key)
+            {
+                times.push_back(static_cast<float>(nodeAnimation.mRotationKeys[key].mTime / ticksPerSecond));
+                rotations.push_back(toQuaternion(nodeAnimation.mRotationKeys[key].mValue));
+            }
+            clip.setRotationKeys(channelIndex, times, rotations);
+
+            times.clear();
+            vectors.clear();
+            for (unsigned int key = 0; key < nodeAnimation.mNumScalingKeys; ++key)
+            {
+                times.push_back(static_cast<float>(nodeAnimation.mScalingKeys[key].mTime / ticksPerSecond));
+                vectors.push_back(toVector3f(nodeAnimation.mScalingKeys[key].mValue));
+            }
+            clip.setScaleKeys(channelIndex, times, vectors);
+        }
+
+        return clip;
+    }
+}
+
+SkinnedModel loadSkinnedModel(const std::filesystem::path& path)
+{
+    Assimp::Importer importer;
+
+    // At most 4 weights per vertex is also the default of aiProcess_LimitBoneWeights
+    const aiScene* scene = importer.ReadFile(path.string(),
+        aiProcess_Triangulate |
+        aiProcess_GenSmoothNormals |
+        aiProcess_JoinIdenticalVertices |
+        aiProcess_LimitBoneWeights);
+
+    if (scene == nullptr or scene->mRootNode == nullptr)
+    {
+        std::cout << "ERROR::SKINNED_MODEL::LOADING_FAILED " << path << ": " << importer.GetErrorString() << std::endl;
+        throw;
+    }
+
+    SkinnedModel model;
+    SkinnedModelBuilder builder(*scene, model);
+    builder.addNode(*scene->mRootNode, NO_BONE);
+    builder.addMeshes();
+
+    for (unsigned int animation = 0; animation < scene->mNumAnimations; ++animation)
+        model.clips.push_back(toAnimationClip(*scene->mAnimations[animation]));
+
+    return model;
+}
+
+} // Grafica
@@ -0,0 +1,34 @@
+/**
+ * @file skinned_model.h
+ * @brief Loading skinned meshes, their skeleton and their animations from files, through assimp.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <vector>
+#include <filesystem>
+#include "animation.h"
+#include "skinning.h"
+
+namespace Grafica
+{
+
+struct SkinnedModel
+{
+    SkinnedShape skinnedShape;
+    Skeleton skeleton;
+    std::vector<AnimationClip> clips;
+};
+
+/** Loads every mesh in the file merged into a single skinned shape, colored with the vertex colors or else
+ * the diffuse color of its material.
+ * Every node of the scene becomes a bone, so animated nodes that are not bones of a mesh still move their children.
+ * Meshes without bones follow the node that holds them. Animation times are converted to seconds.
+ * Bones used by the meshes must be among the first MAX_SKIN_BONES nodes, in depth first order.
+ */
+SkinnedModel loadSkinnedModel(const std::filesystem::path& path);
+
+} // Grafica
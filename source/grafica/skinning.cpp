@@ -0,0 +1,466 @@
+/**
+ * @file skinning.cpp
+ * @brief Skeletal animation: a bone hierarchy with inverse bind matrices, meshes with up to 4 bone influences
+ *        per vertex, a Phong pipeline skinning in the vertex shader, and a multithreaded SIMD CPU fallback.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "skinning.h"
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <ciso646>
+#include "load_shaders.h"
+#include "simd.h"
+#include "stream_buffer.h"
+
+namespace Grafica
+{
+
+BoneIndex Skeleton::addBone(
+    const std::string& name,
+    BoneIndex parent,
+    const Matrix4f& inverseBindMatrix,
+    const TransformTRS& restPose)
+{
+    assert(parent == NO_BONE or parent < size());
+
+    _names.push_back(name);
+    _parents.push_back(parent);
+    _inverseBindMatrices.push_back(AlignedMatrix4f::fromMatrix4f(inverseBindMatrix));
+    _restPose.push_back(restPose);
+
+    return static_cast<BoneIndex>(_names.size() - 1);
+}
+
+BoneIndex Skeleton::findBone(const std::string& name) const
+{
+    auto const it = std::find(_names.begin(), _names.end(), name);
+    return it == _names.end() ? NO_BONE : static_cast<BoneIndex>(it - _names.begin());
+}
+
+void Skeleton::computeSkinningMatrices(const std::vector<TransformTRS>& pose, AlignedMatrix4f* skinningMatrices) const
+{
+    assert(pose.size() >= size());
+
+    // Global transforms first, parents are always computed before their children
+    for (BoneIndex bone = 0; bone < size(); ++bone)
+    {
+        AlignedMatrix4f const local = AlignedMatrix4f::fromMatrix4f(pose[bone].toMatrix4f());
+        if (_parents[bone] == NO_BONE)
+            skinningMatrices[bone] = local;
+        else
+            multiply(skinningMatrices[_parents[bone]], local, skinningMatrices[bone]);
+    }
+
+    // Then in place, as no global transform is needed anymore
+    multiplyBatch(skinningMatrices, _inverseBindMatrices.data(), skinningMatrices, size());
+}
+
+void Skeleton::computeSkinningMatrices(const std::vector<TransformTRS>& pose, AlignedMatrix4fArray& skinningMatrices) const
+{
+    skinningMatrices.resize(size());
+    computeSkinningMatrices(pose, skinningMatrices.data());
+}
+
+Animator Skeleton::createAnimator() const
+{
+    Animator animator(_names);
+    for (BoneIndex bone = 0; bone < size(); ++bone)
+        animator.setRestPose(bone, _restPose[bone]);
+
+    return animator;
+}
+
+VertexInfluences packInfluences(std::vector<BoneWeight> weights)
+{
+    VertexInfluences influences;
+
+    std::sort(weights.begin(), weights.end(), [](const BoneWeight& lhs, const BoneWeight& rhs)
+    {
+        return lhs.weight > rhs.weight;
+    });
+
+    std::size_t const count = std::min<std::size_t>(weights.size(), MAX_BONE_INFLUENCES);
+    float total = 0;
+    for (std::size_t i = 0; i < count; ++i)
+        total += std::max(weights[i].weight, 0.0f);
+
+    // A vertex without weights follows the first bone
+    if (total <= 0)
+    {
+        influences.weights[0] = 255;
+        return influences;
+    }
+
+    int quantizedTotal = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        assert(weights[i].bone < MAX_SKIN_BONES);
+        influences.bones[i] = static_cast<std::uint8_t>(weights[i].bone);
+        influences.weights[i] = static_cast<std::uint8_t>(std::lround(255 * std::max(weights[i].weight, 0.0f) / total));
+        quantizedTotal += influences.weights[i];
+    }
+
+    // Rounding may be off by a few units, the largest weight absorbs them
+    influences.weights[0] = static_cast<std::uint8_t>(influences.weights[0] + 255 - quantizedTotal);
+
+    return influences;
+}
+
+void SkinnedGPUShape::initBuffers()
+{
+    GPUShape::initBuffers();
+    glGenBuffers(1, &influencesVbo);
+}
+
+void SkinnedGPUShape::fillBuffers(const SkinnedShape& skinnedShape, GLuint usage)
+{
+    assert(skinnedShape.shape.vertices.size() == skinnedShape.shape.stride * skinnedShape.influences.size());
+
+    GPUShape::fillBuffers(skinnedShape.shape, usage);
+
+    glBindBuffer(GL_ARRAY_BUFFER, influencesVbo);
+    glBufferData(GL_ARRAY_BUFFER, skinnedShape.influences.size() * sizeof(VertexInfluences), skinnedShape.influences.data(), usage);
+}
+
+void SkinnedGPUShape::clear()
+{
+    GPUShape::clear();
+    glDeleteBuffers(1, &influencesVbo);
+}
+
+BoneMatrixBuffer::BoneMatrixBuffer()
+{
+    glGenBuffers(1, &_buffer);
+    glGenTextures(1, &_texture);
+
+    // Empty buffers are not valid texture buffers
+    AlignedMatrix4f const identity = AlignedMatrix4f::identity();
+    update(&identity, 1);
+}
+
+void BoneMatrixBuffer::update(const AlignedMatrix4f* matrices, std::size_t count)
+{
+    _size = count;
+
+    glBindBuffer(GL_TEXTURE_BUFFER, _buffer);
+    glBufferData(GL_TEXTURE_BUFFER, count * sizeof(AlignedMatrix4f), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, count * sizeof(AlignedMatrix4f), matrices);
+    glBindTexture(GL_TEXTURE_BUFFER, _texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, _buffer);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void BoneMatrixBuffer::update(const AlignedMatrix4fArray& matrices)
+{
+    if (matrices.empty())
+    {
+        AlignedMatrix4f const identity = AlignedMatrix4f::identity();
+        update(&identity, 1);
+        return;
+    }
+
+    update(matrices.data(), matrices.size());
+}
+
+void BoneMatrixBuffer::bind(GLuint shaderProgram, GLuint textureUnit, GLint boneOffset) const
+{
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, _texture);
+    glUniform1i(glGetUniformLocation(shaderProgram, "boneMatrices"), textureUnit);
+    glUniform1i(glGetUniformLocation(shaderProgram, "boneOffset"), boneOffset);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void BoneMatrixBuffer::clear()
+{
+    glDeleteTextures(1, &_texture);
+    glDeleteBuffers(1, &_buffer);
+}
+
+void PositionColorNormalSkinVAO::setupVAO(SkinnedGPUShape& gpuShape) const
+{
+    // Binding VAO to setup
+    glBindVertexArray(gpuShape.vao);
+
+    // Binding buffers to the current VAO
+    glBindBuffer(GL_ARRAY_BUFFER, gpuShape.vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuShape.ebo);
+
+    // position attribute
+    auto position = glGetAttribLocation(shaderProgram, "position");
+    glVertexAttribPointer(position, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (void*)0);
+    glEnableVertexAttribArray(position);
+
+    // color attribute
+    auto color = glGetAttribLocation(shaderProgram, "color");
+    glVertexAttribPointer(color, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(color);
+
+    // normal attribute
+    auto normal = glGetAttribLocation(shaderProgram, "normal");
+    glVertexAttribPointer(normal, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(normal);
+
+    // bone indices stay integers, weights are bytes normalized to [0, 1]
+    glBindBuffer(GL_ARRAY_BUFFER, gpuShape.influencesVbo);
+
+    auto boneIndices = glGetAttribLocation(shaderProgram, "boneIndices");
+    glVertexAttribIPointer(boneIndices, 4, GL_UNSIGNED_BYTE, sizeof(VertexInfluences), (void*)0);
+    glEnableVertexAttribArray(boneIndices);
+
+    auto boneWeights = glGetAttribLocation(shaderProgram, "boneWeights");
+    glVertexAttribPointer(boneWeights, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(VertexInfluences), (void*)MAX_BONE_INFLUENCES);
+    glEnableVertexAttribArray(boneWeights);
+
+    // Unbinding current VAO
+    glBindVertexArray(0);
+}
+
+void PositionColorNormalSkinVAO::drawCall(const SkinnedGPUShape& gpuShape, GLuint mode) const
+{
+    // Binding the VAO
+    glBindVertexArray(gpuShape.vao);
+
+    // Executing the draw call
+    glDrawElements(mode, gpuShape.size, GL_UNSIGNED_INT, nullptr);
+
+    // Unbind the current VAO
+    glBindVertexArray(0);
+}
+
+PhongColorSkinnedShaderProgram::PhongColorSkinnedShaderProgram()
+{
+    const std::string vertexShaderCode = R"(
+        #version 330 core
+
+        layout (location = 0) in vec3 position;
+        layout (location = 1) in vec3 color;
+        layout (location = 2) in vec3 normal;
+        layout (location = 3) in uvec4 boneIndices;
+        layout (location = 4) in vec4 boneWeights;
+        out vec3 fragPosition;
+        out vec3 fragOriginalColor;
+        out vec3 fragNormal;
+        uniform mat4 model;
+        uniform mat4 view;
+        uniform mat4 projection;
+
+        // 4 texels per bone, its columns
+        uniform samplerBuffer boneMatrices;
+        uniform int boneOffset;
+
+        mat4 boneMatrix(uint bone)
+        {
+            int first = 4 * (boneOffset + int(bone));
+            return mat4(
+                texelFetch(boneMatrices, first),
+                texelFetch(boneMatrices, first + 1),
+                texelFetch(boneMatrices, first + 2),
+                texelFetch(boneMatrices, first + 3));
+        }
+
+        void main()
+        {
+            mat4 skin = boneWeights.x * boneMatrix(boneIndices.x)
+                + boneWeights.y * boneMatrix(boneIndices.y)
+                + boneWeights.z * boneMatrix(boneIndices.z)
+                + boneWeights.w * boneMatrix(boneIndices.w);
+
+            vec4 skinnedPosition = skin * vec4(position, 1.0);
+            vec3 skinnedNormal = mat3(skin) * normal;
+
+            fragPosition = vec3(model * skinnedPosition);
+            fragOriginalColor = color;
+            fragNormal = mat3(transpose(inverse(model))) * skinnedNormal;
+            gl_Position = projection * view * vec4(fragPosition, 1.0);
+        }
+    )";
+
+    const std::string fragmentShaderCode = R"(
+        #version 330 core
+
+        out vec4 fragColor;
+
+        in vec3 fragNormal;
+        in vec3 fragPosition;
+        in vec3 fragOriginalColor;
+
+        uniform vec3 lightPosition;
+        uniform vec3 viewPosition;
+        uniform vec3 La;
+        uniform vec3 Ld;
+        uniform vec3 Ls;
+        uniform vec3 Ka;
+        uniform vec3 Kd;
+        uniform vec3 Ks;
+        uniform uint shininess;
+        uniform float constantAttenuation;
+        uniform float linearAttenuation;
+        uniform float quadraticAttenuation;
+
+        void main()
+        {
+            // ambient
+            vec3 ambient = Ka * La;
+
+            // diffuse
+            vec3 normalizedNormal = normalize(fragNormal);
+            vec3 toLight = lightPosition - fragPosition;
+            vec3 lightDir = normalize(toLight);
+            float diff = max(dot(normalizedNormal, lightDir), 0.0);
+            vec3 diffuse = Kd * Ld * diff;
+
+            // specular
+            vec3 viewDir = normalize(viewPosition - fragPosition);
+            vec3 reflectDir = reflect(-lightDir, normalizedNormal);
+            float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+            vec3 specular = Ks * Ls * spec;
+
+            // attenuation
+            float distToLight = length(toLight);
+            float attenuation = constantAttenuation
+                + linearAttenuation * distToLight
+                + quadraticAttenuation * distToLight * distToLight;
+
+            vec3 result = (ambient + ((diffuse + specular) / attenuation)) * fragOriginalColor;
+            fragColor = vec4(result, 1.0);
+        }
+    )";
+
+    shaderProgram = createShaderProgramFromCode({
+        {GL_VERTEX_SHADER, vertexShaderCode.c_str()},
+        {GL_FRAGMENT_SHADER, fragmentShaderCode.c_str()}
+    });
+}
+
+namespace
+{
+    constexpr std::size_t SKINNED_VERTEX_STRIDE = 9;
+    constexpr std::size_t VERTICES_PER_TASK = 1024;
+    constexpr float WEIGHT_SCALE = 1.0f / 255;
+
+    void skinVertexRange(
+        const SkinnedShape& skinnedShape,
+        const AlignedMatrix4f* skinningMatrices,
+        float* vertices,
+        std::size_t begin,
+        std::size_t end)
+    {
+        const float* bindVertices = skinnedShape.shape.vertices.data();
+
+        for (std::size_t vertex = begin; vertex < end; ++vertex)
+        {
+            VertexInfluences const& influences = skinnedShape.influences[vertex];
+            const float* source = bindVertices + SKINNED_VERTEX_STRIDE * vertex;
+            float* destination = vertices + SKINNED_VERTEX_STRIDE * vertex;
+
+            alignas(16) float position[4];
+            alignas(16) float normal[4];
+
+#if defined(GRAFICA_USE_SSE2)
+            // Blending the columns of the bone matrices, then transforming with the blended one
+            __m128 column0 = _mm_setzero_ps();
+            __m128 column1 = _mm_setzero_ps();
+            __m128 column2 = _mm_setzero_ps();
+            __m128 column3 = _mm_setzero_ps();
+
+            for (unsigned int i = 0; i < MAX_BONE_INFLUENCES; ++i)
+            {
+                if (influences.weights[i] == 0)
+                    continue;
+
+                __m128 const weight = _mm_set1_ps(influences.weights[i] * WEIGHT_SCALE);
+                const float* bone = skinningMatrices[influences.bones[i]].data;
+                column0 = _mm_add_ps(column0, _mm_mul_ps(weight, _mm_load_ps(bone + 0)));
+                column1 = _mm_add_ps(column1, _mm_mul_ps(weight, _mm_load_ps(bone + 4)));
+                column2 = _mm_add_ps(column2, _mm_mul_ps(weight, _mm_load_ps(bone + 8)));
+                column3 = _mm_add_ps(column3, _mm_mul_ps(weight, _mm_load_ps(bone + 12)));
+            }
+
+            __m128 const linear =
+                _mm_add_ps(
+                    _mm_add_ps(
+                        _mm_mul_ps(column0, _mm_set1_ps(source[0])),
+                        _mm_mul_ps(column1, _mm_set1_ps(source[1]))),
+                    _mm_mul_ps(column2, _mm_set1_ps(source[2])));
+            _mm_store_ps(position, _mm_add_ps(linear, column3));
+
+            _mm_store_ps(normal,
+                _mm_add_ps(
+                    _mm_add_ps(
+                        _mm_mul_ps(column0, _mm_set1_ps(source[6])),
+                        _mm_mul_ps(column1, _mm_set1_ps(source[7]))),
+                    _mm_mul_ps(column2, _mm_set1_ps(source[8]))));
+#else
+            float blended[16] = {};
+            for (unsigned int i = 0; i < MAX_BONE_INFLUENCES; ++i)
+            {
+                if (influences.weights[i] == 0)
+                    continue;
+
+                float const weight = influences.weights[i] * WEIGHT_SCALE;
+                const float* bone = skinningMatrices[influences.bones[i]].data;
+                for (unsigned int element = 0; element < 16; ++element)
+                    blended[element] += weight * bone[element];
+            }
+
+            for (unsigned int row = 0; row < 3; ++row)
+            {
+                position[row] = blended[row] * source[0] + blended[4 + row] * source[1] + blended[8 + row] * source[2] + blended[12 + row];
+                normal[row] = blended[row] * source[6] + blended[4 + row] * source[7] + blended[8 + row] * source[8];
+            }
+#endif
+
+            // Written in order, as the destination may be write combined memory of a mapped buffer
+            destination[0] = position[0];
+            destination[1] = position[1];
+            destination[2] = position[2];
+            destination[3] = source[3];
+            destination[4] = source[4];
+            destination[5] = source[5];
+            destination[6] = normal[0];
+            destination[7] = normal[1];
+            destination[8] = normal[2];
+        }
+    }
+}
+
+void skinVertices(
+    const SkinnedShape& skinnedShape,
+    const AlignedMatrix4f* skinningMatrices,
+    float* vertices,
+    ThreadPool& threadPool)
+{
+    assert(skinnedShape.shape.stride == SKINNED_VERTEX_STRIDE);
+    assert(skinnedShape.shape.vertices.size() == SKINNED_VERTEX_STRIDE * skinnedShape.influences.size());
+
+    threadPool.parallelFor(0, skinnedShape.influences.size(), VERTICES_PER_TASK,
+        [&](std::size_t begin, std::size_t end)
+    {
+        skinVertexRange(skinnedShape, skinningMatrices, vertices, begin, end);
+    });
+}
+
+void updateSkinnedGPUShape(
+    GPUShape& gpuShape,
+    const SkinnedShape& skinnedShape,
+    const AlignedMatrix4f* skinningMatrices,
+    ThreadPool& threadPool)
+{
+    std::size_t const bytes = skinnedShape.shape.vertices.size() * SIZE_IN_BYTES;
+
+    glBindBuffer(GL_ARRAY_BUFFER, gpuShape.vbo);
+    streamBufferData(GL_ARRAY_BUFFER, bytes, bytes, [&](void* vertices)
+    {
+        skinVertices(skinnedShape, skinningMatrices, static_cast<float*>(vertices), threadPool);
+    });
+}
+
+} // Grafica
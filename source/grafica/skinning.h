@@ -0,0 +1,204 @@
+/**
+ * @file skinning.h
+ * @brief Skeletal animation: a bone hierarchy with inverse bind matrices, meshes with up to 4 bone influences
+ *        per vertex, a Phong pipeline skinning in the vertex shader, and a multithreaded SIMD CPU fallback.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <limits>
+#include <glad/glad.h>
+#include "animation.h"
+#include "gpu_shape.h"
+#include "matrix_batch.h"
+#include "shape.h"
+#include "simple_eigen.h"
+#include "thread_pool.h"
+
+namespace Grafica
+{
+
+using BoneIndex = std::uint32_t;
+
+constexpr BoneIndex NO_BONE = std::numeric_limits<BoneIndex>::max();
+
+constexpr unsigned int MAX_BONE_INFLUENCES = 4;
+
+/** Bones a vertex can reference, as its bone indices are stored in a byte */
+constexpr std::size_t MAX_SKIN_BONES = 256;
+
+/** Bone hierarchy, stored as flat arrays with parents before their children */
+class Skeleton
+{
+public:
+    /** parent must be an already added bone, or NO_BONE for a root.
+     * inverseBindMatrix takes mesh coordinates to the space of the bone in the bind pose.
+     */
+    BoneIndex addBone(
+        const std::string& name,
+        BoneIndex parent,
+        const Matrix4f& inverseBindMatrix,
+        const TransformTRS& restPose = {});
+
+    inline std::size_t size() const { return _names.size(); }
+
+    inline const std::string& name(BoneIndex bone) const { return _names[bone]; }
+
+    inline BoneIndex parent(BoneIndex bone) const { return _parents[bone]; }
+
+    inline const AlignedMatrix4f& inverseBindMatrix(BoneIndex bone) const { return _inverseBindMatrices[bone]; }
+
+    /** Local transform of each bone when it is not animated */
+    inline const std::vector<TransformTRS>& restPose() const { return _restPose; }
+
+    /** Bone names in bone order, to be used as the targets of an Animator */
+    inline const std::vector<std::string>& names() const { return _names; }
+
+    /** NO_BONE if there is no bone with that name */
+    BoneIndex findBone(const std::string& name) const;
+
+    /** skinningMatrices[i] = global(i) * inverseBind(i), where pose has the local transform of each bone,
+     * e.g. Animator::pose() of an animator created with createAnimator.
+     * skinningMatrices must have room for size() matrices, so many skeletons can write into one array.
+     */
+    void computeSkinningMatrices(const std::vector<TransformTRS>& pose, AlignedMatrix4f* skinningMatrices) const;
+
+    void computeSkinningMatrices(const std::vector<TransformTRS>& pose, AlignedMatrix4fArray& skinningMatrices) const;
+
+    /** An Animator targeting every bone by name, with the rest pose already set */
+    Animator createAnimator() const;
+
+private:
+    std::vector<std::string> _names;
+    std::vector<BoneIndex> _parents;
+    AlignedMatrix4fArray _inverseBindMatrices;
+    std::vector<TransformTRS> _restPose;
+};
+
+/** Bone influences of a vertex in 8 bytes: bone indices and weights, the latter as normalized bytes adding up to 255.
+ * Unused slots have weight 0.
+ */
+struct VertexInfluences
+{
+    std::uint8_t bones[MAX_BONE_INFLUENCES] = {0, 0, 0, 0};
+    std::uint8_t weights[MAX_BONE_INFLUENCES] = {0, 0, 0, 0};
+};
+
+static_assert(sizeof(VertexInfluences) == 8, "VertexInfluences is uploaded as is");
+
+struct BoneWeight
+{
+    BoneIndex bone;
+    float weight;
+};
+
+/** Keeps the largest MAX_BONE_INFLUENCES weights, renormalizes them and quantizes them so they add up to exactly 255.
+ * Bones must be below MAX_SKIN_BONES. A vertex without weights follows bone 0.
+ */
+VertexInfluences packInfluences(std::vector<BoneWeight> weights);
+
+/** A mesh deformed by a skeleton. The shape has position, color and normal per vertex, as PhongColorShaderProgram,
+ * in the bind pose; influences has one element per vertex.
+ */
+struct SkinnedShape
+{
+    Shape shape = Shape(9);
+    std::vector<VertexInfluences> influences;
+};
+
+/** GPUShape with a second vertex buffer holding the influences */
+struct SkinnedGPUShape : public GPUShape
+{
+    GLuint influencesVbo = 0;
+
+    void initBuffers();
+
+    void fillBuffers(const SkinnedShape& skinnedShape, GLuint usage);
+
+    /* Freeing GPU memory */
+    void clear();
+};
+
+template <typename PipelineT>
+SkinnedGPUShape toSkinnedGPUShape(const PipelineT& pipeline, const SkinnedShape& skinnedShape, GLuint usage = GL_STATIC_DRAW)
+{
+    SkinnedGPUShape gpuShape;
+    gpuShape.initBuffers();
+    pipeline.setupVAO(gpuShape);
+    gpuShape.fillBuffers(skinnedShape, usage);
+    return gpuShape;
+}
+
+/** Skinning matrices in GPU memory, as a texture buffer with 4 RGBA32F texels (the columns) per bone.
+ * A buffer can hold the matrices of many skeletons; the uniform boneOffset selects the first one of each draw.
+ */
+class BoneMatrixBuffer
+{
+public:
+    BoneMatrixBuffer();
+
+    /** Replaces the content, orphaning the previous storage so the driver does not wait for draws still using it */
+    void update(const AlignedMatrix4f* matrices, std::size_t count);
+
+    void update(const AlignedMatrix4fArray& matrices);
+
+    inline std::size_t size() const { return _size; }
+
+    /** Binds the texture to textureUnit and sets the boneMatrices and boneOffset uniforms. The program must be in use. */
+    void bind(GLuint shaderProgram, GLuint textureUnit = 1, GLint boneOffset = 0) const;
+
+    /** Freeing GPU memory */
+    void clear();
+
+private:
+    GLuint _buffer;
+    GLuint _texture;
+    std::size_t _size = 0;
+};
+
+struct PositionColorNormalSkinVAO
+{
+    GLuint shaderProgram;
+
+    void setupVAO(SkinnedGPUShape& gpuShape) const;
+
+    void drawCall(const SkinnedGPUShape& gpuShape, GLuint mode = GL_TRIANGLES) const;
+};
+
+/** PhongColorShaderProgram with each vertex blended by its bones before the model transform.
+ * Besides the Phong uniforms it reads boneMatrices and boneOffset, see BoneMatrixBuffer::bind.
+ */
+struct PhongColorSkinnedShaderProgram : public PositionColorNormalSkinVAO
+{
+    PhongColorSkinnedShaderProgram();
+};
+
+/** Skins every vertex on the CPU, writing position, color and normal interleaved as the bind pose shape.
+ * Vertices are split among the threads of the pool, and each one blends its bone matrices with SSE.
+ * Normals are transformed by the blended matrix, which is exact for rotations and uniform scales.
+ */
+void skinVertices(
+    const SkinnedShape& skinnedShape,
+    const AlignedMatrix4f* skinningMatrices,
+    float* vertices,
+    ThreadPool& threadPool = defaultThreadPool());
+
+/** CPU fallback for hardware or skeletons the skinned pipeline can not handle.
+ * gpuShape must be created as toGPUShape(pipeline, skinnedShape.shape, GL_STREAM_DRAW), with a pipeline of position,
+ * color and normal such as PhongColorShaderProgram. Each call orphans its vertex buffer and skins directly
+ * into the mapped memory, so there is neither an intermediate copy nor a stall on the previous frame.
+ * The bounds of gpuShape stay those of the bind pose.
+ */
+void updateSkinnedGPUShape(
+    GPUShape& gpuShape,
+    const SkinnedShape& skinnedShape,
+    const AlignedMatrix4f* skinningMatrices,
+    ThreadPool& threadPool = defaultThreadPool());
+
+} // Grafica
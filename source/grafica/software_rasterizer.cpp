@@ -0,0 +1,411 @@
+/**
+ * @file software_rasterizer.cpp
+ * @brief Tiled rasterizer running the easy_shaders pipelines on the CPU, to render Shapes into images
+ *        on machines without a GPU or an OpenGL context.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "software_rasterizer.h"
+
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+#include <ciso646>
+#include <stb_image.h>
+#include "simd.h"
+
+namespace Grafica
+{
+
+namespace
+{
+    /* Triangles set up by each task */
+    constexpr std::size_t CHUNK_TRIANGLES = 2048;
+
+    /* Outcodes, one bit per clip plane the point is outside of */
+    constexpr unsigned int OUTSIDE_LEFT = 1;
+    constexpr unsigned int OUTSIDE_RIGHT = 2;
+    constexpr unsigned int OUTSIDE_BOTTOM = 4;
+    constexpr unsigned int OUTSIDE_TOP = 8;
+    constexpr unsigned int OUTSIDE_NEAR = 16;
+    constexpr unsigned int OUTSIDE_FAR = 32;
+
+    unsigned int outcode(const Vector4f& position)
+    {
+        Coord const w = position[3];
+        return (position[0] < -w ? OUTSIDE_LEFT : 0)
+            | (position[0] > w ? OUTSIDE_RIGHT : 0)
+            | (position[1] < -w ? OUTSIDE_BOTTOM : 0)
+            | (position[1] > w ? OUTSIDE_TOP : 0)
+            | (position[2] < -w ? OUTSIDE_NEAR : 0)
+            | (position[2] > w ? OUTSIDE_FAR : 0);
+    }
+
+    unsigned int wrap(Coord coordinate, unsigned int size)
+    {
+        long const index = static_cast<long>(coordinate) % static_cast<long>(size);
+        return static_cast<unsigned int>(index < 0 ? index + size : index);
+    }
+}
+
+Vector3f SoftwareTexture::sample(Coord s, Coord t) const
+{
+    assert(not texels.empty());
+
+    // Texel centers are at half integers, as in GL_LINEAR
+    Coord const x = s * width - Coord(0.5);
+    Coord const y = t * height - Coord(0.5);
+    Coord const left = std::floor(x);
+    Coord const top = std::floor(y);
+    Coord const fx = x - left;
+    Coord const fy = y - top;
+
+    unsigned int const x0 = wrap(left, width), x1 = wrap(left + 1, width);
+    unsigned int const y0 = wrap(top, height), y1 = wrap(top + 1, height);
+
+    Vector3f const upper = (1 - fx) * texels[std::size_t(y0) * width + x0] + fx * texels[std::size_t(y0) * width + x1];
+    Vector3f const lower = (1 - fx) * texels[std::size_t(y1) * width + x0] + fx * texels[std::size_t(y1) * width + x1];
+    return (1 - fy) * upper + fy * lower;
+}
+
+SoftwareTexture loadSoftwareTexture(const std::filesystem::path& imagePath)
+{
+    int width, height, channels;
+    unsigned char* data = stbi_load(imagePath.string().c_str(), &width, &height, &channels, 3);
+    if (data == nullptr)
+    {
+        std::cout << "ERROR::SOFTWARE_TEXTURE::COULD_NOT_LOAD " << imagePath << std::endl;
+        throw;
+    }
+
+    SoftwareTexture texture;
+    texture.width = width;
+    texture.height = height;
+    texture.texels.resize(std::size_t(width) * height);
+    for (std::size_t i = 0; i < texture.texels.size(); ++i)
+        texture.texels[i] = Vector3f(data[3 * i], data[3 * i + 1], data[3 * i + 2]) / 255;
+
+    stbi_image_free(data);
+    return texture;
+}
+
+void SoftwareModelViewProjectionPipeline::shadeVertices(
+    const Coord* vertices, std::size_t begin, std::size_t end, Vector4f* positions, Coord* varyings) const
+{
+    Matrix4f const transform = projection * view * model;
+
+    for (std::size_t vertex = begin; vertex < end; ++vertex)
+    {
+        Coord const* attributes = vertices + vertex * STRIDE;
+        positions[vertex] = transform * Vector4f(attributes[0], attributes[1], attributes[2], 1);
+        std::copy(attributes + 3, attributes + 6, varyings + vertex * VARYINGS);
+    }
+}
+
+void SoftwarePhongColorPipeline::shadeVertices(
+    const Coord* vertices, std::size_t begin, std::size_t end, Vector4f* positions, Coord* varyings) const
+{
+    Matrix4f const viewProjection = projection * view;
+    Eigen::Matrix3f const normalMatrix = model.block<3, 3>(0, 0).inverse().transpose();
+
+    for (std::size_t vertex = begin; vertex < end; ++vertex)
+    {
+        Coord const* attributes = vertices + vertex * STRIDE;
+        Vector4f const worldPosition = model * Vector4f(attributes[0], attributes[1], attributes[2], 1);
+        Vector3f const normal = normalMatrix * Vector3f(attributes[6], attributes[7], attributes[8]);
+        positions[vertex] = viewProjection * worldPosition;
+
+        Coord* output = varyings + vertex * VARYINGS;
+        std::copy(worldPosition.data(), worldPosition.data() + 3, output);
+        std::copy(attributes + 3, attributes + 6, output + 3);
+        std::copy(normal.data(), normal.data() + 3, output + 6);
+    }
+}
+
+void SoftwarePhongTexturePipeline::shadeVertices(
+    const Coord* vertices, std::size_t begin, std::size_t end, Vector4f* positions, Coord* varyings) const
+{
+    Matrix4f const viewProjection = projection * view;
+    Eigen::Matrix3f const normalMatrix = model.block<3, 3>(0, 0).inverse().transpose();
+
+    for (std::size_t vertex = begin; vertex < end; ++vertex)
+    {
+        Coord const* attributes = vertices + vertex * STRIDE;
+        Vector4f const worldPosition = model * Vector4f(attributes[0], attributes[1], attributes[2], 1);
+        Vector3f const normal = normalMatrix * Vector3f(attributes[5], attributes[6], attributes[7]);
+        positions[vertex] = viewProjection * worldPosition;
+
+        Coord* output = varyings + vertex * VARYINGS;
+        std::copy(worldPosition.data(), worldPosition.data() + 3, output);
+        std::copy(attributes + 3, attributes + 5, output + 3);
+        std::copy(normal.data(), normal.data() + 3, output + 5);
+    }
+}
+
+SoftwareRasterizer::SoftwareRasterizer(unsigned int width, unsigned int height)
+{
+    resize(width, height);
+}
+
+void SoftwareRasterizer::resize(unsigned int width, unsigned int height)
+{
+    _image.width = width;
+    _image.height = height;
+    _image.pixels.assign(std::size_t(width) * height, Vector3f(0, 0, 0));
+
+    _tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    _tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    // Rows cover whole tiles, so groups of 8 pixels never cross into another tile
+    _depthStride = _tilesX * TILE_SIZE;
+    _depth.assign(std::size_t(_depthStride) * height, 1);
+}
+
+void SoftwareRasterizer::clear(const Vector3f& color)
+{
+    std::fill(_image.pixels.begin(), _image.pixels.end(), color);
+    std::fill(_depth.begin(), _depth.end(), Coord(1));
+}
+
+void SoftwareRasterizer::setupTriangles(const Indices& indices, unsigned int varyingsCount, ThreadPool& threadPool)
+{
+    struct ClipVertex
+    {
+        Vector4f position;
+        Coord varyings[MAX_VARYINGS];
+    };
+
+    std::size_t const trianglesCount = indices.size() / 3;
+    std::size_t const chunksCount = (trianglesCount + CHUNK_TRIANGLES - 1) / CHUNK_TRIANGLES;
+    std::size_t const tilesCount = std::size_t(_tilesX) * _tilesY;
+    Coord const width = static_cast<Coord>(_image.width);
+    Coord const height = static_cast<Coord>(_image.height);
+
+    _chunks.resize(chunksCount);
+
+    threadPool.parallelFor(0, chunksCount, 1, [&](std::size_t beginChunk, std::size_t endChunk)
+    {
+        for (std::size_t chunkIndex = beginChunk; chunkIndex < endChunk; ++chunkIndex)
+        {
+            Chunk& chunk = _chunks[chunkIndex];
+            chunk.triangles.clear();
+            chunk.bins.resize(tilesCount);
+            for (auto& bin : chunk.bins)
+                bin.clear();
+
+            auto loadVertex = [&](Index index, ClipVertex& vertex)
+            {
+                vertex.position = _clipPositions[index];
+                std::copy_n(_varyings.data() + std::size_t(index) * varyingsCount, varyingsCount, vertex.varyings);
+            };
+
+            // Viewport transform, culling, bounds and binning of a triangle already inside the near plane
+            auto emit = [&](const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2)
+            {
+                ClipVertex const* vertices[3] = {&v0, &v1, &v2};
+                SetupTriangle triangle;
+
+                for (unsigned int i = 0; i < 3; ++i)
+                {
+                    Vector4f const& position = vertices[i]->position;
+                    Coord const inverseW = 1 / position[3];
+                    triangle.x[i] = (position[0] * inverseW * Coord(0.5) + Coord(0.5)) * width;
+                    triangle.y[i] = (Coord(0.5) - position[1] * inverseW * Coord(0.5)) * height;
+                    triangle.z[i] = position[2] * inverseW * Coord(0.5) + Coord(0.5);
+                    triangle.inverseW[i] = inverseW;
+                }
+
+                // Rows go downwards, so counter clockwise triangles in NDC have a negative area here
+                Coord const area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0])
+                    - (triangle.y[1] - triangle.y[0]) * (triangle.x[2] - triangle.x[0]);
+                if (not (area != 0) or (_cullFace and area > 0))
+                    return;
+
+                if (area < 0)
+                {
+                    std::swap(vertices[1], vertices[2]);
+                    std::swap(triangle.x[1], triangle.x[2]);
+                    std::swap(triangle.y[1], triangle.y[2]);
+                    std::swap(triangle.z[1], triangle.z[2]);
+                    std::swap(triangle.inverseW[1], triangle.inverseW[2]);
+                }
+
+                // Pixels whose centers are inside the bounds, clamped to the viewport
+                auto const [minX, maxX] = std::minmax({triangle.x[0], triangle.x[1], triangle.x[2]});
+                auto const [minY, maxY] = std::minmax({triangle.y[0], triangle.y[1], triangle.y[2]});
+                triangle.minX = static_cast<int>(std::max(std::ceil(minX - Coord(0.5)), Coord(0)));
+                triangle.minY = static_cast<int>(std::max(std::ceil(minY - Coord(0.5)), Coord(0)));
+                triangle.maxX = static_cast<int>(std::min(std::floor(maxX - Coord(0.5)), width - 1));
+                triangle.maxY = static_cast<int>(std::min(std::floor(maxY - Coord(0.5)), height - 1));
+                if (triangle.minX > triangle.maxX or triangle.minY > triangle.maxY)
+                    return;
+
+                for (unsigned int i = 0; i < 3; ++i)
+                    std::copy_n(vertices[i]->varyings, varyingsCount, triangle.varyings[i]);
+
+                std::uint32_t const triangleIndex = static_cast<std::uint32_t>(chunk.triangles.size());
+                chunk.triangles.push_back(triangle);
+
+                for (int tileY = triangle.minY / int(TILE_SIZE); tileY <= triangle.maxY / int(TILE_SIZE); ++tileY)
+                    for (int tileX = triangle.minX / int(TILE_SIZE); tileX <= triangle.maxX / int(TILE_SIZE); ++tileX)
+                        chunk.bins[std::size_t(tileY) * _tilesX + tileX].push_back(triangleIndex);
+            };
+
+            std::size_t const first = chunkIndex * CHUNK_TRIANGLES;
+            std::size_t const last = std::min(first + CHUNK_TRIANGLES, trianglesCount);
+            for (std::size_t triangleIndex = first; triangleIndex < last; ++triangleIndex)
+            {
+                Index const* triangleIndices = indices.data() + 3 * triangleIndex;
+                unsigned int const codes[3] = {
+                    outcode(_clipPositions[triangleIndices[0]]),
+                    outcode(_clipPositions[triangleIndices[1]]),
+                    outcode(_clipPositions[triangleIndices[2]])};
+
+                // All vertices outside of the same plane
+                if (codes[0] & codes[1] & codes[2])
+                    continue;
+
+                ClipVertex input[3];
+                for (unsigned int i = 0; i < 3; ++i)
+                    loadVertex(triangleIndices[i], input[i]);
+
+                if (((codes[0] | codes[1] | codes[2]) & OUTSIDE_NEAR) == 0)
+                {
+                    emit(input[0], input[1], input[2]);
+                    continue;
+                }
+
+                // Clipping against the near plane, z = -w, gives a triangle or a quad
+                ClipVertex output[4];
+                unsigned int outputCount = 0;
+                for (unsigned int i = 0; i < 3; ++i)
+                {
+                    ClipVertex const& a = input[i];
+                    ClipVertex const& b = input[(i + 1) % 3];
+                    Coord const distanceA = a.position[2] + a.position[3];
+                    Coord const distanceB = b.position[2] + b.position[3];
+
+                    if (distanceA >= 0)
+                        output[outputCount++] = a;
+
+                    if ((distanceA >= 0) != (distanceB >= 0))
+                    {
+                        Coord const t = distanceA / (distanceA - distanceB);
+                        ClipVertex& clipped = output[outputCount++];
+                        clipped.position = a.position + t * (b.position - a.position);
+                        for (unsigned int k = 0; k < varyingsCount; ++k)
+                            clipped.varyings[k] = a.varyings[k] + t * (b.varyings[k] - a.varyings[k]);
+                    }
+                }
+
+                for (unsigned int i = 1; i + 1 < outputCount; ++i)
+                    emit(output[0], output[i], output[i + 1]);
+            }
+        }
+    });
+}
+
+void SoftwareRasterizer::rasterizeTriangle(const SetupTriangle& triangle, unsigned int tile, std::vector<Fragment>& fragments)
+{
+    using namespace Simd;
+
+    int const tileX = static_cast<int>(tile % _tilesX) * TILE_SIZE;
+    int const tileY = static_cast<int>(tile / _tilesX) * TILE_SIZE;
+    int const x0 = std::max(triangle.minX, tileX);
+    int const x1 = std::min(triangle.maxX, tileX + int(TILE_SIZE) - 1);
+    int const y0 = std::max(triangle.minY, tileY);
+    int const y1 = std::min(triangle.maxY, tileY + int(TILE_SIZE) - 1);
+    if (x0 > x1 or y0 > y1)
+        return;
+
+    // Edge i is opposite to vertex i: E(x, y) = A x + B y + C, positive inside.
+    // Neighbour triangles compute exactly negated values for a shared edge, the fill rule picks one of them.
+    Coord A[3], B[3], C[3];
+    bool topLeft[3];
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        unsigned int const a = (i + 1) % 3;
+        unsigned int const b = (i + 2) % 3;
+        A[i] = triangle.y[a] - triangle.y[b];
+        B[i] = triangle.x[b] - triangle.x[a];
+        C[i] = triangle.x[a] * triangle.y[b] - triangle.y[a] * triangle.x[b];
+        topLeft[i] = A[i] > 0 or (A[i] == 0 and B[i] > 0);
+    }
+
+    Coord const area = A[0] * triangle.x[0] + B[0] * triangle.y[0] + C[0];
+    Float8 const inverseArea = splat8(1 / area);
+    Float8 const zero = splat8(0);
+    Float8 const firstCenter = splat8(x0 + Coord(0.5));
+    Float8 const lastCenter = splat8(x1 + Coord(0.5));
+
+    alignas(32) float weights[3][8];
+    alignas(32) float weightsSum[8];
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        Coord const py = y + Coord(0.5);
+        Float8 rowEdges[3];
+        for (unsigned int i = 0; i < 3; ++i)
+            rowEdges[i] = splat8(B[i] * py + C[i]);
+
+        Coord* depthRow = _depth.data() + std::size_t(y) * _depthStride;
+
+        for (int x = x0 & ~7; x <= x1; x += 8)
+        {
+            Float8 const px = ramp8(x + Coord(0.5));
+            Mask8 inside = logicalAnd(greaterEqual(px, firstCenter), greaterEqual(lastCenter, px));
+
+            Float8 edges[3];
+            for (unsigned int i = 0; i < 3; ++i)
+            {
+                edges[i] = add(mul(splat8(A[i]), px), rowEdges[i]);
+                inside = logicalAnd(inside, topLeft[i] ? greaterEqual(edges[i], zero) : less(zero, edges[i]));
+            }
+
+            if (not any(inside))
+                continue;
+
+            // Window depth is linear on screen
+            Float8 const b0 = mul(edges[0], inverseArea);
+            Float8 const b1 = mul(edges[1], inverseArea);
+            Float8 const b2 = mul(edges[2], inverseArea);
+            Float8 const depth = add(add(mul(b0, splat8(triangle.z[0])), mul(b1, splat8(triangle.z[1]))), mul(b2, splat8(triangle.z[2])));
+
+            Float8 const previous = load8(depthRow + x);
+            Mask8 const passed = logicalAnd(inside, less(depth, previous));
+            unsigned int const passedLanes = bits(passed);
+            if (passedLanes == 0)
+                continue;
+
+            store8(depthRow + x, select(passed, depth, previous));
+
+            // Attributes are linear in clip space, so barycentrics are weighted by 1 / w
+            Float8 const w0 = mul(b0, splat8(triangle.inverseW[0]));
+            Float8 const w1 = mul(b1, splat8(triangle.inverseW[1]));
+            Float8 const w2 = mul(b2, splat8(triangle.inverseW[2]));
+            store8(weights[0], w0);
+            store8(weights[1], w1);
+            store8(weights[2], w2);
+            store8(weightsSum, add(add(w0, w1), w2));
+
+            std::uint32_t const rowPixel = static_cast<std::uint32_t>(std::size_t(y) * _image.width + x);
+            std::uint32_t const rowTilePixel = static_cast<std::uint32_t>((y - tileY) * TILE_SIZE + x - tileX);
+            for (unsigned int lane = 0; lane < 8; ++lane)
+            {
+                if ((passedLanes & (1u << lane)) == 0)
+                    continue;
+
+                Coord const normalization = 1 / weightsSum[lane];
+                fragments.push_back({
+                    &triangle,
+                    rowPixel + lane,
+                    rowTilePixel + lane,
+                    {weights[0][lane] * normalization, weights[1][lane] * normalization, weights[2][lane] * normalization}});
+            }
+        }
+    }
+}
+
+} // Grafica
@@ -0,0 +1,283 @@
+/**
+ * @file software_rasterizer.h
+ * @brief Tiled rasterizer running the easy_shaders pipelines on the CPU, to render Shapes into images
+ *        on machines without a GPU or an OpenGL context.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <bitset>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+#include <cassert>
+#include "gpu_shape.h"
+#include "image.h"
+#include "phong_lighting.h"
+#include "scene_graph.h"
+#include "shape.h"
+#include "simple_eigen.h"
+#include "thread_pool.h"
+#include "transformations.h"
+
+namespace Grafica
+{
+
+/** Texture in main memory, sampled as textureSimpleSetup configures it with GL_REPEAT and GL_LINEAR.
+ * Rows are stored as in the file, the first one at t = 0, as glTexImage2D receives them.
+ */
+struct SoftwareTexture
+{
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<Vector3f> texels;
+
+    Vector3f sample(Coord s, Coord t) const;
+};
+
+SoftwareTexture loadSoftwareTexture(const std::filesystem::path& imagePath);
+
+/* Software pipelines mirror the shader programs of easy_shaders: the same vertex layout (STRIDE)
+ * and the same uniforms as members. The rasterizer calls
+ *     void shadeVertices(const Coord* vertices, std::size_t begin, std::size_t end, Vector4f* positions, Coord* varyings) const
+ * writing the clip position and VARYINGS values of each vertex in [begin, end), and
+ *     Vector3f shadeFragment(const Coord* varyings) const
+ * with the varyings interpolated with perspective correction at each pixel.
+ */
+
+/** ModelViewProjectionShaderProgram: position and color */
+struct SoftwareModelViewProjectionPipeline
+{
+    static constexpr unsigned int STRIDE = 6;
+    static constexpr unsigned int VARYINGS = 3;
+
+    Matrix4f projection = Transformations::identity();
+    Matrix4f view = Transformations::identity();
+    Matrix4f model = Transformations::identity();
+
+    void shadeVertices(const Coord* vertices, std::size_t begin, std::size_t end, Vector4f* positions, Coord* varyings) const;
+
+    inline Vector3f shadeFragment(const Coord* varyings) const
+    {
+        return Vector3f(varyings[0], varyings[1], varyings[2]);
+    }
+};
+
+/** PhongColorShaderProgram: position, color and normal */
+struct SoftwarePhongColorPipeline
+{
+    static constexpr unsigned int STRIDE = 9;
+    static constexpr unsigned int VARYINGS = 9;
+
+    Matrix4f projection = Transformations::identity();
+    Matrix4f view = Transformations::identity();
+    Matrix4f model = Transformations::identity();
+    Vector3f viewPosition = Vector3f(0, 0, 0);
+    PhongLighting lighting;
+
+    void shadeVertices(const Coord* vertices, std::size_t begin, std::size_t end, Vector4f* positions, Coord* varyings) const;
+
+    inline Vector3f shadeFragment(const Coord* varyings) const
+    {
+        return phongShading(
+            lighting,
+            Vector3f(varyings[0], varyings[1], varyings[2]),
+            Vector3f(varyings[6], varyings[7], varyings[8]),
+            viewPosition,
+            Vector3f(varyings[3], varyings[4], varyings[5]));
+    }
+};
+
+/** PhongTextureShaderProgram: position, texture coordinates and normal */
+struct SoftwarePhongTexturePipeline
+{
+    static constexpr unsigned int STRIDE = 8;
+    static constexpr unsigned int VARYINGS = 8;
+
+    Matrix4f projection = Transformations::identity();
+    Matrix4f view = Transformations::identity();
+    Matrix4f model = Transformations::identity();
+    Vector3f viewPosition = Vector3f(0, 0, 0);
+    PhongLighting lighting;
+    const SoftwareTexture* texturePtr = nullptr;
+
+    void shadeVertices(const Coord* vertices, std::size_t begin, std::size_t end, Vector4f* positions, Coord* varyings) const;
+
+    inline Vector3f shadeFragment(const Coord* varyings) const
+    {
+        return phongShading(
+            lighting,
+            Vector3f(varyings[0], varyings[1], varyings[2]),
+            Vector3f(varyings[5], varyings[6], varyings[7]),
+            viewPosition,
+            texturePtr->sample(varyings[3], varyings[4]));
+    }
+};
+
+/** Each draw runs in three parallel stages: vertices, triangle setup, and rasterization.
+ * Setup clips triangles against the near plane and sorts them into bins, one per screen tile.
+ * Each tile is then rasterized by a single task, so tiles never share pixels and need no locks.
+ * Coverage and depth are computed 8 pixels at a time, with the top-left fill rule and a depth test
+ * as glDepthFunc(GL_LESS). Within a tile, triangles are drawn in the order of the indices, and fragments
+ * are shaded after the whole tile is rasterized, only where they remained visible.
+ */
+class SoftwareRasterizer
+{
+public:
+    static constexpr unsigned int TILE_SIZE = 64;
+    static constexpr unsigned int MAX_VARYINGS = 16;
+
+    SoftwareRasterizer(unsigned int width, unsigned int height);
+
+    void resize(unsigned int width, unsigned int height);
+
+    /** As glClear of the color and depth buffers */
+    void clear(const Vector3f& color = Vector3f(0, 0, 0));
+
+    /** As glEnable(GL_CULL_FACE) with the default back faces and counter clockwise front faces */
+    inline void setCullFace(bool cullFace) { _cullFace = cullFace; }
+
+    template <typename PipelineT>
+    void draw(const Shape& shape, const PipelineT& pipeline, ThreadPool& threadPool = defaultThreadPool());
+
+    inline const Image& image() const { return _image; }
+
+    inline unsigned int width() const { return _image.width; }
+    inline unsigned int height() const { return _image.height; }
+
+    /** Window depth in [0, 1] */
+    inline Coord depth(unsigned int x, unsigned int y) const { return _depth[std::size_t(y) * _depthStride + x]; }
+
+private:
+    struct SetupTriangle
+    {
+        /* Window coordinates, depth in [0, 1] and 1 / w of each vertex, counter clockwise on screen */
+        Coord x[3], y[3], z[3], inverseW[3];
+        int minX, minY, maxX, maxY;
+        Coord varyings[3][MAX_VARYINGS];
+    };
+
+    /* A pixel covered by a triangle that passed the depth test, with perspective correct barycentrics */
+    struct Fragment
+    {
+        const SetupTriangle* trianglePtr;
+        std::uint32_t pixel;
+        std::uint32_t tilePixel;
+        Coord weights[3];
+    };
+
+    /* Triangles set up by one task, binned by tile. Consumed in order, chunk after chunk. */
+    struct Chunk
+    {
+        std::vector<SetupTriangle> triangles;
+        std::vector<std::vector<std::uint32_t>> bins;
+    };
+
+    void setupTriangles(const Indices& indices, unsigned int varyingsCount, ThreadPool& threadPool);
+
+    void rasterizeTriangle(const SetupTriangle& triangle, unsigned int tile, std::vector<Fragment>& fragments);
+
+    Image _image;
+    std::vector<Coord> _depth;
+    unsigned int _depthStride = 0;
+    unsigned int _tilesX = 0;
+    unsigned int _tilesY = 0;
+    bool _cullFace = false;
+
+    std::vector<Vector4f> _clipPositions;
+    std::vector<Coord> _varyings;
+    std::vector<Chunk> _chunks;
+};
+
+template <typename PipelineT>
+void SoftwareRasterizer::draw(const Shape& shape, const PipelineT& pipeline, ThreadPool& threadPool)
+{
+    static_assert(PipelineT::VARYINGS <= MAX_VARYINGS, "Too many varyings for the software rasterizer");
+    assert(shape.stride == PipelineT::STRIDE);
+
+    // Vertices are shaded once, even if many triangles share them
+    std::size_t const verticesCount = shape.vertices.size() / PipelineT::STRIDE;
+    _clipPositions.resize(verticesCount);
+    _varyings.resize(verticesCount * PipelineT::VARYINGS);
+
+    threadPool.parallelFor(0, verticesCount, 1024, [&](std::size_t begin, std::size_t end)
+    {
+        pipeline.shadeVertices(shape.vertices.data(), begin, end, _clipPositions.data(), _varyings.data());
+    });
+
+    setupTriangles(shape.indices, PipelineT::VARYINGS, threadPool);
+
+    threadPool.parallelFor(0, std::size_t(_tilesX) * _tilesY, 1, [&](std::size_t begin, std::size_t end)
+    {
+        // Kept by each thread from draw to draw, to not reallocate it for every tile
+        thread_local std::vector<Fragment> fragments;
+        Coord varyings[MAX_VARYINGS];
+
+        for (std::size_t tile = begin; tile < end; ++tile)
+        {
+            fragments.clear();
+            for (auto const& chunk : _chunks)
+                for (auto triangleIndex : chunk.bins[tile])
+                    rasterizeTriangle(chunk.triangles[triangleIndex], static_cast<unsigned int>(tile), fragments);
+
+            // Only the last fragment written to each pixel is visible, the others are never shaded
+            std::bitset<TILE_SIZE * TILE_SIZE> shaded;
+            for (auto it = fragments.rbegin(); it != fragments.rend(); ++it)
+            {
+                Fragment const& fragment = *it;
+                if (shaded.test(fragment.tilePixel))
+                    continue;
+                shaded.set(fragment.tilePixel);
+
+                SetupTriangle const& triangle = *fragment.trianglePtr;
+                for (unsigned int i = 0; i < PipelineT::VARYINGS; ++i)
+                {
+                    varyings[i] =
+                        fragment.weights[0] * triangle.varyings[0][i] +
+                        fragment.weights[1] * triangle.varyings[1][i] +
+                        fragment.weights[2] * triangle.varyings[2][i];
+                }
+
+                _image.pixels[fragment.pixel] = pipeline.shadeFragment(varyings);
+            }
+        }
+    });
+}
+
+/** CPU counterparts of GPUShapes, as given to fillBuffers */
+using SoftwareShapes = std::unordered_map<const GPUShape*, const Shape*>;
+
+/** As drawSceneGraphNode, setting the model matrix of the pipeline at each node.
+ * Nodes whose GPUShape is not in shapes are skipped.
+ */
+template <typename PipelineT>
+void rasterizeSceneGraphNode(
+    SceneGraphNodePtr nodePtr,
+    SoftwareRasterizer& rasterizer,
+    const PipelineT& pipeline,
+    const SoftwareShapes& shapes,
+    const Matrix4f& parentTransform = Transformations::identity(),
+    ThreadPool& threadPool = defaultThreadPool())
+{
+    Matrix4f const newTransform = parentTransform * nodePtr->transform;
+
+    if (nodePtr->gpuShapeMaybe.has_value())
+    {
+        auto const it = shapes.find(nodePtr->gpuShapeMaybe.value().get());
+        if (it != shapes.end())
+        {
+            PipelineT nodePipeline = pipeline;
+            nodePipeline.model = newTransform;
+            rasterizer.draw(*it->second, nodePipeline, threadPool);
+        }
+    }
+
+    for (auto const& childPtr : nodePtr->childs)
+        rasterizeSceneGraphNode(childPtr, rasterizer, pipeline, shapes, newTransform, threadPool);
+}
+
+} // Grafica
@@ -0,0 +1,268 @@
+/**
+ * @file sprite_batch.cpp
+ * @brief SpriteBatch collects textured quads for 2D scenes, overlays and HUDs, sorts them by layer and texture,
+ *        and draws them from one streamed vertex buffer with a draw call per texture run.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "sprite_batch.h"
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <algorithm>
+#include <ciso646>
+#include "gpu_shape.h"
+#include "load_shaders.h"
+#include "stream_buffer.h"
+
+namespace Grafica
+{
+
+namespace
+{
+    /* Sprites written by each task */
+    constexpr std::size_t CHUNK_SPRITES = 4096;
+
+    constexpr std::size_t VERTICES_PER_SPRITE = 4;
+    constexpr std::size_t INDICES_PER_SPRITE = 6;
+
+    struct SpriteVertex
+    {
+        float x, y;
+        float u, v;
+
+        /* RGBA8, red in the lowest byte */
+        std::uint32_t tint;
+    };
+
+    static_assert(sizeof(SpriteVertex) == 5 * SIZE_IN_BYTES);
+
+    enum SpriteAttribute : GLuint
+    {
+        SPRITE_POSITION = 0,
+        SPRITE_TEXCOORDS,
+        SPRITE_TINT
+    };
+
+    /* Layer in the highest 32 bits, with the sign bit flipped so negative layers sort first, then the texture name */
+    std::uint64_t makeKey(const Sprite& sprite)
+    {
+        std::uint64_t const layer = static_cast<std::uint32_t>(sprite.layer) ^ 0x80000000u;
+        return (layer << 32) | sprite.texture;
+    }
+}
+
+void SpriteBuffer::initBuffers(std::size_t capacity)
+{
+    this->capacity = capacity;
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, capacity * VERTICES_PER_SPRITE * sizeof(SpriteVertex), nullptr, GL_STREAM_DRAW);
+
+    // Every quad as createTextureQuad builds it
+    std::vector<GLuint> indices(capacity * INDICES_PER_SPRITE);
+    for (std::size_t i = 0; i < capacity; ++i)
+    {
+        GLuint const base = static_cast<GLuint>(i * VERTICES_PER_SPRITE);
+        GLuint const quad[INDICES_PER_SPRITE] = {base, base + 1, base + 2, base + 2, base + 3, base};
+        std::copy(quad, quad + INDICES_PER_SPRITE, indices.begin() + i * INDICES_PER_SPRITE);
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * SIZE_IN_BYTES, indices.data(), GL_STATIC_DRAW);
+}
+
+void SpriteBuffer::clear()
+{
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+    glDeleteVertexArrays(1, &vao);
+    vao = vbo = ebo = 0;
+    capacity = 0;
+}
+
+SpriteShaderProgram::SpriteShaderProgram()
+{
+    const std::string vertexShaderCode = R"(
+        #version 330 core
+
+        layout (location = 0) in vec2 position;
+        layout (location = 1) in vec2 texCoords;
+        layout (location = 2) in vec4 tint;
+        out vec2 outTexCoords;
+        out vec4 outTint;
+        uniform mat4 transform;
+
+        void main()
+        {
+            gl_Position = transform * vec4(position, 0.0, 1.0);
+            outTexCoords = texCoords;
+            outTint = tint;
+        }
+    )";
+
+    const std::string fragmentShaderCode = R"(
+        #version 330 core
+
+        in vec2 outTexCoords;
+        in vec4 outTint;
+        out vec4 outColor;
+        uniform sampler2D samplerTex;
+
+        void main()
+        {
+            outColor = outTint * texture(samplerTex, outTexCoords);
+        }
+    )";
+
+    shaderProgram = createShaderProgramFromCode({
+        {GL_VERTEX_SHADER, vertexShaderCode.c_str()},
+        {GL_FRAGMENT_SHADER, fragmentShaderCode.c_str()}
+    });
+}
+
+void SpriteShaderProgram::setupVAO(SpriteBuffer& spriteBuffer) const
+{
+    glBindVertexArray(spriteBuffer.vao);
+
+    // Binding buffers to the current VAO
+    glBindBuffer(GL_ARRAY_BUFFER, spriteBuffer.vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spriteBuffer.ebo);
+
+    glVertexAttribPointer(SPRITE_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, x));
+    glEnableVertexAttribArray(SPRITE_POSITION);
+
+    glVertexAttribPointer(SPRITE_TEXCOORDS, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, u));
+    glEnableVertexAttribArray(SPRITE_TEXCOORDS);
+
+    glVertexAttribPointer(SPRITE_TINT, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, tint));
+    glEnableVertexAttribArray(SPRITE_TINT);
+
+    glBindVertexArray(0);
+}
+
+void SpriteShaderProgram::drawCall(const SpriteBuffer& spriteBuffer, std::size_t first, std::size_t count) const
+{
+    glBindVertexArray(spriteBuffer.vao);
+    glDrawElements(GL_TRIANGLES, count * INDICES_PER_SPRITE, GL_UNSIGNED_INT, (void*)(first * INDICES_PER_SPRITE * SIZE_IN_BYTES));
+    glBindVertexArray(0);
+}
+
+SpriteBuffer toSpriteBuffer(const SpriteShaderProgram& pipeline, std::size_t capacity)
+{
+    SpriteBuffer spriteBuffer;
+    spriteBuffer.initBuffers(capacity);
+    pipeline.setupVAO(spriteBuffer);
+    return spriteBuffer;
+}
+
+void SpriteBatch::begin()
+{
+    _sprites.clear();
+    _keys.clear();
+}
+
+void SpriteBatch::draw(const Sprite& sprite)
+{
+    _keys.push_back({makeKey(sprite), static_cast<std::uint32_t>(_sprites.size())});
+    _sprites.push_back(sprite);
+}
+
+void SpriteBatch::flush(const SpriteShaderProgram& pipeline, SpriteBuffer& spriteBuffer, ThreadPool& threadPool)
+{
+    _stats = SpriteBatchStats();
+    _stats.sprites = _sprites.size();
+    if (_sprites.empty() or spriteBuffer.capacity == 0)
+        return;
+
+    radixSort(_keys, _scratch, threadPool);
+
+    std::size_t const bytes = spriteBuffer.capacity * VERTICES_PER_SPRITE * sizeof(SpriteVertex);
+    GLuint currentTexture = 0;
+
+    for (std::size_t first = 0; first < _sprites.size(); first += spriteBuffer.capacity)
+    {
+        std::size_t const count = std::min(spriteBuffer.capacity, _sprites.size() - first);
+
+        glBindBuffer(GL_ARRAY_BUFFER, spriteBuffer.vbo);
+        streamBufferData(GL_ARRAY_BUFFER, bytes, count * VERTICES_PER_SPRITE * sizeof(SpriteVertex), [&](void* vertices)
+        {
+            fillVertices(vertices, first, count, threadPool);
+        });
+        _stats.uploads++;
+
+        // One draw call for each run of sprites with the same texture, runs may cross layers
+        std::size_t runBegin = 0;
+        while (runBegin < count)
+        {
+            GLuint const texture = _sprites[_keys[first + runBegin].index].texture;
+
+            std::size_t runEnd = runBegin + 1;
+            while (runEnd < count and _sprites[_keys[first + runEnd].index].texture == texture)
+                ++runEnd;
+
+            if (texture != currentTexture)
+            {
+                glBindTexture(GL_TEXTURE_2D, texture);
+                currentTexture = texture;
+                _stats.textureChanges++;
+            }
+
+            pipeline.drawCall(spriteBuffer, runBegin, runEnd - runBegin);
+            _stats.drawCalls++;
+
+            runBegin = runEnd;
+        }
+    }
+}
+
+void SpriteBatch::fillVertices(void* vertices, std::size_t first, std::size_t count, ThreadPool& threadPool) const
+{
+    auto* output = static_cast<SpriteVertex*>(vertices);
+
+    threadPool.parallelFor(0, count, CHUNK_SPRITES, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            Sprite const& sprite = _sprites[_keys[first + i].index];
+
+            // Half sides of the quad, rotated
+            Coord const cosine = std::cos(sprite.rotation);
+            Coord const sine = std::sin(sprite.rotation);
+            Coord const halfWidth = 0.5f * sprite.scale[0];
+            Coord const halfHeight = 0.5f * sprite.scale[1];
+            Coord const ax = cosine * halfWidth, ay = sine * halfWidth;
+            Coord const bx = -sine * halfHeight, by = cosine * halfHeight;
+
+            Coord const x = sprite.position[0], y = sprite.position[1];
+            Coord const u0 = sprite.uvRect[0], v0 = sprite.uvRect[1];
+            Coord const u1 = sprite.uvRect[2], v1 = sprite.uvRect[3];
+            std::uint32_t const tint = packColor(sprite.tint);
+
+            // Bottom left, bottom right, top right and top left, as createTextureQuad
+            SpriteVertex* quad = output + i * VERTICES_PER_SPRITE;
+            quad[0] = {x - ax - bx, y - ay - by, u0, v1, tint};
+            quad[1] = {x + ax - bx, y + ay - by, u1, v1, tint};
+            quad[2] = {x + ax + bx, y + ay + by, u1, v0, tint};
+            quad[3] = {x - ax + bx, y - ay + by, u0, v0, tint};
+        }
+    });
+}
+
+std::ostream& operator<<(std::ostream& os, const SpriteBatchStats& stats)
+{
+    os << "[" << stats.sprites << " sprites - "
+        << stats.drawCalls << " draw calls - "
+        << stats.textureChanges << " textures - "
+        << stats.uploads << " uploads]";
+    return os;
+}
+
+} // Grafica
@@ -0,0 +1,119 @@
+/**
+ * @file sprite_batch.h
+ * @brief SpriteBatch collects textured quads for 2D scenes, overlays and HUDs, sorts them by layer and texture,
+ *        and draws them from one streamed vertex buffer with a draw call per texture run.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <iostream>
+#include <glad/glad.h>
+#include "simple_eigen.h"
+#include "radix_sort.h"
+#include "thread_pool.h"
+
+namespace Grafica
+{
+
+/** A textured quad, as createTextureQuad builds it, moved by its own scale, rotation and position */
+struct Sprite
+{
+    GLuint texture = 0;
+    Vector2f position = Vector2f(0, 0);
+
+    /** Counterclockwise, in radians */
+    Coord rotation = 0;
+
+    /** Size of the quad, which is centered at position */
+    Vector2f scale = Vector2f(1, 1);
+
+    /** Region of the texture as (u0, v0, u1, v1), with v0 at the top row of the image, as createTextureQuad maps it */
+    Vector4f uvRect = Vector4f(0, 0, 1, 1);
+
+    /** Multiplies the texture color */
+    Vector4f tint = Vector4f(1, 1, 1, 1);
+
+    /** Lower layers are drawn first */
+    int layer = 0;
+};
+
+/** Counters of the last flush */
+struct SpriteBatchStats
+{
+    std::size_t sprites = 0;
+    std::size_t drawCalls = 0;
+    std::size_t textureChanges = 0;
+    std::size_t uploads = 0;
+};
+
+/** Vertices of many sprites, streamed every frame. The index buffer is static: quads always use indices 0 1 2 2 3 0.
+ * Each vertex is a position, a texture coordinate and an RGBA8 tint, 20 bytes.
+ */
+struct SpriteBuffer
+{
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    std::size_t capacity = 0;
+
+    void initBuffers(std::size_t capacity);
+
+    /* Freeing GPU memory */
+    void clear();
+};
+
+/** Textured and tinted sprites. Uniforms: transform, usually an orthographic projection times the camera,
+ * and samplerTex. It is meant to be drawn without depth testing and with alpha blending, as
+ *     glDisable(GL_DEPTH_TEST); glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+ */
+struct SpriteShaderProgram
+{
+    GLuint shaderProgram;
+
+    SpriteShaderProgram();
+
+    void setupVAO(SpriteBuffer& spriteBuffer) const;
+
+    /** Draws count sprites starting at the sprite first of the buffer */
+    void drawCall(const SpriteBuffer& spriteBuffer, std::size_t first, std::size_t count) const;
+};
+
+/* Convenience function to ease initialization */
+SpriteBuffer toSpriteBuffer(const SpriteShaderProgram& pipeline, std::size_t capacity);
+
+/** Sprites are accumulated between begin and flush. flush sorts them with a stable radix sort on (layer, texture),
+ * writes their corners into the mapped sprite buffer from the thread pool and issues one draw call for each run
+ * of sprites sharing a texture. Sprites of the same layer and texture keep the order they were drawn in;
+ * sprites of the same layer but different textures do not, so overlapping sprites must be given different layers.
+ * When there are more sprites than the buffer capacity, they are uploaded and drawn in several rounds.
+ */
+class SpriteBatch
+{
+public:
+    /** Forgets the sprites of the previous frame, keeping the allocated memory */
+    void begin();
+
+    void draw(const Sprite& sprite);
+
+    /** Draws every sprite with pipeline, which must be in use with its transform already set. */
+    void flush(const SpriteShaderProgram& pipeline, SpriteBuffer& spriteBuffer, ThreadPool& threadPool = defaultThreadPool());
+
+    inline std::size_t size() const { return _sprites.size(); }
+
+    inline const SpriteBatchStats& stats() const { return _stats; }
+
+private:
+    void fillVertices(void* vertices, std::size_t first, std::size_t count, ThreadPool& threadPool) const;
+
+    std::vector<Sprite> _sprites;
+    std::vector<SortKey> _keys;
+    std::vector<SortKey> _scratch;
+    SpriteBatchStats _stats;
+};
+
+std::ostream& operator<<(std::ostream& os, const SpriteBatchStats& stats);
+
+} // Grafica
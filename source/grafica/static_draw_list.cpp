@@ -0,0 +1,32 @@
+/**
+ * @file static_draw_list.cpp
+ * @brief StaticDrawList stores a scene graph subtree already flattened into world transforms and shapes,
+ *        so static geometry can be drawn every frame without traversing and multiplying matrices again.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "static_draw_list.h"
+
+namespace Grafica
+{
+
+void StaticDrawList::compileNode(SceneGraphNodePtr nodePtr, GLuint shaderProgram, const Matrix4f& parentTransform)
+{
+    Matrix4f newTransform = parentTransform * nodePtr->transform;
+
+    if (nodePtr->gpuShapeMaybe.has_value())
+        _commands.push_back({newTransform, nodePtr->gpuShapeMaybe.value(), shaderProgram});
+
+    for (auto const& childPtr : nodePtr->childs)
+        compileNode(childPtr, shaderProgram, newTransform);
+}
+
+void StaticDrawList::enqueue(RenderQueue& renderQueue, bool translucent) const
+{
+    for (auto const& command : _commands)
+        renderQueue.push(*command.gpuShapePtr, command.shaderProgram, command.transform, translucent);
+}
+
+} // Grafica
@@ -0,0 +1,122 @@
+/**
+ * @file static_draw_list.h
+ * @brief StaticDrawList stores a scene graph subtree already flattened into world transforms and shapes,
+ *        so static geometry can be drawn every frame without traversing and multiplying matrices again.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cassert>
+#include <ciso646>
+#include <glad/glad.h>
+#include "gpu_shape.h"
+#include "scene_graph.h"
+#include "render_queue.h"
+#include "simple_eigen.h"
+#include "transformations.h"
+
+namespace Grafica
+{
+
+/** A single draw: the shape, the pipeline it was compiled for and its accumulated transform */
+struct DrawCommand
+{
+    Matrix4f transform;
+    GPUShapePtr gpuShapePtr;
+    GLuint shaderProgram;
+};
+
+/** Cached flattened version of a scene graph subtree.
+ * Nothing tracks changes on the nodes, so invalidate() must be called after modifying
+ * any transform or shape inside the subtree. Changes of the root node, the pipeline
+ * or the parent transform are detected.
+ */
+class StaticDrawList
+{
+public:
+    inline void invalidate() { _dirty = true; }
+
+    inline bool isDirty() const { return _dirty; }
+
+    inline const std::vector<DrawCommand>& commands() const { return _commands; }
+
+    inline const Matrix4f& parentTransform() const { return _parentTransform; }
+
+    /** The subtree and the shader program of the last compilation */
+    inline const SceneGraphNodePtr& root() const { return _rootPtr; }
+
+    inline GLuint shaderProgram() const { return _shaderProgram; }
+
+    /** True if the commands were not compiled for this subtree, pipeline and parent transform */
+    inline bool isStale(const SceneGraphNodePtr& nodePtr, GLuint shaderProgram, const Matrix4f& parentTransform) const
+    {
+        return _dirty or _rootPtr != nodePtr or _shaderProgram != shaderProgram or _parentTransform != parentTransform;
+    }
+
+    /** Traverses the subtree once, storing a command per node with a shape */
+    template <typename PipelineType>
+    void compile(
+        SceneGraphNodePtr nodePtr,
+        const PipelineType& pipeline,
+        const Matrix4f& parentTransform = Transformations::identity())
+    {
+        _commands.clear();
+        _rootPtr = nodePtr;
+        _shaderProgram = pipeline.shaderProgram;
+        _parentTransform = parentTransform;
+        compileNode(nodePtr, pipeline.shaderProgram, parentTransform);
+        _dirty = false;
+    }
+
+    /** Draws every command in order with the given pipeline, which must be the one they were compiled for */
+    template <typename PipelineType>
+    void replay(const PipelineType& pipeline, const std::string& transformName) const
+    {
+        assert(_commands.empty() or pipeline.shaderProgram == _shaderProgram);
+
+        GLint const transformLocation = glGetUniformLocation(pipeline.shaderProgram, transformName.c_str());
+
+        for (auto const& command : _commands)
+        {
+            glUniformMatrix4fv(transformLocation, 1, GL_FALSE, command.transform.data());
+            pipeline.drawCall(*command.gpuShapePtr);
+        }
+    }
+
+    /** Pushes every command into a render queue, to be sorted with the rest of the frame */
+    void enqueue(RenderQueue& renderQueue, bool translucent = false) const;
+
+private:
+    void compileNode(SceneGraphNodePtr nodePtr, GLuint shaderProgram, const Matrix4f& parentTransform);
+
+    std::vector<DrawCommand> _commands;
+    SceneGraphNodePtr _rootPtr;
+    GLuint _shaderProgram = 0;
+    Matrix4f _parentTransform = Transformations::identity();
+    bool _dirty = true;
+};
+
+/** Same as drawSceneGraphNode, but the subtree is only traversed when drawList is dirty,
+ * or nodePtr, the pipeline or parentTransform changed since the last compilation.
+ * Otherwise the cached commands are replayed.
+ */
+template <typename PipelineType>
+void drawSceneGraphNode(
+    SceneGraphNodePtr nodePtr,
+    const PipelineType& pipeline,
+    const std::string& transformName,
+    StaticDrawList& drawList,
+    const Matrix4f& parentTransform = Transformations::identity())
+{
+    if (drawList.isStale(nodePtr, pipeline.shaderProgram, parentTransform))
+        drawList.compile(nodePtr, pipeline, parentTransform);
+
+    drawList.replay(pipeline, transformName);
+}
+
+} // Grafica
@@ -0,0 +1,35 @@
+/**
+ * @file stream_buffer.cpp
+ * @brief Helpers shared by the buffers rewritten every frame: packing colors for normalized byte attributes
+ *        and replacing the content of a buffer without waiting for the draws still reading it.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "stream_buffer.h"
+
+#include <algorithm>
+
+namespace Grafica
+{
+
+namespace
+{
+    std::uint32_t packChannel(Coord value)
+    {
+        return static_cast<std::uint32_t>(std::clamp(value, 0.0f, 1.0f) * 255 + 0.5f);
+    }
+}
+
+std::uint32_t packColor(const Vector4f& color)
+{
+    return packChannel(color[0]) | (packChannel(color[1]) << 8) | (packChannel(color[2]) << 16) | (packChannel(color[3]) << 24);
+}
+
+std::uint32_t packColor(const Vector3f& color)
+{
+    return packColor(Vector4f(color[0], color[1], color[2], 1));
+}
+
+} // Grafica
@@ -0,0 +1,54 @@
+/**
+ * @file stream_buffer.h
+ * @brief Helpers shared by the buffers rewritten every frame: packing colors for normalized byte attributes
+ *        and replacing the content of a buffer without waiting for the draws still reading it.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <ciso646>
+#include <glad/glad.h>
+#include "simple_eigen.h"
+
+namespace Grafica
+{
+
+/** RGBA8 with red in the lowest byte, as a GL_UNSIGNED_BYTE normalized attribute reads it. Channels are clamped to [0, 1]. */
+std::uint32_t packColor(const Vector4f& color);
+
+/** Same as above, opaque */
+std::uint32_t packColor(const Vector3f& color);
+
+/** Replaces the content of the buffer bound to target: its storage is orphaned with capacityBytes,
+ * so the driver keeps the old one until the draws reading it finish, and the first bytes are mapped
+ * unsynchronized and written by fill(void*).
+ * If the buffer can not be mapped, or its content is lost while mapped (e.g. a screen mode change),
+ * fill writes to a temporary array uploaded with glBufferSubData instead.
+ */
+template <typename FillFunction>
+void streamBufferData(GLenum target, std::size_t capacityBytes, std::size_t bytes, FillFunction&& fill)
+{
+    glBufferData(target, capacityBytes, nullptr, GL_STREAM_DRAW);
+    if (bytes == 0)
+        return;
+
+    void* mapped = glMapBufferRange(target, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapped != nullptr)
+    {
+        fill(mapped);
+        if (glUnmapBuffer(target) == GL_TRUE)
+            return;
+    }
+
+    std::vector<std::uint8_t> data(bytes);
+    fill(static_cast<void*>(data.data()));
+    glBufferSubData(target, 0, bytes, data.data());
+}
+
+} // Grafica
@@ -0,0 +1,259 @@
+/**
+ * @file thread_pool.cpp
+ * @brief A small pool of worker threads to split CPU work (sorting, culling, updates) across cores.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <ciso646>
+
+namespace Grafica
+{
+
+namespace
+{
+    // Which pool and worker the current thread belongs to, if any
+    thread_local const ThreadPool* currentPool = nullptr;
+    thread_local std::size_t currentWorkerIndex = 0;
+}
+
+ThreadPool::ThreadPool(unsigned int workersCount):
+    _queuedTasks(0),
+    _stopping(false)
+{
+    for (unsigned int i = 0; i < workersCount + 1; ++i)
+        _queues.push_back(std::make_unique<WorkQueue>());
+
+    _workers.reserve(workersCount);
+    for (unsigned int i = 0; i < workersCount; ++i)
+        _workers.emplace_back([this, i]() { workerLoop(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(_sleepMutex);
+        _stopping = true;
+    }
+    _condition.notify_all();
+
+    for (auto& worker : _workers)
+        worker.join();
+}
+
+unsigned int ThreadPool::defaultWorkersCount()
+{
+    // The thread calling parallelFor also works, so one core is left for it.
+    unsigned int const hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+std::size_t ThreadPool::currentQueueIndex() const
+{
+    return currentPool == this ? currentWorkerIndex : _workers.size();
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task)
+{
+    // std::function must be copyable, so the packaged task is shared
+    auto packagedTask = std::make_shared<std::packaged_task<void()>>(std::move(task));
+    std::future<void> future = packagedTask->get_future();
+
+    enqueue([packagedTask]() { (*packagedTask)(); });
+
+    return future;
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    // Without workers, the task is executed right away
+    if (_workers.empty())
+    {
+        task();
+        return;
+    }
+
+    {
+        WorkQueue& queue = *_queues[currentQueueIndex()];
+        std::lock_guard<std::mutex> guard(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    // Counting under the sleep mutex, so a worker about to sleep can not miss it
+    {
+        std::lock_guard<std::mutex> guard(_sleepMutex);
+        _queuedTasks.fetch_add(1);
+    }
+    _condition.notify_one();
+}
+
+bool ThreadPool::popOrSteal(std::size_t queueIndex, std::function<void()>& task)
+{
+    // Newest task of our own queue first
+    {
+        WorkQueue& queue = *_queues[queueIndex];
+        std::lock_guard<std::mutex> guard(queue.mutex);
+        if (not queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            _queuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // Then the oldest task of the others, usually the biggest pieces of work
+    std::size_t const queuesCount = _queues.size();
+    for (std::size_t offset = 1; offset < queuesCount; ++offset)
+    {
+        WorkQueue& queue = *_queues[(queueIndex + offset) % queuesCount];
+        std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+        if (lock.owns_lock() and not queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            _queuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ThreadPool::tryRunPendingTask()
+{
+    std::function<void()> task;
+    if (not popOrSteal(currentQueueIndex(), task))
+        return false;
+
+    task();
+    return true;
+}
+
+void ThreadPool::parallelFor(
+    std::size_t begin,
+    std::size_t end,
+    std::size_t grainSize,
+    const std::function<void(std::size_t, std::size_t)>& function)
+{
+    if (end <= begin)
+        return;
+
+    std::size_t const count = end - begin;
+    grainSize = std::max<std::size_t>(grainSize, 1);
+
+    // Enough chunks to feed every worker plus the calling thread, but never smaller than grainSize
+    std::size_t const maxChunks = size() + 1;
+    std::size_t const chunks = std::min(maxChunks, (count + grainSize - 1) / grainSize);
+
+    if (chunks <= 1)
+    {
+        function(begin, end);
+        return;
+    }
+
+    std::size_t const chunkSize = (count + chunks - 1) / chunks;
+
+    TaskGroup taskGroup(*this);
+
+    // The first chunk is kept for the calling thread
+    for (std::size_t chunkBegin = begin + chunkSize; chunkBegin < end; chunkBegin += chunkSize)
+    {
+        std::size_t const chunkEnd = std::min(chunkBegin + chunkSize, end);
+        taskGroup.run([&function, chunkBegin, chunkEnd]() { function(chunkBegin, chunkEnd); });
+    }
+
+    function(begin, std::min(begin + chunkSize, end));
+
+    taskGroup.wait();
+}
+
+void ThreadPool::workerLoop(std::size_t workerIndex)
+{
+    currentPool = this;
+    currentWorkerIndex = workerIndex;
+
+    while (true)
+    {
+        std::function<void()> task;
+        if (popOrSteal(workerIndex, task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        _condition.wait(lock, [this]() { return _stopping or _queuedTasks.load() > 0; });
+
+        if (_stopping and _queuedTasks.load() == 0)
+            return;
+    }
+}
+
+TaskGroup::TaskGroup(ThreadPool& threadPool):
+    _threadPool(threadPool),
+    _pendingTasks(0)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    // Tasks reference this group, so it can not go away before them. Exceptions are dropped here.
+    while (_pendingTasks.load() > 0)
+    {
+        if (not _threadPool.tryRunPendingTask())
+            std::this_thread::yield();
+    }
+}
+
+void TaskGroup::run(std::function<void()> task)
+{
+    _pendingTasks.fetch_add(1);
+
+    _threadPool.enqueue([this, task = std::move(task)]()
+    {
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> guard(_exceptionMutex);
+            if (not _exception)
+                _exception = std::current_exception();
+        }
+
+        _pendingTasks.fetch_sub(1);
+    });
+}
+
+void TaskGroup::wait()
+{
+    // Helping: the waiting thread runs tasks, possibly of this very group, until all are done
+    while (_pendingTasks.load() > 0)
+    {
+        if (not _threadPool.tryRunPendingTask())
+            std::this_thread::yield();
+    }
+
+    std::exception_ptr exception;
+    {
+        std::lock_guard<std::mutex> guard(_exceptionMutex);
+        std::swap(exception, _exception);
+    }
+
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+ThreadPool& defaultThreadPool()
+{
+    static ThreadPool threadPool;
+    return threadPool;
+}
+
+} // Grafica
@@ -0,0 +1,119 @@
+/**
+ * @file thread_pool.h
+ * @brief A small pool of worker threads to split CPU work (sorting, culling, updates) across cores.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+
+namespace Grafica
+{
+
+/** Fixed set of worker threads with work stealing.
+ * Each worker has its own deque: tasks created by a worker are pushed to and popped from the back of its deque,
+ * keeping recently touched data hot in its cache, while idle workers steal from the front of the others.
+ * Tasks submitted from outside the pool go to an extra shared deque.
+ * Workers are created once and live as long as the pool, so per frame work does not pay for thread creation.
+ */
+class ThreadPool
+{
+public:
+    /** Creates workersCount threads. With 0 workers every task is run by the calling thread. */
+    explicit ThreadPool(unsigned int workersCount = defaultWorkersCount());
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    inline std::size_t size() const { return _workers.size(); }
+
+    /** Enqueues a task, the returned future can be used to wait for it. */
+    std::future<void> submit(std::function<void()> task);
+
+    /** Enqueues a task without a future, as TaskGroup does */
+    void enqueue(std::function<void()> task);
+
+    /** Runs one pending task, if there is any, in the calling thread. Waits use it to help instead of blocking. */
+    bool tryRunPendingTask();
+
+    /** Splits [begin, end) in chunks of at least grainSize elements and calls function(chunkBegin, chunkEnd)
+     * for each of them. The calling thread also processes chunks, and it returns once all of them are done.
+     * It can be nested, i.e. called from a task running on this same pool.
+     */
+    void parallelFor(
+        std::size_t begin,
+        std::size_t end,
+        std::size_t grainSize,
+        const std::function<void(std::size_t, std::size_t)>& function);
+
+    static unsigned int defaultWorkersCount();
+
+private:
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(std::size_t workerIndex);
+    bool popOrSteal(std::size_t queueIndex, std::function<void()>& task);
+    std::size_t currentQueueIndex() const;
+
+    std::vector<std::thread> _workers;
+
+    /* One queue per worker plus the last one, shared by threads outside the pool */
+    std::vector<std::unique_ptr<WorkQueue>> _queues;
+
+    /* Tasks pushed and not yet taken, so idle workers know when to sleep */
+    std::atomic<std::size_t> _queuedTasks;
+    std::mutex _sleepMutex;
+    std::condition_variable _condition;
+    bool _stopping;
+};
+
+/** A set of tasks to wait for together. Tasks may add more tasks to the same group,
+ * so recursive algorithms can split their work as they go.
+ * wait runs pending tasks of the pool meanwhile, so it never blocks a worker.
+ */
+class TaskGroup
+{
+public:
+    explicit TaskGroup(ThreadPool& threadPool);
+
+    /** Waits for the remaining tasks */
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task);
+
+    /** Returns when every task is done. If some task threw, the first exception is rethrown here. */
+    void wait();
+
+private:
+    ThreadPool& _threadPool;
+    std::atomic<std::size_t> _pendingTasks;
+    std::mutex _exceptionMutex;
+    std::exception_ptr _exception;
+};
+
+/** Pool shared by the library algorithms, created on first use. */
+ThreadPool& defaultThreadPool();
+
+} // Grafica
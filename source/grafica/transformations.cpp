@@ -108,6 +108,11 @@ Matrix4f rotationA(Coord theta_radians, Vector3f axis)
         0,0,0,1).finished();
 }
 
+Matrix4f rotationQ(Quaternion const& rotation)
+{
+    return rotation.toMatrix4f();
+}
+
 Matrix4f translate(Coord tx, Coord ty, Coord tz)
 {
     return (Matrix4f() <<
@@ -206,5 +211,133 @@ Matrix4f lookAt(Vector3f const& eye, Vector3f const& at, Vector3f const& up)
             0,0,0,1).finished();
 }
 
+namespace
+{
+    /* The 3x3 rotation of rotationA */
+    Eigen::Matrix3f axisRotation(Coord theta_radians, Vector3f axis)
+    {
+        Coord s = std::sin(theta_radians);
+        Coord c = std::cos(theta_radians);
+
+        axis.normalize();
+
+        Coord x = axis[0];
+        Coord y = axis[1];
+        Coord z = axis[2];
+
+        return (Eigen::Matrix3f() <<
+            c + (1 - c) * x * x,     (1 - c) * x * y - s * z, (1 - c) * x * z + s * y,
+            (1 - c) * x * y + s * z, c + (1 - c) * y * y,     (1 - c) * y * z - s * x,
+            (1 - c) * x * z - s * y, (1 - c) * y * z + s * x, c + (1 - c) * z * z).finished();
+    }
+}
+
+AffineTransform affineIdentity()
+{
+    return AffineTransform();
+}
+
+AffineTransform affineUniformScale(Coord s)
+{
+    return affineScale(s, s, s);
+}
+
+AffineTransform affineScale(Coord sx, Coord sy, Coord sz)
+{
+    return AffineTransform((Matrix34f() <<
+        sx, 0, 0, 0,
+        0, sy, 0, 0,
+        0, 0, sz, 0).finished());
+}
+
+AffineTransform affineRotationX(Coord theta_radians)
+{
+    Coord sin_theta = std::sin(theta_radians);
+    Coord cos_theta = std::cos(theta_radians);
+
+    return AffineTransform((Matrix34f() <<
+        1,         0,          0, 0,
+        0, cos_theta, -sin_theta, 0,
+        0, sin_theta,  cos_theta, 0).finished());
+}
+
+AffineTransform affineRotationY(Coord theta_radians)
+{
+    Coord sin_theta = std::sin(theta_radians);
+    Coord cos_theta = std::cos(theta_radians);
+
+    return AffineTransform((Matrix34f() <<
+         cos_theta, 0, sin_theta, 0,
+                 0, 1,         0, 0,
+        -sin_theta, 0, cos_theta, 0).finished());
+}
+
+AffineTransform affineRotationZ(Coord theta_radians)
+{
+    Coord sin_theta = std::sin(theta_radians);
+    Coord cos_theta = std::cos(theta_radians);
+
+    return AffineTransform((Matrix34f() <<
+        cos_theta, -sin_theta, 0, 0,
+        sin_theta,  cos_theta, 0, 0,
+                0,          0, 1, 0).finished());
+}
+
+AffineTransform affineRotationA(Coord theta_radians, Vector3f axis)
+{
+    AffineTransform transform;
+    transform.matrix.leftCols<3>() = axisRotation(theta_radians, axis);
+    return transform;
+}
+
+AffineTransform affineTranslate(Coord tx, Coord ty, Coord tz)
+{
+    return AffineTransform((Matrix34f() <<
+        1, 0, 0, tx,
+        0, 1, 0, ty,
+        0, 0, 1, tz).finished());
+}
+
+AffineTransform translateRotateScale(Vector3f const& translation, Vector3f const& angles_radians, Vector3f const& scales)
+{
+    Coord sx = std::sin(angles_radians[0]), cx = std::cos(angles_radians[0]);
+    Coord sy = std::sin(angles_radians[1]), cy = std::cos(angles_radians[1]);
+    Coord sz = std::sin(angles_radians[2]), cz = std::cos(angles_radians[2]);
+
+    // rotationZ * rotationY * rotationX, each column multiplied by its scale
+    return AffineTransform((Matrix34f() <<
+        // First row
+        cz * cy * scales[0],
+        (cz * sy * sx - sz * cx) * scales[1],
+        (cz * sy * cx + sz * sx) * scales[2],
+        translation[0],
+        // Second row
+        sz * cy * scales[0],
+        (sz * sy * sx + cz * cx) * scales[1],
+        (sz * sy * cx - cz * sx) * scales[2],
+        translation[1],
+        // Third row
+        -sy * scales[0],
+        cy * sx * scales[1],
+        cy * cx * scales[2],
+        translation[2]).finished());
+}
+
+AffineTransform translateRotateScale(Vector3f const& translation, Coord theta_radians, Vector3f axis, Vector3f const& scales)
+{
+    AffineTransform transform;
+    transform.matrix.leftCols<3>() = axisRotation(theta_radians, axis) * scales.asDiagonal();
+    transform.matrix.col(3) = translation;
+    return transform;
+}
+
+AffineTransform translateRotateScale(Vector3f const& translation, Quaternion const& rotation, Vector3f const& scales)
+{
+    AffineTransform transform;
+    transform.matrix.leftCols<3>() = rotation.toMatrix3f() * scales.asDiagonal();
+    transform.matrix.col(3) = translation;
+    return transform;
+}
+
 } // Transformations
 } // Grafica
\ No newline at end of file
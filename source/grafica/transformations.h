@@ -10,6 +10,8 @@
 #pragma once
 
 #include "simple_eigen.h"
+#include "affine_transform.h"
+#include "quaternion.h"
 
 namespace Grafica
 {
@@ -30,6 +32,9 @@ Matrix4f rotationZ(Coord theta_radians);
 
 Matrix4f rotationA(Coord theta_radians, Vector3f axis);
 
+/* Same as rotationA(2 acos(w), (x, y, z)), without trigonometric functions */
+Matrix4f rotationQ(Quaternion const& rotation);
+
 Matrix4f translate(Coord tx, Coord ty, Coord tz);
 
 Matrix4f shearing(Coord xy, Coord yx, Coord xz, Coord zx, Coord yz, Coord zy);
@@ -42,5 +47,33 @@ Matrix4f ortho(Coord left, Coord right, Coord bottom, Coord top, Coord near, Coo
 
 Matrix4f lookAt(Vector3f const& eye, Vector3f const& at, Vector3f const& up);
 
+/* Affine versions of the transformations above, cheaper to store and compose.
+ * They are converted with toMatrix4f when uploading to OpenGL. */
+
+AffineTransform affineIdentity();
+
+AffineTransform affineUniformScale(Coord s);
+
+AffineTransform affineScale(Coord sx, Coord sy, Coord sz);
+
+AffineTransform affineRotationX(Coord theta_radians);
+
+AffineTransform affineRotationY(Coord theta_radians);
+
+AffineTransform affineRotationZ(Coord theta_radians);
+
+AffineTransform affineRotationA(Coord theta_radians, Vector3f axis);
+
+AffineTransform affineTranslate(Coord tx, Coord ty, Coord tz);
+
+/* translate * rotationZ * rotationY * rotationX * scale, written directly instead of with 4 products */
+AffineTransform translateRotateScale(Vector3f const& translation, Vector3f const& angles_radians, Vector3f const& scales);
+
+/* translate * rotationA * scale, written directly instead of with 2 products */
+AffineTransform translateRotateScale(Vector3f const& translation, Coord theta_radians, Vector3f axis, Vector3f const& scales);
+
+/* translate * rotationQ * scale, written directly instead of with 2 products */
+AffineTransform translateRotateScale(Vector3f const& translation, Quaternion const& rotation, Vector3f const& scales);
+
 } // Transformations
 } // Grafica
\ No newline at end of file
@@ -0,0 +1,655 @@
+/**
+ * @file triangle_bvh.cpp
+ * @brief Bounding volume hierarchy over the triangles of a mesh, built with binned SAH in parallel,
+ *        for ray casts, line of sight checks and overlap queries without testing every triangle.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#include "triangle_bvh.h"
+
+#include <bit>
+#include <cmath>
+#include <atomic>
+#include <cassert>
+#include <numeric>
+#include <algorithm>
+#include <ciso646>
+#include "simd.h"
+
+namespace Grafica
+{
+
+namespace
+{
+    /* Subtrees with more triangles are built as separate tasks */
+    constexpr std::uint32_t PARALLEL_BUILD_THRESHOLD = 4096;
+
+    /* Cost of visiting a node relative to testing a triangle */
+    constexpr float TRAVERSAL_COST = 1.0f;
+
+    /* A far child is pushed at most once per level of the path to a leaf */
+    constexpr unsigned int STACK_SIZE = TriangleBVH::MAX_DEPTH;
+
+    float surfaceArea(const AABB& aabb)
+    {
+        if (aabb.isEmpty())
+            return 0;
+
+        Vector3f const size = aabb.max - aabb.min;
+        return 2 * (size[0] * size[1] + size[1] * size[2] + size[2] * size[0]);
+    }
+
+    /* What traversal needs from a ray, computed once */
+    struct PreparedRay
+    {
+        alignas(16) float origin[4];
+        alignas(16) float inverseDirection[4];
+        float direction[3];
+    };
+
+    PreparedRay prepareRay(const Ray& ray)
+    {
+        PreparedRay prepared{};
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+            // A tiny component instead of zero keeps infinities away from 0 * inf in the slab test
+            float const direction = ray.direction[axis];
+            float const safeDirection = std::abs(direction) > 1e-30f ? direction : std::copysign(1e-30f, direction);
+
+            prepared.origin[axis] = ray.origin[axis];
+            prepared.inverseDirection[axis] = 1 / safeDirection;
+            prepared.direction[axis] = direction;
+        }
+
+        return prepared;
+    }
+
+    /* Distance where the ray enters the node, or infinity if it misses it before maxDistance */
+    inline float boxEntry(const BVHNode& node, const PreparedRay& ray, float maxDistance)
+    {
+#if defined(GRAFICA_USE_SSE2)
+        // The 4th lane holds the integers of the node, it is replaced by 0 for the entry and maxDistance for the exit
+        __m128 const lanes = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+        __m128 const origin = _mm_load_ps(ray.origin);
+        __m128 const inverseDirection = _mm_load_ps(ray.inverseDirection);
+
+        __m128 const t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.min), origin), inverseDirection);
+        __m128 const t2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.max), origin), inverseDirection);
+
+        __m128 near = _mm_and_ps(lanes, _mm_min_ps(t1, t2));
+        __m128 far = _mm_or_ps(_mm_and_ps(lanes, _mm_max_ps(t1, t2)), _mm_andnot_ps(lanes, _mm_set1_ps(maxDistance)));
+
+        near = _mm_max_ps(near, _mm_shuffle_ps(near, near, _MM_SHUFFLE(2, 3, 0, 1)));
+        near = _mm_max_ps(near, _mm_shuffle_ps(near, near, _MM_SHUFFLE(1, 0, 3, 2)));
+        far = _mm_min_ps(far, _mm_shuffle_ps(far, far, _MM_SHUFFLE(2, 3, 0, 1)));
+        far = _mm_min_ps(far, _mm_shuffle_ps(far, far, _MM_SHUFFLE(1, 0, 3, 2)));
+
+        float const entry = _mm_cvtss_f32(near);
+        return entry <= _mm_cvtss_f32(far) ? entry : std::numeric_limits<float>::infinity();
+#else
+        float entry = 0;
+        float exit = maxDistance;
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+            float const t1 = (node.min[axis] - ray.origin[axis]) * ray.inverseDirection[axis];
+            float const t2 = (node.max[axis] - ray.origin[axis]) * ray.inverseDirection[axis];
+            entry = std::max(entry, std::min(t1, t2));
+            exit = std::min(exit, std::max(t1, t2));
+        }
+        return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+#endif
+    }
+
+    bool overlaps(const BVHNode& node, const AABB& aabb)
+    {
+        for (unsigned int axis = 0; axis < 3; ++axis)
+            if (node.min[axis] > aabb.max[axis] or aabb.min[axis] > node.max[axis])
+                return false;
+        return true;
+    }
+}
+
+struct TriangleBVH::BuildContext
+{
+    const std::vector<AABB>& bounds;
+    const std::vector<Vector3f>& centroids;
+    std::atomic<std::uint32_t> nodesUsed;
+    TaskGroup* taskGroupPtr;
+};
+
+TriangleBVH::TriangleBVH(const Shape& shape, ThreadPool& threadPool)
+{
+    build(shape, threadPool);
+}
+
+namespace
+{
+    std::vector<Vector3f> shapePositions(const Shape& shape)
+    {
+        assert(shape.stride >= 3);
+
+        std::vector<Vector3f> positions;
+        positions.reserve(shape.vertices.size() / shape.stride);
+        for (std::size_t i = 0; i + 2 < shape.vertices.size(); i += shape.stride)
+            positions.push_back(Vector3f(shape.vertices[i], shape.vertices[i + 1], shape.vertices[i + 2]));
+
+        return positions;
+    }
+}
+
+void TriangleBVH::build(const Shape& shape, ThreadPool& threadPool)
+{
+    build(shapePositions(shape), shape.indices, threadPool);
+}
+
+void TriangleBVH::build(const std::vector<Vector3f>& positions, const Indices& indices, ThreadPool& threadPool)
+{
+    _indices = indices;
+    std::uint32_t const trianglesCount = static_cast<std::uint32_t>(indices.size() / 3);
+
+    _triangleIds.resize(trianglesCount);
+    std::iota(_triangleIds.begin(), _triangleIds.end(), 0);
+
+    std::vector<AABB> bounds(trianglesCount);
+    std::vector<Vector3f> centroids(trianglesCount);
+    threadPool.parallelFor(0, trianglesCount, PARALLEL_BUILD_THRESHOLD, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t triangle = begin; triangle < end; ++triangle)
+        {
+            AABB box = AABB::empty();
+            for (unsigned int corner = 0; corner < 3; ++corner)
+                box.extend(positions[indices[3 * triangle + corner]]);
+
+            bounds[triangle] = box;
+            centroids[triangle] = box.center();
+        }
+    });
+
+    // A binary tree with n leaves at most has 2n - 1 nodes
+    _nodes.assign(std::max(2 * trianglesCount, 1u), BVHNode{});
+
+    if (trianglesCount == 0)
+    {
+        _nodes.clear();
+    }
+    else
+    {
+        TaskGroup taskGroup(threadPool);
+        BuildContext context{bounds, centroids, {1}, &taskGroup};
+        buildNode(0, 0, trianglesCount, 0, context);
+        taskGroup.wait();
+
+        _nodes.resize(context.nodesUsed.load());
+    }
+
+    gatherTriangles(positions, threadPool);
+}
+
+void TriangleBVH::buildNode(std::uint32_t nodeIndex, std::uint32_t first, std::uint32_t count, unsigned int depth, BuildContext& context)
+{
+    std::uint32_t* ids = _triangleIds.data() + first;
+
+    AABB bounds = AABB::empty();
+    AABB centroidBounds = AABB::empty();
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        bounds.extend(context.bounds[ids[i]]);
+        centroidBounds.extend(context.centroids[ids[i]]);
+    }
+
+    BVHNode& node = _nodes[nodeIndex];
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+        node.min[axis] = bounds.min[axis];
+        node.max[axis] = bounds.max[axis];
+    }
+
+    auto makeLeaf = [&]()
+    {
+        node.leftOrFirst = first;
+        node.count = count;
+    };
+
+    if (count <= 2)
+    {
+        makeLeaf();
+        return;
+    }
+
+    // Median splits shrink bit_width(count - 1) by one per level, and it reaches 1 at count 2, which is a leaf.
+    // Once the depth left is just enough for them, SAH is dropped so skewed meshes never exceed MAX_DEPTH.
+    bool const medianOnly = depth + std::bit_width(count - 1) >= MAX_DEPTH;
+
+    // Binned SAH: triangles are grouped by centroid in a few bins per axis, and only bin boundaries are tried
+    float bestCost = std::numeric_limits<float>::infinity();
+    int bestAxis = -1;
+    unsigned int bestSplit = 0;
+
+    for (unsigned int axis = 0; axis < 3 and not medianOnly; ++axis)
+    {
+        float const extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+        if (extent <= 0)
+            continue;
+
+        float const scale = BINS / extent;
+        AABB binBounds[BINS];
+        std::uint32_t binCounts[BINS] = {};
+        std::fill(std::begin(binBounds), std::end(binBounds), AABB::empty());
+
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            unsigned int const bin = std::min(BINS - 1, unsigned((context.centroids[ids[i]][axis] - centroidBounds.min[axis]) * scale));
+            binCounts[bin] += 1;
+            binBounds[bin].extend(context.bounds[ids[i]]);
+        }
+
+        // Sweeping from the left, then from the right evaluating each split
+        float leftAreas[BINS - 1];
+        std::uint32_t leftCounts[BINS - 1];
+        AABB accumulated = AABB::empty();
+        std::uint32_t accumulatedCount = 0;
+        for (unsigned int split = 0; split + 1 < BINS; ++split)
+        {
+            accumulated.extend(binBounds[split]);
+            accumulatedCount += binCounts[split];
+            leftAreas[split] = surfaceArea(accumulated);
+            leftCounts[split] = accumulatedCount;
+        }
+
+        accumulated = AABB::empty();
+        accumulatedCount = 0;
+        for (unsigned int split = BINS - 1; split > 0; --split)
+        {
+            accumulated.extend(binBounds[split]);
+            accumulatedCount += binCounts[split];
+
+            if (leftCounts[split - 1] == 0 or accumulatedCount == 0)
+                continue;
+
+            float const cost = leftAreas[split - 1] * leftCounts[split - 1] + surfaceArea(accumulated) * accumulatedCount;
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = static_cast<int>(axis);
+                bestSplit = split - 1;
+            }
+        }
+    }
+
+    float const area = surfaceArea(bounds);
+    float const leafCost = area * count;
+    float const splitCost = area * TRAVERSAL_COST + bestCost;
+
+    if (count <= MAX_LEAF_SIZE and not medianOnly and (bestAxis < 0 or leafCost <= splitCost))
+    {
+        makeLeaf();
+        return;
+    }
+
+    std::uint32_t leftCount = 0;
+    if (bestAxis >= 0)
+    {
+        unsigned int const axis = static_cast<unsigned int>(bestAxis);
+        float const scale = BINS / (centroidBounds.max[axis] - centroidBounds.min[axis]);
+        float const minimum = centroidBounds.min[axis];
+
+        std::uint32_t* middle = std::partition(ids, ids + count, [&](std::uint32_t id)
+        {
+            return std::min(BINS - 1, unsigned((context.centroids[id][axis] - minimum) * scale)) <= bestSplit;
+        });
+        leftCount = static_cast<std::uint32_t>(middle - ids);
+    }
+
+    // Identical centroids, too many triangles for a leaf with no good split, or too deep: halves along the longest axis
+    if (leftCount == 0 or leftCount == count)
+    {
+        unsigned int axis = 0;
+        (bounds.max - bounds.min).maxCoeff(&axis);
+
+        leftCount = count / 2;
+        std::nth_element(ids, ids + leftCount, ids + count, [&](std::uint32_t lhs, std::uint32_t rhs)
+        {
+            return context.centroids[lhs][axis] < context.centroids[rhs][axis];
+        });
+    }
+
+    std::uint32_t const left = context.nodesUsed.fetch_add(2);
+    node.leftOrFirst = left;
+    node.count = 0;
+
+    if (count > PARALLEL_BUILD_THRESHOLD)
+    {
+        context.taskGroupPtr->run([this, left, first, leftCount, depth, &context]()
+        {
+            buildNode(left, first, leftCount, depth + 1, context);
+        });
+    }
+    else
+    {
+        buildNode(left, first, leftCount, depth + 1, context);
+    }
+
+    buildNode(left + 1, first + leftCount, count - leftCount, depth + 1, context);
+}
+
+void TriangleBVH::gatherTriangles(const std::vector<Vector3f>& positions, ThreadPool& threadPool)
+{
+    std::size_t const trianglesCount = _triangleIds.size();
+
+    // Zeros in the padding are degenerate triangles, which are never hit
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+        _v0[axis].assign(trianglesCount + 3, 0.0f);
+        _edge1[axis].assign(trianglesCount + 3, 0.0f);
+        _edge2[axis].assign(trianglesCount + 3, 0.0f);
+    }
+
+    threadPool.parallelFor(0, trianglesCount, PARALLEL_BUILD_THRESHOLD, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            std::uint32_t const triangle = _triangleIds[i];
+            Vector3f const& a = positions[_indices[3 * triangle]];
+            Vector3f const& b = positions[_indices[3 * triangle + 1]];
+            Vector3f const& c = positions[_indices[3 * triangle + 2]];
+
+            for (unsigned int axis = 0; axis < 3; ++axis)
+            {
+                _v0[axis][i] = a[axis];
+                _edge1[axis][i] = b[axis] - a[axis];
+                _edge2[axis][i] = c[axis] - a[axis];
+            }
+        }
+    });
+}
+
+void TriangleBVH::refit(const Shape& shape, ThreadPool& threadPool)
+{
+    refit(shapePositions(shape), threadPool);
+}
+
+void TriangleBVH::refit(const std::vector<Vector3f>& positions, ThreadPool& threadPool)
+{
+    gatherTriangles(positions, threadPool);
+    refitNodes();
+}
+
+void TriangleBVH::refitNodes()
+{
+    // Children are always stored after their parent, so a backwards sweep sees them first
+    for (std::size_t index = _nodes.size(); index-- > 0;)
+    {
+        BVHNode& node = _nodes[index];
+        AABB bounds = AABB::empty();
+
+        if (node.isLeaf())
+        {
+            for (std::uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+            {
+                Vector3f const v0(_v0[0][i], _v0[1][i], _v0[2][i]);
+                bounds.extend(v0);
+                bounds.extend(v0 + Vector3f(_edge1[0][i], _edge1[1][i], _edge1[2][i]));
+                bounds.extend(v0 + Vector3f(_edge2[0][i], _edge2[1][i], _edge2[2][i]));
+            }
+        }
+        else
+        {
+            for (std::uint32_t child = node.leftOrFirst; child < node.leftOrFirst + 2; ++child)
+            {
+                bounds.extend(Vector3f(_nodes[child].min[0], _nodes[child].min[1], _nodes[child].min[2]));
+                bounds.extend(Vector3f(_nodes[child].max[0], _nodes[child].max[1], _nodes[child].max[2]));
+            }
+        }
+
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+            node.min[axis] = bounds.min[axis];
+            node.max[axis] = bounds.max[axis];
+        }
+    }
+}
+
+template <bool ANY_HIT>
+bool TriangleBVH::traverse(const Ray& ray, Coord maxDistance, TriangleHit& hit) const
+{
+    if (_nodes.empty())
+        return false;
+
+    PreparedRay const prepared = prepareRay(ray);
+    float closest = maxDistance;
+    bool found = false;
+
+    // Möller-Trumbore against the triangles of a leaf, 4 at a time
+    auto intersectLeaf = [&](const BVHNode& leaf)
+    {
+        std::uint32_t const end = leaf.leftOrFirst + leaf.count;
+        for (std::uint32_t base = leaf.leftOrFirst; base < end; base += 4)
+        {
+            alignas(16) float distances[4], us[4], vs[4];
+            int hitMask = 0;
+
+#if defined(GRAFICA_USE_SSE2)
+            __m128 const dx = _mm_set1_ps(prepared.direction[0]);
+            __m128 const dy = _mm_set1_ps(prepared.direction[1]);
+            __m128 const dz = _mm_set1_ps(prepared.direction[2]);
+
+            __m128 const e1x = _mm_loadu_ps(_edge1[0].data() + base);
+            __m128 const e1y = _mm_loadu_ps(_edge1[1].data() + base);
+            __m128 const e1z = _mm_loadu_ps(_edge1[2].data() + base);
+            __m128 const e2x = _mm_loadu_ps(_edge2[0].data() + base);
+            __m128 const e2y = _mm_loadu_ps(_edge2[1].data() + base);
+            __m128 const e2z = _mm_loadu_ps(_edge2[2].data() + base);
+
+            // p = direction x edge2
+            __m128 const px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+            __m128 const py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+            __m128 const pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+            __m128 const determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+            __m128 const inverse = _mm_div_ps(_mm_set1_ps(1), determinant);
+
+            __m128 const tx = _mm_sub_ps(_mm_set1_ps(prepared.origin[0]), _mm_loadu_ps(_v0[0].data() + base));
+            __m128 const ty = _mm_sub_ps(_mm_set1_ps(prepared.origin[1]), _mm_loadu_ps(_v0[1].data() + base));
+            __m128 const tz = _mm_sub_ps(_mm_set1_ps(prepared.origin[2]), _mm_loadu_ps(_v0[2].data() + base));
+
+            __m128 const u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), inverse);
+
+            // q = t x edge1
+            __m128 const qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+            __m128 const qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+            __m128 const qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+
+            __m128 const v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverse);
+            __m128 const t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverse);
+
+            // Comparisons with NaN are false, so degenerate triangles drop out here
+            __m128 const zero = _mm_setzero_ps();
+            __m128 const valid = _mm_cmplt_ps(_mm_setr_ps(0, 1, 2, 3), _mm_set1_ps(float(end - base)));
+            __m128 mask = _mm_and_ps(valid, _mm_cmpneq_ps(determinant, zero));
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+            mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1)));
+            mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, zero));
+            mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(closest)));
+
+            hitMask = _mm_movemask_ps(mask);
+            if (hitMask == 0)
+                continue;
+
+            _mm_store_ps(distances, t);
+            _mm_store_ps(us, u);
+            _mm_store_ps(vs, v);
+#else
+            for (unsigned int lane = 0; lane < 4 and base + lane < end; ++lane)
+            {
+                std::uint32_t const i = base + lane;
+                Vector3f const direction(prepared.direction[0], prepared.direction[1], prepared.direction[2]);
+                Vector3f const edge1(_edge1[0][i], _edge1[1][i], _edge1[2][i]);
+                Vector3f const edge2(_edge2[0][i], _edge2[1][i], _edge2[2][i]);
+
+                Vector3f const p = direction.cross(edge2);
+                float const determinant = edge1.dot(p);
+                if (determinant == 0)
+                    continue;
+
+                float const inverse = 1 / determinant;
+                Vector3f const t = Vector3f(prepared.origin[0] - _v0[0][i], prepared.origin[1] - _v0[1][i], prepared.origin[2] - _v0[2][i]);
+                float const u = t.dot(p) * inverse;
+                Vector3f const q = t.cross(edge1);
+                float const v = direction.dot(q) * inverse;
+                float const distance = edge2.dot(q) * inverse;
+
+                if (u >= 0 and v >= 0 and u + v <= 1 and distance > 0 and distance < closest)
+                {
+                    distances[lane] = distance;
+                    us[lane] = u;
+                    vs[lane] = v;
+                    hitMask |= 1 << lane;
+                }
+            }
+#endif
+
+            for (unsigned int lane = 0; lane < 4; ++lane)
+            {
+                if ((hitMask & (1 << lane)) == 0 or distances[lane] >= closest)
+                    continue;
+
+                closest = distances[lane];
+                hit = {_triangleIds[base + lane], distances[lane], us[lane], vs[lane]};
+                found = true;
+            }
+        }
+    };
+
+    if (boxEntry(_nodes[0], prepared, closest) == std::numeric_limits<float>::infinity())
+        return false;
+
+    struct Pending
+    {
+        std::uint32_t node;
+        float entry;
+    };
+
+    Pending stack[STACK_SIZE];
+    unsigned int stackSize = 0;
+    std::uint32_t current = 0;
+
+    while (true)
+    {
+        BVHNode const& node = _nodes[current];
+
+        if (node.isLeaf())
+        {
+            intersectLeaf(node);
+            if (ANY_HIT and found)
+                return true;
+        }
+        else
+        {
+            // Nearest child first, the other one waits with its entry distance
+            std::uint32_t near = node.leftOrFirst;
+            std::uint32_t far = node.leftOrFirst + 1;
+            float nearEntry = boxEntry(_nodes[near], prepared, closest);
+            float farEntry = boxEntry(_nodes[far], prepared, closest);
+
+            if (farEntry < nearEntry)
+            {
+                std::swap(near, far);
+                std::swap(nearEntry, farEntry);
+            }
+
+            if (nearEntry != std::numeric_limits<float>::infinity())
+            {
+                if (farEntry != std::numeric_limits<float>::infinity())
+                {
+                    assert(stackSize < STACK_SIZE);
+                    stack[stackSize++] = {far, farEntry};
+                }
+
+                current = near;
+                continue;
+            }
+        }
+
+        // Next pending node still in front of the closest hit
+        bool next = false;
+        while (stackSize > 0)
+        {
+            Pending const pending = stack[--stackSize];
+            if (pending.entry < closest)
+            {
+                current = pending.node;
+                next = true;
+                break;
+            }
+        }
+
+        if (not next)
+            break;
+    }
+
+    return found;
+}
+
+std::optional<TriangleHit> TriangleBVH::intersect(const Ray& ray, Coord maxDistance) const
+{
+    TriangleHit hit{};
+    if (traverse<false>(ray, maxDistance, hit))
+        return hit;
+
+    return std::nullopt;
+}
+
+bool TriangleBVH::occluded(const Ray& ray, Coord maxDistance) const
+{
+    TriangleHit hit{};
+    return traverse<true>(ray, maxDistance, hit);
+}
+
+void TriangleBVH::queryAABB(const AABB& aabb, std::vector<std::uint32_t>& result) const
+{
+    if (_nodes.empty())
+        return;
+
+    std::vector<std::uint32_t> pending = {0};
+    while (not pending.empty())
+    {
+        BVHNode const& node = _nodes[pending.back()];
+        pending.pop_back();
+
+        if (not overlaps(node, aabb))
+            continue;
+
+        if (not node.isLeaf())
+        {
+            pending.push_back(node.leftOrFirst);
+            pending.push_back(node.leftOrFirst + 1);
+            continue;
+        }
+
+        for (std::uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+        {
+            Vector3f const v0(_v0[0][i], _v0[1][i], _v0[2][i]);
+            AABB triangleBounds = AABB::empty();
+            triangleBounds.extend(v0);
+            triangleBounds.extend(v0 + Vector3f(_edge1[0][i], _edge1[1][i], _edge1[2][i]));
+            triangleBounds.extend(v0 + Vector3f(_edge2[0][i], _edge2[1][i], _edge2[2][i]));
+
+            if ((triangleBounds.min.array() <= aabb.max.array()).all() and (aabb.min.array() <= triangleBounds.max.array()).all())
+                result.push_back(_triangleIds[i]);
+        }
+    }
+}
+
+AABB TriangleBVH::bounds() const
+{
+    if (_nodes.empty())
+        return AABB::empty();
+
+    BVHNode const& root = _nodes[0];
+    return {Vector3f(root.min[0], root.min[1], root.min[2]), Vector3f(root.max[0], root.max[1], root.max[2])};
+}
+
+} // Grafica
@@ -0,0 +1,113 @@
+/**
+ * @file triangle_bvh.h
+ * @brief Bounding volume hierarchy over the triangles of a mesh, built with binned SAH in parallel,
+ *        for ray casts, line of sight checks and overlap queries without testing every triangle.
+ *
+ * @author Daniel Calderón
+ * @license MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <optional>
+#include "bounds.h"
+#include "shape.h"
+#include "simple_eigen.h"
+#include "thread_pool.h"
+
+namespace Grafica
+{
+
+/** 32 bytes, two per cache line. Inner nodes have count 0 and their children at leftOrFirst and leftOrFirst + 1;
+ * leaves have count triangles starting at leftOrFirst, in leaf order.
+ */
+struct alignas(32) BVHNode
+{
+    float min[3];
+    std::uint32_t leftOrFirst;
+    float max[3];
+    std::uint32_t count;
+
+    inline bool isLeaf() const { return count != 0; }
+};
+
+static_assert(sizeof(BVHNode) == 32, "BVHNode is meant to be 32 bytes");
+
+struct TriangleHit
+{
+    /** Index of the triangle in the mesh, i.e. its first index is indices[3 * triangle] */
+    std::uint32_t triangle;
+    Coord distance;
+
+    /** Barycentric coordinates of the hit, relative to the second and third vertices */
+    Coord u, v;
+};
+
+class TriangleBVH
+{
+public:
+    TriangleBVH() = default;
+
+    /** Positions are the first 3 coordinates of each vertex, every 3 indices are a triangle */
+    explicit TriangleBVH(const Shape& shape, ThreadPool& threadPool = defaultThreadPool());
+
+    void build(const Shape& shape, ThreadPool& threadPool = defaultThreadPool());
+
+    void build(const std::vector<Vector3f>& positions, const Indices& indices, ThreadPool& threadPool = defaultThreadPool());
+
+    /** Updates the bounds after the vertices moved, keeping the tree. Much cheaper than a build,
+     * but queries slow down as the deformation departs from the pose it was built with.
+     */
+    void refit(const Shape& shape, ThreadPool& threadPool = defaultThreadPool());
+
+    void refit(const std::vector<Vector3f>& positions, ThreadPool& threadPool = defaultThreadPool());
+
+    /** Closest hit, both sides of the triangles count */
+    std::optional<TriangleHit> intersect(const Ray& ray, Coord maxDistance = std::numeric_limits<Coord>::infinity()) const;
+
+    /** Whether anything is hit before maxDistance, stopping at the first hit. For shadows and line of sight. */
+    bool occluded(const Ray& ray, Coord maxDistance = std::numeric_limits<Coord>::infinity()) const;
+
+    /** Triangles whose bounds overlap the box, appended to result. Candidates for an exact collision test. */
+    void queryAABB(const AABB& aabb, std::vector<std::uint32_t>& result) const;
+
+    AABB bounds() const;
+
+    inline std::size_t trianglesCount() const { return _triangleIds.size(); }
+
+    inline const std::vector<BVHNode>& nodes() const { return _nodes; }
+
+    /** Mesh triangle of each position in leaf order */
+    inline const std::vector<std::uint32_t>& triangleIds() const { return _triangleIds; }
+
+    static constexpr unsigned int BINS = 16;
+    static constexpr unsigned int MAX_LEAF_SIZE = 8;
+
+    /** No leaf is deeper than this, so traversal fits in a fixed stack. Subtrees that would go deeper are split at the median. */
+    static constexpr unsigned int MAX_DEPTH = 64;
+
+private:
+    struct BuildContext;
+
+    void buildNode(std::uint32_t nodeIndex, std::uint32_t first, std::uint32_t count, unsigned int depth, BuildContext& context);
+    void gatherTriangles(const std::vector<Vector3f>& positions, ThreadPool& threadPool);
+    void refitNodes();
+
+    template <bool ANY_HIT>
+    bool traverse(const Ray& ray, Coord maxDistance, TriangleHit& hit) const;
+
+    std::vector<BVHNode> _nodes;
+    std::vector<std::uint32_t> _triangleIds;
+    Indices _indices;
+
+    /* Triangles in leaf order as structure of arrays: first vertex and both edges from it.
+     * Padded so leaves are tested 4 triangles at a time without reading past the end. */
+    std::vector<float> _v0[3];
+    std::vector<float> _edge1[3];
+    std::vector<float> _edge2[3];
+};
+
+} // Grafica